@@ -29,36 +29,25 @@
 
 // ----------------------------------------------------------
 
-static const int CACHE_SIZE = 32;
-static const int BLOCK_SIZE = (64 * 1024) - 8;
-
-// ----------------------------------------------------------
-
-#ifdef _WIN32
-#pragma pack(push, 1)
-#else
-#pragma pack(1)
-#endif // _WIN32
-
-struct Block {
-     unsigned nr;
-     unsigned next;
-     uint8_t *data;
-};
-
-#ifdef _WIN32
-#pragma pack(pop)
-#else
-#pragma pack()
-#endif // _WIN32
-
-// ----------------------------------------------------------
-
+/**
+Swap storage of the pages modified in a multipage bitmap.
+
+Each file (i.e. an encoded page) is stored contiguously in an arena of reserved address space, 
+committed as it grows : an anonymous mapping when the cache is kept in memory, a sparse memory 
+mapped file otherwise (on Windows, the arena is always backed by the system paging file). 
+Files are referenced by their index in an extent table, so that reading a file is a single memcpy 
+(or no copy at all, see viewFile) and the space of deleted files is reused by the next writes.
+*/
 class CacheFile {
-	typedef std::list<Block *> PageCache;
-	typedef std::list<Block *>::iterator PageCacheIt;
-	typedef std::map<int, PageCacheIt> PageMap;
-	typedef std::map<int, PageCacheIt>::iterator PageMapIt;
+	/** Location of a file in the arena */
+	struct Extent {
+		//! offset of the extent in the arena, in bytes
+		size_t offset;
+		//! size of the extent, in bytes (a multiple of the arena granularity)
+		size_t capacity;
+		//! size of the file, in bytes (-1 if the extent table entry is unused)
+		int size;
+	};
 
 public :
 	CacheFile();
@@ -71,23 +60,40 @@ public :
 	int writeFile(uint8_t *data, int size);
 	void deleteFile(int nr);
 
+	/**
+	Get a read-only view of a file. 
+	The view remains valid until the file is deleted or the cache is closed.
+	@param nr File reference returned by writeFile
+	@param size Receives the size of the file, in bytes
+	@return Returns a pointer to the file data, or nullptr if nr is not a valid reference
+	*/
+	const uint8_t *viewFile(int nr, int *size) const;
+
 private :
-	void cleanupMemCache();
-	int allocateBlock();
-	Block *lockBlock(int nr);
-	BOOL unlockBlock(int nr);
-	BOOL deleteBlock(int nr);
+	BOOL reserveArena();
+	BOOL growArena(size_t size);
+	void discardArena(size_t offset, size_t size);
+	BOOL allocateExtent(size_t capacity, size_t *offset);
 
 private :
-	FILE *m_file;
 	std::string m_filename;
-	std::list<int> m_free_pages;
-	PageCache m_page_cache_mem;
-	PageCache m_page_cache_disk;
-	PageMap m_page_map;
-	int m_page_count;
-	Block *m_current_block;
 	BOOL m_keep_in_memory;
+	//! descriptor of the mapped file (file backed arena only), -1 otherwise
+	int m_fd;
+	//! first byte of the arena
+	uint8_t *m_base;
+	//! size of the reserved address space
+	size_t m_reserved;
+	//! size of the accessible part of the arena
+	size_t m_committed;
+	//! end of the last extent
+	size_t m_used;
+	//! extent table, indexed by file reference
+	std::vector<Extent> m_extents;
+	//! unused entries of the extent table
+	std::vector<int> m_free_refs;
+	//! free extents between the files (offset, capacity), sorted by offset, adjacent extents are merged
+	std::vector<std::pair<size_t, size_t> > m_free_space;
 };
 
 #endif // FREEIMAGE_CACHEFILE_H
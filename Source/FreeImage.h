@@ -137,6 +137,8 @@
 
 FI_STRUCT (FIBITMAP) { void *data; };
 FI_STRUCT (FIMULTIBITMAP) { void *data; };
+FI_STRUCT (FIRESCALER) { void *data; };
+FI_STRUCT (FISCANLINEREADER) { void *data; };
 
 // Types used in the library (directly copied from Windows) -----------------
 
@@ -591,6 +593,8 @@ typedef unsigned (DLL_CALLCONV *FI_ReadProc) (void *buffer, unsigned size, unsig
 typedef unsigned (DLL_CALLCONV *FI_WriteProc) (void *buffer, unsigned size, unsigned count, fi_handle handle);
 typedef int (DLL_CALLCONV *FI_SeekProc) (fi_handle handle, long offset, int origin);
 typedef long (DLL_CALLCONV *FI_TellProc) (fi_handle handle);
+typedef int (DLL_CALLCONV *FI_Seek64Proc) (fi_handle handle, int64_t offset, int origin);
+typedef int64_t (DLL_CALLCONV *FI_Tell64Proc) (fi_handle handle);
 
 #if defined(_WIN32)
 #pragma pack(push, 1)
@@ -605,6 +609,17 @@ FI_STRUCT(FreeImageIO) {
     FI_TellProc  tell_proc;     //! pointer to the function used to aquire the current position
 };
 
+/**
+I/O functions with 64-bit offsets, used to load or save streams larger than 2 GB 
+(see FreeImage_LoadFromHandle64, FreeImage_SaveToHandle64)
+*/
+FI_STRUCT(FreeImageIO64) {
+	FI_ReadProc   read_proc;	//! pointer to the function used to read data
+	FI_WriteProc  write_proc;	//! pointer to the function used to write data
+	FI_Seek64Proc seek_proc;	//! pointer to the function used to seek
+	FI_Tell64Proc tell_proc;	//! pointer to the function used to aquire the current position
+};
+
 #if defined(_WIN32) 
 #pragma pack(pop)
 #else
@@ -616,6 +631,14 @@ Handle to a memory I/O stream
 */
 FI_STRUCT (FIMEMORY) { void *data; };
 
+/**
+Segment of a memory I/O stream (see FreeImage_AcquireMemorySegments)
+*/
+FI_STRUCT (FIMEMORYSEGMENT) { 
+	uint8_t *data;		//! start of the segment
+	uint32_t size;		//! size of the segment in bytes
+};
+
 #endif // FREEIMAGE_IO
 
 // Plugin routines ----------------------------------------------------------
@@ -639,6 +662,44 @@ typedef BOOL (DLL_CALLCONV *FI_SupportsExportBPPProc)(int bpp);
 typedef BOOL (DLL_CALLCONV *FI_SupportsExportTypeProc)(FREE_IMAGE_TYPE type);
 typedef BOOL (DLL_CALLCONV *FI_SupportsICCProfilesProc)(void);
 typedef BOOL (DLL_CALLCONV *FI_SupportsNoPixelsProc)(void);
+typedef FIBITMAP *(DLL_CALLCONV *FI_LoadRegionProc)(FreeImageIO *io, fi_handle handle, int page, int left, int top, int right, int bottom, int flags, void *data);
+
+/**
+Magic signature of a file format, matched against the first bytes of a stream (see FreeImage_GetFileTypeFromHandle). 
+The stream matches when (byte[offset + i] & mask[i]) == magic[i] for each i in [0, length), 
+a nullptr mask compares all the bits.
+*/
+FI_STRUCT (FISIGNATURE) {
+	unsigned offset;		//! position of the signature from the start of the stream
+	unsigned length;		//! length of the signature in bytes
+	const uint8_t *magic;	//! signature bytes
+	const uint8_t *mask;	//! optional mask applied to the stream bytes before the comparison
+};
+
+typedef const FISIGNATURE *(DLL_CALLCONV *FI_SignatureProc)(int *count);
+
+/**
+Copy a page of an opened source into an opened destination of the same format without decoding it. 
+Returns FALSE when the page cannot be copied as is (nothing has been written), the caller then loads and saves the page.
+*/
+typedef BOOL (DLL_CALLCONV *FI_CopyPageProc)(FreeImageIO *src_io, fi_handle src_handle, int src_page, void *src_data, FreeImageIO *io, fi_handle handle, int page, int flags, void *data);
+
+/**
+Row by row decoding (see FreeImage_OpenScanlineReader). 
+FI_OpenScanlineReaderProc reads the file header and returns the plugin reader state (nullptr on error), 
+with a header only bitmap describing the decoded rows. 
+FI_ReadNextScanlineProc decodes the next row, from the top of the image, in the pixel layout of the header bitmap. 
+FI_CloseScanlineReaderProc frees the reader state (the header bitmap is owned by the caller).
+*/
+typedef void *(DLL_CALLCONV *FI_OpenScanlineReaderProc)(FreeImageIO *io, fi_handle handle, int page, int flags, void *data, FIBITMAP **header);
+typedef BOOL (DLL_CALLCONV *FI_ReadNextScanlineProc)(void *reader, uint8_t *bits);
+typedef void (DLL_CALLCONV *FI_CloseScanlineReaderProc)(void *reader);
+
+/**
+Returns TRUE when the data opened for reading by FI_OpenProc may be kept by a multipage bitmap for its whole lifetime 
+and given to every page load, so that the plugin can keep decoding state from one page to the next.
+*/
+typedef BOOL (DLL_CALLCONV *FI_SupportsPersistentDataProc)(void);
 
 FI_STRUCT (Plugin) {
 	FI_FormatProc format_proc;
@@ -657,6 +718,13 @@ FI_STRUCT (Plugin) {
 	FI_SupportsExportTypeProc supports_export_type_proc;
 	FI_SupportsICCProfilesProc supports_icc_profiles_proc;
 	FI_SupportsNoPixelsProc supports_no_pixels_proc;
+	FI_LoadRegionProc load_region_proc;
+	FI_SignatureProc signature_proc;
+	FI_CopyPageProc copypage_proc;
+	FI_OpenScanlineReaderProc open_scanline_reader_proc;
+	FI_ReadNextScanlineProc read_next_scanline_proc;
+	FI_CloseScanlineReaderProc close_scanline_reader_proc;
+	FI_SupportsPersistentDataProc supports_persistent_data_proc;
 };
 
 typedef void (DLL_CALLCONV *FI_InitProc)(Plugin *plugin, int format_id);
@@ -725,6 +793,10 @@ typedef void (DLL_CALLCONV *FI_InitProc)(Plugin *plugin, int format_id);
 #define PNG_Z_BEST_COMPRESSION		0x0009	//! save using ZLib level 9 compression flag (default value is 6)
 #define PNG_Z_NO_COMPRESSION		0x0100	//! save without ZLib compression
 #define PNG_INTERLACED				0x0200	//! save using Adam7 interlacing (use | to combine with other save flags)
+#define PNG_MULTITHREADED			0x0400	//! save: filter and compress bands of rows on several threads (see FreeImage_SetThreadCount), ignored with PNG_INTERLACED
+#define PNG_MULTITHREADED_FAST		0x0800	//! with PNG_MULTITHREADED: compress smaller bands independently of each other (faster, slightly larger file)
+#define PNG_SAVE_FAST				0x1000	//! save using a single filter and ZLib level 1 compression (overrides the PNG_Z_xxx flags)
+#define PNG_SAVE_SMALLEST			0x2000	//! save using the smallest of several filter heuristics and ZLib strategies at level 9 (slow, overrides the PNG_Z_xxx flags)
 #define PNM_DEFAULT         0
 #define PNM_SAVE_RAW        0       //! if set the writer saves in RAW format (i.e. P4, P5 or P6)
 #define PNM_SAVE_ASCII      1       //! if set the writer saves in ASCII format (i.e. P1, P2 or P3)
@@ -755,6 +827,9 @@ typedef void (DLL_CALLCONV *FI_InitProc)(Plugin *plugin, int format_id);
 #define TIFF_LZW			0x4000	//! save using LZW compression
 #define TIFF_JPEG			0x8000	//! save using JPEG compression
 #define TIFF_LOGLUV			0x10000	//! save using LogLuv compression
+#define TIFF_MULTITHREADED	0x20000	//! load: decode strips and tiles on several threads, save: compress strips and tiles on several threads (see FreeImage_SetThreadCount)
+#define TIFF_TILED			0x40000	//! save as a tiled image (256x256 tiles)
+#define TIFF_PYRAMID		0x80000	//! save as a tiled image followed by its reduced-resolution levels, stored as SubIFDs (multi-resolution pyramid)
 #define WBMP_DEFAULT        0
 #define XBM_DEFAULT			0
 #define XPM_DEFAULT			0
@@ -779,6 +854,14 @@ typedef void (DLL_CALLCONV *FI_InitProc)(Plugin *plugin, int format_id);
 #define FI_RESCALE_DEFAULT			0x00    //! default options; none of the following other options apply
 #define FI_RESCALE_TRUE_COLOR		0x01	//! for non-transparent greyscale images, convert to 24-bit if src bitdepth <= 8 (default is a 8-bit greyscale image). 
 #define FI_RESCALE_OMIT_METADATA	0x02	//! do not copy metadata to the rescaled image
+#define FI_RESCALE_MULTITHREADED	0x04	//! filter using several worker threads (see FreeImage_SetThreadCount); the result is identical to the single-threaded one
+
+// Multipage cache options ---------------------------------------------------
+// Constants used in FreeImage_SetMultiBitmapCache
+
+#define FI_PAGECACHE_DEFAULT		0x00	//! keep the cached pages decoded
+#define FI_PAGECACHE_COMPRESS		0x01	//! zlib-compress the pixels of the cached pages (pages which do not compress well are kept as is)
+#define FI_PAGECACHE_PREFETCH		0x02	//! decode the page following a locked page on a background thread
 
 
 // Init / Error routines ----------------------------------------------------
@@ -791,6 +874,17 @@ DLL_API void DLL_CALLCONV FreeImage_DeInitialise(void);
 DLL_API const char *DLL_CALLCONV FreeImage_GetVersion(void);
 DLL_API const char *DLL_CALLCONV FreeImage_GetCopyrightMessage(void);
 
+// Multithreading routines --------------------------------------------------
+// The thread count is used by the operations asked to run multithreaded
+// (FI_RESCALE_MULTITHREADED, PNG_MULTITHREADED, TIFF_MULTITHREADED) :
+// count > 0 uses count threads, 0 uses one thread per hardware thread,
+// count < 0 restores the default 'not set' state, in which these flags use one thread per hardware thread.
+// Loading and saving only run multithreaded with their flag, whereas rescaling also
+// runs multithreaded without FI_RESCALE_MULTITHREADED once a count >= 0 is set
+
+DLL_API void DLL_CALLCONV FreeImage_SetThreadCount(int count);
+DLL_API int DLL_CALLCONV FreeImage_GetThreadCount(void);
+
 // Message output functions -------------------------------------------------
 
 typedef void (*FreeImage_OutputMessageFunction)(FREE_IMAGE_FORMAT fif, const char *msg);
@@ -800,11 +894,41 @@ DLL_API void DLL_CALLCONV FreeImage_SetOutputMessageStdCall(FreeImage_OutputMess
 DLL_API void DLL_CALLCONV FreeImage_SetOutputMessage(FreeImage_OutputMessageFunction omf);
 DLL_API void DLL_CALLCONV FreeImage_OutputMessageProc(int fif, const char *fmt, ...);
 
+// Memory allocation routines -----------------------------------------------
+
+typedef void *(DLL_CALLCONV *FI_MallocProc)(size_t size, void *user);
+typedef void (DLL_CALLCONV *FI_FreeProc)(void *ptr, void *user);
+typedef void *(DLL_CALLCONV *FI_AlignedMallocProc)(size_t size, size_t alignment, void *user);
+typedef void (DLL_CALLCONV *FI_AlignedFreeProc)(void *ptr, void *user);
+
+FI_STRUCT (FreeImageAllocator) {
+	FI_MallocProc malloc_proc;					//! allocate a bitmap handle
+	FI_FreeProc free_proc;						//! release a block allocated by malloc_proc
+	FI_AlignedMallocProc aligned_malloc_proc;	//! allocate bitmap data and aligned work buffers (16 bytes alignment)
+	FI_AlignedFreeProc aligned_free_proc;		//! release a block allocated by aligned_malloc_proc
+	void *user;									//! user context passed to every callback
+};
+
+// Set the allocator of bitmaps and work buffers (nullptr restores the default allocator) and flush the bitmap pool.
+// Call it once at startup, before any allocation : it is not thread-safe, and the blocks allocated before the call 
+// are still released by the allocator that allocated them (its callbacks and user context must stay valid until then).
+DLL_API BOOL DLL_CALLCONV FreeImage_SetAllocator(const FreeImageAllocator *allocator FI_DEFAULT(nullptr));
+DLL_API void DLL_CALLCONV FreeImage_SetBitmapPoolSize(size_t max_bytes);
+DLL_API size_t DLL_CALLCONV FreeImage_GetBitmapPoolSize(void);
+DLL_API void DLL_CALLCONV FreeImage_FlushBitmapPool(void);
+
 // Allocate / Clone / Unload routines ---------------------------------------
 
 DLL_API FIBITMAP *DLL_CALLCONV FreeImage_Allocate(int width, int height, int bpp, unsigned red_mask FI_DEFAULT(0), unsigned green_mask FI_DEFAULT(0), unsigned blue_mask FI_DEFAULT(0));
 DLL_API FIBITMAP *DLL_CALLCONV FreeImage_AllocateT(FREE_IMAGE_TYPE type, int width, int height, int bpp FI_DEFAULT(8), unsigned red_mask FI_DEFAULT(0), unsigned green_mask FI_DEFAULT(0), unsigned blue_mask FI_DEFAULT(0));
 DLL_API FIBITMAP * DLL_CALLCONV FreeImage_Clone(FIBITMAP *dib);
+// FreeImage_CloneShallow shares the pixels of dib with the clone (copy-on-write).
+// FreeImage_GetBits, FreeImage_GetScanLine and FreeImage_MakeWritable give a bitmap a private copy
+// of shared pixels : use FreeImage_GetConstBits / FreeImage_GetConstScanLine to only read them.
+// Several threads may read and detach the same bitmap at once (its pixels are copied once), but
+// writing pixels while other threads access the same bitmap still needs external synchronization
+DLL_API FIBITMAP * DLL_CALLCONV FreeImage_CloneShallow(FIBITMAP *dib);
+DLL_API BOOL DLL_CALLCONV FreeImage_MakeWritable(FIBITMAP *dib);
 DLL_API void DLL_CALLCONV FreeImage_Unload(FIBITMAP *dib);
 
 // Header loading routines
@@ -814,20 +938,39 @@ DLL_API BOOL DLL_CALLCONV FreeImage_HasPixels(FIBITMAP *dib);
 
 DLL_API FIBITMAP *DLL_CALLCONV FreeImage_Load(FREE_IMAGE_FORMAT fif, const char *filename, int flags FI_DEFAULT(0));
 DLL_API FIBITMAP *DLL_CALLCONV FreeImage_LoadU(FREE_IMAGE_FORMAT fif, const wchar_t *filename, int flags FI_DEFAULT(0));
+DLL_API FIBITMAP *DLL_CALLCONV FreeImage_LoadMapped(FREE_IMAGE_FORMAT fif, const char *filename, int flags FI_DEFAULT(0));
+DLL_API FIBITMAP *DLL_CALLCONV FreeImage_LoadMappedU(FREE_IMAGE_FORMAT fif, const wchar_t *filename, int flags FI_DEFAULT(0));
 DLL_API FIBITMAP *DLL_CALLCONV FreeImage_LoadFromHandle(FREE_IMAGE_FORMAT fif, FreeImageIO *io, fi_handle handle, int flags FI_DEFAULT(0));
+DLL_API FIBITMAP *DLL_CALLCONV FreeImage_LoadScaled(FREE_IMAGE_FORMAT fif, FreeImageIO *io, fi_handle handle, int max_width, int max_height, FREE_IMAGE_FILTER filter FI_DEFAULT(FILTER_CATMULLROM), int flags FI_DEFAULT(0));
+DLL_API FIBITMAP *DLL_CALLCONV FreeImage_LoadRegion(FREE_IMAGE_FORMAT fif, FreeImageIO *io, fi_handle handle, int page, int left, int top, int right, int bottom, int flags FI_DEFAULT(0));
 DLL_API BOOL DLL_CALLCONV FreeImage_Save(FREE_IMAGE_FORMAT fif, FIBITMAP *dib, const char *filename, int flags FI_DEFAULT(0));
 DLL_API BOOL DLL_CALLCONV FreeImage_SaveU(FREE_IMAGE_FORMAT fif, FIBITMAP *dib, const wchar_t *filename, int flags FI_DEFAULT(0));
 DLL_API BOOL DLL_CALLCONV FreeImage_SaveToHandle(FREE_IMAGE_FORMAT fif, FIBITMAP *dib, FreeImageIO *io, fi_handle handle, int flags FI_DEFAULT(0));
+DLL_API FIBITMAP *DLL_CALLCONV FreeImage_LoadFromHandle64(FREE_IMAGE_FORMAT fif, FreeImageIO64 *io, fi_handle handle, int flags FI_DEFAULT(0));
+DLL_API BOOL DLL_CALLCONV FreeImage_SaveToHandle64(FREE_IMAGE_FORMAT fif, FIBITMAP *dib, FreeImageIO64 *io, fi_handle handle, int flags FI_DEFAULT(0));
+
+// Scanline reading routines ------------------------------------------------
+
+DLL_API FISCANLINEREADER *DLL_CALLCONV FreeImage_OpenScanlineReader(FREE_IMAGE_FORMAT fif, FreeImageIO *io, fi_handle handle, int flags FI_DEFAULT(0));
+DLL_API FIBITMAP *DLL_CALLCONV FreeImage_GetScanlineReaderInfo(FISCANLINEREADER *reader);
+DLL_API BOOL DLL_CALLCONV FreeImage_ReadNextScanline(FISCANLINEREADER *reader, uint8_t *bits);
+DLL_API void DLL_CALLCONV FreeImage_CloseScanlineReader(FISCANLINEREADER *reader);
 
 // Memory I/O stream routines -----------------------------------------------
 
 DLL_API FIMEMORY *DLL_CALLCONV FreeImage_OpenMemory(uint8_t *data FI_DEFAULT(0), uint32_t size_in_bytes FI_DEFAULT(0));
+DLL_API FIMEMORY *DLL_CALLCONV FreeImage_OpenMemory64(uint8_t *data FI_DEFAULT(0), uint64_t size_in_bytes FI_DEFAULT(0));
+DLL_API FIMEMORY *DLL_CALLCONV FreeImage_OpenMemorySegmented(uint32_t segment_size FI_DEFAULT(0));
 DLL_API void DLL_CALLCONV FreeImage_CloseMemory(FIMEMORY *stream);
 DLL_API FIBITMAP *DLL_CALLCONV FreeImage_LoadFromMemory(FREE_IMAGE_FORMAT fif, FIMEMORY *stream, int flags FI_DEFAULT(0));
 DLL_API BOOL DLL_CALLCONV FreeImage_SaveToMemory(FREE_IMAGE_FORMAT fif, FIBITMAP *dib, FIMEMORY *stream, int flags FI_DEFAULT(0));
 DLL_API long DLL_CALLCONV FreeImage_TellMemory(FIMEMORY *stream);
 DLL_API BOOL DLL_CALLCONV FreeImage_SeekMemory(FIMEMORY *stream, long offset, int origin);
+DLL_API int64_t DLL_CALLCONV FreeImage_TellMemory64(FIMEMORY *stream);
+DLL_API BOOL DLL_CALLCONV FreeImage_SeekMemory64(FIMEMORY *stream, int64_t offset, int origin);
 DLL_API BOOL DLL_CALLCONV FreeImage_AcquireMemory(FIMEMORY *stream, uint8_t **data, uint32_t *size_in_bytes);
+DLL_API BOOL DLL_CALLCONV FreeImage_AcquireMemory64(FIMEMORY *stream, uint8_t **data, uint64_t *size_in_bytes);
+DLL_API BOOL DLL_CALLCONV FreeImage_AcquireMemorySegments(FIMEMORY *stream, FIMEMORYSEGMENT *segments, unsigned *count);
 DLL_API unsigned DLL_CALLCONV FreeImage_ReadMemory(void *buffer, unsigned size, unsigned count, FIMEMORY *stream);
 DLL_API unsigned DLL_CALLCONV FreeImage_WriteMemory(const void *buffer, unsigned size, unsigned count, FIMEMORY *stream);
 
@@ -856,11 +999,14 @@ DLL_API BOOL DLL_CALLCONV FreeImage_FIFSupportsExportBPP(FREE_IMAGE_FORMAT fif,
 DLL_API BOOL DLL_CALLCONV FreeImage_FIFSupportsExportType(FREE_IMAGE_FORMAT fif, FREE_IMAGE_TYPE type);
 DLL_API BOOL DLL_CALLCONV FreeImage_FIFSupportsICCProfiles(FREE_IMAGE_FORMAT fif);
 DLL_API BOOL DLL_CALLCONV FreeImage_FIFSupportsNoPixels(FREE_IMAGE_FORMAT fif);
+DLL_API BOOL DLL_CALLCONV FreeImage_FIFSupportsLoadRegion(FREE_IMAGE_FORMAT fif);
+DLL_API BOOL DLL_CALLCONV FreeImage_FIFSupportsScanlineReading(FREE_IMAGE_FORMAT fif);
 
 // Multipaging interface ----------------------------------------------------
 
 DLL_API FIMULTIBITMAP * DLL_CALLCONV FreeImage_OpenMultiBitmap(FREE_IMAGE_FORMAT fif, const char *filename, BOOL create_new, BOOL read_only, BOOL keep_cache_in_memory FI_DEFAULT(FALSE), int flags FI_DEFAULT(0));
 DLL_API FIMULTIBITMAP * DLL_CALLCONV FreeImage_OpenMultiBitmapFromHandle(FREE_IMAGE_FORMAT fif, FreeImageIO *io, fi_handle handle, int flags FI_DEFAULT(0));
+DLL_API FIMULTIBITMAP * DLL_CALLCONV FreeImage_OpenMultiBitmapMapped(FREE_IMAGE_FORMAT fif, const char *filename, int flags FI_DEFAULT(0));
 DLL_API BOOL DLL_CALLCONV FreeImage_SaveMultiBitmapToHandle(FREE_IMAGE_FORMAT fif, FIMULTIBITMAP *bitmap, FreeImageIO *io, fi_handle handle, int flags FI_DEFAULT(0));
 DLL_API BOOL DLL_CALLCONV FreeImage_CloseMultiBitmap(FIMULTIBITMAP *bitmap, int flags FI_DEFAULT(0));
 DLL_API int DLL_CALLCONV FreeImage_GetPageCount(FIMULTIBITMAP *bitmap);
@@ -868,9 +1014,11 @@ DLL_API void DLL_CALLCONV FreeImage_AppendPage(FIMULTIBITMAP *bitmap, FIBITMAP *
 DLL_API void DLL_CALLCONV FreeImage_InsertPage(FIMULTIBITMAP *bitmap, int page, FIBITMAP *data);
 DLL_API void DLL_CALLCONV FreeImage_DeletePage(FIMULTIBITMAP *bitmap, int page);
 DLL_API FIBITMAP * DLL_CALLCONV FreeImage_LockPage(FIMULTIBITMAP *bitmap, int page);
+DLL_API int DLL_CALLCONV FreeImage_LockPages(FIMULTIBITMAP *bitmap, const int *pages, int count, FIBITMAP **data);
 DLL_API void DLL_CALLCONV FreeImage_UnlockPage(FIMULTIBITMAP *bitmap, FIBITMAP *data, BOOL changed);
 DLL_API BOOL DLL_CALLCONV FreeImage_MovePage(FIMULTIBITMAP *bitmap, int target, int source);
 DLL_API BOOL DLL_CALLCONV FreeImage_GetLockedPageNumbers(FIMULTIBITMAP *bitmap, int *pages, int *count);
+DLL_API BOOL DLL_CALLCONV FreeImage_SetMultiBitmapCache(FIMULTIBITMAP *bitmap, size_t max_bytes, int flags FI_DEFAULT(FI_PAGECACHE_DEFAULT));
 
 // File type request routines ------------------------------------------------
 
@@ -899,6 +1047,8 @@ DLL_API BOOL DLL_CALLCONV FreeImage_LookupSVGColor(const char *szColor, uint8_t
 
 DLL_API uint8_t *DLL_CALLCONV FreeImage_GetBits(FIBITMAP *dib);
 DLL_API uint8_t *DLL_CALLCONV FreeImage_GetScanLine(FIBITMAP *dib, int scanline);
+DLL_API const uint8_t *DLL_CALLCONV FreeImage_GetConstBits(FIBITMAP *dib);
+DLL_API const uint8_t *DLL_CALLCONV FreeImage_GetConstScanLine(FIBITMAP *dib, int scanline);
 
 DLL_API BOOL DLL_CALLCONV FreeImage_GetPixelIndex(FIBITMAP *dib, unsigned x, unsigned y, uint8_t *value);
 DLL_API BOOL DLL_CALLCONV FreeImage_GetPixelColor(FIBITMAP *dib, unsigned x, unsigned y, RGBQUAD *value);
@@ -1110,6 +1260,21 @@ DLL_API FIBITMAP *DLL_CALLCONV FreeImage_Rescale(FIBITMAP *dib, int dst_width, i
 DLL_API FIBITMAP *DLL_CALLCONV FreeImage_MakeThumbnail(FIBITMAP *dib, int max_pixel_size, BOOL convert FI_DEFAULT(TRUE));
 DLL_API FIBITMAP *DLL_CALLCONV FreeImage_RescaleRect(FIBITMAP *dib, int dst_width, int dst_height, int left, int top, int right, int bottom, FREE_IMAGE_FILTER filter FI_DEFAULT(FILTER_CATMULLROM), unsigned flags FI_DEFAULT(0));
 
+// streaming upsampling / downsampling
+/**
+Callback used by FreeImage_ReadRescaledScanline to read the source scanlines.
+Scanlines are requested once each, in increasing order.
+@param data User data given to FreeImage_OpenRescaler
+@param row Index of the requested source scanline
+@param bits Buffer receiving the scanline (src_width pixels, without padding)
+@return Returns TRUE if successful, FALSE otherwise
+*/
+typedef BOOL (DLL_CALLCONV *FI_ReadScanlineProc)(void *data, unsigned row, uint8_t *bits);
+
+DLL_API FIRESCALER *DLL_CALLCONV FreeImage_OpenRescaler(FREE_IMAGE_TYPE type, unsigned bpp, int src_width, int src_height, int dst_width, int dst_height, FREE_IMAGE_FILTER filter, FI_ReadScanlineProc read_proc, void *data);
+DLL_API BOOL DLL_CALLCONV FreeImage_ReadRescaledScanline(FIRESCALER *rescaler, uint8_t *bits);
+DLL_API void DLL_CALLCONV FreeImage_CloseRescaler(FIRESCALER *rescaler);
+
 // color manipulation routines (point operations)
 DLL_API BOOL DLL_CALLCONV FreeImage_AdjustCurve(FIBITMAP *dib, uint8_t *LUT, FREE_IMAGE_COLOR_CHANNEL channel);
 DLL_API BOOL DLL_CALLCONV FreeImage_AdjustGamma(FIBITMAP *dib, double gamma);
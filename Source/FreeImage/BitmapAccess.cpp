@@ -33,6 +33,9 @@
 #include <malloc.h>
 #endif // _WIN32 || _WIN64 || __MINGW32__
 
+#include <atomic>
+#include <mutex>
+
 #include "FreeImage.h"
 #include "FreeImageIO.h"
 #include "Utilities.h"
@@ -69,6 +72,24 @@ FI_STRUCT (METADATAHEADER) {
 	TAGMAP *tagmap;	//! pointer to the tag map
 };
 
+// ----------------------------------------------------------
+//  Copy-on-write pixel sharing
+// ----------------------------------------------------------
+
+/**
+Data block whose pixels are shared by shallow clones (see FreeImage_CloneShallow). 
+The block is the data block of the bitmap which was first cloned : it is released when 
+the last bitmap referencing it is unloaded.
+*/
+FI_STRUCT (FIPIXELSTORE) {
+	/** number of bitmaps referencing the block */
+	std::atomic<unsigned> refs;
+	/** shared data block */
+	void *block;
+	/** size class of the block when it comes from the bitmap pool, 0 otherwise */
+	size_t pool_size;
+};
+
 // ----------------------------------------------------------
 //  FIBITMAP definition
 // ----------------------------------------------------------
@@ -118,6 +139,17 @@ FI_STRUCT (FREEIMAGEHEADER) {
 	unsigned external_pitch;
 	//@}
 
+	/** size class of the data block when it comes from the bitmap pool, 0 otherwise */
+	size_t pool_size;
+
+	/**@name copy-on-write pixel sharing */
+	//@{
+	/** pixel store shared with other bitmaps, nullptr otherwise */
+	FIPIXELSTORE *shared;
+	/** TRUE if external_bits is a private copy of shared pixels, released on unload */
+	BOOL owns_external_bits;
+	//@}
+
 	//uint8_t filler[1];			 // fill to 32-bit alignment
 };
 
@@ -140,30 +172,32 @@ FI_STRUCT (FREEIMAGERGBMASKS) {
 
 #if (defined(_WIN32) || defined(_WIN64)) && !defined(__MINGW32__)
 
-void* FreeImage_Aligned_Malloc(size_t amount, size_t alignment) {
-	assert(alignment == FIBITMAP_ALIGNMENT);
+static void* DLL_CALLCONV 
+_DefaultAlignedMalloc(size_t amount, size_t alignment, void *user) {
 	return _aligned_malloc(amount, alignment);
 }
 
-void FreeImage_Aligned_Free(void* mem) {
+static void DLL_CALLCONV 
+_DefaultAlignedFree(void* mem, void *user) {
 	_aligned_free(mem);
 }
 
 #elif defined (__MINGW32__)
 
-void* FreeImage_Aligned_Malloc(size_t amount, size_t alignment) {
-	assert(alignment == FIBITMAP_ALIGNMENT);
+static void* DLL_CALLCONV 
+_DefaultAlignedMalloc(size_t amount, size_t alignment, void *user) {
 	return __mingw_aligned_malloc (amount, alignment);
 }
 
-void FreeImage_Aligned_Free(void* mem) {
+static void DLL_CALLCONV 
+_DefaultAlignedFree(void* mem, void *user) {
 	__mingw_aligned_free (mem);
 }
 
 #else
 
-void* FreeImage_Aligned_Malloc(size_t amount, size_t alignment) {
-	assert(alignment == FIBITMAP_ALIGNMENT);
+static void* DLL_CALLCONV 
+_DefaultAlignedMalloc(size_t amount, size_t alignment, void *user) {
 	/*
 	In some rare situations, the malloc routines can return misaligned memory. 
 	The routine FreeImage_Aligned_Malloc allocates a bit more memory to do
@@ -187,12 +221,277 @@ void* FreeImage_Aligned_Malloc(size_t amount, size_t alignment) {
 	return mem_align;
 }
 
-void FreeImage_Aligned_Free(void* mem) {
+static void DLL_CALLCONV 
+_DefaultAlignedFree(void* mem, void *user) {
 	free((void*)*((long*)mem - 1));
 }
 
 #endif // _WIN32 || _WIN64
 
+static void* DLL_CALLCONV 
+_DefaultMalloc(size_t size, void *user) {
+	return malloc(size);
+}
+
+static void DLL_CALLCONV 
+_DefaultFree(void *ptr, void *user) {
+	free(ptr);
+}
+
+// ----------------------------------------------------------
+//  User allocator
+// ----------------------------------------------------------
+
+/**
+Default allocator
+*/
+static const FreeImageAllocator s_default_allocator = { _DefaultMalloc, _DefaultFree, _DefaultAlignedMalloc, _DefaultAlignedFree, nullptr };
+
+/**
+Allocator used for new bitmap handles, bitmap data and aligned work buffers.<br>
+Each block keeps a pointer to the allocator which allocated it, so that blocks allocated 
+before a call to FreeImage_SetAllocator are still released by their own allocator. 
+For the same reason, user allocators are copied into records which are never released.
+*/
+static std::atomic<const FreeImageAllocator*> s_allocator(&s_default_allocator);
+
+/**
+Bitmap handle, followed by the allocator which allocated it
+*/
+typedef struct tagFIBITMAPHANDLE {
+	FIBITMAP bitmap;
+	const FreeImageAllocator *allocator;
+} FIBITMAPHANDLE;
+
+void* FreeImage_Aligned_Malloc(size_t amount, size_t alignment) {
+	assert(alignment == FIBITMAP_ALIGNMENT);
+	// the allocator is stored just before the returned block, in an additional alignment unit
+	const FreeImageAllocator *allocator = s_allocator;
+	uint8_t *block = (uint8_t*)allocator->aligned_malloc_proc(amount + alignment, alignment, allocator->user);
+	if(!block) {
+		return nullptr;
+	}
+	block += alignment;
+	((const FreeImageAllocator**)block)[-1] = allocator;
+	return block;
+}
+
+void FreeImage_Aligned_Free(void* mem) {
+	if(mem) {
+		const FreeImageAllocator *allocator = ((const FreeImageAllocator**)mem)[-1];
+		allocator->aligned_free_proc((uint8_t*)mem - FIBITMAP_ALIGNMENT, allocator->user);
+	}
+}
+
+/**
+Allocate a bitmap handle using the current allocator
+@return Returns the handle if successful, returns nullptr otherwise
+*/
+static FIBITMAP* 
+AllocateBitmapHandle() {
+	const FreeImageAllocator *allocator = s_allocator;
+	FIBITMAPHANDLE *handle = (FIBITMAPHANDLE*)allocator->malloc_proc(sizeof(FIBITMAPHANDLE), allocator->user);
+	if(!handle) {
+		return nullptr;
+	}
+	handle->allocator = allocator;
+	return &handle->bitmap;
+}
+
+/**
+Release a bitmap handle using the allocator which allocated it
+*/
+static void 
+FreeBitmapHandle(FIBITMAP *dib) {
+	const FreeImageAllocator *allocator = ((FIBITMAPHANDLE*)dib)->allocator;
+	allocator->free_proc(dib, allocator->user);
+}
+
+// ----------------------------------------------------------
+//  Bitmap data pool
+// ----------------------------------------------------------
+
+/**
+Size-class pool of bitmap data blocks. 
+Blocks released by FreeImage_Unload are kept (up to a byte budget) and reused by the next bitmap 
+of the same size class, so that a pipeline processing many images of similar dimensions 
+does not go back to the allocator for every image. 
+Size classes are spaced by 1/8 of a power of two : a reused block wastes at most 12.5% of its size. 
+The pool is disabled (zero budget) until FreeImage_SetBitmapPoolSize is called.
+*/
+class BitmapPool {
+public:
+	//! smaller blocks are cheap to allocate and are never pooled
+	static const size_t MIN_BLOCK_SIZE = 64 * 1024;
+
+private:
+	struct Block {
+		size_t size;	//! size class
+		void *data;		//! aligned block
+	};
+
+	std::mutex m_mutex;
+	//! cached blocks, most recently released first
+	std::list<Block> m_blocks;
+	//! sum of the cached block sizes
+	size_t m_cached;
+	//! maximum value of m_cached
+	size_t m_budget;
+
+	/**
+	Release blocks until the cache fits into the budget
+	@param blocks Returned released blocks, to be freed outside of the lock
+	*/
+	void Trim(std::vector<void*>& blocks) {
+		while((m_cached > m_budget) && !m_blocks.empty()) {
+			m_cached -= m_blocks.back().size;
+			blocks.push_back(m_blocks.back().data);
+			m_blocks.pop_back();
+		}
+	}
+
+	static void FreeBlocks(const std::vector<void*>& blocks) {
+		for(size_t i = 0; i < blocks.size(); i++) {
+			FreeImage_Aligned_Free(blocks[i]);
+		}
+	}
+
+public:
+	BitmapPool() : m_cached(0), m_budget(0) {
+	}
+
+	~BitmapPool() {
+		Flush();
+	}
+
+	static BitmapPool& instance() {
+		static BitmapPool s_pool;
+		return s_pool;
+	}
+
+	/**
+	Get the size class of a block
+	@return Returns the size class, returns 0 if a block of this size is not pooled
+	*/
+	static size_t GetSizeClass(size_t size) {
+		if(size < MIN_BLOCK_SIZE) {
+			return 0;
+		}
+		size_t high_bit = 1;
+		while((size >> 1) >= high_bit) {
+			high_bit <<= 1;
+		}
+		const size_t step = high_bit >> 3;
+		return (size + step - 1) & ~(step - 1);
+	}
+
+	/**
+	Allocate a block of a given size class, reusing a cached block when available
+	*/
+	void* Acquire(size_t size_class) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for(std::list<Block>::iterator i = m_blocks.begin(); i != m_blocks.end(); ++i) {
+				if(i->size == size_class) {
+					void *data = i->data;
+					m_cached -= i->size;
+					m_blocks.erase(i);
+					return data;
+				}
+			}
+		}
+		return FreeImage_Aligned_Malloc(size_class, FIBITMAP_ALIGNMENT);
+	}
+
+	/**
+	Release a block allocated with Acquire, caching it when the budget allows it
+	*/
+	void Release(void *data, size_t size_class) {
+		std::vector<void*> blocks;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(size_class <= m_budget) {
+				m_blocks.push_front(Block{ size_class, data });
+				m_cached += size_class;
+				data = nullptr;
+				Trim(blocks);
+			}
+		}
+		FreeImage_Aligned_Free(data);
+		FreeBlocks(blocks);
+	}
+
+	void SetBudget(size_t max_bytes) {
+		std::vector<void*> blocks;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_budget = max_bytes;
+			Trim(blocks);
+		}
+		FreeBlocks(blocks);
+	}
+
+	size_t GetBudget() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_budget;
+	}
+
+	BOOL IsEnabled() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return (m_budget > 0);
+	}
+
+	void Flush() {
+		std::vector<void*> blocks;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for(std::list<Block>::iterator i = m_blocks.begin(); i != m_blocks.end(); ++i) {
+				blocks.push_back(i->data);
+			}
+			m_blocks.clear();
+			m_cached = 0;
+		}
+		FreeBlocks(blocks);
+	}
+};
+
+BOOL DLL_CALLCONV
+FreeImage_SetAllocator(const FreeImageAllocator *allocator) {
+	if(allocator && !(allocator->malloc_proc && allocator->free_proc && allocator->aligned_malloc_proc && allocator->aligned_free_proc)) {
+		return FALSE;
+	}
+	if(allocator) {
+		// blocks keep a pointer to the allocator which allocated them, so the record is never released
+		FreeImageAllocator *record = new(std::nothrow) FreeImageAllocator(*allocator);
+		if(!record) {
+			return FALSE;
+		}
+		s_allocator = record;
+	} else {
+		s_allocator = &s_default_allocator;
+	}
+
+	// new bitmaps use the new allocator rather than the cached blocks
+	BitmapPool::instance().Flush();
+
+	return TRUE;
+}
+
+void DLL_CALLCONV
+FreeImage_SetBitmapPoolSize(size_t max_bytes) {
+	BitmapPool::instance().SetBudget(max_bytes);
+}
+
+size_t DLL_CALLCONV
+FreeImage_GetBitmapPoolSize() {
+	return BitmapPool::instance().GetBudget();
+}
+
+void DLL_CALLCONV
+FreeImage_FlushBitmapPool() {
+	BitmapPool::instance().Flush();
+}
+
 // ----------------------------------------------------------
 //  FIBITMAP memory management
 // ----------------------------------------------------------
@@ -368,7 +667,7 @@ FreeImage_AllocateBitmap(BOOL header_only, uint8_t *ext_bits, unsigned ext_pitch
 			return nullptr;
 	}
 
-	FIBITMAP *bitmap = (FIBITMAP *)malloc(sizeof(FIBITMAP));
+	FIBITMAP *bitmap = AllocateBitmapHandle();
 
 	if (bitmap != nullptr) {
 
@@ -383,11 +682,19 @@ FreeImage_AllocateBitmap(BOOL header_only, uint8_t *ext_bits, unsigned ext_pitch
 
 		if(dib_size == 0) {
 			// memory allocation will fail (probably a malloc overflow)
-			free(bitmap);
+			FreeBitmapHandle(bitmap);
 			return nullptr;
 		}
 
-		bitmap->data = (uint8_t *)FreeImage_Aligned_Malloc(dib_size * sizeof(uint8_t), FIBITMAP_ALIGNMENT);
+		// large blocks come from the bitmap pool when it is enabled
+
+		const size_t pool_size = BitmapPool::instance().IsEnabled() ? BitmapPool::GetSizeClass(dib_size) : 0;
+
+		if(pool_size) {
+			bitmap->data = (uint8_t *)BitmapPool::instance().Acquire(pool_size);
+		} else {
+			bitmap->data = (uint8_t *)FreeImage_Aligned_Malloc(dib_size * sizeof(uint8_t), FIBITMAP_ALIGNMENT);
+		}
 
 		if (bitmap->data != nullptr) {
 			memset(bitmap->data, 0, dib_size);
@@ -426,6 +733,8 @@ FreeImage_AllocateBitmap(BOOL header_only, uint8_t *ext_bits, unsigned ext_pitch
 			fih->external_bits = ext_bits;
 			fih->external_pitch = ext_pitch;
 
+			fih->pool_size = pool_size;
+
 			// write out the BITMAPINFOHEADER
 
 			BITMAPINFOHEADER *bih   = FreeImage_GetInfoHeader(bitmap);
@@ -461,12 +770,48 @@ FreeImage_AllocateBitmap(BOOL header_only, uint8_t *ext_bits, unsigned ext_pitch
 			return bitmap;
 		}
 
-		free(bitmap);
+		FreeBitmapHandle(bitmap);
 	}
 
 	return nullptr;
 }
 
+/**
+Release a bitmap data block
+@param block Data block
+@param pool_size Size class of the block when it comes from the bitmap pool, 0 otherwise
+*/
+static void 
+FreeBitmapBlock(void *block, size_t pool_size) {
+	if(pool_size) {
+		BitmapPool::instance().Release(block, pool_size);
+	} else {
+		FreeImage_Aligned_Free(block);
+	}
+}
+
+/**
+Release a reference to a shared pixel store, deleting the store with its last reference
+*/
+static void 
+ReleasePixelStore(FIPIXELSTORE *store) {
+	if(--store->refs == 0) {
+		FreeBitmapBlock(store->block, store->pool_size);
+		delete store;
+	}
+}
+
+/**
+Lock serializing the changes of the pixel store of a bitmap (see FreeImage_CloneShallow and FreeImage_MakeWritable), 
+so that two threads detaching the same shared bitmap do not both copy its pixels and release its store twice. 
+Bitmaps are spread over a small set of mutexes : a collision only serializes two unrelated detaches.
+*/
+static std::mutex & 
+PixelStoreLock(FIBITMAP *dib) {
+	static std::mutex s_locks[16];
+	return s_locks[((size_t)dib / FIBITMAP_ALIGNMENT) % 16];
+}
+
 FIBITMAP * DLL_CALLCONV
 FreeImage_AllocateHeaderForBits(uint8_t *ext_bits, unsigned ext_pitch, FREE_IMAGE_TYPE type, int width, int height, int bpp, unsigned red_mask, unsigned green_mask, unsigned blue_mask) {
 	return FreeImage_AllocateBitmap(FALSE, ext_bits, ext_pitch, type, width, height, bpp, red_mask, green_mask, blue_mask);
@@ -522,18 +867,75 @@ FreeImage_Unload(FIBITMAP *dib) {
 			// delete embedded thumbnail
 			FreeImage_Unload(FreeImage_GetThumbnail(dib));
 
+			// delete private copy of shared pixels
+			FREEIMAGEHEADER *fih = (FREEIMAGEHEADER *)dib->data;
+			if(fih->owns_external_bits) {
+				FreeImage_Aligned_Free(fih->external_bits);
+			}
+
 			// delete bitmap ...
-			FreeImage_Aligned_Free(dib->data);
+			FIPIXELSTORE *shared = fih->shared;
+			if(!shared || (shared->block != dib->data)) {
+				FreeBitmapBlock(dib->data, fih->pool_size);
+			}
+			// ... unless it is a shared pixel store, released by its last user
+			if(shared) {
+				ReleasePixelStore(shared);
+			}
 		}
 
-		free(dib);		// ... and the wrapper
+		FreeBitmapHandle(dib);		// ... and the wrapper
 	}
 }
 
 // ----------------------------------------------------------
 
-FIBITMAP * DLL_CALLCONV
-FreeImage_Clone(FIBITMAP *dib) {
+/**
+Copy the ICC profile, the metadata models and the thumbnail of a bitmap
+@param dst Destination bitmap, without ICC profile, metadata nor thumbnail
+@param src Source bitmap
+*/
+static void 
+CopyAttachedData(FIBITMAP *dst, FIBITMAP *src) {
+	// copy possible ICC profile
+	FIICCPROFILE *src_iccProfile = FreeImage_GetICCProfile(src);
+	FreeImage_CreateICCProfile(dst, src_iccProfile->data, src_iccProfile->size);
+	FreeImage_GetICCProfile(dst)->flags = src_iccProfile->flags;
+
+	// copy metadata models
+	METADATAMAP *src_metadata = ((FREEIMAGEHEADER *)src->data)->metadata;
+	METADATAMAP *dst_metadata = ((FREEIMAGEHEADER *)dst->data)->metadata;
+
+	for(METADATAMAP::iterator i = (*src_metadata).begin(); i != (*src_metadata).end(); i++) {
+		int model = (*i).first;
+		TAGMAP *src_tagmap = (*i).second;
+
+		if(src_tagmap) {
+			// create a metadata model
+			TAGMAP *dst_tagmap = new(std::nothrow) TAGMAP();
+
+			if(dst_tagmap) {
+				// fill the model
+				for(TAGMAP::iterator j = src_tagmap->begin(); j != src_tagmap->end(); j++) {
+					std::string dst_key = (*j).first;
+					FITAG *dst_tag = FreeImage_CloneTag( (*j).second );
+
+					// assign key and tag value
+					(*dst_tagmap)[dst_key] = dst_tag;
+				}
+
+				// assign model and tagmap
+				(*dst_metadata)[model] = dst_tagmap;
+			}
+		}
+	}
+
+	// copy the thumbnail
+	FreeImage_SetThumbnail(dst, FreeImage_GetThumbnail(src));
+}
+
+FIBITMAP *
+FreeImage_CloneInternal(FIBITMAP *dib, BOOL header_only) {
 	if(!dib) {
 		return nullptr;
 	}
@@ -546,8 +948,8 @@ FreeImage_Clone(FIBITMAP *dib) {
 	// if the FIBITMAP is a wrapper to a user provided pixel buffer, get a pointer to this buffer
 	const uint8_t *ext_bits = ((FREEIMAGEHEADER *)dib->data)->external_bits;
 	
-	// check for pixel availability ...
-	BOOL header_only = FreeImage_HasPixels(dib) ? FALSE : TRUE;
+	// pixels are copied only when both bitmaps have pixels ...
+	const BOOL copy_pixels = (!header_only && FreeImage_HasPixels(dib)) ? TRUE : FALSE;
 
 	// check whether this image has masks defined ...
 	BOOL need_masks = (bpp == 16 && type == FIT_BITMAP) ? TRUE : FALSE;
@@ -558,13 +960,14 @@ FreeImage_Clone(FIBITMAP *dib) {
 
 	if (new_dib) {
 		// save ICC profile links
-		FIICCPROFILE *src_iccProfile = FreeImage_GetICCProfile(dib);
 		FIICCPROFILE *dst_iccProfile = FreeImage_GetICCProfile(new_dib);
 
 		// save metadata links
-		METADATAMAP *src_metadata = ((FREEIMAGEHEADER *)dib->data)->metadata;
 		METADATAMAP *dst_metadata = ((FREEIMAGEHEADER *)new_dib->data)->metadata;
 
+		// save allocation info
+		const size_t dst_pool_size = ((FREEIMAGEHEADER *)new_dib->data)->pool_size;
+
 		// calculate the size of the dst image
 		// align the palette and the pixels on a FIBITMAP_ALIGNMENT bytes alignment boundary
 		// palette is aligned on a 16 bytes boundary
@@ -572,7 +975,7 @@ FreeImage_Clone(FIBITMAP *dib) {
 		
 		// when using a user provided pixel buffer, force a 'header only' calculation		
 
-		size_t dib_size = FreeImage_GetInternalImageSize(header_only || ext_bits, width, height, bpp, need_masks);
+		size_t dib_size = FreeImage_GetInternalImageSize(!copy_pixels || ext_bits, width, height, bpp, need_masks);
 
 		// copy the bitmap + internal pointers (remember to restore new_dib internal pointers later)
 		memcpy(new_dib->data, dib->data, dib_size);
@@ -590,40 +993,17 @@ FreeImage_Clone(FIBITMAP *dib) {
 		((FREEIMAGEHEADER *)new_dib->data)->external_bits = nullptr;
 		((FREEIMAGEHEADER *)new_dib->data)->external_pitch = 0;
 
-		// copy possible ICC profile
-		FreeImage_CreateICCProfile(new_dib, src_iccProfile->data, src_iccProfile->size);
-		dst_iccProfile->flags = src_iccProfile->flags;
-
-		// copy metadata models
-		for(METADATAMAP::iterator i = (*src_metadata).begin(); i != (*src_metadata).end(); i++) {
-			int model = (*i).first;
-			TAGMAP *src_tagmap = (*i).second;
-
-			if(src_tagmap) {
-				// create a metadata model
-				TAGMAP *dst_tagmap = new(std::nothrow) TAGMAP();
+		// restore the allocation info of new_dib (its pixels are never shared)
+		((FREEIMAGEHEADER *)new_dib->data)->pool_size = dst_pool_size;
+		((FREEIMAGEHEADER *)new_dib->data)->shared = nullptr;
+		((FREEIMAGEHEADER *)new_dib->data)->owns_external_bits = FALSE;
+		((FREEIMAGEHEADER *)new_dib->data)->has_pixels = header_only ? FALSE : TRUE;
 
-				if(dst_tagmap) {
-					// fill the model
-					for(TAGMAP::iterator j = src_tagmap->begin(); j != src_tagmap->end(); j++) {
-						std::string dst_key = (*j).first;
-						FITAG *dst_tag = FreeImage_CloneTag( (*j).second );
-
-						// assign key and tag value
-						(*dst_tagmap)[dst_key] = dst_tag;
-					}
-
-					// assign model and tagmap
-					(*dst_metadata)[model] = dst_tagmap;
-				}
-			}
-		}
-
-		// copy the thumbnail
-		FreeImage_SetThumbnail(new_dib, FreeImage_GetThumbnail(dib));
+		// copy possible ICC profile, metadata models and thumbnail
+		CopyAttachedData(new_dib, dib);
 
 		// copy user provided pixel buffer (if any)
-		if(ext_bits) {
+		if(copy_pixels && ext_bits) {
 			const unsigned pitch = FreeImage_GetPitch(dib);
 			const unsigned linesize = FreeImage_GetLine(dib);
 			for(unsigned y = 0; y < height; y++) {
@@ -638,10 +1018,171 @@ FreeImage_Clone(FIBITMAP *dib) {
 	return nullptr;
 }
 
+FIBITMAP * DLL_CALLCONV
+FreeImage_Clone(FIBITMAP *dib) {
+	if(!dib) {
+		return nullptr;
+	}
+	return FreeImage_CloneInternal(dib, FreeImage_HasPixels(dib) ? FALSE : TRUE);
+}
+
+FIBITMAP * DLL_CALLCONV
+FreeImage_CloneShallow(FIBITMAP *dib) {
+	if(!dib) {
+		return nullptr;
+	}
+
+	FREEIMAGEHEADER *fih = (FREEIMAGEHEADER *)dib->data;
+
+	// header only bitmaps, user provided pixel buffers and private pixel copies are not shared
+	if(!fih->has_pixels || fih->owns_external_bits || (fih->external_bits && !fih->shared)) {
+		return FreeImage_Clone(dib);
+	}
+
+	FREE_IMAGE_TYPE type = FreeImage_GetImageType(dib);
+	unsigned width	= FreeImage_GetWidth(dib);
+	unsigned height	= FreeImage_GetHeight(dib);
+	unsigned bpp	= FreeImage_GetBPP(dib);
+
+	// check whether this image has masks defined ...
+	BOOL need_masks = (bpp == 16 && type == FIT_BITMAP) ? TRUE : FALSE;
+
+	// allocate a new dib wrapping the pixels of dib
+	FIBITMAP *new_dib = FreeImage_AllocateHeaderForBits(FreeImage_GetBitsInternal(dib), FreeImage_GetPitch(dib), type, width, height, bpp,
+			FreeImage_GetRedMask(dib), FreeImage_GetGreenMask(dib), FreeImage_GetBlueMask(dib));
+
+	if (new_dib) {
+		FREEIMAGEHEADER *new_fih = (FREEIMAGEHEADER *)new_dib->data;
+		FIPIXELSTORE *store = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(PixelStoreLock(dib));
+
+			// skip dib when another thread made a private copy of its pixels in the meantime
+			if(!fih->owns_external_bits) {
+				// the first shallow clone turns the data block of dib into a shared pixel store
+				if(!fih->shared) {
+					FIPIXELSTORE *new_store = new(std::nothrow) FIPIXELSTORE;
+					if(new_store) {
+						new_store->refs = 1;
+						new_store->block = dib->data;
+						new_store->pool_size = fih->pool_size;
+						fih->shared = new_store;
+					}
+				}
+				store = fih->shared;
+				if(store) {
+					++store->refs;
+				}
+			}
+		}
+		if(!store) {
+			FreeImage_Unload(new_dib);
+			return fih->owns_external_bits ? FreeImage_Clone(dib) : nullptr;
+		}
+
+		// save the links of new_dib
+		METADATAMAP *dst_metadata = new_fih->metadata;
+		uint8_t *dst_bits = new_fih->external_bits;
+		const unsigned dst_pitch = new_fih->external_pitch;
+		const size_t dst_pool_size = new_fih->pool_size;
+
+		// copy the header, the palette and the masks (remember to restore new_dib internal pointers later)
+		memcpy(new_dib->data, dib->data, FreeImage_GetInternalImageSize(TRUE, width, height, bpp, need_masks));
+
+		// restore the links of new_dib
+		memset(FreeImage_GetICCProfile(new_dib), 0, sizeof(FIICCPROFILE));
+		new_fih->metadata = dst_metadata;
+		new_fih->thumbnail = nullptr;
+		new_fih->has_pixels = TRUE;
+		new_fih->external_bits = dst_bits;
+		new_fih->external_pitch = dst_pitch;
+		new_fih->pool_size = dst_pool_size;
+		new_fih->owns_external_bits = FALSE;
+
+		// share the pixel store
+		new_fih->shared = store;
+
+		// copy possible ICC profile, metadata models and thumbnail
+		CopyAttachedData(new_dib, dib);
+
+		return new_dib;
+	}
+
+	return nullptr;
+}
+
+BOOL DLL_CALLCONV
+FreeImage_MakeWritable(FIBITMAP *dib) {
+	if(!dib) {
+		return FALSE;
+	}
+
+	FREEIMAGEHEADER *fih = (FREEIMAGEHEADER *)dib->data;
+
+	// pixels which were never shared are private (no lock needed)
+	if(!fih->shared) {
+		return TRUE;
+	}
+
+	std::lock_guard<std::mutex> lock(PixelStoreLock(dib));
+
+	FIPIXELSTORE *store = fih->shared;
+
+	// pixels are private when they are no longer shared, already copied or no longer referenced by another bitmap
+	if(!store || fih->owns_external_bits || (store->refs == 1)) {
+		return TRUE;
+	}
+
+	// make a private copy of the pixels
+	const unsigned height = FreeImage_GetHeight(dib);
+	const unsigned line = FreeImage_GetLine(dib);
+	const unsigned src_pitch = FreeImage_GetPitch(dib);
+	const unsigned dst_pitch = (line + 3) & ~3;
+
+	uint8_t *dst_bits = (uint8_t *)FreeImage_Aligned_Malloc((size_t)dst_pitch * height, FIBITMAP_ALIGNMENT);
+	if(!dst_bits) {
+		return FALSE;
+	}
+	const uint8_t *src_bits = FreeImage_GetBitsInternal(dib);
+	if(src_pitch == dst_pitch) {
+		memcpy(dst_bits, src_bits, (size_t)dst_pitch * height);
+	} else {
+		for(unsigned y = 0; y < height; y++) {
+			memcpy(dst_bits + (size_t)dst_pitch * y, src_bits + (size_t)src_pitch * y, line);
+		}
+	}
+
+	fih->external_bits = dst_bits;
+	fih->external_pitch = dst_pitch;
+	fih->owns_external_bits = TRUE;
+
+	// a clone no longer needs the store, while the first owner of the store keeps its header inside
+	if(store->block != dib->data) {
+		fih->shared = nullptr;
+		ReleasePixelStore(store);
+	}
+
+	return TRUE;
+}
+
 // ----------------------------------------------------------
 
 uint8_t * DLL_CALLCONV
 FreeImage_GetBits(FIBITMAP *dib) {
+	// pixels are about to be modified : shared pixels must be copied first
+	if(!FreeImage_MakeWritable(dib)) {
+		return nullptr;
+	}
+	return FreeImage_GetBitsInternal(dib);
+}
+
+const uint8_t * DLL_CALLCONV
+FreeImage_GetConstBits(FIBITMAP *dib) {
+	return FreeImage_GetBitsInternal(dib);
+}
+
+uint8_t * 
+FreeImage_GetBitsInternal(FIBITMAP *dib) {
 	if(!FreeImage_HasPixels(dib)) {
 		return nullptr;
 	}
@@ -1538,6 +2079,11 @@ FreeImage_GetMemorySize(FIBITMAP *dib) {
 	// add sizes of FREEIMAGEHEADER, BITMAPINFOHEADER, palette and DIB data
 	size += FreeImage_GetInternalImageSize(header_only, width, height, bpp, need_masks);
 
+	// add private copy of shared pixels
+	if (header->owns_external_bits) {
+		size += (size_t)header->external_pitch * height;
+	}
+
 	// add ICC profile size
 	size += header->iccProfile.size;
 
@@ -27,194 +27,197 @@
 
 #include "CacheFile.h"
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// ----------------------------------------------------------
+
+//! extents are allocated on page boundaries
+static const size_t ARENA_GRANULARITY = 4096;
+//! the arena is committed by steps of at least 1 MB
+static const size_t ARENA_MIN_GROWTH = 1024 * 1024;
+//! address space reserved for the arena (the reservation is retried with smaller sizes down to 16 MB)
+static const size_t ARENA_MAX_RESERVE = (sizeof(void*) == 8) ? ((size_t)64 << 30) : ((size_t)256 << 20);
+
 // ----------------------------------------------------------
 
 CacheFile::CacheFile() :
-m_file(nullptr),
-m_free_pages(),
-m_page_cache_mem(),
-m_page_cache_disk(),
-m_page_map(),
-m_page_count(0),
-m_current_block(nullptr),
-m_keep_in_memory(TRUE) {
+m_keep_in_memory(TRUE),
+m_fd(-1),
+m_base(nullptr),
+m_reserved(0),
+m_committed(0),
+m_used(0) {
 }
 
 CacheFile::~CacheFile() {
-  close();
+	close();
 }
 
 BOOL
 CacheFile::open(const std::string& filename, BOOL keep_in_memory) {
 
-  assert(!m_file);
+	assert(!m_base);
+
+	m_filename = filename;
+	m_keep_in_memory = keep_in_memory;
 
-  m_filename = filename;
-  m_keep_in_memory = keep_in_memory;
+	if (!m_keep_in_memory && m_filename.empty()) {
+		return FALSE;
+	}
+
+#ifndef _WIN32
+	if (!m_keep_in_memory) {
+		m_fd = ::open(m_filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+		if (m_fd == -1) {
+			return FALSE;
+		}
+	}
+#endif
 
-	if ((!m_filename.empty()) && (!m_keep_in_memory)) {
-		m_file = fopen(m_filename.c_str(), "w+b"); 
-		return (m_file != nullptr);
+	if (!reserveArena()) {
+		close();
+		return FALSE;
 	}
 
-	return (m_keep_in_memory == TRUE);
+	return TRUE;
 }
 
 void
 CacheFile::close() {
-	// dispose the cache entries
-
-	while (!m_page_cache_disk.empty()) {
-		Block *block = *m_page_cache_disk.begin();
-		m_page_cache_disk.pop_front();
-		delete [] block->data;
-		delete block;
+	if (m_base) {
+#ifdef _WIN32
+		VirtualFree(m_base, 0, MEM_RELEASE);
+#else
+		munmap(m_base, m_reserved);
+#endif
+		m_base = nullptr;
 	}
-	while (!m_page_cache_mem.empty()) { 
-		Block *block = *m_page_cache_mem.begin(); 
-		m_page_cache_mem.pop_front(); 
-		delete [] block->data; 
-		delete block; 
-	} 
-
-	if (m_file) {
-		// close the file
-		fclose(m_file);
-		m_file = nullptr;
-		
-		// delete the file
+	m_reserved = m_committed = m_used = 0;
+
+	m_extents.clear();
+	m_free_refs.clear();
+	m_free_space.clear();
+
+#ifndef _WIN32
+	if (m_fd != -1) {
+		// close and delete the file
+		::close(m_fd);
+		m_fd = -1;
 		remove(m_filename.c_str());
 	}
+#endif
 }
 
-void
-CacheFile::cleanupMemCache() {
-	if (!m_keep_in_memory) {
-		if (m_page_cache_mem.size() > CACHE_SIZE) {
-			// flush the least used block to file
-
-			Block *old_block = m_page_cache_mem.back();
-			fseek(m_file, old_block->nr * BLOCK_SIZE, SEEK_SET);
-			fwrite(old_block->data, BLOCK_SIZE, 1, m_file);
-
-			// remove the data
-
-			delete [] old_block->data;
-			old_block->data = nullptr;
-
-			// move the block to another list
-
-			m_page_cache_disk.splice(m_page_cache_disk.begin(), m_page_cache_mem, --m_page_cache_mem.end());
-			m_page_map[old_block->nr] = m_page_cache_disk.begin();
+BOOL
+CacheFile::reserveArena() {
+	for (size_t reserve = ARENA_MAX_RESERVE; reserve >= ARENA_MIN_GROWTH * 16; reserve /= 2) {
+#ifdef _WIN32
+		void *base = VirtualAlloc(nullptr, reserve, MEM_RESERVE, PAGE_NOACCESS);
+		if (base) {
+#else
+		void *base = mmap(nullptr, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (base != MAP_FAILED) {
+#endif
+			m_base = (uint8_t*)base;
+			m_reserved = reserve;
+			m_committed = 0;
+			m_used = 0;
+			return TRUE;
 		}
 	}
+	return FALSE;
 }
 
-int
-CacheFile::allocateBlock() {
-	Block *block = new Block;
-	block->data = new uint8_t[BLOCK_SIZE];
-	block->next = 0;
-
-	if (!m_free_pages.empty()) {
-		block->nr = *m_free_pages.begin();
-		m_free_pages.pop_front();
-	} else {
-		block->nr = m_page_count++;
+BOOL
+CacheFile::growArena(size_t size) {
+	if (size <= m_committed) {
+		return TRUE;
+	}
+	if (size > m_reserved) {
+		return FALSE;
 	}
 
-	m_page_cache_mem.push_front(block);
-	m_page_map[block->nr] = m_page_cache_mem.begin();
-
-	cleanupMemCache();
-
-	return block->nr;
-}
-
-Block *
-CacheFile::lockBlock(int nr) {
-	if (m_current_block == nullptr) {
-		PageMapIt it = m_page_map.find(nr);
-
-		if (it != m_page_map.end()) {
-			m_current_block = *(it->second);
-
-			// the block is swapped out to disc. load it back
-			// and remove the block from the cache. it might get cached
-			// again as soon as the memory buffer fills up
-
-			if (m_current_block->data == nullptr) {
-				m_current_block->data = new uint8_t[BLOCK_SIZE];
-
-				fseek(m_file, m_current_block->nr * BLOCK_SIZE, SEEK_SET);
-				fread(m_current_block->data, BLOCK_SIZE, 1, m_file);
-
-				m_page_cache_mem.splice(m_page_cache_mem.begin(), m_page_cache_disk, it->second);
-				m_page_map[nr] = m_page_cache_mem.begin();
-			}
-
-			// if the memory cache size is too large, swap an item to disc
-
-			cleanupMemCache();
-
-			// return the current block
+	// grow geometrically to limit the number of system calls
+	size_t committed = MAX(size, MAX(m_committed + ARENA_MIN_GROWTH, m_committed * 2));
+	committed = MIN(m_reserved, (committed + ARENA_MIN_GROWTH - 1) & ~(ARENA_MIN_GROWTH - 1));
 
-			return m_current_block;
+#ifdef _WIN32
+	if (!VirtualAlloc(m_base + m_committed, committed - m_committed, MEM_COMMIT, PAGE_READWRITE)) {
+		return FALSE;
+	}
+#else
+	if (m_fd != -1) {
+		// extend the sparse file and map it over the reserved range
+		if ((ftruncate(m_fd, (off_t)committed) != 0) || (mmap(m_base, committed, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, m_fd, 0) == MAP_FAILED)) {
+			return FALSE;
 		}
+	} else if (mprotect(m_base + m_committed, committed - m_committed, PROT_READ | PROT_WRITE) != 0) {
+		return FALSE;
 	}
+#endif
 
-	return nullptr;
+	m_committed = committed;
+
+	return TRUE;
 }
 
-BOOL
-CacheFile::unlockBlock(int nr) {
-	if (m_current_block) {
-		m_current_block = nullptr;
-		return TRUE;
+void
+CacheFile::discardArena(size_t offset, size_t size) {
+	// give the pages of a large deleted file back to the system
+	if (size >= ARENA_MIN_GROWTH) {
+#ifdef _WIN32
+		VirtualAlloc(m_base + offset, size, MEM_RESET, PAGE_READWRITE);
+#elif defined(MADV_DONTNEED)
+		if (m_fd == -1) {
+			madvise(m_base + offset, size, MADV_DONTNEED);
+		}
+#endif
 	}
-	return FALSE;
 }
 
 BOOL
-CacheFile::deleteBlock(int nr) {
-	if (!m_current_block) {
-		PageMapIt it = m_page_map.find(nr);
-
-		// remove block from cache
+CacheFile::allocateExtent(size_t capacity, size_t *offset) {
+	// best fit in the space of the deleted files
 
-		if (it != m_page_map.end()) {
-			m_page_map.erase(nr);
+	size_t best = m_free_space.size();
+	for (size_t i = 0; i < m_free_space.size(); i++) {
+		if ((m_free_space[i].second >= capacity) && ((best == m_free_space.size()) || (m_free_space[i].second < m_free_space[best].second))) {
+			best = i;
 		}
+	}
+	if (best < m_free_space.size()) {
+		*offset = m_free_space[best].first;
+		if (m_free_space[best].second > capacity) {
+			m_free_space[best].first += capacity;
+			m_free_space[best].second -= capacity;
+		} else {
+			m_free_space.erase(m_free_space.begin() + best);
+		}
+		return TRUE;
+	}
 
-		// add block to free page list
-
-		m_free_pages.push_back(nr);
+	// append to the arena
 
-		return TRUE;
+	if ((capacity > m_reserved - m_used) || !growArena(m_used + capacity)) {
+		return FALSE;
 	}
+	*offset = m_used;
+	m_used += capacity;
 
-	return FALSE;
+	return TRUE;
 }
 
 BOOL
 CacheFile::readFile(uint8_t *data, int nr, int size) {
-	if ((data) && (size > 0)) {
-		int s = 0;
-		int block_nr = nr;
-
-		do {
-			int copy_nr = block_nr;
-
-			Block *block = lockBlock(copy_nr);
-
-			block_nr = block->next;
-
-			memcpy(data + s, block->data, (s + BLOCK_SIZE > size) ? size - s : BLOCK_SIZE);
+	int file_size = 0;
+	const uint8_t *view = viewFile(nr, &file_size);
 
-			unlockBlock(copy_nr);
-
-			s += BLOCK_SIZE;
-		} while (block_nr != 0);
+	if ((data) && (size > 0) && (view)) {
+		memcpy(data, view, MIN(size, file_size));
 
 		return TRUE;
 	}
@@ -222,55 +225,83 @@ CacheFile::readFile(uint8_t *data, int nr, int size) {
 	return FALSE;
 }
 
+const uint8_t *
+CacheFile::viewFile(int nr, int *size) const {
+	if ((nr >= 0) && (nr < (int)m_extents.size()) && (m_extents[nr].size >= 0)) {
+		if (size) {
+			*size = m_extents[nr].size;
+		}
+		return m_base + m_extents[nr].offset;
+	}
+
+	return nullptr;
+}
+
 int
 CacheFile::writeFile(uint8_t *data, int size) {
 	if ((data) && (size > 0)) {
-		int nr_blocks_required = 1 + (size / BLOCK_SIZE);
-		int count = 0;
-		int s = 0;
-		int stored_alloc;
-		int alloc;
-		
-		stored_alloc = alloc = allocateBlock();
-
-		do {
-			int copy_alloc = alloc;
-
-			Block *block = lockBlock(copy_alloc);
-
-			block->next = 0;
+		// caches which were not opened are kept in memory
+		if (!m_base && (!m_keep_in_memory || !reserveArena())) {
+			return -1;
+		}
 
-			memcpy(block->data, data + s, (s + BLOCK_SIZE > size) ? size - s : BLOCK_SIZE);
+		Extent extent;
+		extent.capacity = ((size_t)size + ARENA_GRANULARITY - 1) & ~(ARENA_GRANULARITY - 1);
+		extent.size = size;
 
-			if (count + 1 < nr_blocks_required)
-				alloc = block->next = allocateBlock();
+		if (!allocateExtent(extent.capacity, &extent.offset)) {
+			return -1;
+		}
+		memcpy(m_base + extent.offset, data, size);
 
-			unlockBlock(copy_alloc);
+		// get a file reference
 
-			s += BLOCK_SIZE;			
-		} while (++count < nr_blocks_required);
+		if (!m_free_refs.empty()) {
+			const int nr = m_free_refs.back();
+			m_free_refs.pop_back();
+			m_extents[nr] = extent;
+			return nr;
+		}
+		m_extents.push_back(extent);
 
-		return stored_alloc;
+		return (int)m_extents.size() - 1;
 	}
 
-	return 0;
+	return -1;
 }
 
 void
 CacheFile::deleteFile(int nr) {
-	do {
-		Block *block = lockBlock(nr);
+	if ((nr >= 0) && (nr < (int)m_extents.size()) && (m_extents[nr].size >= 0)) {
+		Extent& extent = m_extents[nr];
 
-		if (block == nullptr)
-			break;
+		discardArena(extent.offset, extent.capacity);
 
-		int next = block->next;
+		// insert the extent into the (sorted) free space, merging it with its neighbours
 
-		unlockBlock(nr);
+		size_t offset = extent.offset;
+		size_t capacity = extent.capacity;
 
-		deleteBlock(nr);
+		std::vector<std::pair<size_t, size_t> >::iterator next = std::lower_bound(m_free_space.begin(), m_free_space.end(), std::make_pair(offset, capacity));
+		if ((next != m_free_space.end()) && (offset + capacity == next->first)) {
+			capacity += next->second;
+			next = m_free_space.erase(next);
+		}
+		if ((next != m_free_space.begin()) && ((next - 1)->first + (next - 1)->second == offset)) {
+			--next;
+			offset = next->first;
+			capacity += next->second;
+			next = m_free_space.erase(next);
+		}
 
-		nr = next;
-	} while (nr != 0);
-}
+		if (offset + capacity == m_used) {
+			// the free space ending the arena is released
+			m_used = offset;
+		} else {
+			m_free_space.insert(next, std::make_pair(offset, capacity));
+		}
 
+		extent.size = -1;
+		m_free_refs.push_back(nr);
+	}
+}
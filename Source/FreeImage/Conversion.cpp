@@ -483,7 +483,7 @@ void DLL_CALLCONV
 FreeImage_ConvertToRawBits(uint8_t *bits, FIBITMAP *dib, int pitch, unsigned bpp, unsigned red_mask, unsigned green_mask, unsigned blue_mask, BOOL topdown) {
 	if (FreeImage_HasPixels(dib) && (bits != nullptr)) {
 		for (unsigned i = 0; i < FreeImage_GetHeight(dib); ++i) {
-			uint8_t *scanline = FreeImage_GetScanLine(dib, topdown ? (FreeImage_GetHeight(dib) - i - 1) : i);
+			uint8_t *scanline = (uint8_t*)FreeImage_GetConstScanLine(dib, topdown ? (FreeImage_GetHeight(dib) - i - 1) : i);
 
 			if ((bpp == 16) && (FreeImage_GetBPP(dib) == 16)) {
 				// convert 555 to 565 or vice versa
@@ -129,7 +129,7 @@ FreeImage_ConvertTo16Bits555(FIBITMAP *dib) {
 				return nullptr;
 			}
 			for (int rows = 0; rows < height; rows++) {
-				FreeImage_ConvertLine16_565_To16_555(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+				FreeImage_ConvertLine16_565_To16_555(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 			}
 
 			// copy metadata from src to dst
@@ -155,7 +155,7 @@ FreeImage_ConvertTo16Bits555(FIBITMAP *dib) {
 			case 1 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine1To16_555(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib));
+					FreeImage_ConvertLine1To16_555(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib));
 				}
 
 				return new_dib;
@@ -164,7 +164,7 @@ FreeImage_ConvertTo16Bits555(FIBITMAP *dib) {
 			case 4 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine4To16_555(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib));
+					FreeImage_ConvertLine4To16_555(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib));
 				}
 
 				return new_dib;
@@ -173,7 +173,7 @@ FreeImage_ConvertTo16Bits555(FIBITMAP *dib) {
 			case 8 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine8To16_555(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib));
+					FreeImage_ConvertLine8To16_555(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib));
 				}
 
 				return new_dib;
@@ -182,7 +182,7 @@ FreeImage_ConvertTo16Bits555(FIBITMAP *dib) {
 			case 24 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine24To16_555(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+					FreeImage_ConvertLine24To16_555(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 				}
 
 				return new_dib;
@@ -191,7 +191,7 @@ FreeImage_ConvertTo16Bits555(FIBITMAP *dib) {
 			case 32 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine32To16_555(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+					FreeImage_ConvertLine32To16_555(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 				}
 
 				return new_dib;
@@ -125,7 +125,7 @@ FreeImage_ConvertTo16Bits565(FIBITMAP *dib) {
 				return nullptr;
 			}
 			for (int rows = 0; rows < height; rows++) {
-				FreeImage_ConvertLine16_555_To16_565(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+				FreeImage_ConvertLine16_555_To16_565(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 			}
 
 			// copy metadata from src to dst
@@ -151,7 +151,7 @@ FreeImage_ConvertTo16Bits565(FIBITMAP *dib) {
 			case 1 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine1To16_565(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib));
+					FreeImage_ConvertLine1To16_565(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib));
 				}
 
 				return new_dib;
@@ -160,7 +160,7 @@ FreeImage_ConvertTo16Bits565(FIBITMAP *dib) {
 			case 4 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine4To16_565(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib));
+					FreeImage_ConvertLine4To16_565(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib));
 				}
 
 				return new_dib;
@@ -169,7 +169,7 @@ FreeImage_ConvertTo16Bits565(FIBITMAP *dib) {
 			case 8 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine8To16_565(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib));
+					FreeImage_ConvertLine8To16_565(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib));
 				}
 
 				return new_dib;
@@ -178,7 +178,7 @@ FreeImage_ConvertTo16Bits565(FIBITMAP *dib) {
 			case 24 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine24To16_565(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+					FreeImage_ConvertLine24To16_565(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 				}
 
 				return new_dib;
@@ -187,7 +187,7 @@ FreeImage_ConvertTo16Bits565(FIBITMAP *dib) {
 			case 32 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine32To16_565(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+					FreeImage_ConvertLine32To16_565(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 				}
 
 				return new_dib;
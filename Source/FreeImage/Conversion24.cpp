@@ -150,7 +150,7 @@ FreeImage_ConvertTo24Bits(FIBITMAP *dib) {
 			case 1 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine1To24(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib));					
+					FreeImage_ConvertLine1To24(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib));					
 				}
 				return new_dib;
 			}
@@ -158,7 +158,7 @@ FreeImage_ConvertTo24Bits(FIBITMAP *dib) {
 			case 4 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine4To24(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib));
+					FreeImage_ConvertLine4To24(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib));
 				}
 				return new_dib;
 			}
@@ -166,7 +166,7 @@ FreeImage_ConvertTo24Bits(FIBITMAP *dib) {
 			case 8 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine8To24(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib));
+					FreeImage_ConvertLine8To24(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib));
 				}
 				return new_dib;
 			}
@@ -175,10 +175,10 @@ FreeImage_ConvertTo24Bits(FIBITMAP *dib) {
 			{
 				for (int rows = 0; rows < height; rows++) {
 					if ((FreeImage_GetRedMask(dib) == FI16_565_RED_MASK) && (FreeImage_GetGreenMask(dib) == FI16_565_GREEN_MASK) && (FreeImage_GetBlueMask(dib) == FI16_565_BLUE_MASK)) {
-						FreeImage_ConvertLine16To24_565(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+						FreeImage_ConvertLine16To24_565(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 					} else {
 						// includes case where all the masks are 0
-						FreeImage_ConvertLine16To24_555(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+						FreeImage_ConvertLine16To24_555(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 					}
 				}
 				return new_dib;
@@ -187,7 +187,7 @@ FreeImage_ConvertTo24Bits(FIBITMAP *dib) {
 			case 32 :
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine32To24(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+					FreeImage_ConvertLine32To24(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 				}
 				return new_dib;
 			}
@@ -204,7 +204,7 @@ FreeImage_ConvertTo24Bits(FIBITMAP *dib) {
 
 		const unsigned src_pitch = FreeImage_GetPitch(dib);
 		const unsigned dst_pitch = FreeImage_GetPitch(new_dib);
-		const uint8_t *src_bits = FreeImage_GetBits(dib);
+		const uint8_t *src_bits = FreeImage_GetConstBits(dib);
 		uint8_t *dst_bits = FreeImage_GetBits(new_dib);
 		for (int rows = 0; rows < height; rows++) {
 			const FIRGB16 *src_pixel = (FIRGB16*)src_bits;
@@ -231,7 +231,7 @@ FreeImage_ConvertTo24Bits(FIBITMAP *dib) {
 
 		const unsigned src_pitch = FreeImage_GetPitch(dib);
 		const unsigned dst_pitch = FreeImage_GetPitch(new_dib);
-		const uint8_t *src_bits = FreeImage_GetBits(dib);
+		const uint8_t *src_bits = FreeImage_GetConstBits(dib);
 		uint8_t *dst_bits = FreeImage_GetBits(new_dib);
 		for (int rows = 0; rows < height; rows++) {
 			const FIRGBA16 *src_pixel = (FIRGBA16*)src_bits;
@@ -219,11 +219,11 @@ FreeImage_ConvertTo32Bits(FIBITMAP *dib) {
 			{
 				if(bIsTransparent) {
 					for (int rows = 0; rows < height; rows++) {
-						FreeImage_ConvertLine1To32MapTransparency(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib), FreeImage_GetTransparencyTable(dib), FreeImage_GetTransparencyCount(dib));
+						FreeImage_ConvertLine1To32MapTransparency(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib), FreeImage_GetTransparencyTable(dib), FreeImage_GetTransparencyCount(dib));
 					}
 				} else {
 					for (int rows = 0; rows < height; rows++) {
-						FreeImage_ConvertLine1To32(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib));
+						FreeImage_ConvertLine1To32(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib));
 					}					
 				}
 
@@ -234,11 +234,11 @@ FreeImage_ConvertTo32Bits(FIBITMAP *dib) {
 			{
 				if(bIsTransparent) {
 					for (int rows = 0; rows < height; rows++) {
-						FreeImage_ConvertLine4To32MapTransparency(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib), FreeImage_GetTransparencyTable(dib), FreeImage_GetTransparencyCount(dib));
+						FreeImage_ConvertLine4To32MapTransparency(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib), FreeImage_GetTransparencyTable(dib), FreeImage_GetTransparencyCount(dib));
 					}
 				} else {
 					for (int rows = 0; rows < height; rows++) {
-						FreeImage_ConvertLine4To32(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib));
+						FreeImage_ConvertLine4To32(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib));
 					}					
 				}
 
@@ -249,11 +249,11 @@ FreeImage_ConvertTo32Bits(FIBITMAP *dib) {
 			{
 				if(bIsTransparent) {
 					for (int rows = 0; rows < height; rows++) {
-						FreeImage_ConvertLine8To32MapTransparency(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib), FreeImage_GetTransparencyTable(dib), FreeImage_GetTransparencyCount(dib));
+						FreeImage_ConvertLine8To32MapTransparency(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib), FreeImage_GetTransparencyTable(dib), FreeImage_GetTransparencyCount(dib));
 					}
 				} else {
 					for (int rows = 0; rows < height; rows++) {
-						FreeImage_ConvertLine8To32(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib));
+						FreeImage_ConvertLine8To32(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib));
 					}					
 				}
 
@@ -264,10 +264,10 @@ FreeImage_ConvertTo32Bits(FIBITMAP *dib) {
 			{
 				for (int rows = 0; rows < height; rows++) {
 					if (/*(FreeImage_GetRedMask(dib) == FI16_565_RED_MASK) && */(FreeImage_GetGreenMask(dib) == FI16_565_GREEN_MASK)/* && (FreeImage_GetBlueMask(dib) == FI16_565_BLUE_MASK)*/) {
-						FreeImage_ConvertLine16To32_565(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+						FreeImage_ConvertLine16To32_565(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 					} else {
 						// includes case where all the masks are 0
-						FreeImage_ConvertLine16To32_555(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+						FreeImage_ConvertLine16To32_555(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 					}
 				}
 
@@ -277,7 +277,7 @@ FreeImage_ConvertTo32Bits(FIBITMAP *dib) {
 			case 24:
 			{
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine24To32(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+					FreeImage_ConvertLine24To32(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 				}
 
 				return new_dib;
@@ -295,7 +295,7 @@ FreeImage_ConvertTo32Bits(FIBITMAP *dib) {
 
 		const unsigned src_pitch = FreeImage_GetPitch(dib);
 		const unsigned dst_pitch = FreeImage_GetPitch(new_dib);
-		const uint8_t *src_bits = FreeImage_GetBits(dib);
+		const uint8_t *src_bits = FreeImage_GetConstBits(dib);
 		uint8_t *dst_bits = FreeImage_GetBits(new_dib);
 		for (int rows = 0; rows < height; rows++) {
 			const FIRGB16 *src_pixel = (FIRGB16*)src_bits;
@@ -323,7 +323,7 @@ FreeImage_ConvertTo32Bits(FIBITMAP *dib) {
 
 		const unsigned src_pitch = FreeImage_GetPitch(dib);
 		const unsigned dst_pitch = FreeImage_GetPitch(new_dib);
-		const uint8_t *src_bits = FreeImage_GetBits(dib);
+		const uint8_t *src_bits = FreeImage_GetConstBits(dib);
 		uint8_t *dst_bits = FreeImage_GetBits(new_dib);
 		for (int rows = 0; rows < height; rows++) {
 			const FIRGBA16 *src_pixel = (FIRGBA16*)src_bits;
@@ -190,7 +190,7 @@ FreeImage_ConvertTo4Bits(FIBITMAP *dib) {
 				// Expand and copy the bitmap data
 
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine1To4(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+					FreeImage_ConvertLine1To4(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 				}
 				return new_dib;
 			}
@@ -200,7 +200,7 @@ FreeImage_ConvertTo4Bits(FIBITMAP *dib) {
 				// Expand and copy the bitmap data
 
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine8To4(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width, FreeImage_GetPalette(dib));
+					FreeImage_ConvertLine8To4(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width, FreeImage_GetPalette(dib));
 				}
 				return new_dib;
 			}
@@ -211,9 +211,9 @@ FreeImage_ConvertTo4Bits(FIBITMAP *dib) {
 
 				for (int rows = 0; rows < height; rows++) {
 					if ((FreeImage_GetRedMask(dib) == FI16_565_RED_MASK) && (FreeImage_GetGreenMask(dib) == FI16_565_GREEN_MASK) && (FreeImage_GetBlueMask(dib) == FI16_565_BLUE_MASK)) {
-						FreeImage_ConvertLine16To4_565(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+						FreeImage_ConvertLine16To4_565(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 					} else {
-						FreeImage_ConvertLine16To4_555(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+						FreeImage_ConvertLine16To4_555(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 					}
 				}
 				
@@ -225,7 +225,7 @@ FreeImage_ConvertTo4Bits(FIBITMAP *dib) {
 				// Expand and copy the bitmap data
 
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine24To4(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);					
+					FreeImage_ConvertLine24To4(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);					
 				}
 				return new_dib;
 			}
@@ -235,7 +235,7 @@ FreeImage_ConvertTo4Bits(FIBITMAP *dib) {
 				// Expand and copy the bitmap data
 
 				for (int rows = 0; rows < height; rows++) {
-					FreeImage_ConvertLine32To4(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+					FreeImage_ConvertLine32To4(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 				}
 				return new_dib;
 			}
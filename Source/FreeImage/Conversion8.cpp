@@ -144,7 +144,7 @@ FreeImage_ConvertTo8Bits(FIBITMAP *dib) {
 
 					// Expand and copy the bitmap data
 					for (unsigned rows = 0; rows < height; rows++) {
-						FreeImage_ConvertLine1To8(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+						FreeImage_ConvertLine1To8(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 					}
 					return new_dib;
 				}
@@ -158,7 +158,7 @@ FreeImage_ConvertTo8Bits(FIBITMAP *dib) {
 
 					// Expand and copy the bitmap data
 					for (unsigned rows = 0; rows < height; rows++) {
-						FreeImage_ConvertLine4To8(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);					
+						FreeImage_ConvertLine4To8(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);					
 					}
 					return new_dib;
 				}
@@ -168,11 +168,11 @@ FreeImage_ConvertTo8Bits(FIBITMAP *dib) {
 					// Expand and copy the bitmap data
 					if (IS_FORMAT_RGB565(dib)) {
 						for (unsigned rows = 0; rows < height; rows++) {
-							FreeImage_ConvertLine16To8_565(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+							FreeImage_ConvertLine16To8_565(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 						}
 					} else {
 						for (unsigned rows = 0; rows < height; rows++) {
-							FreeImage_ConvertLine16To8_555(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+							FreeImage_ConvertLine16To8_555(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 						}
 					}
 					return new_dib;
@@ -182,7 +182,7 @@ FreeImage_ConvertTo8Bits(FIBITMAP *dib) {
 				{
 					// Expand and copy the bitmap data
 					for (unsigned rows = 0; rows < height; rows++) {
-						FreeImage_ConvertLine24To8(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);					
+						FreeImage_ConvertLine24To8(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);					
 					}
 					return new_dib;
 				}
@@ -191,7 +191,7 @@ FreeImage_ConvertTo8Bits(FIBITMAP *dib) {
 				{
 					// Expand and copy the bitmap data
 					for (unsigned rows = 0; rows < height; rows++) {
-						FreeImage_ConvertLine32To8(FreeImage_GetScanLine(new_dib, rows), FreeImage_GetScanLine(dib, rows), width);
+						FreeImage_ConvertLine32To8(FreeImage_GetScanLine(new_dib, rows), (uint8_t*)FreeImage_GetConstScanLine(dib, rows), width);
 					}
 					return new_dib;
 				}
@@ -201,7 +201,7 @@ FreeImage_ConvertTo8Bits(FIBITMAP *dib) {
 
 			const unsigned src_pitch = FreeImage_GetPitch(dib);
 			const unsigned dst_pitch = FreeImage_GetPitch(new_dib);
-			const uint8_t *src_bits = FreeImage_GetBits(dib);
+			const uint8_t *src_bits = FreeImage_GetConstBits(dib);
 			uint8_t *dst_bits = FreeImage_GetBits(new_dib);
 
 			for (unsigned rows = 0; rows < height; rows++) {
@@ -252,7 +252,7 @@ FreeImage_ConvertToGreyscale(FIBITMAP *dib) {
 			pal++;
 		}
 
-		const uint8_t *src_bits = FreeImage_GetBits(dib);
+		const uint8_t *src_bits = FreeImage_GetConstBits(dib);
 		uint8_t *dst_bits = FreeImage_GetBits(new_dib);
 
 		const unsigned src_pitch = FreeImage_GetPitch(dib);
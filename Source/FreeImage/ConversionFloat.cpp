@@ -83,7 +83,7 @@ FreeImage_ConvertToFloat(FIBITMAP *dib) {
 	const unsigned src_pitch = FreeImage_GetPitch(src);
 	const unsigned dst_pitch = FreeImage_GetPitch(dst);
 
-	const uint8_t *src_bits = (uint8_t*)FreeImage_GetBits(src);
+	const uint8_t *src_bits = FreeImage_GetConstBits(src);
 	uint8_t *dst_bits = (uint8_t*)FreeImage_GetBits(dst);
 
 	switch(src_type) {
@@ -89,7 +89,7 @@ FreeImage_ConvertToRGBA16(FIBITMAP *dib) {
 			const unsigned bytespp = FreeImage_GetLine(src) / FreeImage_GetWidth(src);
 
 			for(unsigned y = 0; y < height; y++) {
-				const uint8_t *src_bits = (uint8_t*)FreeImage_GetScanLine(src, y);
+				const uint8_t *src_bits = (const uint8_t*)FreeImage_GetConstScanLine(src, y);
 				FIRGBA16 *dst_bits = (FIRGBA16*)FreeImage_GetScanLine(dst, y);
 				for(unsigned x = 0; x < width; x++) {
 					dst_bits[x].red		= src_bits[FI_RGBA_RED] << 8;
@@ -105,7 +105,7 @@ FreeImage_ConvertToRGBA16(FIBITMAP *dib) {
 		case FIT_UINT16:
 		{
 			for(unsigned y = 0; y < height; y++) {
-				const uint16_t *src_bits = (uint16_t*)FreeImage_GetScanLine(src, y);
+				const uint16_t *src_bits = (const uint16_t*)FreeImage_GetConstScanLine(src, y);
 				FIRGBA16 *dst_bits = (FIRGBA16*)FreeImage_GetScanLine(dst, y);
 				for(unsigned x = 0; x < width; x++) {
 					// convert by copying greyscale channel to each R, G, B channels
@@ -121,7 +121,7 @@ FreeImage_ConvertToRGBA16(FIBITMAP *dib) {
 		case FIT_RGB16:
 		{
 			for(unsigned y = 0; y < height; y++) {
-				const FIRGB16 *src_bits = (FIRGB16*)FreeImage_GetScanLine(src, y);
+				const FIRGB16 *src_bits = (const FIRGB16*)FreeImage_GetConstScanLine(src, y);
 				FIRGBA16 *dst_bits = (FIRGBA16*)FreeImage_GetScanLine(dst, y);
 				for(unsigned x = 0; x < width; x++) {
 					// convert pixels directly, while adding a "dummy" alpha of 1.0
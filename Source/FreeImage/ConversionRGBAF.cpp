@@ -105,7 +105,7 @@ FreeImage_ConvertToRGBAF(FIBITMAP *dib) {
 			// calculate the number of bytes per pixel (4 for 32-bit)
 			const unsigned bytespp = FreeImage_GetLine(src) / FreeImage_GetWidth(src);
 
-			const uint8_t *src_bits = (uint8_t*)FreeImage_GetBits(src);
+			const uint8_t *src_bits = FreeImage_GetConstBits(src);
 			uint8_t *dst_bits = (uint8_t*)FreeImage_GetBits(dst);
 
 			for(unsigned y = 0; y < height; y++) {
@@ -129,7 +129,7 @@ FreeImage_ConvertToRGBAF(FIBITMAP *dib) {
 
 		case FIT_UINT16:
 		{
-			const uint8_t *src_bits = (uint8_t*)FreeImage_GetBits(src);
+			const uint8_t *src_bits = FreeImage_GetConstBits(src);
 			uint8_t *dst_bits = (uint8_t*)FreeImage_GetBits(dst);
 
 			for(unsigned y = 0; y < height; y++) {
@@ -152,7 +152,7 @@ FreeImage_ConvertToRGBAF(FIBITMAP *dib) {
 
 		case FIT_RGB16:
 		{
-			const uint8_t *src_bits = (uint8_t*)FreeImage_GetBits(src);
+			const uint8_t *src_bits = FreeImage_GetConstBits(src);
 			uint8_t *dst_bits = (uint8_t*)FreeImage_GetBits(dst);
 
 			for(unsigned y = 0; y < height; y++) {
@@ -174,7 +174,7 @@ FreeImage_ConvertToRGBAF(FIBITMAP *dib) {
 
 		case FIT_RGBA16:
 		{
-			const uint8_t *src_bits = (uint8_t*)FreeImage_GetBits(src);
+			const uint8_t *src_bits = FreeImage_GetConstBits(src);
 			uint8_t *dst_bits = (uint8_t*)FreeImage_GetBits(dst);
 
 			for(unsigned y = 0; y < height; y++) {
@@ -196,7 +196,7 @@ FreeImage_ConvertToRGBAF(FIBITMAP *dib) {
 
 		case FIT_FLOAT:
 		{
-			const uint8_t *src_bits = (uint8_t*)FreeImage_GetBits(src);
+			const uint8_t *src_bits = FreeImage_GetConstBits(src);
 			uint8_t *dst_bits = (uint8_t*)FreeImage_GetBits(dst);
 
 			for(unsigned y = 0; y < height; y++) {
@@ -220,7 +220,7 @@ FreeImage_ConvertToRGBAF(FIBITMAP *dib) {
 
 		case FIT_RGBF:
 		{
-			const uint8_t *src_bits = (uint8_t*)FreeImage_GetBits(src);
+			const uint8_t *src_bits = FreeImage_GetConstBits(src);
 			uint8_t *dst_bits = (uint8_t*)FreeImage_GetBits(dst);
 
 			for(unsigned y = 0; y < height; y++) {
@@ -104,7 +104,7 @@ FreeImage_ConvertToRGBF(FIBITMAP *dib) {
 			// calculate the number of bytes per pixel (3 for 24-bit or 4 for 32-bit)
 			const unsigned bytespp = FreeImage_GetLine(src) / FreeImage_GetWidth(src);
 
-			const uint8_t *src_bits = (uint8_t*)FreeImage_GetBits(src);
+			const uint8_t *src_bits = FreeImage_GetConstBits(src);
 			uint8_t *dst_bits = (uint8_t*)FreeImage_GetBits(dst);
 
 			for(unsigned y = 0; y < height; y++) {
@@ -127,7 +127,7 @@ FreeImage_ConvertToRGBF(FIBITMAP *dib) {
 
 		case FIT_UINT16:
 		{
-			const uint8_t *src_bits = (uint8_t*)FreeImage_GetBits(src);
+			const uint8_t *src_bits = FreeImage_GetConstBits(src);
 			uint8_t *dst_bits = (uint8_t*)FreeImage_GetBits(dst);
 
 			for(unsigned y = 0; y < height; y++) {
@@ -149,7 +149,7 @@ FreeImage_ConvertToRGBF(FIBITMAP *dib) {
 
 		case FIT_RGB16:
 		{
-			const uint8_t *src_bits = (uint8_t*)FreeImage_GetBits(src);
+			const uint8_t *src_bits = FreeImage_GetConstBits(src);
 			uint8_t *dst_bits = (uint8_t*)FreeImage_GetBits(dst);
 
 			for(unsigned y = 0; y < height; y++) {
@@ -170,7 +170,7 @@ FreeImage_ConvertToRGBF(FIBITMAP *dib) {
 
 		case FIT_RGBA16:
 		{
-			const uint8_t *src_bits = (uint8_t*)FreeImage_GetBits(src);
+			const uint8_t *src_bits = FreeImage_GetConstBits(src);
 			uint8_t *dst_bits = (uint8_t*)FreeImage_GetBits(dst);
 
 			for(unsigned y = 0; y < height; y++) {
@@ -191,7 +191,7 @@ FreeImage_ConvertToRGBF(FIBITMAP *dib) {
 
 		case FIT_FLOAT:
 		{
-			const uint8_t *src_bits = (uint8_t*)FreeImage_GetBits(src);
+			const uint8_t *src_bits = FreeImage_GetConstBits(src);
 			uint8_t *dst_bits = (uint8_t*)FreeImage_GetBits(dst);
 
 			for(unsigned y = 0; y < height; y++) {
@@ -214,7 +214,7 @@ FreeImage_ConvertToRGBF(FIBITMAP *dib) {
 
 		case FIT_RGBAF:
 		{
-			const uint8_t *src_bits = (uint8_t*)FreeImage_GetBits(src);
+			const uint8_t *src_bits = FreeImage_GetConstBits(src);
 			uint8_t *dst_bits = (uint8_t*)FreeImage_GetBits(dst);
 
 			for(unsigned y = 0; y < height; y++) {
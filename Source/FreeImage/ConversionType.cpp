@@ -53,7 +53,7 @@ CONVERT_TYPE<Tdst, Tsrc>::convert(FIBITMAP *src, FREE_IMAGE_TYPE dst_type) {
 	// convert from src_type to dst_type
 	
 	for(unsigned y = 0; y < height; y++) {
-		const Tsrc *src_bits = reinterpret_cast<Tsrc*>(FreeImage_GetScanLine(src, y));
+		const Tsrc *src_bits = reinterpret_cast<const Tsrc*>(FreeImage_GetConstScanLine(src, y));
 		Tdst *dst_bits = reinterpret_cast<Tdst*>(FreeImage_GetScanLine(dst, y));
 
 		for(unsigned x = 0; x < width; x++) {
@@ -107,7 +107,7 @@ CONVERT_TO_BYTE<Tsrc>::convert(FIBITMAP *src, BOOL scale_linear) {
 		Tsrc l_min, l_max;
 		min = 255, max = 0;
 		for(y = 0; y < height; y++) {
-			Tsrc *bits = reinterpret_cast<Tsrc*>(FreeImage_GetScanLine(src, y));
+			const Tsrc *bits = reinterpret_cast<const Tsrc*>(FreeImage_GetConstScanLine(src, y));
 			MAXMIN(bits, width, l_max, l_min);
 			if(l_max > max) max = l_max;
 			if(l_min < min) min = l_min;
@@ -121,7 +121,7 @@ CONVERT_TO_BYTE<Tsrc>::convert(FIBITMAP *src, BOOL scale_linear) {
 
 		// scale to 8-bit
 		for(y = 0; y < height; y++) {
-			Tsrc *src_bits = reinterpret_cast<Tsrc*>(FreeImage_GetScanLine(src, y));
+			const Tsrc *src_bits = reinterpret_cast<const Tsrc*>(FreeImage_GetConstScanLine(src, y));
 			uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 			for(x = 0; x < width; x++) {
 				dst_bits[x] = (uint8_t)( scale * (src_bits[x] - min) + 0.5);
@@ -129,7 +129,7 @@ CONVERT_TO_BYTE<Tsrc>::convert(FIBITMAP *src, BOOL scale_linear) {
 		}
 	} else {
 		for(y = 0; y < height; y++) {
-			Tsrc *src_bits = reinterpret_cast<Tsrc*>(FreeImage_GetScanLine(src, y));
+			const Tsrc *src_bits = reinterpret_cast<const Tsrc*>(FreeImage_GetConstScanLine(src, y));
 			uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 			for(x = 0; x < width; x++) {
 				// rounding
@@ -166,7 +166,7 @@ CONVERT_TO_COMPLEX<Tsrc>::convert(FIBITMAP *src) {
 	// convert from src_type to FIT_COMPLEX
 	
 	for(unsigned y = 0; y < height; y++) {
-		const Tsrc *src_bits = reinterpret_cast<Tsrc*>(FreeImage_GetScanLine(src, y));
+		const Tsrc *src_bits = reinterpret_cast<const Tsrc*>(FreeImage_GetConstScanLine(src, y));
 		FICOMPLEX *dst_bits = (FICOMPLEX *)FreeImage_GetScanLine(dst, y);
 
 		for(unsigned x = 0; x < width; x++) {
@@ -86,7 +86,7 @@ FreeImage_ConvertToUINT16(FIBITMAP *dib) {
 		case FIT_BITMAP:
 		{
 			for(unsigned y = 0; y < height; y++) {
-				const uint8_t *src_bits = (uint8_t*)FreeImage_GetScanLine(src, y);
+				const uint8_t *src_bits = (const uint8_t*)FreeImage_GetConstScanLine(src, y);
 				uint16_t *dst_bits = (uint16_t*)FreeImage_GetScanLine(dst, y);
 				for(unsigned x = 0; x < width; x++) {
 					dst_bits[x] = src_bits[x] << 8;
@@ -98,7 +98,7 @@ FreeImage_ConvertToUINT16(FIBITMAP *dib) {
 		case FIT_RGB16:
 		{
 			for(unsigned y = 0; y < height; y++) {
-				const FIRGB16 *src_bits = (FIRGB16*)FreeImage_GetScanLine(src, y);
+				const FIRGB16 *src_bits = (const FIRGB16*)FreeImage_GetConstScanLine(src, y);
 				uint16_t *dst_bits = (uint16_t*)FreeImage_GetScanLine(dst, y);
 				for(unsigned x = 0; x < width; x++) {
 					// convert to grey
@@ -111,7 +111,7 @@ FreeImage_ConvertToUINT16(FIBITMAP *dib) {
 		case FIT_RGBA16:
 		{
 			for(unsigned y = 0; y < height; y++) {
-				const FIRGBA16 *src_bits = (FIRGBA16*)FreeImage_GetScanLine(src, y);
+				const FIRGBA16 *src_bits = (const FIRGBA16*)FreeImage_GetConstScanLine(src, y);
 				uint16_t *dst_bits = (uint16_t*)FreeImage_GetScanLine(dst, y);
 				for(unsigned x = 0; x < width; x++) {
 					// convert to grey
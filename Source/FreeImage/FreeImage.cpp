@@ -22,8 +22,11 @@
 // ==========================================================
 
 
+#include <atomic>
+
 #include "FreeImage.h"
 #include "Utilities.h"
+#include "Threading.h"
 
 //----------------------------------------------------------------------
 
@@ -100,6 +103,32 @@ FreeImage_IsLittleEndian() {
 
 //----------------------------------------------------------------------
 
+// number of worker threads set by the user (-1 means 'not set')
+static std::atomic<int> s_thread_count(-1);
+
+void DLL_CALLCONV
+FreeImage_SetThreadCount(int count) {
+	// 0 means 'one thread per hardware thread', a negative value restores the 'not set' state
+	s_thread_count = (count < 0) ? -1 : count;
+}
+
+int DLL_CALLCONV
+FreeImage_GetThreadCount() {
+	return (int)GetWorkerCount(FALSE);
+}
+
+unsigned 
+GetWorkerCount(BOOL force) {
+	const int thread_count = s_thread_count;
+	if ((thread_count < 0 && force) || (thread_count == 0)) {
+		const unsigned hardware_threads = std::thread::hardware_concurrency();
+		return (hardware_threads > 0) ? hardware_threads : 1;
+	}
+	return (thread_count > 0) ? (unsigned)thread_count : 1;
+}
+
+//----------------------------------------------------------------------
+
 static FreeImage_OutputMessageFunction freeimage_outputmessage_proc = nullptr;
 static FreeImage_OutputMessageFunctionStdCall freeimage_outputmessagestdcall_proc = nullptr; 
 
@@ -23,6 +23,13 @@
 #include "Utilities.h"
 #include "FreeImageIO.h"
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 // =====================================================================
 // File IO functions
 // =====================================================================
@@ -47,6 +54,24 @@ _TellProc(fi_handle handle) {
 	return ftell((FILE *)handle);
 }
 
+static int
+_Seek64Proc(fi_handle handle, int64_t offset, int origin) {
+#ifdef _WIN32
+	return _fseeki64((FILE *)handle, offset, origin);
+#else
+	return fseeko((FILE *)handle, (off_t)offset, origin);
+#endif
+}
+
+static int64_t
+_Tell64Proc(fi_handle handle) {
+#ifdef _WIN32
+	return _ftelli64((FILE *)handle);
+#else
+	return (int64_t)ftello((FILE *)handle);
+#endif
+}
+
 // ----------------------------------------------------------
 
 void
@@ -61,18 +86,195 @@ SetDefaultIO(FreeImageIO *io) {
 // Memory IO functions
 // =====================================================================
 
+/**
+Maximum size of a memory stream
+*/
+static const uint64_t MEMORY_STREAM_MAX_SIZE = (sizeof(size_t) > 4) ? (uint64_t)INT64_MAX : (uint64_t)0x7FFFFFFF;
+
+// ----------------------------------------------------------
+//  Segmented memory streams
+// ----------------------------------------------------------
+
+/**
+Make sure the segments covering the bytes [0, length) of a segmented stream are allocated
+@return Returns TRUE if successful, returns FALSE otherwise
+*/
+static BOOL
+ReserveMemorySegments(FIMEMORYHEADER *mem_header, int64_t length) {
+	const unsigned segment_size = mem_header->segment_size;
+	const uint64_t needed_segments = ((uint64_t)length + segment_size - 1) / segment_size;
+	if(needed_segments > (UINT_MAX >> 1)) {
+		return FALSE;
+	}
+	const unsigned needed = (unsigned)needed_segments;
+
+	if(needed > mem_header->segment_capacity) {
+		const unsigned capacity = MAX(needed, MAX(2 * mem_header->segment_capacity, 16U));
+		uint8_t **segments = (uint8_t**)realloc(mem_header->segments, capacity * sizeof(uint8_t*));
+		if(!segments) {
+			return FALSE;
+		}
+		mem_header->segments = segments;
+		mem_header->segment_capacity = capacity;
+	}
+	while(mem_header->segment_count < needed) {
+		uint8_t *segment = (uint8_t*)malloc(segment_size);
+		if(!segment) {
+			return FALSE;
+		}
+		mem_header->segments[mem_header->segment_count++] = segment;
+		mem_header->data_length = (int64_t)mem_header->segment_count * segment_size;
+	}
+	return TRUE;
+}
+
+/**
+Copy bytes into a segmented stream, or zero-fill the stream when src is nullptr
+*/
+static void
+WriteMemorySegments(FIMEMORYHEADER *mem_header, int64_t position, const uint8_t *src, size_t length) {
+	const unsigned segment_size = mem_header->segment_size;
+
+	while(length > 0) {
+		uint8_t *dst = mem_header->segments[position / segment_size] + (position % segment_size);
+		const size_t n = MIN(length, (size_t)(segment_size - (position % segment_size)));
+		if(src) {
+			memcpy(dst, src, n);
+			src += n;
+		} else {
+			memset(dst, 0, n);
+		}
+		position += (int64_t)n;
+		length -= n;
+	}
+}
+
+/**
+Copy bytes out of a segmented stream
+*/
+static void
+ReadMemorySegments(const FIMEMORYHEADER *mem_header, int64_t position, uint8_t *dst, size_t length) {
+	const unsigned segment_size = mem_header->segment_size;
+
+	while(length > 0) {
+		const uint8_t *src = mem_header->segments[position / segment_size] + (position % segment_size);
+		const size_t n = MIN(length, (size_t)(segment_size - (position % segment_size)));
+		memcpy(dst, src, n);
+		dst += n;
+		position += (int64_t)n;
+		length -= n;
+	}
+}
+
+static unsigned
+SegmentedReadProc(void *buffer, unsigned size, unsigned count, FIMEMORYHEADER *mem_header) {
+	const int64_t remaining_bytes = mem_header->file_length - mem_header->current_position;
+	if((size == 0) || (remaining_bytes <= 0)) {
+		if(remaining_bytes < 0) {
+			mem_header->current_position = mem_header->file_length;
+		}
+		return 0;
+	}
+
+	// copy all the complete items
+	const unsigned items = (unsigned)MIN((uint64_t)count, (uint64_t)remaining_bytes / size);
+	ReadMemorySegments(mem_header, mem_header->current_position, (uint8_t*)buffer, (size_t)items * size);
+	mem_header->current_position += (int64_t)items * size;
+
+	//if there isn't size bytes left to read, copy the last bytes, set pos to eof and return a short count
+	if(items < count) {
+		const int64_t tail = mem_header->file_length - mem_header->current_position;
+		if(tail > 0) {
+			ReadMemorySegments(mem_header, mem_header->current_position, (uint8_t*)buffer + (size_t)items * size, (size_t)tail);
+		}
+		mem_header->current_position = mem_header->file_length;
+	}
+	return items;
+}
+
+static unsigned
+SegmentedWriteProc(void *buffer, unsigned size, unsigned count, FIMEMORYHEADER *mem_header) {
+	const uint64_t length = (uint64_t)size * count;
+	const uint64_t end = (uint64_t)mem_header->current_position + length;
+
+	if(end > MEMORY_STREAM_MAX_SIZE) {
+		return 0;
+	}
+	if(!ReserveMemorySegments(mem_header, (int64_t)end)) {
+		return 0;
+	}
+	// clear the gap left by a seek beyond the end of the stream
+	if(mem_header->current_position > mem_header->file_length) {
+		WriteMemorySegments(mem_header, mem_header->file_length, nullptr, (size_t)(mem_header->current_position - mem_header->file_length));
+	}
+	WriteMemorySegments(mem_header, mem_header->current_position, (const uint8_t*)buffer, (size_t)length);
+
+	mem_header->current_position = (int64_t)end;
+	if( mem_header->current_position > mem_header->file_length ) {
+		mem_header->file_length = mem_header->current_position;
+	}
+	return count;
+}
+
+void
+FreeMemorySegments(FIMEMORYHEADER *mem_header) {
+	for(unsigned i = 0; i < mem_header->segment_count; i++) {
+		free(mem_header->segments[i]);
+	}
+	free(mem_header->segments);
+	mem_header->segments = nullptr;
+	mem_header->segment_count = 0;
+	mem_header->segment_capacity = 0;
+}
+
+BOOL
+FlattenMemorySegments(FIMEMORYHEADER *mem_header) {
+	if(!mem_header->segment_size) {
+		return TRUE;
+	}
+	uint8_t *data = (uint8_t*)malloc((size_t)MAX(mem_header->file_length, (int64_t)1));
+	if(!data) {
+		return FALSE;
+	}
+	ReadMemorySegments(mem_header, 0, data, (size_t)mem_header->file_length);
+	FreeMemorySegments(mem_header);
+
+	// the stream is now a contiguous stream
+	mem_header->segment_size = 0;
+	mem_header->data = data;
+	mem_header->data_length = MAX(mem_header->file_length, (int64_t)1);
+
+	return TRUE;
+}
+
+// ----------------------------------------------------------
+
 unsigned DLL_CALLCONV 
 _MemoryReadProc(void *buffer, unsigned size, unsigned count, fi_handle handle) {
 	unsigned x;
 
 	FIMEMORYHEADER *mem_header = (FIMEMORYHEADER*)(((FIMEMORY*)handle)->data);
 
+	if(mem_header->segment_size) {
+		return SegmentedReadProc(buffer, size, count, mem_header);
+	}
+
+	// fast path : copy all the complete items at once
+	if((size != 0) && (mem_header->current_position < mem_header->file_length)) {
+		const uint64_t remaining_items = (uint64_t)(mem_header->file_length - mem_header->current_position) / size;
+		if(remaining_items >= count) {
+			memcpy( buffer, (char *)mem_header->data + mem_header->current_position, (size_t)size * count );
+			mem_header->current_position += (int64_t)size * count;
+			return count;
+		}
+	}
+
 	for(x = 0; x < count; x++) {
-		long remaining_bytes = mem_header->file_length - mem_header->current_position;
+		int64_t remaining_bytes = mem_header->file_length - mem_header->current_position;
 		//if there isn't size bytes left to read, set pos to eof and return a short count
-		if( remaining_bytes < (long)size ) {
+		if( remaining_bytes < (int64_t)size ) {
 			if(remaining_bytes > 0) {
-				memcpy( buffer, (char *)mem_header->data + mem_header->current_position, remaining_bytes );
+				memcpy( buffer, (char *)mem_header->data + mem_header->current_position, (size_t)remaining_bytes );
 			}
 			mem_header->current_position = mem_header->file_length;
 			break;
@@ -87,44 +289,42 @@ _MemoryReadProc(void *buffer, unsigned size, unsigned count, fi_handle handle) {
 
 unsigned DLL_CALLCONV 
 _MemoryWriteProc(void *buffer, unsigned size, unsigned count, fi_handle handle) {
-	void *newdata;
-	long newdatalen;
-
 	FIMEMORYHEADER *mem_header = (FIMEMORYHEADER*)(((FIMEMORY*)handle)->data);
 
+	if(mem_header->segment_size) {
+		return SegmentedWriteProc(buffer, size, count, mem_header);
+	}
+
+	const uint64_t length = (uint64_t)size * count;
+	const uint64_t end = (uint64_t)mem_header->current_position + length;
+	if( end >= MEMORY_STREAM_MAX_SIZE ) {
+		return 0;
+	}
+
 	//double the data block size if we need to
-	while( (mem_header->current_position + (long)(size * count)) >= mem_header->data_length ) {
-		//if we are at or above 1G, we cant double without going negative
-		if( mem_header->data_length & 0x40000000 ) {
-			//max 2G
-			if( mem_header->data_length == 0x7FFFFFFF ) {
-				return 0;
-			}
-			newdatalen = 0x7FFFFFFF;
-		} else if( mem_header->data_length == 0 ) {
-			//default to 4K if nothing yet
-			newdatalen = 4096;
-		} else {
-			//double size
-			newdatalen = mem_header->data_length << 1;
+	if( (int64_t)end >= mem_header->data_length ) {
+		//default to 4K if nothing yet
+		uint64_t newdatalen = mem_header->data_length ? (uint64_t)mem_header->data_length : 4096;
+		while( newdatalen <= end ) {
+			newdatalen = MIN(newdatalen << 1, MEMORY_STREAM_MAX_SIZE);
 		}
-		newdata = realloc( mem_header->data, newdatalen );
+		void *newdata = realloc( mem_header->data, (size_t)newdatalen );
 		if( !newdata ) {
 			return 0;
 		}
 		mem_header->data = newdata;
-		mem_header->data_length = newdatalen;
+		mem_header->data_length = (int64_t)newdatalen;
 	}
-	memcpy( (char *)mem_header->data + mem_header->current_position, buffer, size * count );
-	mem_header->current_position += size * count;
+	memcpy( (char *)mem_header->data + mem_header->current_position, buffer, (size_t)length );
+	mem_header->current_position = (int64_t)end;
 	if( mem_header->current_position > mem_header->file_length ) {
 		mem_header->file_length = mem_header->current_position;
 	}
 	return count;
 }
 
-int DLL_CALLCONV 
-_MemorySeekProc(fi_handle handle, long offset, int origin) {
+static int
+_MemorySeek64Proc(fi_handle handle, int64_t offset, int origin) {
 	FIMEMORYHEADER *mem_header = (FIMEMORYHEADER*)(((FIMEMORY*)handle)->data);
 
 	// you can use _MemorySeekProc to reposition the pointer anywhere in a file
@@ -132,7 +332,7 @@ _MemorySeekProc(fi_handle handle, long offset, int origin) {
 
 	switch(origin) { //0 to filelen-1 are 'inside' the file
 		default:
-		case SEEK_SET: //can fseek() to 0-7FFFFFFF always
+		case SEEK_SET:
 			if( offset >= 0 ) {
 				mem_header->current_position = offset;
 				return 0;
@@ -157,13 +357,26 @@ _MemorySeekProc(fi_handle handle, long offset, int origin) {
 	return -1;
 }
 
-long DLL_CALLCONV 
-_MemoryTellProc(fi_handle handle) {
+static int64_t
+_MemoryTell64Proc(fi_handle handle) {
 	FIMEMORYHEADER *mem_header = (FIMEMORYHEADER*)(((FIMEMORY*)handle)->data);
 
 	return mem_header->current_position;
 }
 
+int DLL_CALLCONV 
+_MemorySeekProc(fi_handle handle, long offset, int origin) {
+	return _MemorySeek64Proc(handle, offset, origin);
+}
+
+long DLL_CALLCONV 
+_MemoryTellProc(fi_handle handle) {
+	const int64_t position = _MemoryTell64Proc(handle);
+
+	// the position of a stream larger than 2 GB may not fit into a long
+	return (position <= std::numeric_limits<long>::max()) ? (long)position : -1L;
+}
+
 // ----------------------------------------------------------
 
 void
@@ -173,3 +386,204 @@ SetMemoryIO(FreeImageIO *io) {
 	io->tell_proc  = _MemoryTellProc;
 	io->write_proc = _MemoryWriteProc;
 }
+
+// =====================================================================
+// 64-bit IO functions
+// =====================================================================
+
+static unsigned DLL_CALLCONV 
+_IO64ReadProc(void *buffer, unsigned size, unsigned count, fi_handle handle) {
+	FIIO64HANDLE *io64_handle = (FIIO64HANDLE*)handle;
+	return io64_handle->io->read_proc(buffer, size, count, io64_handle->handle);
+}
+
+static unsigned DLL_CALLCONV 
+_IO64WriteProc(void *buffer, unsigned size, unsigned count, fi_handle handle) {
+	FIIO64HANDLE *io64_handle = (FIIO64HANDLE*)handle;
+	return io64_handle->io->write_proc(buffer, size, count, io64_handle->handle);
+}
+
+static int DLL_CALLCONV
+_IO64SeekProc(fi_handle handle, long offset, int origin) {
+	FIIO64HANDLE *io64_handle = (FIIO64HANDLE*)handle;
+	return io64_handle->io->seek_proc(io64_handle->handle, offset, origin);
+}
+
+static long DLL_CALLCONV
+_IO64TellProc(fi_handle handle) {
+	FIIO64HANDLE *io64_handle = (FIIO64HANDLE*)handle;
+	const int64_t position = io64_handle->io->tell_proc(io64_handle->handle);
+	return (position <= std::numeric_limits<long>::max()) ? (long)position : -1L;
+}
+
+void
+SetIO64(FreeImageIO *io, FIIO64HANDLE *io64_handle, FreeImageIO64 *io64, fi_handle handle) {
+	io64_handle->io = io64;
+	io64_handle->handle = handle;
+
+	io->read_proc  = _IO64ReadProc;
+	io->seek_proc  = _IO64SeekProc;
+	io->tell_proc  = _IO64TellProc;
+	io->write_proc = _IO64WriteProc;
+}
+
+// ----------------------------------------------------------
+
+int
+IOSeek64(FreeImageIO *io, fi_handle handle, int64_t offset, int origin) {
+	if(io->seek_proc == _MemorySeekProc) {
+		return _MemorySeek64Proc(handle, offset, origin);
+	}
+	if(io->seek_proc == _SeekProc) {
+		return _Seek64Proc(handle, offset, origin);
+	}
+	if(io->seek_proc == _IO64SeekProc) {
+		FIIO64HANDLE *io64_handle = (FIIO64HANDLE*)handle;
+		return io64_handle->io->seek_proc(io64_handle->handle, offset, origin);
+	}
+
+	// user IO : seek by steps when the offset does not fit into a long
+	const int64_t max_step = std::numeric_limits<long>::max();
+	while((offset > max_step) || (offset < -max_step)) {
+		const long step = (offset > 0) ? (long)max_step : -(long)max_step;
+		if(io->seek_proc(handle, step, origin) != 0) {
+			return -1;
+		}
+		offset -= step;
+		origin = SEEK_CUR;
+	}
+	return io->seek_proc(handle, (long)offset, origin);
+}
+
+int64_t
+IOTell64(FreeImageIO *io, fi_handle handle) {
+	if(io->tell_proc == _MemoryTellProc) {
+		return _MemoryTell64Proc(handle);
+	}
+	if(io->tell_proc == _TellProc) {
+		return _Tell64Proc(handle);
+	}
+	if(io->tell_proc == _IO64TellProc) {
+		FIIO64HANDLE *io64_handle = (FIIO64HANDLE*)handle;
+		return io64_handle->io->tell_proc(io64_handle->handle);
+	}
+	return io->tell_proc(handle);
+}
+
+// =====================================================================
+// Memory mapped file functions
+// =====================================================================
+
+#ifdef _WIN32
+
+static FIMAPPEDFILE*
+MapFileHandle(HANDLE file) {
+	FIMAPPEDFILE *mapping = nullptr;
+
+	if(file == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+	LARGE_INTEGER file_size;
+	// the mapped view must fit into the address space
+	if(GetFileSizeEx(file, &file_size) && (file_size.QuadPart > 0) && ((uint64_t)file_size.QuadPart <= MEMORY_STREAM_MAX_SIZE)) {
+		HANDLE file_mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(file_mapping) {
+			void *view = MapViewOfFile(file_mapping, FILE_MAP_READ, 0, 0, 0);
+			if(view) {
+				mapping = new(std::nothrow) FIMAPPEDFILE;
+				if(mapping) {
+					mapping->data = (uint8_t*)view;
+					mapping->size = (size_t)file_size.QuadPart;
+				} else {
+					UnmapViewOfFile(view);
+				}
+			}
+			// the view keeps a reference to the mapping object
+			CloseHandle(file_mapping);
+		}
+	}
+	CloseHandle(file);
+
+	return mapping;
+}
+
+FIMAPPEDFILE*
+MapFile(const char *filename) {
+	return MapFileHandle(CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+}
+
+FIMAPPEDFILE*
+MapFileU(const wchar_t *filename) {
+	return MapFileHandle(CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+}
+
+void
+UnmapFile(FIMAPPEDFILE *mapping) {
+	if(mapping) {
+		UnmapViewOfFile(mapping->data);
+		delete mapping;
+	}
+}
+
+#else
+
+FIMAPPEDFILE*
+MapFile(const char *filename) {
+	FIMAPPEDFILE *mapping = nullptr;
+
+	const int fd = open(filename, O_RDONLY);
+	if(fd == -1) {
+		return nullptr;
+	}
+	struct stat file_stat;
+	// the mapped view must fit into the address space
+	if((fstat(fd, &file_stat) == 0) && S_ISREG(file_stat.st_mode) && (file_stat.st_size > 0) && ((uint64_t)file_stat.st_size <= MEMORY_STREAM_MAX_SIZE)) {
+		const size_t size = (size_t)file_stat.st_size;
+		void *view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(view != MAP_FAILED) {
+			// most decoders read their input from the start to the end
+			posix_madvise(view, size, POSIX_MADV_SEQUENTIAL);
+			mapping = new(std::nothrow) FIMAPPEDFILE;
+			if(mapping) {
+				mapping->data = (uint8_t*)view;
+				mapping->size = size;
+			} else {
+				munmap(view, size);
+			}
+		}
+	}
+	// the mapping remains valid after the file descriptor is closed
+	close(fd);
+
+	return mapping;
+}
+
+void
+UnmapFile(FIMAPPEDFILE *mapping) {
+	if(mapping) {
+		munmap(mapping->data, mapping->size);
+		delete mapping;
+	}
+}
+
+#endif // _WIN32
+
+// ----------------------------------------------------------
+
+BOOL
+GetIOView(FreeImageIO *io, fi_handle handle, const uint8_t **data, size_t *size) {
+	if(!io || !handle || !data || !size || (io->read_proc != _MemoryReadProc)) {
+		return FALSE;
+	}
+	FIMEMORYHEADER *mem_header = (FIMEMORYHEADER*)(((FIMEMORY*)handle)->data);
+	if(!mem_header || !mem_header->data || mem_header->segment_size) {
+		// segmented streams are not contiguous
+		return FALSE;
+	}
+	// the position may be beyond the end of the stream after a seek
+	const int64_t position = MIN(mem_header->current_position, mem_header->file_length);
+	*data = (const uint8_t*)mem_header->data + position;
+	*size = (size_t)(mem_header->file_length - position);
+
+	return TRUE;
+}
@@ -29,28 +29,111 @@
 #include "FreeImageIO.h"
 #include "Plugin.h"
 
+// =====================================================================
+// Magic signature matching
+// =====================================================================
+
+/**
+Check a magic signature against the first bytes of a stream
+*/
+static BOOL
+MatchSignature(const FISIGNATURE *signature, const uint8_t *prefix, unsigned prefix_size) {
+	if((uint64_t)signature->offset + signature->length > prefix_size) {
+		return FALSE;
+	}
+	const uint8_t *bytes = prefix + signature->offset;
+	if(signature->mask) {
+		for(unsigned i = 0; i < signature->length; i++) {
+			if((bytes[i] & signature->mask[i]) != signature->magic[i]) {
+				return FALSE;
+			}
+		}
+		return TRUE;
+	}
+	return (memcmp(bytes, signature->magic, signature->length) == 0) ? TRUE : FALSE;
+}
+
+/**
+Find the first enabled plugin registered before 'first_match' whose signature matches the stream
+@return Returns the plugin FIF, or first_match if none matches
+*/
+static int
+FindSignature(const PluginTable *table, const std::vector<PluginTable::SignatureEntry> &entries, const uint8_t *prefix, unsigned prefix_size, int first_match) {
+	for(size_t i = 0; i < entries.size(); i++) {
+		const PluginTable::SignatureEntry &entry = entries[i];
+		if(entry.m_id >= first_match) {
+			// entries are sorted by FIF
+			break;
+		}
+		if(table->m_nodes[entry.m_id]->m_enabled && MatchSignature(entry.m_signature, prefix, prefix_size)) {
+			return entry.m_id;
+		}
+	}
+	return first_match;
+}
+
 // =====================================================================
 // Generic stream file type access
 // =====================================================================
 
+/**
+Identify the format of a stream. 
+The first bytes of the stream are read once and matched against the magic signatures of the plugins; 
+only the plugins without signature (e.g. TARGA, ICO, RAW) read the stream themselves, through their validate_proc. 
+The result is the same as validating each plugin in turn : the first plugin recognizing the stream wins.
+*/
 FREE_IMAGE_FORMAT DLL_CALLCONV
 FreeImage_GetFileTypeFromHandle(FreeImageIO *io, fi_handle handle, int size) {
-	if (handle != nullptr) {
-		int fif_count = FreeImage_GetFIFCount();
-
-		for (int i = 0; i < fif_count; ++i) {
-			FREE_IMAGE_FORMAT fif = (FREE_IMAGE_FORMAT)i;
-			if (FreeImage_ValidateFIF(fif, io, handle)) {
-				if(fif == FIF_TIFF) {
-					// many camera raw files use a TIFF signature ...
-					// ... try to revalidate against FIF_RAW (even if it breaks the code genericity)
-					if (FreeImage_ValidateFIF(FIF_RAW, io, handle)) {
-						return FIF_RAW;
-					}
-				}
-				return fif;
+	PluginList *plugins = FreeImage_GetPluginList();
+
+	if ((handle != nullptr) && (plugins != nullptr)) {
+		const PluginTable *table = plugins->GetTable();
+
+		// read the stream prefix
+
+		uint8_t stack_prefix[1024];
+		std::vector<uint8_t> heap_prefix;
+		uint8_t *prefix = stack_prefix;
+		if(table->m_signature_size > sizeof(stack_prefix)) {
+			heap_prefix.resize(table->m_signature_size);
+			prefix = &heap_prefix[0];
+		}
+
+		unsigned prefix_size = 0;
+		if(table->m_signature_size > 0) {
+			const int64_t start = IOTell64(io, handle);
+			prefix_size = io->read_proc(prefix, 1, table->m_signature_size, handle);
+			IOSeek64(io, handle, start, SEEK_SET);
+		}
+
+		// match the signatures
+
+		int fif = INT_MAX;
+		if(prefix_size > 0) {
+			fif = FindSignature(table, table->m_signatures[prefix[0]], prefix, prefix_size, fif);
+		}
+		fif = FindSignature(table, table->m_other_signatures, prefix, prefix_size, fif);
+
+		// formats without signature registered before the matching format
+
+		for (size_t i = 0; (i < table->m_validators.size()) && (table->m_validators[i] < fif); ++i) {
+			if (FreeImage_ValidateFIF((FREE_IMAGE_FORMAT)table->m_validators[i], io, handle)) {
+				fif = table->m_validators[i];
+				break;
+			}
+		}
+
+		if(fif == INT_MAX) {
+			return FIF_UNKNOWN;
+		}
+		if(fif == FIF_TIFF) {
+			// many camera raw files use a TIFF signature ...
+			// ... try to revalidate against FIF_RAW (even if it breaks the code genericity)
+			if (FreeImage_ValidateFIF(FIF_RAW, io, handle)) {
+				return FIF_RAW;
 			}
 		}
+		return (FREE_IMAGE_FORMAT)fif;
 	}
 
 	return FIF_UNKNOWN;
@@ -118,6 +118,46 @@ static int int_ceildivpow2(int a, int b) {
 	return (a + (1 << b) - 1) >> b;
 }
 
+/**
+Select the smallest decoded resolution still at least as large as a requested size.
+Each discarded resolution level halves the image size and skips the corresponding wavelet levels.
+@param d_codec Decompressor handle, after the main header has been read
+@param image OpenJPEG image returned by opj_read_header
+@param requested_size Requested size of the largest image dimension, in pixels (0 means full resolution)
+@return Returns the number of discarded resolution levels
+*/
+int J2KSetDecodedResolution(opj_codec_t *d_codec, const opj_image_t *image, int requested_size) {
+	if((requested_size <= 0) || !image || (image->numcomps == 0)) {
+		return 0;
+	}
+
+	// get the number of resolution levels available in all components
+	int numresolutions = 0;
+	opj_codestream_info_v2_t *cstr_info = opj_get_cstr_info(d_codec);
+	if(cstr_info) {
+		const opj_tccp_info_t *tccp_info = cstr_info->m_default_tile_info.tccp_info;
+		if(tccp_info) {
+			numresolutions = (int)tccp_info[0].numresolutions;
+			for(OPJ_UINT32 c = 1; c < cstr_info->nbcomps; c++) {
+				numresolutions = MIN(numresolutions, (int)tccp_info[c].numresolutions);
+			}
+		}
+		opj_destroy_cstr_info(&cstr_info);
+	}
+
+	const int max_size = (int)MAX(image->x1 - image->x0, image->y1 - image->y0);
+
+	int reduce = 0;
+	while((reduce + 1 < numresolutions) && (int_ceildivpow2(max_size, reduce + 1) >= requested_size)) {
+		reduce++;
+	}
+	if(reduce && !opj_set_decoded_resolution_factor(d_codec, (OPJ_UINT32)reduce)) {
+		return 0;
+	}
+
+	return reduce;
+}
+
 /**
 Convert a OpenJPEG image to a FIBITMAP
 @param format_id Plugin ID
@@ -131,13 +171,16 @@ FIBITMAP* J2KImageToFIBITMAP(int format_id, const opj_image_t *image, BOOL heade
 	try {
 		// compute image width and height
 
+		// when a resolution reduction was requested (see J2KSetDecodedResolution),
+		// the component size is already given at the decoded resolution
+
 		//int w = int_ceildiv(image->x1 - image->x0, image->comps[0].dx);
 		int wr = image->comps[0].w;
-		int wrr = int_ceildivpow2(image->comps[0].w, image->comps[0].factor);
+		int wrr = image->comps[0].w;
 		
 		//int h = int_ceildiv(image->y1 - image->y0, image->comps[0].dy);
 		//int hr = image->comps[0].h;
-		int hrr = int_ceildivpow2(image->comps[0].h, image->comps[0].factor);
+		int hrr = image->comps[0].h;
 
 		// check the number of components
 
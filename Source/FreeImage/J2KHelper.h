@@ -24,6 +24,11 @@ Stream destructor
 */
 void opj_freeimage_stream_destroy(J2KFIO_t* fio);
 
+/**
+Reduced resolution decoding (used with the loading size hint)
+*/
+int J2KSetDecodedResolution(opj_codec_t *d_codec, const opj_image_t *image, int requested_size);
+
 /**
 Conversion opj_image_t => FIBITMAP
 */
@@ -27,12 +27,25 @@
 // =====================================================================
 
 
+/**
+Default segment size of a segmented memory stream
+*/
+#define FIMEMORY_SEGMENT_SIZE	(1 << 20)
+
 // =====================================================================
 // Open and close a memory handle
 // =====================================================================
 
 FIMEMORY * DLL_CALLCONV 
 FreeImage_OpenMemory(uint8_t *data, uint32_t size_in_bytes) {
+	return FreeImage_OpenMemory64(data, size_in_bytes);
+}
+
+/**
+64-bit version of FreeImage_OpenMemory, used to wrap buffers larger than 4 GB
+*/
+FIMEMORY * DLL_CALLCONV 
+FreeImage_OpenMemory64(uint8_t *data, uint64_t size_in_bytes) {
 	// allocate a memory handle
 	FIMEMORY *stream = (FIMEMORY*)malloc(sizeof(FIMEMORY));
 	if(stream) {
@@ -48,7 +61,7 @@ FreeImage_OpenMemory(uint8_t *data, uint32_t size_in_bytes) {
 				// wrap a user buffer
 				mem_header->delete_me = FALSE;
 				mem_header->data = (uint8_t*)data;
-				mem_header->data_length = mem_header->file_length = size_in_bytes;
+				mem_header->data_length = mem_header->file_length = (int64_t)size_in_bytes;
 			} else {
 				mem_header->delete_me = TRUE;
 			}
@@ -61,11 +74,27 @@ FreeImage_OpenMemory(uint8_t *data, uint32_t size_in_bytes) {
 	return nullptr;
 }
 
+FIMEMORY * DLL_CALLCONV 
+FreeImage_OpenMemorySegmented(uint32_t segment_size) {
+	// allocate a read/write memory handle
+	FIMEMORY *stream = FreeImage_OpenMemory();
+	if(stream) {
+		FIMEMORYHEADER *mem_header = (FIMEMORYHEADER*)(stream->data);
+
+		// data are stored into fixed-size segments, allocated as the stream grows
+		mem_header->segment_size = segment_size ? segment_size : FIMEMORY_SEGMENT_SIZE;
+	}
+
+	return stream;
+}
 
 void DLL_CALLCONV
 FreeImage_CloseMemory(FIMEMORY *stream) {
 	if(stream && stream->data) {
 		FIMEMORYHEADER *mem_header = (FIMEMORYHEADER*)(stream->data);
+		if(mem_header->segment_size) {
+			FreeMemorySegments(mem_header);
+		}
 		if(mem_header->delete_me) {
 			free(mem_header->data);
 		}
@@ -119,8 +148,73 @@ FreeImage_AcquireMemory(FIMEMORY *stream, uint8_t **data, uint32_t *size_in_byte
 	if (stream) {
 		FIMEMORYHEADER *mem_header = (FIMEMORYHEADER*)(stream->data);
 
+		// use FreeImage_AcquireMemory64 for streams larger than 4 GB
+		if((uint64_t)mem_header->file_length > 0xFFFFFFFF) {
+			return FALSE;
+		}
+
+		uint64_t size = 0;
+		if(FreeImage_AcquireMemory64(stream, data, &size)) {
+			*size_in_bytes = (uint32_t)size;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+64-bit version of FreeImage_AcquireMemory
+*/
+BOOL DLL_CALLCONV
+FreeImage_AcquireMemory64(FIMEMORY *stream, uint8_t **data, uint64_t *size_in_bytes) {
+	if (stream) {
+		FIMEMORYHEADER *mem_header = (FIMEMORYHEADER*)(stream->data);
+
+		// a segmented stream is copied once into a single buffer (use FreeImage_AcquireMemorySegments to avoid the copy)
+		if(!FlattenMemorySegments(mem_header)) {
+			return FALSE;
+		}
+
 		*data = (uint8_t*)mem_header->data;
-		*size_in_bytes = mem_header->file_length;
+		*size_in_bytes = (uint64_t)mem_header->file_length;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+Provides a direct access to the data of a memory stream, as a list of segments. 
+A contiguous stream is returned as a single segment (or as 2 GB segments when larger than 2 GB). 
+The segments remain valid until the stream is written to or closed.
+@param stream Pointer to FIMEMORY structure
+@param segments Array receiving the segments, may be nullptr to query the number of segments
+@param count On input, the size of the segments array. On output, the number of segments of the stream
+@return Returns TRUE if successful, returns FALSE if the segments array is too small
+*/
+BOOL DLL_CALLCONV
+FreeImage_AcquireMemorySegments(FIMEMORY *stream, FIMEMORYSEGMENT *segments, unsigned *count) {
+	if (stream && count) {
+		FIMEMORYHEADER *mem_header = (FIMEMORYHEADER*)(stream->data);
+
+		const uint64_t file_length = (uint64_t)mem_header->file_length;
+		const uint64_t segment_size = mem_header->segment_size ? mem_header->segment_size : MAX(MIN(file_length, (uint64_t)0x80000000), (uint64_t)1);
+		const unsigned segment_count = (unsigned)((file_length + (segment_size - 1)) / segment_size);
+
+		if(!segments) {
+			*count = segment_count;
+			return TRUE;
+		}
+		if(*count < segment_count) {
+			*count = segment_count;
+			return FALSE;
+		}
+		for(unsigned i = 0; i < segment_count; i++) {
+			segments[i].data = mem_header->segment_size ? mem_header->segments[i] : (uint8_t*)mem_header->data + i * segment_size;
+			segments[i].size = (uint32_t)MIN(segment_size, file_length - i * segment_size);
+		}
+		*count = segment_count;
 		return TRUE;
 	}
 
@@ -168,6 +262,43 @@ FreeImage_TellMemory(FIMEMORY *stream) {
 	return -1L;
 }
 
+/**
+64-bit version of FreeImage_SeekMemory
+@param stream Pointer to FIMEMORY structure
+@param offset Number of bytes from origin
+@param origin Initial position
+@return Returns TRUE if successful, returns FALSE otherwise
+*/
+BOOL DLL_CALLCONV
+FreeImage_SeekMemory64(FIMEMORY *stream, int64_t offset, int origin) {
+	FreeImageIO io;
+	SetMemoryIO(&io);
+
+	if (stream != nullptr) {
+		int success = IOSeek64(&io, (fi_handle)stream, offset, origin);
+		return (success == 0) ? TRUE : FALSE;
+	}
+
+	return FALSE;
+}
+
+/**
+64-bit version of FreeImage_TellMemory
+@param stream Target FIMEMORY structure
+@return Returns the current file position if successful, -1 otherwise
+*/
+int64_t DLL_CALLCONV
+FreeImage_TellMemory64(FIMEMORY *stream) {
+	FreeImageIO io;
+	SetMemoryIO(&io);
+
+	if (stream != nullptr) {
+		return IOTell64(&io, (fi_handle)stream);
+	}
+
+	return -1;
+}
+
 // =====================================================================
 // Reading or Writing in Memory stream
 // =====================================================================
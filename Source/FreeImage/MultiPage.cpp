@@ -34,9 +34,18 @@
 #include "CacheFile.h"
 #include "FreeImageIO.h"
 #include "Plugin.h"
+#include "Threading.h"
 #include "Utilities.h"
 #include "FreeImage.h"
 
+#include <zlib-ng.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
 namespace {
 
 // ----------------------------------------------------------
@@ -97,6 +106,82 @@ typedef BlockList::iterator BlockListIterator;
 
 // ----------------------------------------------------------
 
+/**
+A page held by the page cache
+*/
+struct CachedPage {
+	//! source page number
+	int page;
+	//! decoded page, or 'header only' bitmap when the pixels are compressed
+	FIBITMAP *dib;
+	//! zlib compressed pixels, empty when dib has pixels
+	std::vector<uint8_t> pixels;
+	//! memory used by the page, in bytes
+	size_t cost;
+};
+
+typedef std::list<CachedPage> CachedPageList;
+
+/**
+LRU cache of decoded pages bounded by a byte budget, with an optional prefetch thread. 
+A page is owned either by the cache or by the caller who locked it, never by both : 
+locking a cached page takes it out of the cache, unlocking an unchanged page gives it back.
+*/
+class PageCache {
+public:
+	typedef std::function<FIBITMAP *(int page)> DecodeProc;
+
+	/**
+	@param decode Page decoder, called from the prefetch thread
+	@param max_bytes Memory budget of the cached pages
+	@param flags Cache options (FI_PAGECACHE_xxx)
+	*/
+	PageCache(const DecodeProc& decode, size_t max_bytes, int flags);
+	~PageCache();
+
+	/**
+	Take a page out of the cache, waiting for its prefetch when it is being decoded
+	@return Returns the decoded page, or nullptr if the page is not cached
+	*/
+	FIBITMAP *take(int page);
+
+	/**
+	Give a decoded page to the cache, evicting the least recently used pages when over budget
+	*/
+	void put(int page, FIBITMAP *dib);
+
+	/**
+	Ask the prefetch thread (if any) to decode a page, replacing any pending request
+	*/
+	void prefetch(int page);
+
+private:
+	void compress(CachedPage& entry) const;
+	FIBITMAP *restore(CachedPage& entry) const;
+	void run();
+
+private:
+	DecodeProc m_decode;
+	size_t m_max_size;
+	int m_flags;
+
+	std::mutex m_lock;
+	std::condition_variable m_cond;
+	//! cached pages, most recently used first
+	CachedPageList m_pages;
+	std::unordered_map<int, CachedPageList::iterator> m_index;
+	size_t m_size;
+
+	//! page requested to the prefetch thread, -1 if none
+	int m_prefetch_page;
+	//! page being decoded by the prefetch thread, -1 if none
+	int m_decoding_page;
+	bool m_stop;
+	std::thread m_thread;
+};
+
+// ----------------------------------------------------------
+
 struct MULTIBITMAPHEADER {
 	
 	MULTIBITMAPHEADER()
@@ -108,6 +193,8 @@ struct MULTIBITMAPHEADER {
 		, read_only(TRUE)
 		, cache_fif(fif)
 		, load_flags(0)
+		, m_mapping(nullptr)
+		, m_read_data(nullptr)
 	{
 		SetDefaultIO(&io);
 	}
@@ -125,8 +212,211 @@ struct MULTIBITMAPHEADER {
 	BOOL read_only;
 	FREE_IMAGE_FORMAT cache_fif;
 	int load_flags;
+	//! file mapping read through 'handle' (a FIMEMORY stream), see FreeImage_OpenMultiBitmapMapped
+	FIMAPPEDFILE *m_mapping;
+	//! serializes the reads of 'handle' (shared with the prefetch thread)
+	std::mutex m_io_lock;
+	//! plugin data kept open between page decodes (see FI_SupportsPersistentDataProc), guarded by m_io_lock
+	void *m_read_data;
+	//! decoded page cache, see FreeImage_SetMultiBitmapCache
+	std::unique_ptr<PageCache> m_page_cache;
 };
 
+// =====================================================================
+// Page cache
+// =====================================================================
+
+PageCache::PageCache(const DecodeProc& decode, size_t max_bytes, int flags)
+: m_decode(decode)
+, m_max_size(max_bytes)
+, m_flags(flags)
+, m_size(0)
+, m_prefetch_page(-1)
+, m_decoding_page(-1)
+, m_stop(false) {
+	if (m_flags & FI_PAGECACHE_PREFETCH) {
+		try {
+			m_thread = std::thread(&PageCache::run, this);
+		} catch (...) {
+			// no prefetch
+		}
+	}
+}
+
+PageCache::~PageCache() {
+	if (m_thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			m_stop = true;
+		}
+		m_cond.notify_all();
+		m_thread.join();
+	}
+	for (CachedPageList::iterator i = m_pages.begin(); i != m_pages.end(); ++i) {
+		FreeImage_Unload(i->dib);
+	}
+}
+
+FIBITMAP *
+PageCache::take(int page) {
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	// the caller is about to decode the page itself
+	if (m_prefetch_page == page) {
+		m_prefetch_page = -1;
+	}
+	while (m_decoding_page == page) {
+		m_cond.wait(guard);
+	}
+
+	std::unordered_map<int, CachedPageList::iterator>::iterator found = m_index.find(page);
+	if (found == m_index.end()) {
+		return nullptr;
+	}
+	CachedPage entry;
+	entry.page = page;
+	entry.dib = found->second->dib;
+	entry.pixels.swap(found->second->pixels);
+	entry.cost = found->second->cost;
+
+	m_size -= entry.cost;
+	m_pages.erase(found->second);
+	m_index.erase(found);
+
+	guard.unlock();
+
+	return restore(entry);
+}
+
+void
+PageCache::put(int page, FIBITMAP *dib) {
+	CachedPage entry;
+	entry.page = page;
+	entry.dib = dib;
+	entry.cost = 0;
+
+	if (m_flags & FI_PAGECACHE_COMPRESS) {
+		compress(entry);
+	}
+	entry.cost = (size_t)FreeImage_GetMemorySize(entry.dib) + entry.pixels.size();
+
+	std::lock_guard<std::mutex> guard(m_lock);
+
+	if ((entry.cost > m_max_size) || (m_index.find(page) != m_index.end())) {
+		FreeImage_Unload(entry.dib);
+		return;
+	}
+
+	m_pages.push_front(CachedPage());
+	m_pages.front().page = page;
+	m_pages.front().dib = entry.dib;
+	m_pages.front().pixels.swap(entry.pixels);
+	m_pages.front().cost = entry.cost;
+	m_index[page] = m_pages.begin();
+	m_size += entry.cost;
+
+	// evict the least recently used pages
+	while (m_size > m_max_size) {
+		CachedPage& last = m_pages.back();
+		m_size -= last.cost;
+		FreeImage_Unload(last.dib);
+		m_index.erase(last.page);
+		m_pages.pop_back();
+	}
+}
+
+void
+PageCache::prefetch(int page) {
+	if (m_thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> guard(m_lock);
+			if ((m_decoding_page == page) || (m_index.find(page) != m_index.end())) {
+				return;
+			}
+			m_prefetch_page = page;
+		}
+		m_cond.notify_all();
+	}
+}
+
+void
+PageCache::compress(CachedPage& entry) const {
+	FIBITMAP *dib = entry.dib;
+	if (!FreeImage_HasPixels(dib) || (FreeImage_GetPitch(dib) != ((FreeImage_GetLine(dib) + 3) & ~3))) {
+		// no pixels or user provided pixel buffer
+		return;
+	}
+	const size_t size = (size_t)FreeImage_GetPitch(dib) * FreeImage_GetHeight(dib);
+
+	std::vector<uint8_t> pixels(zng_compressBound(size));
+	size_t compressed_size = pixels.size();
+
+	if (zng_compress2(&pixels[0], &compressed_size, FreeImage_GetBitsInternal(dib), size, Z_BEST_SPEED) != Z_OK) {
+		return;
+	}
+	// keep pages which do not compress well decoded
+	if (compressed_size > size - size / 4) {
+		return;
+	}
+	FIBITMAP *header_dib = FreeImage_CloneInternal(dib, TRUE);
+	if (!header_dib) {
+		return;
+	}
+	pixels.resize(compressed_size);
+	pixels.shrink_to_fit();
+
+	entry.pixels.swap(pixels);
+	entry.dib = header_dib;
+	FreeImage_Unload(dib);
+}
+
+FIBITMAP *
+PageCache::restore(CachedPage& entry) const {
+	if (entry.pixels.empty()) {
+		return entry.dib;
+	}
+	FIBITMAP *dib = FreeImage_CloneInternal(entry.dib, FALSE);
+	FreeImage_Unload(entry.dib);
+
+	if (dib) {
+		const size_t size = (size_t)FreeImage_GetPitch(dib) * FreeImage_GetHeight(dib);
+		size_t uncompressed_size = size;
+		if ((zng_uncompress(FreeImage_GetBitsInternal(dib), &uncompressed_size, &entry.pixels[0], entry.pixels.size()) != Z_OK) || (uncompressed_size != size)) {
+			FreeImage_Unload(dib);
+			return nullptr;
+		}
+	}
+	return dib;
+}
+
+void
+PageCache::run() {
+	std::unique_lock<std::mutex> guard(m_lock);
+
+	while (!m_stop) {
+		if (m_prefetch_page < 0) {
+			m_cond.wait(guard);
+			continue;
+		}
+		const int page = m_prefetch_page;
+		m_prefetch_page = -1;
+		if (m_index.find(page) != m_index.end()) {
+			continue;
+		}
+		m_decoding_page = page;
+		guard.unlock();
+
+		FIBITMAP *dib = m_decode(page);
+		if (dib) {
+			put(page, dib);
+		}
+
+		guard.lock();
+		m_decoding_page = -1;
+		m_cond.notify_all();
+	}
+}
+
 // =====================================================================
 // Helper functions
 // =====================================================================
@@ -222,6 +512,49 @@ FreeImage_FindBlock(FIMULTIBITMAP *bitmap, int position) {
 	return header->m_blocks.end();
 }
 
+/**
+Decode a page of the source file
+@param header Multipage bitmap header
+@param page Source page number
+@return Returns the decoded page, or nullptr if an error occured
+*/
+static FIBITMAP *
+FreeImage_DecodePage(MULTIBITMAPHEADER *header, int page) {
+	std::lock_guard<std::mutex> guard(header->m_io_lock);
+
+	Plugin *plugin = header->node->m_plugin;
+
+	const BOOL persistent = (plugin->supports_persistent_data_proc != nullptr) && plugin->supports_persistent_data_proc();
+
+	// open the bitmap, unless the plugin data has been kept from a previous page
+
+	void *data = header->m_read_data;
+
+	if (data == nullptr) {
+		header->io.seek_proc(header->handle, 0, SEEK_SET);
+
+		data = FreeImage_Open(header->node, &header->io, header->handle, TRUE);
+	}
+
+	// load the bitmap data
+
+	if (data != nullptr) {
+		FIBITMAP *dib = (plugin->load_proc != nullptr) ? plugin->load_proc(&header->io, header->handle, page, header->load_flags, data) : nullptr;
+
+		// close the file
+
+		if (persistent) {
+			header->m_read_data = data;
+		} else {
+			FreeImage_Close(header->node, &header->io, header->handle, data);
+		}
+
+		return dib;
+	}
+
+	return nullptr;
+}
+
 int DLL_CALLCONV
 FreeImage_InternalGetPageCount(FIMULTIBITMAP *bitmap) {	
 	if (bitmap) {
@@ -374,6 +707,37 @@ FreeImage_OpenMultiBitmapFromHandle(FREE_IMAGE_FORMAT fif, FreeImageIO *io, fi_h
 	return nullptr;
 }
 
+FIMULTIBITMAP * DLL_CALLCONV
+FreeImage_OpenMultiBitmapMapped(FREE_IMAGE_FORMAT fif, const char *filename, int flags) {
+	FIMAPPEDFILE *mapping = MapFile(filename);
+
+	if (!mapping) {
+		// the file cannot be mapped, read it through stdio
+		return FreeImage_OpenMultiBitmap(fif, filename, FALSE, TRUE, FALSE, flags);
+	}
+
+	FIMEMORY *stream = FreeImage_OpenMemory64(mapping->data, mapping->size);
+
+	if (stream) {
+		FreeImageIO io;
+		SetMemoryIO(&io);
+
+		// pages are decoded from the mapped view, modifications (if any) are stored into the memory cache
+
+		FIMULTIBITMAP *bitmap = FreeImage_OpenMultiBitmapFromHandle(fif, &io, (fi_handle)stream, flags);
+
+		if (bitmap) {
+			FreeImage_GetMultiBitmapHeader(bitmap)->m_mapping = mapping;
+			return bitmap;
+		}
+
+		FreeImage_CloseMemory(stream);
+	}
+	UnmapFile(mapping);
+
+	return nullptr;
+}
+
 BOOL DLL_CALLCONV
 FreeImage_SaveMultiBitmapToHandle(FREE_IMAGE_FORMAT fif, FIMULTIBITMAP *bitmap, FreeImageIO *io, fi_handle handle, int flags) {
 	if(!bitmap || !bitmap->data || !io || !handle) {
@@ -391,6 +755,9 @@ FreeImage_SaveMultiBitmapToHandle(FREE_IMAGE_FORMAT fif, FIMULTIBITMAP *bitmap,
 		if(node) {
 			MULTIBITMAPHEADER *header = FreeImage_GetMultiBitmapHeader(bitmap);
 			
+			// the source file is shared with the prefetch thread
+			std::lock_guard<std::mutex> guard(header->m_io_lock);
+
 			// dst data
 			void *data = FreeImage_Open(node, io, handle, FALSE);
 			// src data
@@ -411,8 +778,17 @@ FreeImage_SaveMultiBitmapToHandle(FREE_IMAGE_FORMAT fif, FIMULTIBITMAP *bitmap,
 					switch(i->m_type) {
 						case BLOCK_CONTINUEUS:
 						{
+							// untouched pages of a source in the same format are copied without decoding them,
+							// unless the load flags change the decoded pages (e.g. GIF_PLAYBACK)
+
+							FI_CopyPageProc copy_page = ((node == header->node) && data_read && (header->load_flags == 0)) ? node->m_plugin->copypage_proc : nullptr;
+
 							for (int j = i->getStart(); j <= i->getEnd(); j++) {
-								
+								if (copy_page && copy_page(&header->io, header->handle, j, data_read, io, handle, count, flags, data)) {
+									count++;
+									continue;
+								}
+
 								// load the original source data
 								FIBITMAP *dib = header->node->m_plugin->load_proc(&header->io, header->handle, j, header->load_flags, data_read);
 								
@@ -428,21 +804,15 @@ FreeImage_SaveMultiBitmapToHandle(FREE_IMAGE_FORMAT fif, FIMULTIBITMAP *bitmap,
 						
 						case BLOCK_REFERENCE:
 						{
-							// read the compressed data
-							
-							uint8_t *compressed_data = (uint8_t*)malloc(i->getSize() * sizeof(uint8_t));
+							// uncompress the data, read in place from the cache
 							
-							header->m_cachefile.readFile((uint8_t *)compressed_data, i->getReference(), i->getSize());
+							int compressed_size = 0;
+							uint8_t *compressed_data = (uint8_t*)header->m_cachefile.viewFile(i->getReference(), &compressed_size);
 							
-							// uncompress the data
-							
-							FIMEMORY *hmem = FreeImage_OpenMemory(compressed_data, i->getSize());
+							FIMEMORY *hmem = FreeImage_OpenMemory(compressed_data, compressed_size);
 							FIBITMAP *dib = FreeImage_LoadFromMemory(header->cache_fif, hmem, 0);
 							FreeImage_CloseMemory(hmem);
 							
-							// get rid of the buffer
-							free(compressed_data);
-							
 							// save the data
 							
 							success = node->m_plugin->save_proc(io, dib, handle, count, flags, data);
@@ -481,6 +851,15 @@ FreeImage_CloseMultiBitmap(FIMULTIBITMAP *bitmap, int flags) {
 		
 		if (bitmap->data) {
 			MULTIBITMAPHEADER *header = FreeImage_GetMultiBitmapHeader(bitmap);			
+
+			// stop the prefetch thread and release the cached pages
+
+			header->m_page_cache.reset();
+
+			if (header->m_read_data) {
+				FreeImage_Close(header->node, &header->io, header->handle, header->m_read_data);
+				header->m_read_data = nullptr;
+			}
 			
 			// saves changes only of images loaded directly from a file
 			if (header->changed && !header->m_filename.empty()) {
@@ -534,6 +913,13 @@ FreeImage_CloseMultiBitmap(FIMULTIBITMAP *bitmap, int flags) {
 				}
 			}
 
+			// release the mapped source file
+
+			if (header->m_mapping) {
+				FreeImage_CloseMemory((FIMEMORY *)header->handle);
+				UnmapFile(header->m_mapping);
+			}
+
 			// delete the last open bitmaps
 
 			while (!header->locked_pages.empty()) {
@@ -608,6 +994,11 @@ FreeImage_SavePageToBlock(MULTIBITMAPHEADER *header, FIBITMAP *data) {
 	// get rid of the compressed data
 	FreeImage_CloseMemory(hmem);
 	
+	if (ref < 0) {
+		FreeImage_OutputMessageProc(header->fif, FI_MSG_ERROR_MEMORY);
+		return res;
+	}
+
 	res = PageBlock(BLOCK_REFERENCE, ref, compressed_size);
 	
 	return res;
@@ -696,36 +1087,167 @@ FreeImage_LockPage(FIMULTIBITMAP *bitmap, int page) {
 			}
 		}
 
-		// open the bitmap
-		
-		header->io.seek_proc(header->handle, 0, SEEK_SET);
-		
-		void *data = FreeImage_Open(header->node, &header->io, header->handle, TRUE);
-		
-		// load the bitmap data
-		
-		if (data != nullptr) {
-			FIBITMAP *dib = (header->node->m_plugin->load_proc != nullptr) ? header->node->m_plugin->load_proc(&header->io, header->handle, page, header->load_flags, data) : nullptr;
+		// get the page from the cache or decode it
 
-			// close the file
-			
-			FreeImage_Close(header->node, &header->io, header->handle, data);
+		FIBITMAP *dib = header->m_page_cache ? header->m_page_cache->take(page) : nullptr;
 
-			// if there was still another bitmap open, get rid of it
+		if (!dib) {
+			dib = FreeImage_DecodePage(header, page);
+		}
 
-			if (dib) {
-				header->locked_pages[dib] = page;
+		if (dib) {
+			header->locked_pages[dib] = page;
 
-				return dib;
-			}	
+			// decode the next page while the caller works on this one
 
-			return nullptr;
+			if (header->m_page_cache && (page + 1 < FreeImage_GetPageCount(bitmap))) {
+				BOOL next_locked = FALSE;
+				for (std::map<FIBITMAP *, int>::iterator i = header->locked_pages.begin(); i != header->locked_pages.end(); ++i) {
+					if (i->second == page + 1) {
+						next_locked = TRUE;
+						break;
+					}
+				}
+				if (!next_locked) {
+					header->m_page_cache->prefetch(page + 1);
+				}
+			}
+
+			return dib;
 		}
 	}
 
 	return nullptr;
 }
 
+/**
+Decode several pages of the source file with a private stream and plugin instance. 
+The source must be a file or a contiguous memory stream.
+@param header Multipage bitmap header
+@param view Memory view of the source, nullptr when the source is a file
+@param view_size Size of the memory view
+@param pages Source page numbers
+@param dibs Receives the decoded pages
+@param count Number of pages
+*/
+static void
+FreeImage_DecodePagesPrivately(MULTIBITMAPHEADER *header, const uint8_t *view, size_t view_size, const int *pages, FIBITMAP **dibs, unsigned count) {
+	FreeImageIO io;
+	fi_handle handle = nullptr;
+
+	if (view) {
+		SetMemoryIO(&io);
+		handle = (fi_handle)FreeImage_OpenMemory64(const_cast<uint8_t*>(view), (int64_t)view_size);
+	} else {
+		SetDefaultIO(&io);
+		handle = (fi_handle)fopen(header->m_filename.c_str(), "rb");
+	}
+	if (!handle) {
+		return;
+	}
+
+	void *data = FreeImage_Open(header->node, &io, handle, TRUE);
+
+	if (data != nullptr) {
+		for (unsigned i = 0; i < count; i++) {
+			dibs[i] = (header->node->m_plugin->load_proc != nullptr) ? header->node->m_plugin->load_proc(&io, handle, pages[i], header->load_flags, data) : nullptr;
+		}
+
+		FreeImage_Close(header->node, &io, handle, data);
+	}
+
+	if (view) {
+		FreeImage_CloseMemory((FIMEMORY*)handle);
+	} else {
+		fclose((FILE*)handle);
+	}
+}
+
+int DLL_CALLCONV
+FreeImage_LockPages(FIMULTIBITMAP *bitmap, const int *pages, int count, FIBITMAP **data) {
+	if (!bitmap || !pages || !data || (count <= 0)) {
+		return 0;
+	}
+
+	MULTIBITMAPHEADER *header = FreeImage_GetMultiBitmapHeader(bitmap);
+
+	try {
+		// pages already locked (or requested twice) are not locked
+
+		std::set<int> locked;
+		for (std::map<FIBITMAP *, int>::iterator i = header->locked_pages.begin(); i != header->locked_pages.end(); ++i) {
+			locked.insert(i->second);
+		}
+
+		std::vector<int> decode_pages;
+		std::vector<int> decode_slots;
+
+		for (int i = 0; i < count; i++) {
+			data[i] = nullptr;
+
+			if (!locked.insert(pages[i]).second) {
+				continue;
+			}
+			if (header->m_page_cache) {
+				data[i] = header->m_page_cache->take(pages[i]);
+			}
+			if (!data[i] && header->handle) {
+				decode_pages.push_back(pages[i]);
+				decode_slots.push_back(i);
+			}
+		}
+
+		// decode the other pages
+
+		if (!decode_pages.empty()) {
+			std::vector<FIBITMAP *> dibs(decode_pages.size(), nullptr);
+
+			// each worker needs its own stream : reopen the source file or read the memory buffer through private streams
+
+			const uint8_t *view = nullptr;
+			size_t view_size = 0;
+			BOOL independent = header->m_filename.empty() ? FALSE : TRUE;
+
+			if (!independent) {
+				std::lock_guard<std::mutex> guard(header->m_io_lock);
+				header->io.seek_proc(header->handle, 0, SEEK_SET);
+				independent = GetIOView(&header->io, header->handle, &view, &view_size);
+			}
+
+			const unsigned workers = independent ? GetWorkerCount(TRUE) : 1;
+
+			if (workers > 1) {
+				ParallelFor(0, (unsigned)decode_pages.size(), workers, 1, [&](unsigned first, unsigned last) {
+					FreeImage_DecodePagesPrivately(header, view, view_size, &decode_pages[first], &dibs[first], last - first);
+				});
+			} else {
+				for (size_t i = 0; i < decode_pages.size(); i++) {
+					dibs[i] = FreeImage_DecodePage(header, decode_pages[i]);
+				}
+			}
+
+			for (size_t i = 0; i < decode_pages.size(); i++) {
+				data[decode_slots[i]] = dibs[i];
+			}
+		}
+	} catch (std::bad_alloc &) {
+		FreeImage_OutputMessageProc(header->fif, FI_MSG_ERROR_MEMORY);
+	}
+
+	// register the locked pages
+
+	int locked_count = 0;
+
+	for (int i = 0; i < count; i++) {
+		if (data[i]) {
+			header->locked_pages[data[i]] = pages[i];
+			locked_count++;
+		}
+	}
+
+	return locked_count;
+}
+
 void DLL_CALLCONV
 FreeImage_UnlockPage(FIMULTIBITMAP *bitmap, FIBITMAP *page, BOOL changed) {
 	if ((bitmap) && (page)) {
@@ -757,13 +1279,17 @@ FreeImage_UnlockPage(FIMULTIBITMAP *bitmap, FIBITMAP *page, BOOL changed) {
 
 				// write the data to the cache
 				
-				if (i->m_type == BLOCK_REFERENCE) {
-					header->m_cachefile.deleteFile(i->getReference());
-				}
-				
 				int iPage = header->m_cachefile.writeFile(compressed_data, compressed_size);
-				
-				*i = PageBlock(BLOCK_REFERENCE, iPage, compressed_size);
+
+				if (iPage >= 0) {
+					if (i->m_type == BLOCK_REFERENCE) {
+						header->m_cachefile.deleteFile(i->getReference());
+					}
+
+					*i = PageBlock(BLOCK_REFERENCE, iPage, compressed_size);
+				} else {
+					FreeImage_OutputMessageProc(header->fif, FI_MSG_ERROR_MEMORY);
+				}
 				
 				// get rid of the compressed data
 
@@ -771,10 +1297,17 @@ FreeImage_UnlockPage(FIMULTIBITMAP *bitmap, FIBITMAP *page, BOOL changed) {
 			}
 
 			// reset the locked page so that another page can be locked
+			// (unchanged pages go back to the page cache)
 
-			FreeImage_Unload(page);
+			const int page_number = header->locked_pages[page];
 
 			header->locked_pages.erase(page);
+
+			if (!changed && header->m_page_cache) {
+				header->m_page_cache->put(page_number, page);
+			} else {
+				FreeImage_Unload(page);
+			}
 		}
 	}
 }
@@ -829,6 +1362,30 @@ FreeImage_GetLockedPageNumbers(FIMULTIBITMAP *bitmap, int *pages, int *count) {
 	return FALSE;
 }
 
+BOOL DLL_CALLCONV
+FreeImage_SetMultiBitmapCache(FIMULTIBITMAP *bitmap, size_t max_bytes, int flags) {
+	if (bitmap && bitmap->data) {
+		MULTIBITMAPHEADER *header = FreeImage_GetMultiBitmapHeader(bitmap);
+
+		// release the previous cache (and its prefetch thread)
+
+		header->m_page_cache.reset();
+
+		if ((max_bytes == 0) || !header->handle) {
+			return TRUE;
+		}
+
+		try {
+			header->m_page_cache.reset(new PageCache([header](int page) { return FreeImage_DecodePage(header, page); }, max_bytes, flags));
+			return TRUE;
+		} catch (std::bad_alloc &) {
+			FreeImage_OutputMessageProc(header->fif, FI_MSG_ERROR_MEMORY);
+		}
+	}
+
+	return FALSE;
+}
+
 // =====================================================================
 // Memory IO Multipage functions
 // =====================================================================
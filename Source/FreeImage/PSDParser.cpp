@@ -28,6 +28,7 @@
 #include "FreeImage.h"
 #include "Utilities.h"
 #include "PSDParser.h"
+#include "FreeImageIO.h"
 
 #include "../Metadata/FreeImageTag.h"
 
@@ -1063,21 +1064,11 @@ unsigned psdParser::GetChannelOffset(FIBITMAP* bitmap, unsigned c) const {
 bool psdParser::ReadLayerAndMaskInfoSection(FreeImageIO *io, fi_handle handle)	{
 	bool bSuccess = true;
 
-	uint64_t nTotalBytes = psdReadSize(io, handle, _headerInfo);
+	const uint64_t nTotalBytes = psdReadSize(io, handle, _headerInfo);
 
-	// Hack to handle large PSB files without using fseeko().
-	if (sizeof(long) < sizeof(uint64_t)) {
-		const long offset = 0x10000000;
-		while (nTotalBytes > offset) {
-			if (io->seek_proc(handle, offset, SEEK_CUR) != 0) {
-				bSuccess = false;
-				break;
-			}
-			nTotalBytes -= offset;
-		}
-	}
-	if (bSuccess && nTotalBytes > 0) {
-		if (io->seek_proc(handle, (long)nTotalBytes, SEEK_CUR) != 0)
+	// PSB sections may be larger than 2 GB
+	if (nTotalBytes > 0) {
+		if (IOSeek64(io, handle, (int64_t)nTotalBytes, SEEK_CUR) != 0)
 			bSuccess = false;
 	}
 
@@ -1861,7 +1852,7 @@ bool psdParser::WriteImageData(FreeImageIO *io, fi_handle handle, FIBITMAP* dib)
 				throw std::bad_alloc();
 			}
 			memset(rleLineSizeList, 0, sizeof(uint32_t)*nChannels*nHeight);
-			const long offsets_pos = io->tell_proc(handle);
+			const int64_t offsets_pos = IOTell64(io, handle);
 			if(_headerInfo._Version == 1) {
 				if(io->write_proc(rleLineSizeList, nChannels*nHeight*2, 1, handle) != 1) {
 					return false;
@@ -1886,7 +1877,7 @@ bool psdParser::WriteImageData(FreeImageIO *io, fi_handle handle, FIBITMAP* dib)
 			}
 			SAFE_DELETE_ARRAY(rle_line_start);
 			// Fix length of resource
-			io->seek_proc(handle, offsets_pos, SEEK_SET);
+			IOSeek64(io, handle, offsets_pos, SEEK_SET);
 			if(_headerInfo._Version == 1) {
 				uint16_t *rleLineSizeList2 = new (std::nothrow) uint16_t[nChannels*nHeight];
 				if(!rleLineSizeList2) {
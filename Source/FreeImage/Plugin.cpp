@@ -79,14 +79,116 @@ FreeImage_stricmp(const char *s1, const char *s2) {
 //  Implementation of PluginList
 // =====================================================================
 
+size_t
+PluginKeyHash::operator()(const char *key) const {
+	// FNV-1a hash of the lower case string
+	size_t hash = 2166136261U;
+	for(; *key; key++) {
+		hash = (hash ^ (size_t)tolower((unsigned char)*key)) * 16777619U;
+	}
+	return hash;
+}
+
+bool
+PluginKeyEqual::operator()(const char *key1, const char *key2) const {
+	return FreeImage_stricmp(key1, key2) == 0;
+}
+
+/**
+Add a key to a lookup table of a snapshot
+*/
+static void
+AddPluginKey(PluginTable *table, PluginTable::PluginIndex &index, const char *key, size_t length, int node_id) {
+	if(length == 0) {
+		return;
+	}
+	table->m_keys.push_back(std::string(key, length));
+	std::vector<int> &ids = index[table->m_keys.back().c_str()];
+	// a format string may also appear in the extension list
+	if(ids.empty() || (ids.back() != node_id)) {
+		ids.push_back(node_id);
+	}
+}
+
+/**
+Build a snapshot of the registered plugins
+*/
+static PluginTable*
+BuildPluginTable(const std::vector<PluginNode *> &nodes) {
+	PluginTable *table = new(std::nothrow) PluginTable;
+	if(!table) {
+		return nullptr;
+	}
+	table->m_nodes = nodes;
+	table->m_signature_size = 0;
+
+	for(size_t i = 0; i < nodes.size(); i++) {
+		const PluginNode *node = nodes[i];
+		const Plugin *plugin = node->m_plugin;
+
+		const char *the_format = (node->m_format != nullptr) ? node->m_format : plugin->format_proc();
+		if(the_format) {
+			AddPluginKey(table, table->m_formats, the_format, strlen(the_format), node->m_id);
+			AddPluginKey(table, table->m_extensions, the_format, strlen(the_format), node->m_id);
+		}
+
+		const char *the_mime = (plugin->mime_proc != nullptr) ? plugin->mime_proc() : nullptr;
+		if(the_mime) {
+			AddPluginKey(table, table->m_mimes, the_mime, strlen(the_mime), node->m_id);
+		}
+
+		// split the comma separated extension list
+		const char *the_extension = (node->m_extension != nullptr) ? node->m_extension : (plugin->extension_proc != nullptr) ? plugin->extension_proc() : nullptr;
+		while(the_extension && *the_extension) {
+			const char *separator = strchr(the_extension, ',');
+			const size_t length = separator ? (size_t)(separator - the_extension) : strlen(the_extension);
+			AddPluginKey(table, table->m_extensions, the_extension, length, node->m_id);
+			the_extension = separator ? separator + 1 : nullptr;
+		}
+
+		// compile the magic signatures
+
+		int count = 0;
+		const FISIGNATURE *signatures = (plugin->signature_proc != nullptr) ? plugin->signature_proc(&count) : nullptr;
+		if(signatures && (count > 0)) {
+			for(int k = 0; k < count; k++) {
+				const FISIGNATURE *signature = &signatures[k];
+				if(signature->length == 0) {
+					continue;
+				}
+				const PluginTable::SignatureEntry entry = { node->m_id, signature };
+				if((signature->offset == 0) && (!signature->mask || (signature->mask[0] == 0xFF))) {
+					table->m_signatures[signature->magic[0]].push_back(entry);
+				} else {
+					table->m_other_signatures.push_back(entry);
+				}
+				table->m_signature_size = MAX(table->m_signature_size, signature->offset + signature->length);
+			}
+		} else if(plugin->validate_proc != nullptr) {
+			table->m_validators.push_back(node->m_id);
+		}
+	}
+
+	return table;
+}
+
 PluginList::PluginList() :
-m_plugin_map(),
-m_node_count(0) {
+m_table(nullptr) {
+	m_table = BuildPluginTable(std::vector<PluginNode *>());
 }
 
 FREE_IMAGE_FORMAT
 PluginList::AddNode(FI_InitProc init_proc, void *instance, const char *format, const char *description, const char *extension, const char *regexpr) {
 	if (init_proc != nullptr) {
+		std::lock_guard<std::mutex> guard(m_write_lock);
+
+		const PluginTable *current = m_table.load(std::memory_order_acquire);
+		if(!current) {
+			FreeImage_OutputMessageProc(FIF_UNKNOWN, FI_MSG_ERROR_MEMORY);
+			return FIF_UNKNOWN;
+		}
+		const int node_id = (int)current->m_nodes.size();
+
 		PluginNode *node = new(std::nothrow) PluginNode;
 		Plugin *plugin = new(std::nothrow) Plugin;
 		if(!node || !plugin) {
@@ -101,7 +203,7 @@ PluginList::AddNode(FI_InitProc init_proc, void *instance, const char *format, c
 		// fill-in the plugin structure
 		// note we have memset to 0, so all unset pointers should be nullptr)
 
-		init_proc(plugin, (int)m_plugin_map.size());
+		init_proc(plugin, node_id);
 
 		// get the format string (two possible ways)
 
@@ -116,7 +218,7 @@ PluginList::AddNode(FI_InitProc init_proc, void *instance, const char *format, c
 		// add the node if it wasn't there already
 
 		if (the_format != nullptr) {
-			node->m_id = (int)m_plugin_map.size();
+			node->m_id = node_id;
 			node->m_instance = instance;
 			node->m_plugin = plugin;
 			node->m_format = format;
@@ -125,9 +227,19 @@ PluginList::AddNode(FI_InitProc init_proc, void *instance, const char *format, c
 			node->m_regexpr = regexpr;
 			node->m_enabled = TRUE;
 
-			m_plugin_map[(const int)m_plugin_map.size()] = node;
+			// build and publish a new snapshot
+
+			std::vector<PluginNode *> nodes(current->m_nodes);
+			nodes.push_back(node);
+
+			PluginTable *table = BuildPluginTable(nodes);
+			if(table) {
+				m_retired_tables.push_back(current);
+				m_table.store(table, std::memory_order_release);
 
-			return (FREE_IMAGE_FORMAT)node->m_id;
+				return (FREE_IMAGE_FORMAT)node->m_id;
+			}
+			FreeImage_OutputMessageProc(FIF_UNKNOWN, FI_MSG_ERROR_MEMORY);
 		}
 
 		// something went wrong while allocating the plugin... cleanup
@@ -140,13 +252,16 @@ PluginList::AddNode(FI_InitProc init_proc, void *instance, const char *format, c
 }
 
 PluginNode *
-PluginList::FindNodeFromFormat(const char *format) {
-	for (map<int, PluginNode *>::iterator i = m_plugin_map.begin(); i != m_plugin_map.end(); ++i) {
-		const char *the_format = ((*i).second->m_format != nullptr) ? (*i).second->m_format : (*i).second->m_plugin->format_proc();
-
-		if ((*i).second->m_enabled) {
-			if (FreeImage_stricmp(the_format, format) == 0) {
-				return (*i).second;
+PluginList::FindEnabledNode(const PluginTable *table, const PluginTable::PluginIndex &index, const char *key) const {
+	if(key != nullptr) {
+		PluginTable::PluginIndex::const_iterator i = index.find(key);
+
+		if(i != index.end()) {
+			for(size_t k = 0; k < (*i).second.size(); k++) {
+				PluginNode *node = table->m_nodes[(*i).second[k]];
+				if(node->m_enabled) {
+					return node;
+				}
 			}
 		}
 	}
@@ -154,52 +269,71 @@ PluginList::FindNodeFromFormat(const char *format) {
 	return nullptr;
 }
 
+PluginNode *
+PluginList::FindNodeFromFormat(const char *format) {
+	const PluginTable *table = m_table.load(std::memory_order_acquire);
+
+	return FindEnabledNode(table, table->m_formats, format);
+}
+
 PluginNode *
 PluginList::FindNodeFromMime(const char *mime) {
-	for (map<int, PluginNode *>::iterator i = m_plugin_map.begin(); i != m_plugin_map.end(); ++i) {
-		const char *the_mime = ((*i).second->m_plugin->mime_proc != nullptr) ? (*i).second->m_plugin->mime_proc() : "";
+	const PluginTable *table = m_table.load(std::memory_order_acquire);
 
-		if ((*i).second->m_enabled) {
-			if ((the_mime != nullptr) && (strcmp(the_mime, mime) == 0)) {
-				return (*i).second;
-			}
-		}
-	}
+	return FindEnabledNode(table, table->m_mimes, mime);
+}
 
-	return nullptr;
+PluginNode *
+PluginList::FindNodeFromExtension(const char *extension) {
+	const PluginTable *table = m_table.load(std::memory_order_acquire);
+
+	return FindEnabledNode(table, table->m_extensions, extension);
 }
 
 PluginNode *
 PluginList::FindNodeFromFIF(int node_id) {
-	map<int, PluginNode *>::iterator i = m_plugin_map.find(node_id);
+	const PluginTable *table = m_table.load(std::memory_order_acquire);
 
-	if (i != m_plugin_map.end()) {
-		return (*i).second;
+	if ((node_id >= 0) && (node_id < (int)table->m_nodes.size())) {
+		return table->m_nodes[node_id];
 	}
 
 	return nullptr;
 }
 
+const PluginTable *
+PluginList::GetTable() const {
+	return m_table.load(std::memory_order_acquire);
+}
+
 int
 PluginList::Size() const {
-	return (int)m_plugin_map.size();
+	return (int)m_table.load(std::memory_order_acquire)->m_nodes.size();
 }
 
 BOOL
 PluginList::IsEmpty() const {
-	return m_plugin_map.empty();
+	return m_table.load(std::memory_order_acquire)->m_nodes.empty();
 }
 
 PluginList::~PluginList() {
-	for (map<int, PluginNode *>::iterator i = m_plugin_map.begin(); i != m_plugin_map.end(); ++i) {
+	const PluginTable *table = m_table.load();
+
+	for (size_t i = 0; i < table->m_nodes.size(); ++i) {
+		PluginNode *node = table->m_nodes[i];
 #ifdef _WIN32
-		if ((*i).second->m_instance != nullptr) {
-			FreeLibrary((HINSTANCE)(*i).second->m_instance);
+		if (node->m_instance != nullptr) {
+			FreeLibrary((HINSTANCE)node->m_instance);
 		}
 #endif
-		delete (*i).second->m_plugin;
-		delete ((*i).second);
+		delete node->m_plugin;
+		delete node;
+	}
+
+	for (size_t i = 0; i < m_retired_tables.size(); ++i) {
+		delete m_retired_tables[i];
 	}
+	delete table;
 }
 
 // =====================================================================
@@ -350,6 +484,8 @@ FreeImage_DeInitialise() {
 	if (s_plugin_reference_count == 0) {
 		delete s_plugins;
 		delete &TagLib::instance();
+		// release the cached bitmap data blocks
+		FreeImage_FlushBitmapPool();
 	}
 }
 
@@ -398,6 +534,24 @@ FreeImage_LoadFromHandle(FREE_IMAGE_FORMAT fif, FreeImageIO *io, fi_handle handl
 	return nullptr;
 }
 
+/**
+Load an image from a stream using 64-bit offsets. 
+Plugins see the stream through a FreeImageIO wrapper; those handling large files 
+(TIFF, PSD/PSB, EXR) use its 64-bit seek and tell functions (see IOSeek64).
+*/
+FIBITMAP * DLL_CALLCONV
+FreeImage_LoadFromHandle64(FREE_IMAGE_FORMAT fif, FreeImageIO64 *io64, fi_handle handle, int flags) {
+	if (io64) {
+		FreeImageIO io;
+		FIIO64HANDLE io64_handle;
+		SetIO64(&io, &io64_handle, io64, handle);
+
+		return FreeImage_LoadFromHandle(fif, &io, (fi_handle)&io64_handle, flags);
+	}
+
+	return nullptr;
+}
+
 FIBITMAP * DLL_CALLCONV
 FreeImage_Load(FREE_IMAGE_FORMAT fif, const char *filename, int flags) {
 	FreeImageIO io;
@@ -438,6 +592,455 @@ FreeImage_LoadU(FREE_IMAGE_FORMAT fif, const wchar_t *filename, int flags) {
 	return nullptr;
 }
 
+/**
+Load an image from a file mapped into memory. 
+The plugin reads the file through a read-only memory stream wrapping the mapped view : 
+there is no buffered file read and plugins able to use a contiguous view of the stream (see GetIOView) 
+decode directly from the mapped pages. Falls back to FreeImage_Load when the file cannot be mapped.
+*/
+static FIBITMAP*
+LoadFromMapping(FREE_IMAGE_FORMAT fif, FIMAPPEDFILE *mapping, int flags) {
+	FIBITMAP *bitmap = nullptr;
+
+	FIMEMORY *stream = FreeImage_OpenMemory64(mapping->data, mapping->size);
+	if (stream) {
+		FreeImageIO io;
+		SetMemoryIO(&io);
+
+		bitmap = FreeImage_LoadFromHandle(fif, &io, (fi_handle)stream, flags);
+
+		FreeImage_CloseMemory(stream);
+	}
+	UnmapFile(mapping);
+
+	return bitmap;
+}
+
+FIBITMAP * DLL_CALLCONV
+FreeImage_LoadMapped(FREE_IMAGE_FORMAT fif, const char *filename, int flags) {
+	FIMAPPEDFILE *mapping = MapFile(filename);
+
+	if (mapping) {
+		return LoadFromMapping(fif, mapping, flags);
+	}
+
+	return FreeImage_Load(fif, filename, flags);
+}
+
+FIBITMAP * DLL_CALLCONV
+FreeImage_LoadMappedU(FREE_IMAGE_FORMAT fif, const wchar_t *filename, int flags) {
+#ifdef _WIN32
+	FIMAPPEDFILE *mapping = MapFileU(filename);
+
+	if (mapping) {
+		return LoadFromMapping(fif, mapping, flags);
+	}
+#endif
+	return FreeImage_LoadU(fif, filename, flags);
+}
+
+// ----------------------------------------------------------
+
+/**
+Computes the size of an image fitted into a bounding box, preserving its aspect ratio. 
+Images already fitting into the box keep their size (no upscaling).
+*/
+static void
+FitToBox(int width, int height, int max_width, int max_height, int *fit_width, int *fit_height) {
+	if((width <= max_width) && (height <= max_height)) {
+		*fit_width = width;
+		*fit_height = height;
+		return;
+	}
+	const double scale = MIN((double)max_width / width, (double)max_height / height);
+	*fit_width = CLAMP((int)(width * scale + 0.5), 1, max_width);
+	*fit_height = CLAMP((int)(height * scale + 0.5), 1, max_height);
+}
+
+/**
+Returns TRUE if a (possibly reduced) image of size width x height has the aspect ratio of 
+an image of size ref_width x ref_height. Each dimension of a reduced image may be rounded by up to one pixel.
+*/
+static BOOL
+HasAspectRatio(int width, int height, int ref_width, int ref_height) {
+	const double expected_height = (double)ref_height * width / ref_width;
+	return fabs(expected_height - height) <= MAX(2.0, 0.01 * height) ? TRUE : FALSE;
+}
+
+/**
+FI_ReadScanlineProc reading the source rows of a rescaler from a scanline reader
+*/
+static BOOL DLL_CALLCONV
+ReadDecodedScanline(void *data, unsigned row, uint8_t *bits) {
+	(void)row;
+	return FreeImage_ReadNextScanline((FISCANLINEREADER*)data, bits);
+}
+
+/**
+Load an image fitted into a bounding box by rescaling its rows as they are decoded, 
+so that the full size image is never allocated. 
+Returns nullptr when the image needs no rescaling or when its type is not supported 
+by the streaming rescaler, the stream is then rewound to 'start'.
+*/
+static FIBITMAP *
+LoadScaledScanlines(FREE_IMAGE_FORMAT fif, FreeImageIO *io, fi_handle handle, long start, int max_width, int max_height, FREE_IMAGE_FILTER filter, int flags) {
+	FISCANLINEREADER *reader = FreeImage_OpenScanlineReader(fif, io, handle, flags);
+	if(!reader) {
+		io->seek_proc(handle, start, SEEK_SET);
+		return nullptr;
+	}
+
+	FIBITMAP *header = FreeImage_GetScanlineReaderInfo(reader);
+	const FREE_IMAGE_TYPE image_type = FreeImage_GetImageType(header);
+	const unsigned bpp = FreeImage_GetBPP(header);
+	const int width = (int)FreeImage_GetWidth(header);
+	const int height = (int)FreeImage_GetHeight(header);
+
+	int dst_width, dst_height;
+	FitToBox(width, height, max_width, max_height, &dst_width, &dst_height);
+
+	// images FreeImage_Rescale would convert to another bit depth are not streamed
+	BOOL supported = FALSE;
+	switch(image_type) {
+		case FIT_BITMAP:
+			supported = (bpp == 24) || (bpp == 32) || ((bpp == 8) && (FreeImage_GetColorType(header) == FIC_MINISBLACK) && !FreeImage_IsTransparent(header));
+			break;
+		case FIT_UINT16:
+		case FIT_RGB16:
+		case FIT_RGBA16:
+		case FIT_FLOAT:
+		case FIT_RGBF:
+		case FIT_RGBAF:
+			supported = TRUE;
+			break;
+		default:
+			break;
+	}
+
+	FIBITMAP *dst = nullptr;
+
+	if(supported && ((dst_width != width) || (dst_height != height))) {
+		FIRESCALER *rescaler = FreeImage_OpenRescaler(image_type, bpp, width, height, dst_width, dst_height, filter, ReadDecodedScanline, reader);
+		if(rescaler) {
+			dst = FreeImage_AllocateT(image_type, dst_width, dst_height, bpp);
+			BOOL bSuccess = (dst != nullptr);
+			// rows are decoded from the top of the image
+			for(int y = dst_height - 1; bSuccess && (y >= 0); y--) {
+				bSuccess = FreeImage_ReadRescaledScanline(rescaler, FreeImage_GetScanLine(dst, y));
+			}
+			FreeImage_CloseRescaler(rescaler);
+
+			if(bSuccess) {
+				// decode the rows the filter did not need, for the metadata stored after the image data
+				uint8_t *row = (uint8_t*)malloc(FreeImage_GetLine(header));
+				if(row) {
+					while(FreeImage_ReadNextScanline(reader, row)) {
+					}
+					free(row);
+				}
+				FreeImage_CloneMetadata(dst, header);
+			} else if(dst) {
+				FreeImage_Unload(dst);
+				dst = nullptr;
+			}
+		}
+	}
+
+	FreeImage_CloseScanlineReader(reader);
+
+	if(!dst) {
+		io->seek_proc(handle, start, SEEK_SET);
+	}
+
+	return dst;
+}
+
+FIBITMAP * DLL_CALLCONV
+FreeImage_LoadScaled(FREE_IMAGE_FORMAT fif, FreeImageIO *io, fi_handle handle, int max_width, int max_height, FREE_IMAGE_FILTER filter, int flags) {
+	if(!io || (max_width <= 0) || (max_height <= 0) || ((flags & FIF_LOAD_NOPIXELS) == FIF_LOAD_NOPIXELS)) {
+		return nullptr;
+	}
+	if(!FreeImage_FIFSupportsReading(fif)) {
+		return nullptr;
+	}
+
+	// plugins able to decode at a reduced size when given a size hint (see flags >> 16)
+	const BOOL has_size_hint = (fif == FIF_JPEG) || (fif == FIF_J2K) || (fif == FIF_JP2) || (fif == FIF_RAW);
+	// plugins which may rotate the image on loading
+	const BOOL may_rotate = ((fif == FIF_JPEG) && ((flags & JPEG_EXIFROTATE) == JPEG_EXIFROTATE)) || (fif == FIF_RAW);
+
+	const long start = io->tell_proc(handle);
+
+	// read the image size (and the embedded thumbnail, if any) without decoding the pixels
+
+	int width = 0;
+	int height = 0;
+	FIBITMAP *thumbnail = nullptr;
+
+	if(FreeImage_FIFSupportsNoPixels(fif)) {
+		FIBITMAP *header = FreeImage_LoadFromHandle(fif, io, handle, (flags & 0xFFFF) | FIF_LOAD_NOPIXELS);
+		io->seek_proc(handle, start, SEEK_SET);
+
+		if(header) {
+			width = (int)FreeImage_GetWidth(header);
+			height = (int)FreeImage_GetHeight(header);
+
+			// an embedded thumbnail large enough for the target size is the cheapest source
+			FIBITMAP *embedded = FreeImage_GetThumbnail(header);
+			if(embedded && !may_rotate && (width > 0) && (height > 0)) {
+				const int thumb_width = (int)FreeImage_GetWidth(embedded);
+				const int thumb_height = (int)FreeImage_GetHeight(embedded);
+				int fit_width, fit_height;
+				FitToBox(width, height, max_width, max_height, &fit_width, &fit_height);
+
+				if((thumb_width >= fit_width) && (thumb_height >= fit_height) && HasAspectRatio(thumb_width, thumb_height, width, height)) {
+					thumbnail = FreeImage_RescaleRect(embedded, fit_width, fit_height, 0, 0, thumb_width, thumb_height, filter, FI_RESCALE_OMIT_METADATA);
+					if(thumbnail) {
+						FreeImage_CloneMetadata(thumbnail, header);
+					}
+				}
+			}
+
+			FreeImage_Unload(header);
+		}
+	}
+
+	if(thumbnail) {
+		return thumbnail;
+	}
+
+	// without a reduced decoding, rescale the rows while they are decoded
+
+	if(!has_size_hint && FreeImage_FIFSupportsScanlineReading(fif)) {
+		FIBITMAP *dst = LoadScaledScanlines(fif, io, handle, start, max_width, max_height, filter, flags);
+		if(dst) {
+			return dst;
+		}
+	}
+
+	// decode at the smallest size supported by the plugin, yet at least as large as the target size
+
+	int load_flags = flags;
+
+	if(has_size_hint) {
+		int size_hint = MAX(max_width, max_height);
+		if((width > 0) && (height > 0)) {
+			int fit_width, fit_height;
+			FitToBox(width, height, max_width, max_height, &fit_width, &fit_height);
+			size_hint = MAX(fit_width, fit_height);
+			if(may_rotate) {
+				FitToBox(height, width, max_width, max_height, &fit_width, &fit_height);
+				size_hint = MAX(size_hint, MAX(fit_width, fit_height));
+			}
+		}
+		load_flags = (flags & 0xFFFF) | (MIN(size_hint, 0x7FFF) << 16);
+	}
+
+	FIBITMAP *dib = FreeImage_LoadFromHandle(fif, io, handle, load_flags);
+	if(!dib) {
+		return nullptr;
+	}
+
+	// resample to the exact target size
+
+	const int dib_width = (int)FreeImage_GetWidth(dib);
+	const int dib_height = (int)FreeImage_GetHeight(dib);
+
+	// a reduced decoding rounds the image size: compute the target size from the original size if possible
+	int ref_width = dib_width;
+	int ref_height = dib_height;
+	if((width > 0) && (height > 0)) {
+		if(HasAspectRatio(dib_width, dib_height, width, height)) {
+			ref_width = width;
+			ref_height = height;
+		} else if(HasAspectRatio(dib_width, dib_height, height, width)) {
+			// image was rotated on loading
+			ref_width = height;
+			ref_height = width;
+		}
+	}
+
+	int dst_width, dst_height;
+	FitToBox(ref_width, ref_height, max_width, max_height, &dst_width, &dst_height);
+
+	if((dst_width == dib_width) && (dst_height == dib_height)) {
+		return dib;
+	}
+
+	FIBITMAP *dst = FreeImage_Rescale(dib, dst_width, dst_height, filter);
+	FreeImage_Unload(dib);
+
+	return dst;
+}
+
+/**
+Load a rectangular region of an image. 
+Plugins able to decode a region (see FreeImage_FIFSupportsLoadRegion) only read and decompress 
+the parts of the file intersecting the region, other plugins load the whole image and crop it. 
+The rectangle follows the FreeImage_Copy conventions: (left, top) is included, (right, bottom) is excluded, 
+and the rectangle is clipped to the image bounds.
+@param fif Format of the image
+@param io FreeImage IO
+@param handle FreeImage handle
+@param page Page (or directory) to load, -1 for the default image
+@param left Left position of the region
+@param top Top position of the region
+@param right Right position of the region
+@param bottom Bottom position of the region
+@param flags Load flags (FIF_LOAD_NOPIXELS is ignored)
+@return Returns the loaded region if successful, returns nullptr otherwise
+*/
+FIBITMAP * DLL_CALLCONV
+FreeImage_LoadRegion(FREE_IMAGE_FORMAT fif, FreeImageIO *io, fi_handle handle, int page, int left, int top, int right, int bottom, int flags) {
+	if ((fif >= 0) && (fif < FreeImage_GetFIFCount())) {
+		PluginNode *node = s_plugins->FindNodeFromFIF(fif);
+		
+		if (node != nullptr) {
+			flags &= ~FIF_LOAD_NOPIXELS;
+
+			if (node->m_plugin->load_region_proc != nullptr) {
+				void *data = FreeImage_Open(node, io, handle, TRUE);
+
+				FIBITMAP *bitmap = node->m_plugin->load_region_proc(io, handle, page, left, top, right, bottom, flags, data);
+
+				FreeImage_Close(node, io, handle, data);
+
+				return bitmap;
+			}
+			else if (node->m_plugin->load_proc != nullptr) {
+				// no region support: load the whole image and crop it
+				void *data = FreeImage_Open(node, io, handle, TRUE);
+
+				FIBITMAP *bitmap = node->m_plugin->load_proc(io, handle, page, flags, data);
+
+				FreeImage_Close(node, io, handle, data);
+
+				if (bitmap) {
+					// normalize and clip the rectangle
+					if (right < left) {
+						INPLACESWAP(left, right);
+					}
+					if (bottom < top) {
+						INPLACESWAP(top, bottom);
+					}
+					left = MAX(left, 0);
+					top = MAX(top, 0);
+					right = MIN(right, (int)FreeImage_GetWidth(bitmap));
+					bottom = MIN(bottom, (int)FreeImage_GetHeight(bitmap));
+
+					FIBITMAP *region = ((left < right) && (top < bottom)) ? FreeImage_Copy(bitmap, left, top, right, bottom) : nullptr;
+					FreeImage_Unload(bitmap);
+
+					return region;
+				}
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+// ----------------------------------------------------------
+
+/**
+State of a scanline reader
+*/
+typedef struct tagScanlineReader {
+	PluginNode *node;
+	FreeImageIO *io;
+	fi_handle handle;
+	void *data;			//! plugin data returned by FreeImage_Open
+	void *reader;		//! plugin reader state
+	FIBITMAP *header;	//! header only bitmap describing the rows
+} ScanlineReader;
+
+/**
+Open an image for row by row decoding (see FreeImage_FIFSupportsScanlineReading). 
+Rows are decoded on demand, from the top of the image, so that they can be processed 
+(e.g. by a rescaler opened with FreeImage_OpenRescaler) while the rest of the file is still to be decoded. 
+The IO handle must stay valid until the reader is closed.
+@param fif Format of the image
+@param io FreeImage IO
+@param handle FreeImage handle
+@param flags Load flags (FIF_LOAD_NOPIXELS is ignored)
+@return Returns the reader if successful, returns nullptr otherwise
+@see FreeImage_GetScanlineReaderInfo, FreeImage_ReadNextScanline, FreeImage_CloseScanlineReader
+*/
+FISCANLINEREADER * DLL_CALLCONV
+FreeImage_OpenScanlineReader(FREE_IMAGE_FORMAT fif, FreeImageIO *io, fi_handle handle, int flags) {
+	if (!io || !handle || (fif < 0) || (fif >= FreeImage_GetFIFCount())) {
+		return nullptr;
+	}
+	PluginNode *node = s_plugins->FindNodeFromFIF(fif);
+	if (!node || !node->m_plugin->open_scanline_reader_proc) {
+		return nullptr;
+	}
+
+	ScanlineReader *reader = new(std::nothrow) ScanlineReader;
+	FISCANLINEREADER *scanline_reader = new(std::nothrow) FISCANLINEREADER;
+	if (!reader || !scanline_reader) {
+		delete reader;
+		delete scanline_reader;
+		return nullptr;
+	}
+
+	reader->node = node;
+	reader->io = io;
+	reader->handle = handle;
+	reader->header = nullptr;
+	reader->data = FreeImage_Open(node, io, handle, TRUE);
+	reader->reader = node->m_plugin->open_scanline_reader_proc(io, handle, -1, flags & ~FIF_LOAD_NOPIXELS, reader->data, &reader->header);
+
+	if (!reader->reader) {
+		FreeImage_Close(node, io, handle, reader->data);
+		delete reader;
+		delete scanline_reader;
+		return nullptr;
+	}
+
+	scanline_reader->data = reader;
+
+	return scanline_reader;
+}
+
+/**
+Returns a header only bitmap describing the rows returned by a scanline reader: 
+image type, size, bit depth, palette, transparency and metadata. 
+Metadata stored after the image data are added once the last row has been read. 
+The bitmap belongs to the reader.
+*/
+FIBITMAP * DLL_CALLCONV
+FreeImage_GetScanlineReaderInfo(FISCANLINEREADER *scanline_reader) {
+	return scanline_reader ? ((ScanlineReader*)scanline_reader->data)->header : nullptr;
+}
+
+/**
+Decode the next row of an image
+@param scanline_reader Scanline reader
+@param bits Buffer receiving the row, FreeImage_GetLine(header) bytes in the pixel layout of a FreeImage scanline
+@return Returns TRUE if successful, returns FALSE on error or when all the rows have been read
+*/
+BOOL DLL_CALLCONV
+FreeImage_ReadNextScanline(FISCANLINEREADER *scanline_reader, uint8_t *bits) {
+	if (scanline_reader && bits) {
+		ScanlineReader *reader = (ScanlineReader*)scanline_reader->data;
+		return reader->node->m_plugin->read_next_scanline_proc(reader->reader, bits);
+	}
+	return FALSE;
+}
+
+void DLL_CALLCONV
+FreeImage_CloseScanlineReader(FISCANLINEREADER *scanline_reader) {
+	if (scanline_reader) {
+		ScanlineReader *reader = (ScanlineReader*)scanline_reader->data;
+		reader->node->m_plugin->close_scanline_reader_proc(reader->reader);
+		FreeImage_Close(reader->node, reader->io, reader->handle, reader->data);
+		FreeImage_Unload(reader->header);
+		delete reader;
+		delete scanline_reader;
+	}
+}
+
 BOOL DLL_CALLCONV
 FreeImage_SaveToHandle(FREE_IMAGE_FORMAT fif, FIBITMAP *dib, FreeImageIO *io, fi_handle handle, int flags) {
 	// cannot save "header only" formats
@@ -466,6 +1069,22 @@ FreeImage_SaveToHandle(FREE_IMAGE_FORMAT fif, FIBITMAP *dib, FreeImageIO *io, fi
 }
 
 
+/**
+Save an image to a stream using 64-bit offsets (see FreeImage_LoadFromHandle64)
+*/
+BOOL DLL_CALLCONV
+FreeImage_SaveToHandle64(FREE_IMAGE_FORMAT fif, FIBITMAP *dib, FreeImageIO64 *io64, fi_handle handle, int flags) {
+	if (io64) {
+		FreeImageIO io;
+		FIIO64HANDLE io64_handle;
+		SetIO64(&io, &io64_handle, io64, handle);
+
+		return FreeImage_SaveToHandle(fif, dib, &io, (fi_handle)&io64_handle, flags);
+	}
+
+	return FALSE;
+}
+
 BOOL DLL_CALLCONV
 FreeImage_Save(FREE_IMAGE_FORMAT fif, FIBITMAP *dib, const char *filename, int flags) {
 	FreeImageIO io;
@@ -543,11 +1162,7 @@ FreeImage_SetPluginEnabled(FREE_IMAGE_FORMAT fif, BOOL enable) {
 		PluginNode *node = s_plugins->FindNodeFromFIF(fif);
 
 		if (node != nullptr) {
-			BOOL previous_state = node->m_enabled;
-
-			node->m_enabled = enable;
-
-			return previous_state;
+			return node->m_enabled.exchange(enable);
 		}
 	}
 
@@ -559,7 +1174,7 @@ FreeImage_IsPluginEnabled(FREE_IMAGE_FORMAT fif) {
 	if (s_plugins != nullptr) {
 		PluginNode *node = s_plugins->FindNodeFromFIF(fif);
 
-		return (node != nullptr) ? node->m_enabled : FALSE;
+		return (node != nullptr) ? node->m_enabled.load() : FALSE;
 	}
 	
 	return -1;
@@ -725,53 +1340,43 @@ FreeImage_FIFSupportsNoPixels(FREE_IMAGE_FORMAT fif) {
 	return FALSE;
 }
 
-FREE_IMAGE_FORMAT DLL_CALLCONV
-FreeImage_GetFIFFromFilename(const char *filename) {
-	if (filename != nullptr) {
-		const char *extension;
-
-		// get the proper extension if we received a filename
-
-		char *place = strrchr((char *)filename, '.');	
-		extension = (place != nullptr) ? ++place : filename;
-
-		// look for the extension in the plugin table
-
-		for (int i = 0; i < FreeImage_GetFIFCount(); ++i) {
+BOOL DLL_CALLCONV
+FreeImage_FIFSupportsLoadRegion(FREE_IMAGE_FORMAT fif) {
+	if (s_plugins != nullptr) {
+		PluginNode *node = s_plugins->FindNodeFromFIF(fif);
 
-			if (s_plugins->FindNodeFromFIF(i)->m_enabled) {
+		return (node != nullptr) ? (node->m_plugin->load_region_proc != nullptr) : FALSE;
+	}
 
-				// compare the format id with the extension
+	return FALSE;
+}
 
-				if (FreeImage_stricmp(FreeImage_GetFormatFromFIF((FREE_IMAGE_FORMAT)i), extension) == 0) {
-					return (FREE_IMAGE_FORMAT)i;
-				} else {
-					// make a copy of the extension list and split it
+BOOL DLL_CALLCONV
+FreeImage_FIFSupportsScanlineReading(FREE_IMAGE_FORMAT fif) {
+	if (s_plugins != nullptr) {
+		PluginNode *node = s_plugins->FindNodeFromFIF(fif);
 
-					char *copy = (char *)malloc(strlen(FreeImage_GetFIFExtensionList((FREE_IMAGE_FORMAT)i)) + 1);
-					memset(copy, 0, strlen(FreeImage_GetFIFExtensionList((FREE_IMAGE_FORMAT)i)) + 1);
-					memcpy(copy, FreeImage_GetFIFExtensionList((FREE_IMAGE_FORMAT)i), strlen(FreeImage_GetFIFExtensionList((FREE_IMAGE_FORMAT)i)));
+		return (node != nullptr) ? (node->m_plugin->open_scanline_reader_proc != nullptr) : FALSE;
+	}
 
-					// get the first token
+	return FALSE;
+}
 
-					char *token = strtok(copy, ",");
+FREE_IMAGE_FORMAT DLL_CALLCONV
+FreeImage_GetFIFFromFilename(const char *filename) {
+	if ((filename != nullptr) && (s_plugins != nullptr)) {
+		const char *extension;
 
-					while (token != nullptr) {
-						if (FreeImage_stricmp(token, extension) == 0) {
-							free(copy);
+		// get the proper extension if we received a filename
 
-								return (FREE_IMAGE_FORMAT)i;
-						}
+		const char *place = strrchr(filename, '.');	
+		extension = (place != nullptr) ? ++place : filename;
 
-						token = strtok(nullptr, ",");
-					}
+		// look for the extension (or the format id) in the plugin table
 
-					// free the copy of the extension list
+		PluginNode *node = s_plugins->FindNodeFromExtension(extension);
 
-					free(copy);
-				}	
-			}
-		}
+		return (node != nullptr) ? (FREE_IMAGE_FORMAT)node->m_id : FIF_UNKNOWN;
 	}
 
 	return FIF_UNKNOWN;
@@ -1077,6 +1077,20 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return FALSE;
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t bmp_signature1[] = { 0x42, 0x4D };
+	static const uint8_t bmp_signature2[] = { 0x42, 0x41 };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(bmp_signature1), bmp_signature1, nullptr },
+		{ 0, sizeof(bmp_signature2), bmp_signature2, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return (
@@ -1173,7 +1187,7 @@ On return, the function will return the real size of the target buffer, which sh
 @return Returns the target buffer size
 */
 static int
-RLEEncodeLine(uint8_t *target, uint8_t *source, int size) {
+RLEEncodeLine(uint8_t *target, const uint8_t *source, int size) {
 	uint8_t buffer[256];
 	int buffer_size = 0;
 	int target_pos = 0;
@@ -1418,7 +1432,7 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 			uint8_t *buffer = (uint8_t*)malloc(dst_pitch * 2 * sizeof(uint8_t));
 
 			for (unsigned i = 0; i < dst_height; ++i) {
-				int size = RLEEncodeLine(buffer, FreeImage_GetScanLine(dib, i), FreeImage_GetLine(dib));
+				int size = RLEEncodeLine(buffer, FreeImage_GetConstScanLine(dib, i), FreeImage_GetLine(dib));
 
 				if (io->write_proc(buffer, size, 1, handle) != 1) {
 					free(buffer);
@@ -1441,9 +1455,9 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 			uint16_t pad = 0;
 			uint16_t pixel;
 			for(unsigned y = 0; y < dst_height; y++) {
-				uint8_t *line = FreeImage_GetScanLine(dib, y);
+				const uint8_t *line = FreeImage_GetConstScanLine(dib, y);
 				for(unsigned x = 0; x < dst_width; x++) {
-					pixel = ((uint16_t *)line)[x];
+					pixel = ((const uint16_t *)line)[x];
 					SwapShort(&pixel);
 					if (io->write_proc(&pixel, sizeof(uint16_t), 1, handle) != 1) {
 						return FALSE;
@@ -1462,9 +1476,9 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 			uint32_t pad = 0;
 			FILE_BGR bgr;
 			for(unsigned y = 0; y < dst_height; y++) {
-				uint8_t *line = FreeImage_GetScanLine(dib, y);
+				const uint8_t *line = FreeImage_GetConstScanLine(dib, y);
 				for(unsigned x = 0; x < dst_width; x++) {
-					RGBTRIPLE *triple = ((RGBTRIPLE *)line)+x;
+					const RGBTRIPLE *triple = ((const RGBTRIPLE *)line)+x;
 					bgr.b = triple->rgbtBlue;
 					bgr.g = triple->rgbtGreen;
 					bgr.r = triple->rgbtRed;
@@ -1481,9 +1495,9 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 		} else if (dst_bpp == 32) {
 			FILE_BGRA bgra;
 			for(unsigned y = 0; y < dst_height; y++) {
-				uint8_t *line = FreeImage_GetScanLine(dib, y);
+				const uint8_t *line = FreeImage_GetConstScanLine(dib, y);
 				for(unsigned x = 0; x < dst_width; x++) {
-					RGBQUAD *quad = ((RGBQUAD *)line)+x;
+					const RGBQUAD *quad = ((const RGBQUAD *)line)+x;
 					bgra.b = quad->rgbBlue;
 					bgra.g = quad->rgbGreen;
 					bgra.r = quad->rgbRed;
@@ -1496,13 +1510,13 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 #endif
 		} 
 		else if (FreeImage_GetPitch(dib) == dst_pitch) {
-			return (io->write_proc(FreeImage_GetBits(dib), dst_height * dst_pitch, 1, handle) != 1) ? FALSE : TRUE;
+			return (io->write_proc((void *)FreeImage_GetConstBits(dib), dst_height * dst_pitch, 1, handle) != 1) ? FALSE : TRUE;
 		}
 		else {
 			for (unsigned y = 0; y < dst_height; y++) {
-				uint8_t *line = (uint8_t*)FreeImage_GetScanLine(dib, y);
+				const uint8_t *line = FreeImage_GetConstScanLine(dib, y);
 				
-				if (io->write_proc(line, dst_pitch, 1, handle) != 1) {
+				if (io->write_proc((void *)line, dst_pitch, 1, handle) != 1) {
 					return FALSE;
 				}
 			}
@@ -1534,6 +1548,7 @@ InitBMP(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = Save;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
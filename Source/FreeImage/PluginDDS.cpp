@@ -23,6 +23,7 @@
 
 #include "FreeImage.h"
 #include "Utilities.h"
+#include "FreeImageIO.h"
 
 // ----------------------------------------------------------
 //   Definitions for the RGB 444 format
@@ -707,11 +708,26 @@ LoadDXT_Helper(FreeImageIO *io, fi_handle handle, FIBITMAP *dib, int width, int
 	const int inputLine = (width + 3) / 4;
 	int y = 0;
 
+	// when the stream is in memory (e.g. a mapped file), decode the blocks in place
+	const size_t blockLineSize = sizeof(Block) * inputLine;
+	const size_t blockLines = (size_t)(height + 3) / 4;
+	const uint8_t *view = nullptr;
+	size_t view_size = 0;
+	const BOOL use_view = GetIOView(io, handle, &view, &view_size)
+		&& (view_size >= blockLines * blockLineSize) && (((uintptr_t)view % alignof(Block)) == 0);
+	if (use_view) {
+		io->seek_proc(handle, (long)(blockLines * blockLineSize), SEEK_CUR);
+	}
+
 	if (height >= 4) {
 		for (; y < heightTrimmed; y += 4) {
-			io->read_proc (input_buffer, sizeof(typename INFO::Block), inputLine, handle);
+			const uint8_t *pbSrc = (const uint8_t *)input_buffer;
+			if (use_view) {
+				pbSrc = view + (y / 4) * blockLineSize;
+			} else {
+				io->read_proc (input_buffer, sizeof(typename INFO::Block), inputLine, handle);
+			}
 			// TODO: probably need some endian work here
-			const uint8_t *pbSrc = (uint8_t *)input_buffer;
 			uint8_t *pbDst = FreeImage_GetScanLine (dib, height - y - 1);
 
 			if (widthTrimmed >= 4) {
@@ -727,9 +743,13 @@ LoadDXT_Helper(FreeImageIO *io, fi_handle handle, FIBITMAP *dib, int width, int
 		}
 	}
 	if (heightRest)	{
-		io->read_proc (input_buffer, sizeof (typename INFO::Block), inputLine, handle);
+		const uint8_t *pbSrc = (const uint8_t *)input_buffer;
+		if (use_view) {
+			pbSrc = view + (y / 4) * blockLineSize;
+		} else {
+			io->read_proc (input_buffer, sizeof (typename INFO::Block), inputLine, handle);
+		}
 		// TODO: probably need some endian work here
-		const uint8_t *pbSrc = (uint8_t *)input_buffer;
 		uint8_t *pbDst = FreeImage_GetScanLine (dib, height - y - 1);
 
 		if (widthTrimmed >= 4) {
@@ -829,6 +849,32 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return TRUE;
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	// 'DDS ' magic number, surfaceDesc.dwSize = 124, surfaceDesc.ddspf.dwSize = 32 (little-endian)
+	static const uint8_t dds_signature[] = {
+		0x44, 0x44, 0x53, 0x20, 0x7C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00
+	};
+	static const uint8_t dds_signature_mask[] = {
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF
+	};
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(dds_signature), dds_signature, dds_signature_mask }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return FALSE;
@@ -916,6 +962,7 @@ InitDDS(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = nullptr;	//Save;	// not implemented (yet?)
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
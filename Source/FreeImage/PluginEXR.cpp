@@ -22,6 +22,7 @@
 
 #include "FreeImage.h"
 #include "Utilities.h"
+#include "FreeImageIO.h"
 
 #ifdef _MSC_VER
 // OpenEXR has many problems with MSVC warnings (why not just correct them ?), just ignore one of them
@@ -67,11 +68,11 @@ public:
 	}
 
 	virtual uint64_t tellg() {
-		return _io->tell_proc(_handle);
+		return (uint64_t)IOTell64(_io, _handle);
 	}
 
 	virtual void seekg(uint64_t pos) {
-		_io->seek_proc(_handle, (unsigned)pos, SEEK_SET);
+		IOSeek64(_io, _handle, (int64_t)pos, SEEK_SET);
 	}
 
 	virtual void clear() {
@@ -101,11 +102,11 @@ public:
 	}
 
 	virtual uint64_t tellp() {
-		return _io->tell_proc(_handle);
+		return (uint64_t)IOTell64(_io, _handle);
 	}
 
 	virtual void seekp(uint64_t pos) {
-		_io->seek_proc(_handle, (unsigned)pos, SEEK_SET);
+		IOSeek64(_io, _handle, (int64_t)pos, SEEK_SET);
 	}
 };
 
@@ -150,6 +151,18 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return (memcmp(exr_signature, signature, 4) == 0);
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t exr_signature[] = { 0x76, 0x2F, 0x31, 0x01 };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(exr_signature), exr_signature, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return FALSE;
@@ -184,7 +197,7 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 		BOOL header_only = (flags & FIF_LOAD_NOPIXELS) == FIF_LOAD_NOPIXELS;
 
 		// save the stream starting point
-		const long stream_start = io->tell_proc(handle);
+		const int64_t stream_start = IOTell64(io, handle);
 
 		// wrap the FreeImage IO stream
 		C_IStream istream(io, handle);
@@ -363,7 +376,7 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 			uint8_t *scanline = (uint8_t*)bits;
 
 			// re-open using the RGBA interface
-			io->seek_proc(handle, stream_start, SEEK_SET);
+			IOSeek64(io, handle, stream_start, SEEK_SET);
 			Imf::RgbaInputFile rgbaFile(istream);
 
 			// read the file in chunks
@@ -765,6 +778,7 @@ InitEXR(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = Save;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
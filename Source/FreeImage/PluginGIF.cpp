@@ -47,6 +47,39 @@
 // ==========================================================
 
 
+//distance between two snapshots of the playback canvas, in frames
+#define GIF_KEYFRAME_INTERVAL		16
+//memory budget of the snapshots of an animation
+#define GIF_KEYFRAME_MEMORY			(64 * 1024 * 1024)
+
+/**
+Playback state of an animation (GIF_PLAYBACK). 
+The canvas holds the logical screen once 'frame' has been drawn and disposed of, so that playing 
+the next frame only has to draw that frame. Snapshots of the canvas, taken every 'interval' frames, 
+bound the number of frames replayed when seeking backwards.
+*/
+struct GIFPlayback {
+	uint16_t logical_width, logical_height;
+	RGBQUAD background;
+	FIBITMAP *canvas;
+	//! last frame applied to the canvas, -1 for the empty logical screen
+	int frame;
+	int interval;
+	//! snapshots of the canvas, indexed by their last applied frame
+	std::map<int, FIBITMAP *> keyframes;
+
+	GIFPlayback() : logical_width(0), logical_height(0), canvas(nullptr), frame(-1), interval(GIF_KEYFRAME_INTERVAL)
+	{
+		memset(&background, 0, sizeof(RGBQUAD));
+	}
+	~GIFPlayback() {
+		FreeImage_Unload(canvas);
+		for( std::map<int, FIBITMAP *>::iterator i = keyframes.begin(); i != keyframes.end(); ++i ) {
+			FreeImage_Unload(i->second);
+		}
+	}
+};
+
 struct GIFinfo {
 	BOOL read;
 	//only really used when reading
@@ -57,6 +90,8 @@ struct GIFinfo {
 	std::vector<size_t> comment_extension_offsets;
 	std::vector<size_t> graphic_control_extension_offsets;
 	std::vector<size_t> image_descriptor_offsets;
+	//created by the first GIF_PLAYBACK load, kept between pages of a multipage bitmap
+	std::unique_ptr<GIFPlayback> playback;
 
 	GIFinfo() : read(0), global_color_table_offset(0), global_color_table_size(0), background_color(0)
 	{
@@ -74,6 +109,9 @@ struct PageInfo {
 //GIF defines a max of 12 bits per code
 #define MAX_LZW_CODE			4096
 
+//size of the compressor dictionary hash table (a power of 2, twice the number of codes)
+#define LZW_HASH_SIZE			8192
+
 class StringTable
 {
 public:
@@ -97,13 +135,23 @@ protected:
 	int m_prefix; //Compressor state variable
 	int m_codeSize, m_codeMask; //Compressor/Decompressor state variables
 	int m_oldCode; //Decompressor state variable
-	int m_partial, m_partialSize; //Compressor/Decompressor bit buffer
+	unsigned m_partial; //Compressor/Decompressor bit buffer
+	int m_partialSize;
 
 	int firstPixelPassed; // A specific flag that indicates if the first pixel
 	                      // of the whole image had already been read
 
-	std::string m_strings[MAX_LZW_CODE]; //This is what is really the "string table" data for the Decompressor
-	int* m_strmap;
+	//Decompressor string table : each code is the string of its prefix code followed by its suffix
+	uint16_t m_prefixes[MAX_LZW_CODE];
+	uint8_t m_suffixes[MAX_LZW_CODE];
+	uint8_t m_firsts[MAX_LZW_CODE];
+	uint16_t m_lengths[MAX_LZW_CODE];
+	//string cut by the end of the output buffer, and the number of its bytes already output
+	int m_pendingCode, m_pendingLength;
+
+	//Compressor dictionary : (prefix << 8 | pixel) + 1 keys, 0 for an empty slot, and their codes
+	uint32_t m_hashKeys[LZW_HASH_SIZE];
+	uint16_t m_hashCodes[LZW_HASH_SIZE];
 
 	//input buffer
 	uint8_t *m_buffer;
@@ -111,6 +159,7 @@ protected:
 
 	void ClearCompressorTable(void);
 	void ClearDecompressorTable(void);
+	void OutputString(int code, int skip, int count, uint8_t *buf) const;
 };
 
 #define GIF_PACKED_LSD_HAVEGCT		0x80
@@ -184,10 +233,6 @@ StringTable::StringTable()
 {
 	m_buffer = nullptr;
 	firstPixelPassed = 0; // Still no pixel read
-	// Maximum number of entries in the map is MAX_LZW_CODE * 256 
-	// (aka 2**12 * 2**8 => a 20 bits key)
-	// This Map could be optmized to only handle MAX_LZW_CODE * 2**(m_bpp)
-	m_strmap = new(std::nothrow) int[1<<20];
 }
 
 StringTable::~StringTable()
@@ -195,10 +240,6 @@ StringTable::~StringTable()
 	if( m_buffer != nullptr ) {
 		delete [] m_buffer;
 	}
-	if( m_strmap != nullptr ) {
-		delete [] m_strmap;
-		m_strmap = nullptr;
-	}
 }
 
 void StringTable::Initialize(int minCodeSize)
@@ -219,6 +260,16 @@ void StringTable::Initialize(int minCodeSize)
 	m_bufferSize = 0;
 	ClearCompressorTable();
 	ClearDecompressorTable();
+
+	//single pixel strings
+	for( int i = 0; i < m_clearCode; i++ ) {
+		m_prefixes[i] = 0;
+		m_suffixes[i] = (uint8_t)i;
+		m_firsts[i] = (uint8_t)i;
+		m_lengths[i] = 1;
+	}
+	m_pendingCode = MAX_LZW_CODE;
+	m_pendingLength = 0;
 }
 
 uint8_t *StringTable::FillInputBuffer(int len)
@@ -282,81 +333,70 @@ bool StringTable::Compress(uint8_t *buf, int *len)
 		return false;
 	}
 
-	int mask = (1 << m_bpp) - 1;
+	const int mask = (1 << m_bpp) - 1;
 	uint8_t *bufpos = buf;
+	uint8_t *const bufend = buf + *len;
 	while( m_bufferPos < m_bufferSize ) {
 		//get the current pixel value
-		char ch = (char)((m_buffer[m_bufferPos] >> m_bufferShift) & mask);
-
-		// The next prefix is : 
-		// <the previous LZW code (on 12 bits << 8)> | <the code of the current pixel (on 8 bits)>
-		int nextprefix = (((m_prefix)<<8)&0xFFF00) + (ch & 0x000FF);
-		if(firstPixelPassed) {
-			
-			if( m_strmap[nextprefix] > 0) {
-				m_prefix = m_strmap[nextprefix];
-			} else {
-				m_partial |= m_prefix << m_partialSize;
-				m_partialSize += m_codeSize;
-				//grab full bytes for the output buffer
-				while( m_partialSize >= 8 && bufpos - buf < *len ) {
-					*bufpos++ = (uint8_t)m_partial;
-					m_partial >>= 8;
-					m_partialSize -= 8;
-				}
+		const int ch = (m_buffer[m_bufferPos] >> m_bufferShift) & mask;
 
-				//add the code to the "table map"
-				m_strmap[nextprefix] = m_nextCode;
+		//increment to the next pixel
+		if( m_bufferShift > 0 && !(m_bufferPos + 1 == m_bufferSize && m_bufferShift <= m_slack) ) {
+			m_bufferShift -= m_bpp;
+		} else {
+			m_bufferPos++;
+			m_bufferShift = 8 - m_bpp;
+		}
 
-				//increment the next highest valid code, increase the code size
-				if( m_nextCode == (1 << m_codeSize) ) {
-					m_codeSize++;
-				}
-				m_nextCode++;
+		if( !firstPixelPassed ) {
+			// Specific behavior for the first pixel of the whole image
+			firstPixelPassed = 1;
+			m_prefix = ch;
+			continue;
+		}
 
-				//if we're out of codes, restart the string table
-				if( m_nextCode == MAX_LZW_CODE ) {
-					m_partial |= m_clearCode << m_partialSize;
-					m_partialSize += m_codeSize;
-					ClearCompressorTable();
-				}
+		//look for the string <prefix><pixel> in the dictionary
+		const uint32_t key = (((uint32_t)m_prefix << 8) | (uint32_t)ch) + 1;
+		uint32_t slot = (key * 0x9E3779B1U) >> 19;
+		while( m_hashKeys[slot] != 0 && m_hashKeys[slot] != key ) {
+			slot = (slot + 1) & (LZW_HASH_SIZE - 1);
+		}
+		if( m_hashKeys[slot] == key ) {
+			m_prefix = m_hashCodes[slot];
+			continue;
+		}
 
-				// Only keep the 8 lowest bits (prevent problems with "negative chars")
-				m_prefix = ch & 0x000FF;
-			}
+		m_partial |= m_prefix << m_partialSize;
+		m_partialSize += m_codeSize;
+		//grab full bytes for the output buffer
+		while( m_partialSize >= 8 && bufpos < bufend ) {
+			*bufpos++ = (uint8_t)m_partial;
+			m_partial >>= 8;
+			m_partialSize -= 8;
+		}
 
-			//increment to the next pixel
-			if( m_bufferShift > 0 && !(m_bufferPos + 1 == m_bufferSize && m_bufferShift <= m_slack) ) {
-				m_bufferShift -= m_bpp;
-			} else {
-				m_bufferPos++;
-				m_bufferShift = 8 - m_bpp;
-			}
+		//add the code to the dictionary
+		m_hashKeys[slot] = key;
+		m_hashCodes[slot] = (uint16_t)m_nextCode;
 
-			//jump out here if the output buffer is full
-			if( bufpos - buf == *len ) {
-				return true;
-			}
-		
-		} else {
-			// Specific behavior for the first pixel of the whole image
+		//increment the next highest valid code, increase the code size
+		if( m_nextCode == (1 << m_codeSize) ) {
+			m_codeSize++;
+		}
+		m_nextCode++;
 
-			firstPixelPassed=1;
-			// Only keep the 8 lowest bits (prevent problems with "negative chars")
-			m_prefix = ch & 0x000FF;
+		//if we're out of codes, restart the string table
+		if( m_nextCode == MAX_LZW_CODE ) {
+			m_partial |= m_clearCode << m_partialSize;
+			m_partialSize += m_codeSize;
+			ClearCompressorTable();
+		}
 
-			//increment to the next pixel
-			if( m_bufferShift > 0 && !(m_bufferPos + 1 == m_bufferSize && m_bufferShift <= m_slack) ) {
-				m_bufferShift -= m_bpp;
-			} else {
-				m_bufferPos++;
-				m_bufferShift = 8 - m_bpp;
-			}
+		m_prefix = ch;
 
-			//jump out here if the output buffer is full
-			if( bufpos - buf == *len ) {
-				return true;
-			}
+		//jump out here if the output buffer is full
+		if( bufpos == bufend ) {
+			return true;
 		}
 	}
 
@@ -366,6 +406,21 @@ bool StringTable::Compress(uint8_t *buf, int *len)
 	return true;
 }
 
+/**
+Output 'count' bytes of the string of a code, starting at its byte 'skip'. 
+Strings are linked from their last byte, so that they are written backwards.
+*/
+void StringTable::OutputString(int code, int skip, int count, uint8_t *buf) const
+{
+	for( int i = m_lengths[code] - skip - count; i > 0; i-- ) {
+		code = m_prefixes[code];
+	}
+	for( int i = count - 1; i >= 0; i-- ) {
+		buf[i] = m_suffixes[code];
+		code = m_prefixes[code];
+	}
+}
+
 bool StringTable::Decompress(uint8_t *buf, int *len)
 {
 	if( m_bufferSize == 0 || m_done ) {
@@ -373,58 +428,77 @@ bool StringTable::Decompress(uint8_t *buf, int *len)
 	}
 
 	uint8_t *bufpos = buf;
-	for( ; m_bufferPos < m_bufferSize; m_bufferPos++ ) {
-		m_partial |= (int)m_buffer[m_bufferPos] << m_partialSize;
-		m_partialSize += 8;
-		while( m_partialSize >= m_codeSize ) {
-			int code = m_partial & m_codeMask;
-			m_partial >>= m_codeSize;
-			m_partialSize -= m_codeSize;
-
-			if( code > m_nextCode || /*(m_nextCode == MAX_LZW_CODE && code != m_clearCode) || */code == m_endCode ) {
-				m_done = true;
-				*len = (int)(bufpos - buf);
-				return true;
-			}
-			if( code == m_clearCode ) {
-				ClearDecompressorTable();
-				continue;
-			}
-
-			//add new string to string table, if not the first pass since a clear code
-			if( m_oldCode != MAX_LZW_CODE && m_nextCode < MAX_LZW_CODE) {
-				m_strings[m_nextCode] = m_strings[m_oldCode] + m_strings[code == m_nextCode ? m_oldCode : code][0];
-			}
+	uint8_t *const bufend = buf + *len;
+
+	//finish the string cut by the end of the previous output buffer
+	if( m_pendingCode != MAX_LZW_CODE ) {
+		const int count = MIN(m_lengths[m_pendingCode] - m_pendingLength, *len);
+		OutputString(m_pendingCode, m_pendingLength, count, bufpos);
+		bufpos += count;
+		m_pendingLength += count;
+		if( m_pendingLength == m_lengths[m_pendingCode] ) {
+			m_pendingCode = MAX_LZW_CODE;
+		}
+	}
 
-			if( (int)m_strings[code].size() > *len - (bufpos - buf) ) {
-				//out of space, stuff the code back in for next time
-				m_partial <<= m_codeSize;
-				m_partialSize += m_codeSize;
-				m_partial |= code;
-				m_bufferPos++;
+	while( bufpos < bufend ) {
+		while( m_partialSize < m_codeSize ) {
+			if( m_bufferPos == m_bufferSize ) {
+				//wait for the next sub-block
+				m_bufferSize = 0;
 				*len = (int)(bufpos - buf);
 				return true;
 			}
+			m_partial |= (unsigned)m_buffer[m_bufferPos++] << m_partialSize;
+			m_partialSize += 8;
+		}
+		const int code = m_partial & m_codeMask;
+		m_partial >>= m_codeSize;
+		m_partialSize -= m_codeSize;
+
+		if( code > m_nextCode || code >= MAX_LZW_CODE || code == m_endCode || (code == m_nextCode && m_oldCode == MAX_LZW_CODE) ) {
+			m_done = true;
+			*len = (int)(bufpos - buf);
+			return true;
+		}
+		if( code == m_clearCode ) {
+			ClearDecompressorTable();
+			continue;
+		}
 
-			//output the string into the buffer
-			memcpy(bufpos, m_strings[code].data(), m_strings[code].size());
-			bufpos += m_strings[code].size();
+		//add new string to string table, if not the first pass since a clear code
+		if( m_oldCode != MAX_LZW_CODE && m_nextCode < MAX_LZW_CODE ) {
+			m_prefixes[m_nextCode] = (uint16_t)m_oldCode;
+			m_suffixes[m_nextCode] = m_firsts[code == m_nextCode ? m_oldCode : code];
+			m_firsts[m_nextCode] = m_firsts[m_oldCode];
+			m_lengths[m_nextCode] = m_lengths[m_oldCode] + 1;
+		}
 
-			//increment the next highest valid code, add a bit to the mask if we need to increase the code size
-			if( m_oldCode != MAX_LZW_CODE && m_nextCode < MAX_LZW_CODE ) {
-				if( ++m_nextCode < MAX_LZW_CODE ) {
-					if( (m_nextCode & m_codeMask) == 0 ) {
-						m_codeSize++;
-						m_codeMask |= m_nextCode;
-					}
+		//output the string into the buffer, keep what doesn't fit for next time
+		const int length = m_lengths[code];
+		if( length <= bufend - bufpos ) {
+			OutputString(code, 0, length, bufpos);
+			bufpos += length;
+		} else {
+			m_pendingCode = code;
+			m_pendingLength = (int)(bufend - bufpos);
+			OutputString(code, 0, m_pendingLength, bufpos);
+			bufpos = bufend;
+		}
+
+		//increment the next highest valid code, add a bit to the mask if we need to increase the code size
+		if( m_oldCode != MAX_LZW_CODE && m_nextCode < MAX_LZW_CODE ) {
+			if( ++m_nextCode < MAX_LZW_CODE ) {
+				if( (m_nextCode & m_codeMask) == 0 ) {
+					m_codeSize++;
+					m_codeMask |= m_nextCode;
 				}
 			}
-
-			m_oldCode = code;
 		}
+
+		m_oldCode = code;
 	}
 
-	m_bufferSize = 0;
 	*len = (int)(bufpos - buf);
 
 	return true;
@@ -437,9 +511,7 @@ void StringTable::Done(void)
 
 void StringTable::ClearCompressorTable(void)
 {
-	if(m_strmap) {
-		memset(m_strmap, 0xFF, sizeof(unsigned int)*(1<<20));
-	}
+	memset(m_hashKeys, 0, sizeof(m_hashKeys));
 	m_nextCode = m_endCode + 1;
 
 	m_prefix = 0;
@@ -448,10 +520,6 @@ void StringTable::ClearCompressorTable(void)
 
 void StringTable::ClearDecompressorTable(void)
 {
-	for( int i = 0; i < m_clearCode; i++ ) {
-		m_strings[i].resize(1);
-		m_strings[i][0] = (char)i;
-	}
 	m_nextCode = m_endCode + 1;
 
 	m_codeSize = m_minCodeSize + 1;
@@ -510,6 +578,20 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return FALSE;
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t GIF89a[] = { 0x47, 0x49, 0x46, 0x38, 0x39, 0x61 };	// ASCII code for "GIF89a"
+	static const uint8_t GIF87a[] = { 0x47, 0x49, 0x46, 0x38, 0x37, 0x61 };	// ASCII code for "GIF87a"
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(GIF89a), GIF89a, nullptr },
+		{ 0, sizeof(GIF87a), GIF87a, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV 
 SupportsExportDepth(int depth) {
 	return	(depth == 1) ||
@@ -522,6 +604,12 @@ SupportsExportType(FREE_IMAGE_TYPE type) {
 	return (type == FIT_BITMAP) ? TRUE : FALSE;
 }
 
+static BOOL DLL_CALLCONV 
+SupportsPersistentData() {
+	// the playback canvas is kept between the pages of a multipage bitmap
+	return TRUE;
+}
+
 // ----------------------------------------------------------
 
 static void *DLL_CALLCONV 
@@ -655,6 +743,243 @@ PageCount(FreeImageIO *io, fi_handle handle, void *data) {
 	return (int) info->image_descriptor_offsets.size();
 }
 
+static FIBITMAP * DLL_CALLCONV Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data);
+
+/**
+Read the disposal method and the position of a frame. 
+A frame without Graphic Control Extension is left in place and has no transparency.
+*/
+static PageInfo 
+ReadPageInfo(FreeImageIO *io, fi_handle handle, GIFinfo *info, int page, bool *have_transparent) {
+	uint8_t packed = 0;
+	uint16_t left, top, width, height;
+
+	//Graphic Control Extension
+	if( info->graphic_control_extension_offsets[page] != 0 ) {
+		io->seek_proc(handle, (long)(info->graphic_control_extension_offsets[page] + 1), SEEK_SET);
+		io->read_proc(&packed, 1, 1, handle);
+	}
+	*have_transparent = (packed & GIF_PACKED_GCE_HAVETRANS) ? true : false;
+
+	//Image Descriptor
+	io->seek_proc(handle, (long)(info->image_descriptor_offsets[page]), SEEK_SET);
+	io->read_proc(&left, 2, 1, handle);
+	io->read_proc(&top, 2, 1, handle);
+	io->read_proc(&width, 2, 1, handle);
+	io->read_proc(&height, 2, 1, handle);
+#ifdef FREEIMAGE_BIGENDIAN
+	SwapShort(&left);
+	SwapShort(&top);
+	SwapShort(&width);
+	SwapShort(&height);
+#endif
+
+	return PageInfo((packed & GIF_PACKED_GCE_DISPOSAL) >> 2, left, top, width, height);
+}
+
+/**
+Fill the part of a frame rectangle lying inside the logical screen
+*/
+static void 
+FillFrameRect(FIBITMAP *canvas, const PageInfo &frame, RGBQUAD color) {
+	const int logicalwidth = (int)FreeImage_GetWidth(canvas);
+	const int logicalheight = (int)FreeImage_GetHeight(canvas);
+	const int right = MIN(logicalwidth, frame.left + frame.width);
+	const int bottom = MIN(logicalheight, frame.top + frame.height);
+
+	for( int y = frame.top; y < bottom; y++ ) {
+		RGBQUAD *scanline = (RGBQUAD *)FreeImage_GetScanLine(canvas, logicalheight - y - 1);
+		for( int x = frame.left; x < right; x++ ) {
+			scanline[x] = color;
+		}
+	}
+}
+
+/**
+Draw a frame decoded with GIF_LOAD256 onto the logical screen, with full alpha opaqueness
+*/
+static void 
+DrawFrame(FIBITMAP *canvas, FIBITMAP *pagedib, const PageInfo &frame) {
+	const RGBQUAD *pal = FreeImage_GetPalette(pagedib);
+
+	bool have_transparent = false;
+	int transparent_color = 0;
+	if( FreeImage_IsTransparent(pagedib) ) {
+		const int count = FreeImage_GetTransparencyCount(pagedib);
+		const uint8_t *table = FreeImage_GetTransparencyTable(pagedib);
+		for( int i = 0; i < count; i++ ) {
+			if( table[i] == 0 ) {
+				have_transparent = true;
+				transparent_color = i;
+				break;
+			}
+		}
+	}
+
+	const int logicalwidth = (int)FreeImage_GetWidth(canvas);
+	const int logicalheight = (int)FreeImage_GetHeight(canvas);
+	const int width = MIN(logicalwidth - (int)frame.left, (int)FreeImage_GetWidth(pagedib));
+	const int height = MIN(logicalheight - (int)frame.top, (int)FreeImage_GetHeight(pagedib));
+
+	for( int y = 0; y < height; y++ ) {
+		RGBQUAD *scanline = (RGBQUAD *)FreeImage_GetScanLine(canvas, logicalheight - (y + frame.top) - 1) + frame.left;
+		const uint8_t *pageline = FreeImage_GetScanLine(pagedib, FreeImage_GetHeight(pagedib) - y - 1);
+		for( int x = 0; x < width; x++ ) {
+			if( !have_transparent || pageline[x] != transparent_color ) {
+				scanline[x] = pal[pageline[x]];
+				scanline[x].rgbReserved = 255;
+			}
+		}
+	}
+}
+
+/**
+Create the playback state of an animation, with an empty logical screen
+*/
+static GIFPlayback *
+OpenPlayback(FreeImageIO *io, fi_handle handle, GIFinfo *info) {
+	std::unique_ptr<GIFPlayback> playback(new GIFPlayback);
+
+	//Logical Screen Descriptor
+	io->seek_proc(handle, 6, SEEK_SET);
+	io->read_proc(&playback->logical_width, 2, 1, handle);
+	io->read_proc(&playback->logical_height, 2, 1, handle);
+#ifdef FREEIMAGE_BIGENDIAN
+	SwapShort(&playback->logical_width);
+	SwapShort(&playback->logical_height);
+#endif
+	//set the background color with 0 alpha
+	if( info->global_color_table_offset != 0 && info->background_color < info->global_color_table_size ) {
+		io->seek_proc(handle, (long)(info->global_color_table_offset + (info->background_color * 3)), SEEK_SET);
+		io->read_proc(&playback->background.rgbRed, 1, 1, handle);
+		io->read_proc(&playback->background.rgbGreen, 1, 1, handle);
+		io->read_proc(&playback->background.rgbBlue, 1, 1, handle);
+	}
+
+	//allocate entire logical area
+	playback->canvas = FreeImage_Allocate(playback->logical_width, playback->logical_height, 32);
+	if( playback->canvas == nullptr ) {
+		throw FI_MSG_ERROR_DIB_MEMORY;
+	}
+	FillFrameRect(playback->canvas, PageInfo(0, 0, 0, playback->logical_width, playback->logical_height), playback->background);
+
+	//widen the snapshot interval of long animations to stay within the memory budget
+	const uint64_t canvas_size = (uint64_t)FreeImage_GetPitch(playback->canvas) * playback->logical_height;
+	const uint64_t frame_count = info->image_descriptor_offsets.size();
+	playback->interval = (int)MAX((uint64_t)GIF_KEYFRAME_INTERVAL, (frame_count * canvas_size) / GIF_KEYFRAME_MEMORY + 1);
+
+	return playback.release();
+}
+
+/**
+Apply the next frame to the playback canvas. 
+@param view When not nullptr, the frame is also drawn onto this copy of the canvas before its disposal
+@param delay_time Receives the frame time when view is not nullptr
+*/
+static void 
+AdvancePlayback(GIFPlayback *playback, FreeImageIO *io, fi_handle handle, GIFinfo *info, FIBITMAP *view, int *delay_time) {
+	const int page = playback->frame + 1;
+
+	bool have_transparent;
+	const PageInfo frame = ReadPageInfo(io, handle, info, page, &have_transparent);
+
+	//frames restored or cleared by their disposal don't need to be decoded, unless they are shown
+	FIBITMAP *pagedib = nullptr;
+	if( view != nullptr || (frame.disposal_method != GIF_DISPOSAL_PREVIOUS && frame.disposal_method != GIF_DISPOSAL_BACKGROUND) ) {
+		pagedib = Load(io, handle, page, GIF_LOAD256, info);
+	}
+
+	if( pagedib != nullptr ) {
+		if( view != nullptr ) {
+			DrawFrame(view, pagedib, frame);
+			FITAG *tag;
+			if( FreeImage_GetMetadataEx(FIMD_ANIMATION, pagedib, "FrameTime", FIDT_LONG, &tag) ) {
+				*delay_time = *(int32_t *)FreeImage_GetTagValue(tag);
+			}
+		}
+		if( frame.disposal_method != GIF_DISPOSAL_PREVIOUS && frame.disposal_method != GIF_DISPOSAL_BACKGROUND ) {
+			DrawFrame(playback->canvas, pagedib, frame);
+		}
+		FreeImage_Unload(pagedib);
+	}
+	if( frame.disposal_method == GIF_DISPOSAL_BACKGROUND ) {
+		FillFrameRect(playback->canvas, frame, playback->background);
+	}
+
+	playback->frame = page;
+
+	if( (page + 1) % playback->interval == 0 && playback->keyframes.find(page) == playback->keyframes.end() ) {
+		FIBITMAP *snapshot = FreeImage_Clone(playback->canvas);
+		if( snapshot != nullptr ) {
+			playback->keyframes[page] = snapshot;
+		}
+	}
+}
+
+/**
+Bring the playback canvas to the state following a given frame (-1 for the empty logical screen), 
+starting from the closest known state: the canvas itself, a snapshot, or the last full screen frame hiding all the previous ones
+*/
+static void 
+SeekPlayback(GIFPlayback *playback, FreeImageIO *io, fi_handle handle, GIFinfo *info, int target) {
+	int from = -1;
+	FIBITMAP *source = nullptr;
+
+	if( playback->frame <= target ) {
+		from = playback->frame;
+		source = playback->canvas;
+	}
+	std::map<int, FIBITMAP *>::iterator keyframe = playback->keyframes.upper_bound(target);
+	if( keyframe != playback->keyframes.begin() ) {
+		--keyframe;
+		if( keyframe->first > from ) {
+			from = keyframe->first;
+			source = keyframe->second;
+		}
+	}
+
+	bool clear = (source == nullptr);
+	for( int page = target; page > from; page-- ) {
+		bool have_transparent;
+		const PageInfo frame = ReadPageInfo(io, handle, info, page, &have_transparent);
+		if( frame.left == 0 && frame.top == 0 && frame.width == playback->logical_width && frame.height == playback->logical_height ) {
+			if( frame.disposal_method == GIF_DISPOSAL_BACKGROUND ) {
+				from = page;
+				clear = true;
+				break;
+			} else if( frame.disposal_method != GIF_DISPOSAL_PREVIOUS && !have_transparent ) {
+				//the state before this frame doesn't matter
+				from = page - 1;
+				clear = true;
+				break;
+			}
+		}
+	}
+
+	if( clear ) {
+		FillFrameRect(playback->canvas, PageInfo(0, 0, 0, playback->logical_width, playback->logical_height), playback->background);
+	} else if( source != playback->canvas ) {
+		memcpy(FreeImage_GetBits(playback->canvas), FreeImage_GetBits(source), FreeImage_GetPitch(source) * FreeImage_GetHeight(source));
+	}
+	playback->frame = from;
+
+	while( playback->frame < target ) {
+		AdvancePlayback(playback, io, handle, info, nullptr, nullptr);
+	}
+}
+
+/**
+Pack a row of 1- or 4-bit color indexes into a scanline
+*/
+static void 
+PackIndexes(uint8_t *scanline, const uint8_t *indexes, int count, int bpp) {
+	const int mask = (1 << bpp) - 1;
+	for( int i = 0; i < count; i++ ) {
+		const int bit = i * bpp;
+		scanline[bit >> 3] |= (indexes[i] & mask) << (8 - bpp - (bit & 7));
+	}
+}
+
 static FIBITMAP * DLL_CALLCONV 
 Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 	if( data == nullptr ) {
@@ -679,155 +1004,21 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 
 		//playback pages to generate what the user would see for this frame
 		if( (flags & GIF_PLAYBACK) == GIF_PLAYBACK ) {
-			//Logical Screen Descriptor
-			io->seek_proc(handle, 6, SEEK_SET);
-			uint16_t logicalwidth, logicalheight;
-			io->read_proc(&logicalwidth, 2, 1, handle);
-			io->read_proc(&logicalheight, 2, 1, handle);
-#ifdef FREEIMAGE_BIGENDIAN
-			SwapShort(&logicalwidth);
-			SwapShort(&logicalheight);
-#endif
-			//set the background color with 0 alpha
-			RGBQUAD background;
-			if( info->global_color_table_offset != 0 && info->background_color < info->global_color_table_size ) {
-				io->seek_proc(handle, (long)(info->global_color_table_offset + (info->background_color * 3)), SEEK_SET);
-				io->read_proc(&background.rgbRed, 1, 1, handle);
-				io->read_proc(&background.rgbGreen, 1, 1, handle);
-				io->read_proc(&background.rgbBlue, 1, 1, handle);
-			} else {
-				background.rgbRed = 0;
-				background.rgbGreen = 0;
-				background.rgbBlue = 0;
+			if( !info->playback ) {
+				info->playback.reset(OpenPlayback(io, handle, info));
 			}
-			background.rgbReserved = 0;
+			GIFPlayback *playback = info->playback.get();
+
+			SeekPlayback(playback, io, handle, info, page - 1);
 
-			//allocate entire logical area
-			dib = FreeImage_Allocate(logicalwidth, logicalheight, 32);
+			dib = FreeImage_Clone(playback->canvas);
 			if( dib == nullptr ) {
 				throw FI_MSG_ERROR_DIB_MEMORY;
 			}
 
-			//fill with background color to start
-			int x, y;
-			RGBQUAD *scanline;
-			for( y = 0; y < logicalheight; y++ ) {
-				scanline = (RGBQUAD *)FreeImage_GetScanLine(dib, y);
-				for( x = 0; x < logicalwidth; x++ ) {
-					*scanline++ = background;
-				}
-			}
-
-			//cache some info about each of the pages so we can avoid decoding as many of them as possible
-			std::vector<PageInfo> pageinfo;
-			int start = page, end = page;
-			while( start >= 0 ) {
-				//Graphic Control Extension
-				io->seek_proc(handle, (long)(info->graphic_control_extension_offsets[start] + 1), SEEK_SET);
-				io->read_proc(&packed, 1, 1, handle);
-				have_transparent = (packed & GIF_PACKED_GCE_HAVETRANS) ? true : false;
-				disposal_method = (packed & GIF_PACKED_GCE_DISPOSAL) >> 2;
-				//Image Descriptor
-				io->seek_proc(handle, (long)(info->image_descriptor_offsets[start]), SEEK_SET);
-				io->read_proc(&left, 2, 1, handle);
-				io->read_proc(&top, 2, 1, handle);
-				io->read_proc(&width, 2, 1, handle);
-				io->read_proc(&height, 2, 1, handle);
-#ifdef FREEIMAGE_BIGENDIAN
-				SwapShort(&left);
-				SwapShort(&top);
-				SwapShort(&width);
-				SwapShort(&height);
-#endif
-
-				pageinfo.push_back(PageInfo(disposal_method, left, top, width, height));
-
-				if( start != end ) {
-					if( left == 0 && top == 0 && width == logicalwidth && height == logicalheight ) {
-						if( disposal_method == GIF_DISPOSAL_BACKGROUND ) {
-							pageinfo.pop_back();
-							start++;
-							break;
-						} else if( disposal_method != GIF_DISPOSAL_PREVIOUS ) {
-							if( !have_transparent ) {
-								break;
-							}
-						}
-					}
-				}
-				start--;
-			}
-			if( start < 0 ) {
-				start = 0;
-			}
-
-			//draw each page into the logical area
-			delay_time = 0;
-			for( page = start; page <= end; page++ ) {
-				PageInfo &info = pageinfo[end - page];
-				//things we can skip having to decode
-				if( page != end ) {
-					if( info.disposal_method == GIF_DISPOSAL_PREVIOUS ) {
-						continue;
-					}
-					if( info.disposal_method == GIF_DISPOSAL_BACKGROUND ) {
-						for( y = 0; y < info.height; y++ ) {
-							const int scanidx = logicalheight - (y + info.top) - 1;
-							if ( scanidx < 0 ) {
-								break;  // If data is corrupt, don't calculate in invalid scanline
-							}
-							scanline = (RGBQUAD *)FreeImage_GetScanLine(dib, scanidx) + info.left;
-							for( x = 0; x < info.width; x++ ) {
-								*scanline++ = background;
-							}
-						}
-						continue;
-					}
-				}
-
-				//decode page
-				FIBITMAP *pagedib = Load(io, handle, page, GIF_LOAD256, data);
-				if( pagedib != nullptr ) {
-					RGBQUAD *pal = FreeImage_GetPalette(pagedib);
-					have_transparent = false;
-					if( FreeImage_IsTransparent(pagedib) ) {
-						int count = FreeImage_GetTransparencyCount(pagedib);
-						uint8_t *table = FreeImage_GetTransparencyTable(pagedib);
-						for( int i = 0; i < count; i++ ) {
-							if( table[i] == 0 ) {
-								have_transparent = true;
-								transparent_color = i;
-								break;
-							}
-						}
-					}
-					//copy page data into logical buffer, with full alpha opaqueness
-					for( y = 0; y < info.height; y++ ) {
-						const int scanidx = logicalheight - (y + info.top) - 1;
-						if ( scanidx < 0 ) {
-							break;  // If data is corrupt, don't calculate in invalid scanline
-						}
-						scanline = (RGBQUAD *)FreeImage_GetScanLine(dib, scanidx) + info.left;
-						uint8_t *pageline = FreeImage_GetScanLine(pagedib, info.height - y - 1);
-						for( x = 0; x < info.width; x++ ) {
-							if( !have_transparent || *pageline != transparent_color ) {
-								*scanline = pal[*pageline];
-								scanline->rgbReserved = 255;
-							}
-							scanline++;
-							pageline++;
-						}
-					}
-					//copy frame time
-					if( page == end ) {
-						FITAG *tag;
-						if( FreeImage_GetMetadataEx(FIMD_ANIMATION, pagedib, "FrameTime", FIDT_LONG, &tag) ) {
-							delay_time = *(int32_t *)FreeImage_GetTagValue(tag);
-						}
-					}
-					FreeImage_Unload(pagedib);
-				}
-			}
+			//draw this frame, and carry the canvas over to the next one
+			int delay_time = 0;
+			AdvancePlayback(playback, io, handle, info, dib, &delay_time);
 
 			//setup frame time
 			FreeImage_SetMetadataEx(FIMD_ANIMATION, dib, "FrameTime", ANIMTAG_FRAMETIME, FIDT_LONG, 1, 4, &delay_time);
@@ -911,48 +1102,58 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 
 		//LZW Minimum Code Size
 		io->read_proc(&b, 1, 1, handle);
+		if( b > 11 ) {
+			//the clear and end codes would not fit in 12-bit codes
+			throw "Invalid LZW minimum code size";
+		}
 		StringTable *stringtable = new(std::nothrow) StringTable;
 		stringtable->Initialize(b);
 
 		//Image Data Sub-blocks
-		int x = 0, xpos = 0, y = 0, shift = 8 - bpp, mask = (1 << bpp) - 1, interlacepass = 0;
+		//8-bit rows are decoded in place, smaller depths are packed from a row of color indexes
+		std::vector<uint8_t> indexes((bpp < 8) ? width : 0);
+		int x = 0, y = 0, interlacepass = 0;
 		uint8_t *scanline = FreeImage_GetScanLine(dib, height - 1);
-		uint8_t buf[4096];
+		uint8_t *row = (bpp < 8) ? indexes.data() : scanline;
+		if( width == 0 || height == 0 ) {
+			stringtable->Done();
+		}
 		io->read_proc(&b, 1, 1, handle);
 		while( b ) {
 			io->read_proc(stringtable->FillInputBuffer(b), b, 1, handle);
-			int size = sizeof(buf);
-			while( stringtable->Decompress(buf, &size) ) {
-				for( int i = 0; i < size; i++ ) {
-					scanline[xpos] |= (buf[i] & mask) << shift;
-					if( shift > 0 ) {
-						shift -= bpp;
+			int size = width - x;
+			while( stringtable->Decompress(row + x, &size) ) {
+				x += size;
+				if( x >= width ) {
+					if( bpp < 8 ) {
+						PackIndexes(scanline, row, width, bpp);
+					}
+					if( interlaced ) {
+						y += g_GifInterlaceIncrement[interlacepass];
+						if( y >= height && ++interlacepass < GIF_INTERLACE_PASSES ) {
+							y = g_GifInterlaceOffset[interlacepass];
+						} 						
 					} else {
-						xpos++;
-						shift = 8 - bpp;
+						y++;
 					}
-					if( ++x >= width ) {
-						if( interlaced ) {
-							y += g_GifInterlaceIncrement[interlacepass];
-							if( y >= height && ++interlacepass < GIF_INTERLACE_PASSES ) {
-								y = g_GifInterlaceOffset[interlacepass];
-							} 						
-						} else {
-							y++;
-						}
-						if( y >= height ) {
-							stringtable->Done();
-							break;
-						}
-						x = xpos = 0;
-						shift = 8 - bpp;
-						scanline = FreeImage_GetScanLine(dib, height - y - 1);
+					if( y >= height ) {
+						stringtable->Done();
+						break;
+					}
+					x = 0;
+					scanline = FreeImage_GetScanLine(dib, height - y - 1);
+					if( bpp == 8 ) {
+						row = scanline;
 					}
 				}
-				size = sizeof(buf);
+				size = width - x;
 			}
 			io->read_proc(&b, 1, 1, handle);
 		}
+		if( bpp < 8 && x > 0 ) {
+			//truncated image
+			PackIndexes(scanline, row, x, bpp);
+		}
 
 		if( page == 0 ) {
 			size_t idx;
@@ -1379,6 +1580,94 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 	return TRUE;
 }
 
+/**
+Copy a frame of an opened GIF into the GIF being written, keeping its LZW data as is. 
+The first page is always saved with Save, it carries the logical screen and the global palette. 
+A frame using the global palette of the source gets it as a local palette.
+*/
+static BOOL DLL_CALLCONV 
+CopyPage(FreeImageIO *src_io, fi_handle src_handle, int src_page, void *src_data, FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
+	if( src_data == nullptr || data == nullptr || page == 0 ) {
+		return FALSE;
+	}
+	GIFinfo *info = (GIFinfo *)src_data;
+
+	if( src_page < 0 || src_page >= (int)info->image_descriptor_offsets.size() ) {
+		return FALSE;
+	}
+	//Save always writes a GCE, let it choose the defaults of a frame without one
+	if( info->graphic_control_extension_offsets[src_page] == 0 ) {
+		return FALSE;
+	}
+
+	//the frame is read entirely before anything is written
+	std::vector<uint8_t> frame;
+	uint8_t buf[256];
+
+	//Graphic Control Extension
+	src_io->seek_proc(src_handle, (long)info->graphic_control_extension_offsets[src_page], SEEK_SET);
+	if( src_io->read_proc(buf, 6, 1, src_handle) < 1 || buf[0] != 4 || buf[5] != 0 ) {
+		return FALSE;
+	}
+	frame.push_back(GIF_BLOCK_EXTENSION);
+	frame.push_back(GIF_EXT_GRAPHIC_CONTROL);
+	frame.insert(frame.end(), buf, buf + 6);
+
+	//Image Descriptor
+	src_io->seek_proc(src_handle, (long)info->image_descriptor_offsets[src_page], SEEK_SET);
+	if( src_io->read_proc(buf, 9, 1, src_handle) < 1 ) {
+		return FALSE;
+	}
+	uint8_t packed = buf[8];
+	frame.push_back(GIF_BLOCK_IMAGE_DESCRIPTOR);
+
+	if( packed & GIF_PACKED_ID_HAVELCT ) {
+		//Local Color Table
+		const int lct_size = 3 * (2 << (packed & GIF_PACKED_ID_LCTSIZE));
+		frame.insert(frame.end(), buf, buf + 9);
+		frame.resize(frame.size() + lct_size);
+		if( src_io->read_proc(&frame[frame.size() - lct_size], lct_size, 1, src_handle) < 1 ) {
+			return FALSE;
+		}
+	} else {
+		//Global Color Table of the source, turned into a Local Color Table
+		if( info->global_color_table_offset == 0 ) {
+			return FALSE;
+		}
+		int size_bits = 0;
+		while( (2 << size_bits) < info->global_color_table_size ) {
+			size_bits++;
+		}
+		buf[8] = (uint8_t)(packed | GIF_PACKED_ID_HAVELCT | (size_bits & GIF_PACKED_ID_LCTSIZE));
+		frame.insert(frame.end(), buf, buf + 9);
+
+		const long position = src_io->tell_proc(src_handle);
+		const int gct_size = 3 * info->global_color_table_size;
+		src_io->seek_proc(src_handle, (long)info->global_color_table_offset, SEEK_SET);
+		frame.resize(frame.size() + gct_size);
+		if( src_io->read_proc(&frame[frame.size() - gct_size], gct_size, 1, src_handle) < 1 ) {
+			return FALSE;
+		}
+		src_io->seek_proc(src_handle, position, SEEK_SET);
+	}
+
+	//LZW Minimum Code Size and Image Data Sub-blocks, up to the Block Terminator
+	if( src_io->read_proc(buf, 2, 1, src_handle) < 1 ) {
+		return FALSE;
+	}
+	frame.insert(frame.end(), buf, buf + 2);
+	uint8_t len = buf[1];
+	while( len != 0 ) {
+		if( src_io->read_proc(buf, len + 1, 1, src_handle) < 1 ) {
+			return FALSE;
+		}
+		frame.insert(frame.end(), buf, buf + len + 1);
+		len = buf[len];
+	}
+
+	return (io->write_proc(&frame[0], (unsigned)frame.size(), 1, handle) == 1) ? TRUE : FALSE;
+}
+
 // ==========================================================
 //   Init
 // ==========================================================
@@ -1398,8 +1687,11 @@ InitGIF(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = Save;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
 	plugin->supports_icc_profiles_proc = nullptr;
+	plugin->copypage_proc = CopyPage;
+	plugin->supports_persistent_data_proc = SupportsPersistentData;
 }
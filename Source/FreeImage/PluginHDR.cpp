@@ -21,6 +21,7 @@
 
 #include "FreeImage.h"
 #include "Utilities.h"
+#include "FreeImageIO.h"
 
 // ==========================================================
 // Plugin Interface
@@ -361,11 +362,157 @@ rgbe_WritePixels(FreeImageIO *io, fi_handle handle, FIRGBF *data, unsigned numpi
   return TRUE;
 }
 
+/**
+Same as rgbe_ReadPixels, reading the pixels from a contiguous view of the stream
+@param src Start of the view
+@param size Size of the view in bytes
+@param data Output pixels
+@param numpixels Number of pixels to read
+@param consumed Returned number of bytes read from the view
+*/
+static BOOL 
+rgbe_ReadPixels_View(const uint8_t *src, size_t size, FIRGBF *data, unsigned numpixels, size_t *consumed) {
+	uint8_t rgbe[4];
+
+	if(size / sizeof(rgbe) < numpixels) {
+		return rgbe_Error(rgbe_read_error, nullptr);
+	}
+	for(unsigned x = 0; x < numpixels; x++) {
+		memcpy(rgbe, src, sizeof(rgbe));
+		rgbe_RGBEToFloat(&data[x], rgbe);
+		src += sizeof(rgbe);
+	}
+	*consumed = sizeof(rgbe) * numpixels;
+
+	return TRUE;
+}
+
+/**
+Same as rgbe_ReadPixels_RLE, decoding the scanlines from a contiguous view of the stream 
+(no read call per run)
+@param src Start of the view
+@param size Size of the view in bytes
+@param data Output pixels
+@param scanline_width Image width
+@param num_scanlines Image height
+@param consumed Returned number of bytes read from the view
+*/
+static BOOL 
+rgbe_ReadPixels_RLE_View(const uint8_t *src, size_t size, FIRGBF *data, int scanline_width, unsigned num_scanlines, size_t *consumed) {
+	uint8_t rgbe[4], *scanline_buffer, *ptr, *ptr_end;
+	int i, count;
+
+	const uint8_t *p = src;
+	const uint8_t *end = src + size;
+
+	if ((scanline_width < 8)||(scanline_width > 0x7fff)) {
+		// run length encoding is not allowed so read flat
+		return rgbe_ReadPixels_View(src, size, data, scanline_width * num_scanlines, consumed);
+	}
+	scanline_buffer = nullptr;
+	// read in each successive scanline 
+	while(num_scanlines > 0) {
+		if(end - p < 4) {
+			free(scanline_buffer);
+			return rgbe_Error(rgbe_read_error,nullptr);
+		}
+		if((p[0] != 2) || (p[1] != 2) || (p[2] & 0x80)) {
+			// this file is not run length encoded
+			free(scanline_buffer);
+			size_t flat_size = 0;
+			if(!rgbe_ReadPixels_View(p, (size_t)(end - p), data, scanline_width * num_scanlines, &flat_size)) {
+				return FALSE;
+			}
+			*consumed = (size_t)(p - src) + flat_size;
+			return TRUE;
+		}
+		if((((int)p[2]) << 8 | p[3]) != scanline_width) {
+			free(scanline_buffer);
+			return rgbe_Error(rgbe_format_error,"wrong scanline width");
+		}
+		p += 4;
+		if(scanline_buffer == nullptr) {
+			scanline_buffer = (uint8_t*)malloc(sizeof(uint8_t) * 4 * scanline_width);
+			if(scanline_buffer == nullptr) {
+				return rgbe_Error(rgbe_memory_error, "unable to allocate buffer space");
+			}
+		}
+
+		ptr = &scanline_buffer[0];
+		// read each of the four channels for the scanline into the buffer
+		for(i = 0; i < 4; i++) {
+			ptr_end = &scanline_buffer[(i+1)*scanline_width];
+			while(ptr < ptr_end) {
+				if(end - p < 2) {
+					free(scanline_buffer);
+					return rgbe_Error(rgbe_read_error, nullptr);
+				}
+				if(p[0] > 128) {
+					// a run of the same value
+					count = p[0] - 128;
+					if((count == 0) || (count > ptr_end - ptr)) {
+						free(scanline_buffer);
+						return rgbe_Error(rgbe_format_error, "bad scanline data");
+					}
+					memset(ptr, p[1], count);
+					ptr += count;
+					p += 2;
+				}
+				else {
+					// a non-run
+					count = p[0];
+					if((count == 0) || (count > ptr_end - ptr)) {
+						free(scanline_buffer);
+						return rgbe_Error(rgbe_format_error, "bad scanline data");
+					}
+					p++;
+					if(end - p < count) {
+						free(scanline_buffer);
+						return rgbe_Error(rgbe_read_error, nullptr);
+					}
+					memcpy(ptr, p, count);
+					ptr += count;
+					p += count;
+				}
+			}
+		}
+		// now convert data from buffer into floats
+		for(i = 0; i < scanline_width; i++) {
+			rgbe[0] = scanline_buffer[i];
+			rgbe[1] = scanline_buffer[i+scanline_width];
+			rgbe[2] = scanline_buffer[i+2*scanline_width];
+			rgbe[3] = scanline_buffer[i+3*scanline_width];
+			rgbe_RGBEToFloat(data, rgbe);
+			data ++;
+		}
+
+		num_scanlines--;
+	}
+
+	free(scanline_buffer);
+
+	*consumed = (size_t)(p - src);
+
+	return TRUE;
+}
+
 static BOOL 
 rgbe_ReadPixels_RLE(FreeImageIO *io, fi_handle handle, FIRGBF *data, int scanline_width, unsigned num_scanlines) {
 	uint8_t rgbe[4], *scanline_buffer, *ptr, *ptr_end;
 	int i, count;
 	uint8_t buf[2];
+
+	// when the stream is in memory (e.g. a mapped file), decode it in place
+	const uint8_t *view = nullptr;
+	size_t view_size = 0;
+	if(GetIOView(io, handle, &view, &view_size)) {
+		size_t consumed = 0;
+		if(!rgbe_ReadPixels_RLE_View(view, view_size, data, scanline_width, num_scanlines, &consumed)) {
+			return FALSE;
+		}
+		io->seek_proc(handle, (long)consumed, SEEK_CUR);
+		return TRUE;
+	}
 	
 	if ((scanline_width < 8)||(scanline_width > 0x7fff)) {
 		// run length encoding is not allowed so read flat
@@ -606,6 +753,18 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return (memcmp(hdr_signature, signature, 2) == 0);
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t hdr_signature[] = { 0x23, 0x3F };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(hdr_signature), hdr_signature, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return FALSE;
@@ -734,6 +893,7 @@ InitHDR(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = Save;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
@@ -182,6 +182,23 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return (type == ID_ILBM) || (type == ID_PBM);
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	// "FORM" chunk (the chunk size is ignored) of type ILBM or PBM
+	static const uint8_t iff_ilbm[] = { 0x46, 0x4F, 0x52, 0x4D, 0x00, 0x00, 0x00, 0x00, 0x49, 0x4C, 0x42, 0x4D };
+	static const uint8_t iff_ilbm_mask[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF };
+	static const uint8_t iff_pbm[] = { 0x46, 0x4F, 0x52, 0x4D, 0x00, 0x00, 0x00, 0x00, 0x50, 0x42, 0x4D, 0x20 };
+	static const uint8_t iff_pbm_mask[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(iff_ilbm), iff_ilbm, iff_ilbm_mask },
+		{ 0, sizeof(iff_pbm), iff_pbm, iff_pbm_mask }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
@@ -452,6 +469,7 @@ InitIFF(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = nullptr;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
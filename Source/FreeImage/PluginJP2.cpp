@@ -90,6 +90,18 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return (memcmp(jp2_signature, signature, sizeof(jp2_signature)) == 0);
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t jp2_signature[] = { 0x00, 0x00, 0x00, 0x0C, 0x6A, 0x50, 0x20, 0x20, 0x0D, 0x0A, 0x87, 0x0A };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(jp2_signature), jp2_signature, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return (
@@ -186,6 +198,9 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 				return dib;
 			}
 
+			// when a size hint was given, decode the smallest sufficient resolution
+			J2KSetDecodedResolution(d_codec, image, flags >> 16);
+
 			// decode the stream and fill the image structure 
 			if( !( opj_decode(d_codec, d_stream, image) && opj_end_decompress(d_codec, d_stream) ) ) {
 				throw "Failed to decode image!\n";
@@ -323,6 +338,7 @@ InitJP2(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = Save;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
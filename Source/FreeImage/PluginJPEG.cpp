@@ -1122,6 +1122,18 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return (memcmp(jpeg_signature, signature, sizeof(jpeg_signature)) == 0);
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t jpeg_signature[] = { 0xFF, 0xD8 };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(jpeg_signature), jpeg_signature, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return (
@@ -1196,12 +1208,25 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 
 			// step 4: set parameters for decompression
 
-			unsigned int scale_denom = 1;		// fraction by which to scale image
+			unsigned int scale_num = 1;			// fraction by which to scale image
+			unsigned int scale_denom = 1;
 			int	requested_size = flags >> 16;	// requested user size in pixels
 			if(requested_size > 0) {
+				const unsigned max_size = MAX(cinfo.image_width, cinfo.image_height);
+#if JPEG_LIB_VERSION >= 70
+				// the JPEG codec can perform a M/8 scaling (M = 1..16) on loading
+				// use the smallest scaling giving an image at least as large as the user's need
+				scale_num = ((unsigned)requested_size * 8 + max_size - 1) / max_size;
+				if(scale_num < 8) {
+					scale_num = MAX(scale_num, 1U);
+					scale_denom = 8;
+				} else {
+					scale_num = 1;
+				}
+#else
 				// the JPEG codec can perform x2, x4 or x8 scaling on loading
 				// try to find the more appropriate scaling according to user's need
-				double scale = MAX((double)cinfo.image_width, (double)cinfo.image_height) / (double)requested_size;
+				double scale = (double)max_size / (double)requested_size;
 				if(scale >= 8) {
 					scale_denom = 8;
 				} else if(scale >= 4) {
@@ -1209,8 +1234,9 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 				} else if(scale >= 2) {
 					scale_denom = 2;
 				}
+#endif
 			}
-			cinfo.scale_num = 1;
+			cinfo.scale_num = scale_num;
 			cinfo.scale_denom = scale_denom;
 
 			if ((flags & JPEG_ACCURATE) != JPEG_ACCURATE) {
@@ -1257,7 +1283,7 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 					}
 				}
 			}
-			if(scale_denom != 1) {
+			if(scale_num != scale_denom) {
 				// store original size info if a scaling was requested
 				store_size_info(dib, cinfo.image_width, cinfo.image_height);
 			}
@@ -1591,7 +1617,7 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 
 				while (cinfo.next_scanline < cinfo.image_height) {
 					// get a copy of the scanline
-					memcpy(target, FreeImage_GetScanLine(dib, FreeImage_GetHeight(dib) - cinfo.next_scanline - 1), pitch);
+					memcpy(target, FreeImage_GetConstScanLine(dib, FreeImage_GetHeight(dib) - cinfo.next_scanline - 1), pitch);
 #if FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR
 					// swap R and B channels
 					uint8_t *target_p = target;
@@ -1614,7 +1640,7 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 				
 				while (cinfo.next_scanline < cinfo.image_height) {
 					// get a copy of the scanline
-					memcpy(target, FreeImage_GetScanLine(dib, FreeImage_GetHeight(dib) - cinfo.next_scanline - 1), pitch);
+					memcpy(target, FreeImage_GetConstScanLine(dib, FreeImage_GetHeight(dib) - cinfo.next_scanline - 1), pitch);
 					
 					uint8_t *target_p = target;
 					for(unsigned x = 0; x < cinfo.image_width; x++) {
@@ -1635,7 +1661,8 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 			else if(color_type == FIC_MINISBLACK) {
 				// 8-bit standard greyscale images
 				while (cinfo.next_scanline < cinfo.image_height) {
-					JSAMPROW b = FreeImage_GetScanLine(dib, FreeImage_GetHeight(dib) - cinfo.next_scanline - 1);
+					// the compressor does not modify its input
+					JSAMPROW b = (JSAMPROW)FreeImage_GetConstScanLine(dib, FreeImage_GetHeight(dib) - cinfo.next_scanline - 1);
 
 					jpeg_write_scanlines(&cinfo, &b, 1);
 				}
@@ -1649,7 +1676,7 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 				}
 
 				while (cinfo.next_scanline < cinfo.image_height) {
-					uint8_t *source = FreeImage_GetScanLine(dib, FreeImage_GetHeight(dib) - cinfo.next_scanline - 1);
+					uint8_t *source = (uint8_t*)FreeImage_GetConstScanLine(dib, FreeImage_GetHeight(dib) - cinfo.next_scanline - 1);
 					FreeImage_ConvertLine8To24(target, source, cinfo.image_width, palette);
 
 #if FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR
@@ -1681,7 +1708,7 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 				}
 
 				while(cinfo.next_scanline < cinfo.image_height) {
-					uint8_t *source = FreeImage_GetScanLine(dib, FreeImage_GetHeight(dib) - cinfo.next_scanline - 1);
+					const uint8_t *source = FreeImage_GetConstScanLine(dib, FreeImage_GetHeight(dib) - cinfo.next_scanline - 1);
 					for(i = 0; i < cinfo.image_width; i++) {
 						target[i] = reverse[ source[i] ];
 					}
@@ -1731,6 +1758,7 @@ InitJPEG(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = Save;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
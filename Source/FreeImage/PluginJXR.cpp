@@ -907,6 +907,18 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return (memcmp(jxr_signature, signature, 3) == 0);
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t jxr_signature[] = { 0x49, 0x49, 0xBC };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(jxr_signature), jxr_signature, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return (
@@ -1466,6 +1478,7 @@ InitJXR(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = Save;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
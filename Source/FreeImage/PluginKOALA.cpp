@@ -122,6 +122,18 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return (memcmp(koala_signature, signature, sizeof(koala_signature)) == 0);
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t koala_signature[] = { 0x00, 0x60 };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(koala_signature), koala_signature, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return FALSE;
@@ -236,6 +248,7 @@ InitKOALA(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = nullptr;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
@@ -277,6 +277,29 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return pcx_validate(io, handle);
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	// magic number 0x0A, version 0 to 5, encoding 0 or 1, 1 or 8 bits per pixel per plane
+	static const uint8_t pcx_v0_1bpp[] = { 0x0A, 0x00, 0x00, 0x01 };
+	static const uint8_t pcx_v0_1bpp_mask[] = { 0xFF, 0xFC, 0xFE, 0xFF };
+	static const uint8_t pcx_v0_8bpp[] = { 0x0A, 0x00, 0x00, 0x08 };
+	static const uint8_t pcx_v0_8bpp_mask[] = { 0xFF, 0xFC, 0xFE, 0xFF };
+	static const uint8_t pcx_v4_1bpp[] = { 0x0A, 0x04, 0x00, 0x01 };
+	static const uint8_t pcx_v4_1bpp_mask[] = { 0xFF, 0xFE, 0xFE, 0xFF };
+	static const uint8_t pcx_v4_8bpp[] = { 0x0A, 0x04, 0x00, 0x08 };
+	static const uint8_t pcx_v4_8bpp_mask[] = { 0xFF, 0xFE, 0xFE, 0xFF };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(pcx_v0_1bpp), pcx_v0_1bpp, pcx_v0_1bpp_mask },
+		{ 0, sizeof(pcx_v0_8bpp), pcx_v0_8bpp, pcx_v0_8bpp_mask },
+		{ 0, sizeof(pcx_v4_1bpp), pcx_v4_1bpp, pcx_v4_1bpp_mask },
+		{ 0, sizeof(pcx_v4_8bpp), pcx_v4_8bpp, pcx_v4_8bpp_mask }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 /*!
     This function is used to 'ask' the plugin if it can write
 	a bitmap in a certain bitdepth. Different bitmap types have different
@@ -693,6 +716,7 @@ InitPCX(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = nullptr;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
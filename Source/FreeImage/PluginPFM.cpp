@@ -174,6 +174,20 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return FALSE;
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t pfm_id1[] = { 0x50, 0x46 };
+	static const uint8_t pfm_id2[] = { 0x50, 0x66 };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(pfm_id1), pfm_id1, nullptr },
+		{ 0, sizeof(pfm_id2), pfm_id2, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return FALSE;
@@ -401,6 +415,7 @@ InitPFM(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = Save;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
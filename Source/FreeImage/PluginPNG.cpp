@@ -29,6 +29,7 @@
 
 #include "FreeImage.h"
 #include "Utilities.h"
+#include "Threading.h"
 
 #include "../Metadata/FreeImageTag.h"
 
@@ -279,6 +280,18 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return (memcmp(png_signature, signature, 8) == 0);
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t png_signature[] = { 0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(png_signature), png_signature, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return (
@@ -500,224 +513,260 @@ ConfigureDecoder(png_structp png_ptr, png_infop info_ptr, int flags, FREE_IMAGE_
 	return TRUE;
 }
 
-static FIBITMAP * DLL_CALLCONV
-Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
-	png_structp png_ptr = nullptr;
-	png_infop info_ptr = nullptr;
-	png_uint_32 width, height;
-	int color_type;
-	int bit_depth;
-	int pixel_depth = 0;	// pixel_depth = bit_depth * channels
+/**
+Check the PNG signature and create the libpng read structures
+@param fio IO structure given to libpng
+@param png_ptr Receives the PNG handle
+@param info_ptr Receives the PNG info handle
+@return Returns TRUE if successful, returns FALSE otherwise
+*/
+static BOOL
+CreateDecoder(fi_ioStructure *fio, png_structp *png_ptr, png_infop *info_ptr) {
+	// check to see if the file is in fact a PNG file
 
-	FIBITMAP *dib = nullptr;
-	png_bytepp row_pointers = nullptr;
+	uint8_t png_check[PNG_BYTES_TO_CHECK];
 
-    fi_ioStructure fio;
-    fio.s_handle = handle;
-	fio.s_io = io;
-    
-	if (handle) {
-		BOOL header_only = (flags & FIF_LOAD_NOPIXELS) == FIF_LOAD_NOPIXELS;
+	fio->s_io->read_proc(png_check, PNG_BYTES_TO_CHECK, 1, fio->s_handle);
 
-		try {		
-			// check to see if the file is in fact a PNG file
+	if (png_sig_cmp(png_check, (png_size_t)0, PNG_BYTES_TO_CHECK) != 0) {
+		return FALSE;	// Bad signature
+	}
 
-			uint8_t png_check[PNG_BYTES_TO_CHECK];
+	// create the chunk manage structure
 
-			io->read_proc(png_check, PNG_BYTES_TO_CHECK, 1, handle);
+	*png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)nullptr, error_handler, warning_handler);
 
-			if (png_sig_cmp(png_check, (png_size_t)0, PNG_BYTES_TO_CHECK) != 0) {
-				return nullptr;	// Bad signature
-			}
-			
-			// create the chunk manage structure
+	if (!*png_ptr) {
+		return FALSE;
+	}
 
-			png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)nullptr, error_handler, warning_handler);
+	// create the info structure
 
-			if (!png_ptr) {
-				return nullptr;			
-			}
+	*info_ptr = png_create_info_struct(*png_ptr);
 
-			// create the info structure
+	if (!*info_ptr) {
+		png_destroy_read_struct(png_ptr, (png_infopp)nullptr, (png_infopp)nullptr);
+		return FALSE;
+	}
 
-		    info_ptr = png_create_info_struct(png_ptr);
+	// init the IO
 
-			if (!info_ptr) {
-				png_destroy_read_struct(&png_ptr, (png_infopp)nullptr, (png_infopp)nullptr);
-				return nullptr;
-			}
+	png_set_read_fn(*png_ptr, fio, _ReadProc);
 
-			// init the IO
+	// because we have already read the signature...
 
-			png_set_read_fn(png_ptr, &fio, _ReadProc);            
-			
-			// PNG errors will be redirected here
+	png_set_sig_bytes(*png_ptr, PNG_BYTES_TO_CHECK);
 
-			if (setjmp(png_jmpbuf(png_ptr))) {
-				// assume error_handler was called before by the PNG library
-				throw((const char*)nullptr);
-			}
+	return TRUE;
+}
 
-			// because we have already read the signature...
+/**
+Allocate the bitmap receiving the decoded image, with its palette, transparency table, background color, 
+resolution and ICC profile. The decoder has been configured (see ConfigureDecoder). 
+@param png_ptr PNG handle
+@param info_ptr PNG info handle
+@param image_type Image type returned by ConfigureDecoder
+@param header_only If TRUE, allocate a header only bitmap
+@return Returns the allocated bitmap, throws an error message otherwise
+*/
+static FIBITMAP *
+AllocateDecodedImage(png_structp png_ptr, png_infop info_ptr, FREE_IMAGE_TYPE image_type, BOOL header_only) {
+	FIBITMAP *dib = nullptr;
 
-			png_set_sig_bytes(png_ptr, PNG_BYTES_TO_CHECK);
+	const png_uint_32 width = png_get_image_width(png_ptr, info_ptr);
+	const png_uint_32 height = png_get_image_height(png_ptr, info_ptr);
 
-			// read the IHDR chunk
+	// get the decoded image info
 
-			png_read_info(png_ptr, info_ptr);
-			png_get_IHDR(png_ptr, info_ptr, &width, &height, &bit_depth, &color_type, nullptr, nullptr, nullptr);
+	const int color_type = png_get_color_type(png_ptr, info_ptr);
+	const int bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+	const int pixel_depth = bit_depth * png_get_channels(png_ptr, info_ptr);
 
-			// configure the decoder
+	// create a dib and write the bitmap header
+	// set up the dib palette, if needed
 
-			FREE_IMAGE_TYPE image_type = FIT_BITMAP;
+	switch (color_type) {
+		case PNG_COLOR_TYPE_RGB:
+		case PNG_COLOR_TYPE_RGB_ALPHA:
+			dib = FreeImage_AllocateHeaderT(header_only, image_type, width, height, pixel_depth, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK);
+			break;
 
-			if(!ConfigureDecoder(png_ptr, info_ptr, flags, &image_type)) {
-				throw FI_MSG_ERROR_UNSUPPORTED_FORMAT;
+		case PNG_COLOR_TYPE_PALETTE:
+			dib = FreeImage_AllocateHeaderT(header_only, image_type, width, height, pixel_depth, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK);
+			if(dib) {
+				png_colorp png_palette = nullptr;
+				int palette_entries = 0;
+
+				png_get_PLTE(png_ptr,info_ptr, &png_palette, &palette_entries);
+
+				palette_entries = MIN((unsigned)palette_entries, FreeImage_GetColorsUsed(dib));
+
+				// store the palette
+
+				RGBQUAD *palette = FreeImage_GetPalette(dib);
+				for(int i = 0; i < palette_entries; i++) {
+					palette[i].rgbRed   = png_palette[i].red;
+					palette[i].rgbGreen = png_palette[i].green;
+					palette[i].rgbBlue  = png_palette[i].blue;
+				}
 			}
+			break;
 
-			// update image info
+		case PNG_COLOR_TYPE_GRAY:
+			dib = FreeImage_AllocateHeaderT(header_only, image_type, width, height, pixel_depth, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK);
 
-			color_type = png_get_color_type(png_ptr, info_ptr);
-			bit_depth = png_get_bit_depth(png_ptr, info_ptr);
-			pixel_depth = bit_depth * png_get_channels(png_ptr, info_ptr);
+			if(dib && (pixel_depth <= 8)) {
+				RGBQUAD *palette = FreeImage_GetPalette(dib);
+				const int palette_entries = 1 << pixel_depth;
 
-			// create a dib and write the bitmap header
-			// set up the dib palette, if needed
+				for(int i = 0; i < palette_entries; i++) {
+					palette[i].rgbRed   =
+					palette[i].rgbGreen =
+					palette[i].rgbBlue  = (uint8_t)((i * 255) / (palette_entries - 1));
+				}
+			}
+			break;
 
-			switch (color_type) {
-				case PNG_COLOR_TYPE_RGB:
-				case PNG_COLOR_TYPE_RGB_ALPHA:
-					dib = FreeImage_AllocateHeaderT(header_only, image_type, width, height, pixel_depth, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK);
-					break;
+		default:
+			throw FI_MSG_ERROR_UNSUPPORTED_FORMAT;
+	}
 
-				case PNG_COLOR_TYPE_PALETTE:
-					dib = FreeImage_AllocateHeaderT(header_only, image_type, width, height, pixel_depth, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK);
-					if(dib) {
-						png_colorp png_palette = nullptr;
-						int palette_entries = 0;
+	if(!dib) {
+		throw FI_MSG_ERROR_DIB_MEMORY;
+	}
 
-						png_get_PLTE(png_ptr,info_ptr, &png_palette, &palette_entries);
+	// store the transparency table
+
+	if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) {
+		// array of alpha (transparency) entries for palette
+		png_bytep trans_alpha = nullptr;
+		// number of transparent entries
+		int num_trans = 0;						
+		// graylevel or color sample values of the single transparent color for non-paletted images
+		png_color_16p trans_color = nullptr;
+
+		png_get_tRNS(png_ptr, info_ptr, &trans_alpha, &num_trans, &trans_color);
+
+		if((color_type == PNG_COLOR_TYPE_GRAY) && trans_color) {
+			// single transparent color
+			if (trans_color->gray < 256) { 
+				uint8_t table[256]; 
+				memset(table, 0xFF, 256); 
+				table[trans_color->gray] = 0; 
+				FreeImage_SetTransparencyTable(dib, table, 256); 
+			}
+			// check for a full transparency table, too
+			else if ((trans_alpha) && (pixel_depth <= 8)) {
+				FreeImage_SetTransparencyTable(dib, (uint8_t *)trans_alpha, num_trans);
+			}
 
-						palette_entries = MIN((unsigned)palette_entries, FreeImage_GetColorsUsed(dib));
+		} else if((color_type == PNG_COLOR_TYPE_PALETTE) && trans_alpha) {
+			// transparency table
+			FreeImage_SetTransparencyTable(dib, (uint8_t *)trans_alpha, num_trans);
+		}
+	}
 
-						// store the palette
+	// store the background color (only supported for FIT_BITMAP types)
 
-						RGBQUAD *palette = FreeImage_GetPalette(dib);
-						for(int i = 0; i < palette_entries; i++) {
-							palette[i].rgbRed   = png_palette[i].red;
-							palette[i].rgbGreen = png_palette[i].green;
-							palette[i].rgbBlue  = png_palette[i].blue;
-						}
-					}
-					break;
+	if ((image_type == FIT_BITMAP) && png_get_valid(png_ptr, info_ptr, PNG_INFO_bKGD)) {
+		// Get the background color to draw transparent and alpha images over.
+		// Note that even if the PNG file supplies a background, you are not required to
+		// use it - you should use the (solid) application background if it has one.
 
-				case PNG_COLOR_TYPE_GRAY:
-					dib = FreeImage_AllocateHeaderT(header_only, image_type, width, height, pixel_depth, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK);
+		png_color_16p image_background = nullptr;
+		RGBQUAD rgbBkColor;
 
-					if(dib && (pixel_depth <= 8)) {
-						RGBQUAD *palette = FreeImage_GetPalette(dib);
-						const int palette_entries = 1 << pixel_depth;
+		if (png_get_bKGD(png_ptr, info_ptr, &image_background)) {
+			rgbBkColor.rgbRed      = (uint8_t)image_background->red;
+			rgbBkColor.rgbGreen    = (uint8_t)image_background->green;
+			rgbBkColor.rgbBlue     = (uint8_t)image_background->blue;
+			rgbBkColor.rgbReserved = 0;
 
-						for(int i = 0; i < palette_entries; i++) {
-							palette[i].rgbRed   =
-							palette[i].rgbGreen =
-							palette[i].rgbBlue  = (uint8_t)((i * 255) / (palette_entries - 1));
-						}
-					}
-					break;
+			FreeImage_SetBackgroundColor(dib, &rgbBkColor);
+		}
+	}
 
-				default:
-					throw FI_MSG_ERROR_UNSUPPORTED_FORMAT;
-			}
+	// get physical resolution
 
-			if(!dib) {
-				throw FI_MSG_ERROR_DIB_MEMORY;
-			}
+	if (png_get_valid(png_ptr, info_ptr, PNG_INFO_pHYs)) {
+		png_uint_32 res_x, res_y;
+		
+		// we'll overload this var and use 0 to mean no phys data,
+		// since if it's not in meters we can't use it anyway
 
-			// store the transparency table
-
-			if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) {
-				// array of alpha (transparency) entries for palette
-				png_bytep trans_alpha = nullptr;
-				// number of transparent entries
-				int num_trans = 0;						
-				// graylevel or color sample values of the single transparent color for non-paletted images
-				png_color_16p trans_color = nullptr;
-
-				png_get_tRNS(png_ptr, info_ptr, &trans_alpha, &num_trans, &trans_color);
-
-				if((color_type == PNG_COLOR_TYPE_GRAY) && trans_color) {
-					// single transparent color
-					if (trans_color->gray < 256) { 
-						uint8_t table[256]; 
-						memset(table, 0xFF, 256); 
-						table[trans_color->gray] = 0; 
-						FreeImage_SetTransparencyTable(dib, table, 256); 
-					}
-					// check for a full transparency table, too
-					else if ((trans_alpha) && (pixel_depth <= 8)) {
-						FreeImage_SetTransparencyTable(dib, (uint8_t *)trans_alpha, num_trans);
-					}
+		int res_unit_type = PNG_RESOLUTION_UNKNOWN;
 
-				} else if((color_type == PNG_COLOR_TYPE_PALETTE) && trans_alpha) {
-					// transparency table
-					FreeImage_SetTransparencyTable(dib, (uint8_t *)trans_alpha, num_trans);
-				}
-			}
+		png_get_pHYs(png_ptr,info_ptr, &res_x, &res_y, &res_unit_type);
 
-			// store the background color (only supported for FIT_BITMAP types)
+		if (res_unit_type == PNG_RESOLUTION_METER) {
+			FreeImage_SetDotsPerMeterX(dib, res_x);
+			FreeImage_SetDotsPerMeterY(dib, res_y);
+		}
+	}
 
-			if ((image_type == FIT_BITMAP) && png_get_valid(png_ptr, info_ptr, PNG_INFO_bKGD)) {
-				// Get the background color to draw transparent and alpha images over.
-				// Note that even if the PNG file supplies a background, you are not required to
-				// use it - you should use the (solid) application background if it has one.
+	// get possible ICC profile
 
-				png_color_16p image_background = nullptr;
-				RGBQUAD rgbBkColor;
+	if (png_get_valid(png_ptr, info_ptr, PNG_INFO_iCCP)) {
+		png_charp profile_name = nullptr;
+		png_bytep profile_data = nullptr;
+		png_uint_32 profile_length = 0;
+		int  compression_type;
 
-				if (png_get_bKGD(png_ptr, info_ptr, &image_background)) {
-					rgbBkColor.rgbRed      = (uint8_t)image_background->red;
-					rgbBkColor.rgbGreen    = (uint8_t)image_background->green;
-					rgbBkColor.rgbBlue     = (uint8_t)image_background->blue;
-					rgbBkColor.rgbReserved = 0;
+		png_get_iCCP(png_ptr, info_ptr, &profile_name, &compression_type, &profile_data, &profile_length);
 
-					FreeImage_SetBackgroundColor(dib, &rgbBkColor);
-				}
-			}
+		// copy ICC profile data (must be done after FreeImage_AllocateHeader)
 
-			// get physical resolution
+		FreeImage_CreateICCProfile(dib, profile_data, profile_length);
+	}
 
-			if (png_get_valid(png_ptr, info_ptr, PNG_INFO_pHYs)) {
-				png_uint_32 res_x, res_y;
-				
-				// we'll overload this var and use 0 to mean no phys data,
-				// since if it's not in meters we can't use it anyway
+	return dib;
+}
 
-				int res_unit_type = PNG_RESOLUTION_UNKNOWN;
+static FIBITMAP * DLL_CALLCONV
+Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
+	png_structp png_ptr = nullptr;
+	png_infop info_ptr = nullptr;
+	png_uint_32 width, height;
+	int color_type;
+	int bit_depth;
 
-				png_get_pHYs(png_ptr,info_ptr, &res_x, &res_y, &res_unit_type);
+	FIBITMAP *dib = nullptr;
+	png_bytepp row_pointers = nullptr;
 
-				if (res_unit_type == PNG_RESOLUTION_METER) {
-					FreeImage_SetDotsPerMeterX(dib, res_x);
-					FreeImage_SetDotsPerMeterY(dib, res_y);
-				}
+    fi_ioStructure fio;
+    fio.s_handle = handle;
+	fio.s_io = io;
+    
+	if (handle) {
+		BOOL header_only = (flags & FIF_LOAD_NOPIXELS) == FIF_LOAD_NOPIXELS;
+
+		try {		
+			if (!CreateDecoder(&fio, &png_ptr, &info_ptr)) {
+				return nullptr;
 			}
 
-			// get possible ICC profile
+			// PNG errors will be redirected here
 
-			if (png_get_valid(png_ptr, info_ptr, PNG_INFO_iCCP)) {
-				png_charp profile_name = nullptr;
-				png_bytep profile_data = nullptr;
-				png_uint_32 profile_length = 0;
-				int  compression_type;
+			if (setjmp(png_jmpbuf(png_ptr))) {
+				// assume error_handler was called before by the PNG library
+				throw((const char*)nullptr);
+			}
 
-				png_get_iCCP(png_ptr, info_ptr, &profile_name, &compression_type, &profile_data, &profile_length);
+			// read the IHDR chunk
 
-				// copy ICC profile data (must be done after FreeImage_AllocateHeader)
+			png_read_info(png_ptr, info_ptr);
+			png_get_IHDR(png_ptr, info_ptr, &width, &height, &bit_depth, &color_type, nullptr, nullptr, nullptr);
 
-				FreeImage_CreateICCProfile(dib, profile_data, profile_length);
+			// configure the decoder
+
+			FREE_IMAGE_TYPE image_type = FIT_BITMAP;
+
+			if(!ConfigureDecoder(png_ptr, info_ptr, flags, &image_type)) {
+				throw FI_MSG_ERROR_UNSUPPORTED_FORMAT;
 			}
 
+			dib = AllocateDecodedImage(png_ptr, info_ptr, image_type, header_only);
+
 			// --- header only mode => clean-up and return
 
 			if (header_only) {
@@ -805,6 +854,774 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 
 // --------------------------------------------------------------------------
 
+// ==========================================================
+// Scanline reading
+// ==========================================================
+
+/**
+State of a row by row decoding (see FreeImage_OpenScanlineReader). 
+Non-interlaced images are inflated one row per call. 
+The Adam7 passes of an interlaced image are read at the first call and kept as reduced images, 
+each returned row is then deinterlaced from them.
+*/
+typedef struct tagPNGScanlineReader {
+	fi_ioStructure fio;
+	png_structp png_ptr;
+	png_infop info_ptr;
+	FIBITMAP *header;		//! header only bitmap describing the decoded rows
+	unsigned width;
+	unsigned height;
+	unsigned pixel_depth;	//! bits per decoded pixel
+	unsigned row;			//! next row to return, from the top of the image
+	BOOL interlaced;
+	std::vector<uint8_t> passes;	//! reduced images of the interlaced passes, one after the other
+	size_t pass_offset[7];		//! position of each pass in 'passes'
+	size_t pass_pitch[7];		//! row size of each pass (0 for an empty pass)
+	std::vector<uint8_t> pass_row;	//! full width row read by libpng
+} PNGScanlineReader;
+
+static void
+CloseReader(PNGScanlineReader *reader) {
+	if (reader->png_ptr) {
+		png_destroy_read_struct(&reader->png_ptr, &reader->info_ptr, (png_infopp)nullptr);
+	}
+	delete reader;
+}
+
+static void DLL_CALLCONV
+CloseScanlineReader(void *data) {
+	if (data) {
+		CloseReader((PNGScanlineReader*)data);
+	}
+}
+
+static void * DLL_CALLCONV
+OpenScanlineReader(FreeImageIO *io, fi_handle handle, int page, int flags, void *data, FIBITMAP **header) {
+	PNGScanlineReader *reader = new(std::nothrow) PNGScanlineReader;
+	if (!reader) {
+		return nullptr;
+	}
+	reader->fio.s_io = io;
+	reader->fio.s_handle = handle;
+	reader->png_ptr = nullptr;
+	reader->info_ptr = nullptr;
+	reader->header = nullptr;
+	reader->row = 0;
+
+	FIBITMAP *dib = nullptr;
+
+	try {
+		if (!CreateDecoder(&reader->fio, &reader->png_ptr, &reader->info_ptr)) {
+			delete reader;
+			return nullptr;
+		}
+		png_structp png_ptr = reader->png_ptr;
+		png_infop info_ptr = reader->info_ptr;
+
+		if (setjmp(png_jmpbuf(png_ptr))) {
+			throw((const char*)nullptr);
+		}
+
+		png_read_info(png_ptr, info_ptr);
+
+		// interlace handling is not enabled: the passes are read as reduced images
+
+		FREE_IMAGE_TYPE image_type = FIT_BITMAP;
+
+		if (!ConfigureDecoder(png_ptr, info_ptr, flags, &image_type)) {
+			throw FI_MSG_ERROR_UNSUPPORTED_FORMAT;
+		}
+
+		dib = AllocateDecodedImage(png_ptr, info_ptr, image_type, TRUE);
+
+		// pixels are unknown yet, a 32-bit image is transparent when it has an alpha channel
+		if ((image_type == FIT_BITMAP) && (FreeImage_GetBPP(dib) == 32)) {
+			FreeImage_SetTransparent(dib, (png_get_color_type(png_ptr, info_ptr) == PNG_COLOR_TYPE_RGB_ALPHA) ? TRUE : FALSE);
+		}
+
+		// metadata located before the image data
+		ReadMetadata(png_ptr, info_ptr, dib);
+
+		reader->width = png_get_image_width(png_ptr, info_ptr);
+		reader->height = png_get_image_height(png_ptr, info_ptr);
+		reader->pixel_depth = png_get_bit_depth(png_ptr, info_ptr) * png_get_channels(png_ptr, info_ptr);
+		reader->interlaced = (png_get_interlace_type(png_ptr, info_ptr) == PNG_INTERLACE_ADAM7) ? TRUE : FALSE;
+
+		// allow loading of PNG with minor errors (such as images with several IDAT chunks)
+		png_set_benign_errors(png_ptr, 1);
+
+		reader->header = dib;
+		*header = dib;
+
+		return reader;
+
+	} catch (const char *text) {
+		if (dib) {
+			FreeImage_Unload(dib);
+		}
+		CloseReader(reader);
+		if (nullptr != text) {
+			FreeImage_OutputMessageProc(s_format_id, text);
+		}
+		return nullptr;
+	}
+}
+
+/**
+Read the Adam7 passes of an interlaced image, as libpng returns them when interlace handling is not enabled
+*/
+static void
+ReadInterlacedPasses(PNGScanlineReader *reader) {
+	size_t size = 0;
+	for (int pass = 0; pass < 7; pass++) {
+		const png_uint_32 cols = PNG_PASS_COLS(reader->width, pass);
+		const png_uint_32 rows = PNG_PASS_ROWS(reader->height, pass);
+		// libpng skips empty passes
+		reader->pass_pitch[pass] = (cols && rows) ? (((size_t)cols * reader->pixel_depth + 7) / 8) : 0;
+		reader->pass_offset[pass] = size;
+		size += reader->pass_pitch[pass] * rows;
+	}
+
+	reader->passes.resize(size);
+
+	// libpng copies a full width row, of which the pass row is the beginning
+	std::vector<uint8_t>& row = reader->pass_row;
+	row.resize(png_get_rowbytes(reader->png_ptr, reader->info_ptr));
+
+	for (int pass = 0; pass < 7; pass++) {
+		const png_uint_32 rows = reader->pass_pitch[pass] ? PNG_PASS_ROWS(reader->height, pass) : 0;
+		for (png_uint_32 y = 0; y < rows; y++) {
+			png_read_row(reader->png_ptr, &row[0], nullptr);
+			memcpy(&reader->passes[reader->pass_offset[pass] + y * reader->pass_pitch[pass]], &row[0], reader->pass_pitch[pass]);
+		}
+	}
+}
+
+/**
+Build a row of an interlaced image from the pass rows it is made of
+*/
+static void
+DeinterlaceRow(const PNGScanlineReader *reader, unsigned y, uint8_t *bits) {
+	const unsigned pixel_depth = reader->pixel_depth;
+	const unsigned bytespp = pixel_depth / 8;
+
+	for (int pass = 0; pass < 7; pass++) {
+		if (!reader->pass_pitch[pass] || !PNG_ROW_IN_INTERLACE_PASS(y, pass)) {
+			continue;
+		}
+		const uint8_t *src = &reader->passes[reader->pass_offset[pass] + ((y - PNG_PASS_START_ROW(pass)) >> PNG_PASS_ROW_SHIFT(pass)) * reader->pass_pitch[pass]];
+		const png_uint_32 cols = PNG_PASS_COLS(reader->width, pass);
+		const unsigned start = PNG_PASS_START_COL(pass);
+		const unsigned shift = PNG_PASS_COL_SHIFT(pass);
+
+		if (pixel_depth >= 8) {
+			for (png_uint_32 i = 0; i < cols; i++) {
+				memcpy(bits + ((start + (i << shift)) * bytespp), src + i * bytespp, bytespp);
+			}
+		} else {
+			// packed pixels, most significant bits first
+			const unsigned mask = (1 << pixel_depth) - 1;
+			for (png_uint_32 i = 0; i < cols; i++) {
+				const unsigned src_bit = i * pixel_depth;
+				const unsigned value = (src[src_bit >> 3] >> (8 - pixel_depth - (src_bit & 7))) & mask;
+				const unsigned dst_bit = (start + (i << shift)) * pixel_depth;
+				const unsigned dst_shift = 8 - pixel_depth - (dst_bit & 7);
+				bits[dst_bit >> 3] = (uint8_t)((bits[dst_bit >> 3] & ~(mask << dst_shift)) | (value << dst_shift));
+			}
+		}
+	}
+}
+
+static BOOL DLL_CALLCONV
+ReadNextScanline(void *data, uint8_t *bits) {
+	PNGScanlineReader *reader = (PNGScanlineReader*)data;
+
+	if (!reader || !bits || (reader->row >= reader->height)) {
+		return FALSE;
+	}
+
+	try {
+		if (setjmp(png_jmpbuf(reader->png_ptr))) {
+			throw((const char*)nullptr);
+		}
+
+		if (reader->interlaced) {
+			if (reader->passes.empty()) {
+				ReadInterlacedPasses(reader);
+			}
+			DeinterlaceRow(reader, reader->row, bits);
+		} else {
+			png_read_row(reader->png_ptr, bits, nullptr);
+		}
+
+		reader->row++;
+
+		if (reader->row == reader->height) {
+			// read the rest of the file, getting any additional metadata
+			png_read_end(reader->png_ptr, reader->info_ptr);
+			ReadMetadata(reader->png_ptr, reader->info_ptr, reader->header);
+			// the pass images are no longer needed
+			std::vector<uint8_t>().swap(reader->passes);
+			std::vector<uint8_t>().swap(reader->pass_row);
+		}
+
+		return TRUE;
+
+	} catch (const char *text) {
+		// no more rows can be read
+		reader->row = reader->height;
+		if (nullptr != text) {
+			FreeImage_OutputMessageProc(s_format_id, text);
+		}
+		return FALSE;
+	}
+}
+
+// --------------------------------------------------------------------------
+
+// ==========================================================
+// Image data encoding
+// ==========================================================
+
+// SIMD instruction sets used by the filter kernels
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FI_PNG_SSE2
+#include <emmintrin.h>
+#endif
+
+// uncompressed size of a band of rows compressed by a worker thread
+#define PNG_BAND_SIZE		(1024 * 1024)
+#define PNG_BAND_SIZE_FAST	(128 * 1024)
+// size of the deflate window, used to prime a band with the end of the previous one
+#define PNG_WINDOW_SIZE		32768
+// size of the IDAT chunks written by a single-threaded encoding
+#define PNG_IDAT_SIZE		65536
+
+/// Choice of the filter of a row when several filters are allowed
+enum PNGFilterHeuristic {
+	PNG_HEURISTIC_SAD,		//! smallest sum of absolute differences (as libpng)
+	PNG_HEURISTIC_ENTROPY	//! smallest entropy of the filtered bytes
+};
+
+/**
+Layout of the rows written by WriteImageData, with the transformations libpng would apply to the dib scanlines
+*/
+typedef struct {
+	FIBITMAP *dib;
+	unsigned width;
+	unsigned height;
+	size_t rowbytes;	//! size of a PNG row, without the filter type byte
+	unsigned bpp;		//! distance between corresponding bytes of adjacent pixels (at least 1)
+	int filters;		//! allowed PNG_FILTER_xxx filters
+	PNGFilterHeuristic heuristic;	//! filter choice when several filters are allowed
+	BOOL strip_alpha;	//! 32-bit dib written as RGB
+	BOOL swap_rgb;		//! BGR(A) dib written as RGB(A)
+	BOOL swap_16;		//! 16-bit samples written as big endian
+	BOOL invert;		//! min-is-white dib written as min-is-black
+} PNGRowFormat;
+
+/**
+Deflate settings of the image data
+*/
+typedef struct {
+	int level;
+	int strategy;
+	int mem_level;
+} PNGCompression;
+
+/**
+Copy a scanline of the dib into a PNG row
+@param format Row layout
+@param y Row number, from the top of the image
+@param row Receives the row (format.rowbytes bytes)
+*/
+static void
+PrepareRow(const PNGRowFormat& format, unsigned y, uint8_t *row) {
+	const uint8_t *bits = FreeImage_GetConstScanLine(format.dib, format.height - y - 1);
+
+	if (format.strip_alpha) {
+		FreeImage_ConvertLine32To24(row, (uint8_t*)bits, format.width);
+	} else {
+		memcpy(row, bits, format.rowbytes);
+	}
+	if (format.swap_rgb) {
+		for (size_t x = 0; x + 2 < format.rowbytes; x += format.bpp) {
+			const uint8_t tmp = row[x];
+			row[x] = row[x + 2];
+			row[x + 2] = tmp;
+		}
+	}
+	if (format.swap_16) {
+		for (size_t x = 0; x + 1 < format.rowbytes; x += 2) {
+			const uint8_t tmp = row[x];
+			row[x] = row[x + 1];
+			row[x + 1] = tmp;
+		}
+	}
+	if (format.invert) {
+		for (size_t x = 0; x < format.rowbytes; x++) {
+			row[x] = (uint8_t)~row[x];
+		}
+	}
+}
+
+// --------------------------------------------------------------------------
+// Filter kernels : row is the row to filter, prior the previous row (all zeros for the first row), 
+// the bytes of the first pixel have no left neighbour
+
+static inline uint8_t
+PaethPredictor(int a, int b, int c) {
+	const int p = a + b - c;
+	const int pa = abs(p - a);
+	const int pb = abs(p - b);
+	const int pc = abs(p - c);
+	if ((pa <= pb) && (pa <= pc)) {
+		return (uint8_t)a;
+	}
+	return (uint8_t)((pb <= pc) ? b : c);
+}
+
+static void
+FilterSub(const uint8_t *row, size_t rowbytes, unsigned bpp, uint8_t *out) {
+	size_t x = MIN((size_t)bpp, rowbytes);
+	memcpy(out, row, x);
+#if defined(FI_PNG_SSE2)
+	for (; x + 16 <= rowbytes; x += 16) {
+		const __m128i r = _mm_loadu_si128((const __m128i*)(row + x));
+		const __m128i a = _mm_loadu_si128((const __m128i*)(row + x - bpp));
+		_mm_storeu_si128((__m128i*)(out + x), _mm_sub_epi8(r, a));
+	}
+#endif
+	for (; x < rowbytes; x++) {
+		out[x] = (uint8_t)(row[x] - row[x - bpp]);
+	}
+}
+
+static void
+FilterUp(const uint8_t *row, const uint8_t *prior, size_t rowbytes, uint8_t *out) {
+	size_t x = 0;
+#if defined(FI_PNG_SSE2)
+	for (; x + 16 <= rowbytes; x += 16) {
+		const __m128i r = _mm_loadu_si128((const __m128i*)(row + x));
+		const __m128i b = _mm_loadu_si128((const __m128i*)(prior + x));
+		_mm_storeu_si128((__m128i*)(out + x), _mm_sub_epi8(r, b));
+	}
+#endif
+	for (; x < rowbytes; x++) {
+		out[x] = (uint8_t)(row[x] - prior[x]);
+	}
+}
+
+static void
+FilterAvg(const uint8_t *row, const uint8_t *prior, size_t rowbytes, unsigned bpp, uint8_t *out) {
+	size_t x = 0;
+	for (; (x < bpp) && (x < rowbytes); x++) {
+		out[x] = (uint8_t)(row[x] - (prior[x] >> 1));
+	}
+#if defined(FI_PNG_SSE2)
+	const __m128i one = _mm_set1_epi8(1);
+	for (; x + 16 <= rowbytes; x += 16) {
+		const __m128i r = _mm_loadu_si128((const __m128i*)(row + x));
+		const __m128i a = _mm_loadu_si128((const __m128i*)(row + x - bpp));
+		const __m128i b = _mm_loadu_si128((const __m128i*)(prior + x));
+		// _mm_avg_epu8 rounds up, (a + b) >> 1 rounds down
+		const __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+		_mm_storeu_si128((__m128i*)(out + x), _mm_sub_epi8(r, avg));
+	}
+#endif
+	for (; x < rowbytes; x++) {
+		out[x] = (uint8_t)(row[x] - ((row[x - bpp] + prior[x]) >> 1));
+	}
+}
+
+#if defined(FI_PNG_SSE2)
+/// Paeth predictor of 8 pixels bytes, widened to 16-bit
+static inline __m128i
+PaethPredictor16(__m128i a, __m128i b, __m128i c) {
+	// p - a = b - c, p - b = a - c, p - c = a + b - 2c
+	const __m128i zero = _mm_setzero_si128();
+	__m128i pa = _mm_sub_epi16(b, c);
+	__m128i pb = _mm_sub_epi16(a, c);
+	__m128i pc = _mm_add_epi16(pa, pb);
+	pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+	pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+	pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+	// a if pa <= pb and pa <= pc, else b if pb <= pc, else c
+	const __m128i use_a = _mm_andnot_si128(_mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc)), _mm_set1_epi16(-1));
+	const __m128i use_b = _mm_andnot_si128(_mm_cmpgt_epi16(pb, pc), _mm_set1_epi16(-1));
+	const __m128i b_or_c = _mm_or_si128(_mm_and_si128(use_b, b), _mm_andnot_si128(use_b, c));
+	return _mm_or_si128(_mm_and_si128(use_a, a), _mm_andnot_si128(use_a, b_or_c));
+}
+#endif
+
+static void
+FilterPaeth(const uint8_t *row, const uint8_t *prior, size_t rowbytes, unsigned bpp, uint8_t *out) {
+	size_t x = 0;
+	for (; (x < bpp) && (x < rowbytes); x++) {
+		out[x] = (uint8_t)(row[x] - prior[x]);
+	}
+#if defined(FI_PNG_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	for (; x + 16 <= rowbytes; x += 16) {
+		const __m128i r = _mm_loadu_si128((const __m128i*)(row + x));
+		const __m128i a = _mm_loadu_si128((const __m128i*)(row + x - bpp));
+		const __m128i b = _mm_loadu_si128((const __m128i*)(prior + x));
+		const __m128i c = _mm_loadu_si128((const __m128i*)(prior + x - bpp));
+		const __m128i lo = PaethPredictor16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero));
+		const __m128i hi = PaethPredictor16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero));
+		_mm_storeu_si128((__m128i*)(out + x), _mm_sub_epi8(r, _mm_packus_epi16(lo, hi)));
+	}
+#endif
+	for (; x < rowbytes; x++) {
+		out[x] = (uint8_t)(row[x] - PaethPredictor(row[x - bpp], prior[x], prior[x - bpp]));
+	}
+}
+
+/**
+Apply a PNG filter to a row
+@param type Filter type (0 = None, 1 = Sub, 2 = Up, 3 = Average, 4 = Paeth)
+@param row Row to filter
+@param prior Previous row (all zeros for the first row)
+@param rowbytes Size of the rows
+@param bpp Distance between corresponding bytes of adjacent pixels
+@param out Receives the filtered row
+*/
+static void
+FilterRow(int type, const uint8_t *row, const uint8_t *prior, size_t rowbytes, unsigned bpp, uint8_t *out) {
+	switch (type) {
+		case 0: memcpy(out, row, rowbytes); break;
+		case 1: FilterSub(row, rowbytes, bpp, out); break;
+		case 2: FilterUp(row, prior, rowbytes, out); break;
+		case 3: FilterAvg(row, prior, rowbytes, bpp, out); break;
+		case 4: FilterPaeth(row, prior, rowbytes, bpp, out); break;
+	}
+}
+
+/**
+Sum of the filtered bytes taken as signed values (the libpng heuristic)
+*/
+static double
+ScoreSAD(const uint8_t *filtered, size_t rowbytes) {
+	uint64_t sum = 0;
+	size_t x = 0;
+#if defined(FI_PNG_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc = zero;
+	for (; x + 16 <= rowbytes; x += 16) {
+		const __m128i v = _mm_loadu_si128((const __m128i*)(filtered + x));
+		// |v| of a signed byte is min(v, 256 - v) taken as unsigned
+		const __m128i magnitude = _mm_min_epu8(v, _mm_sub_epi8(zero, v));
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(magnitude, zero));
+	}
+	sum = (uint64_t)_mm_cvtsi128_si32(acc) + (uint64_t)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#endif
+	for (; x < rowbytes; x++) {
+		const uint8_t v = filtered[x];
+		sum += (v < 128) ? v : (256 - v);
+	}
+	return (double)sum;
+}
+
+/**
+Shannon entropy of the filtered bytes, in bits (an estimate of their size after Huffman coding)
+*/
+static double
+ScoreEntropy(const uint8_t *filtered, size_t rowbytes) {
+	unsigned histogram[256] = { 0 };
+	for (size_t x = 0; x < rowbytes; x++) {
+		histogram[filtered[x]]++;
+	}
+	double bits = 0;
+	const double total = (double)rowbytes;
+	for (int i = 0; i < 256; i++) {
+		if (histogram[i]) {
+			bits -= histogram[i] * log2(histogram[i] / total);
+		}
+	}
+	return bits;
+}
+
+/**
+Filter a row with the allowed filter that scores best
+@param format Row layout
+@param row Row to filter
+@param prior Previous row (all zeros for the first row)
+@param out Receives the filter type byte followed by the filtered row
+@param scratch Work buffer of format.rowbytes bytes
+*/
+static void
+SelectFilter(const PNGRowFormat& format, const uint8_t *row, const uint8_t *prior, uint8_t *out, uint8_t *scratch) {
+	static const int masks[] = { PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP, PNG_FILTER_AVG, PNG_FILTER_PAETH };
+
+	// a single allowed filter needs no scoring
+	for (int type = 0; type < 5; type++) {
+		if (format.filters == masks[type]) {
+			out[0] = (uint8_t)type;
+			FilterRow(type, row, prior, format.rowbytes, format.bpp, out + 1);
+			return;
+		}
+	}
+
+	double best_score = -1;
+
+	for (int type = 0; type < 5; type++) {
+		if (format.filters & masks[type]) {
+			FilterRow(type, row, prior, format.rowbytes, format.bpp, scratch);
+			const double score = (format.heuristic == PNG_HEURISTIC_ENTROPY) ? ScoreEntropy(scratch, format.rowbytes) : ScoreSAD(scratch, format.rowbytes);
+			if ((best_score < 0) || (score < best_score)) {
+				best_score = score;
+				out[0] = (uint8_t)type;
+				memcpy(out + 1, scratch, format.rowbytes);
+			}
+		}
+	}
+}
+
+/**
+Filter and deflate a range of rows
+@param format Row layout
+@param first First row
+@param last One past the last row
+@param compression Deflate settings
+@param window_bits MAX_WBITS for a complete zlib stream, -MAX_WBITS for a raw deflate stream
+@param prime If TRUE, the 32 KB of filtered rows before 'first' are used as a preset dictionary
+@param flush Z_FINISH to end the stream, Z_SYNC_FLUSH to end it on a byte boundary
+@param sink Functor called as sink(const uint8_t *data, size_t size) with the compressed data
+@param adler Receives the Adler-32 checksum of the filtered rows (raw streams only)
+@return Returns TRUE if successful, returns FALSE otherwise
+*/
+template <class Sink> static BOOL
+DeflateRows(const PNGRowFormat& format, unsigned first, unsigned last, const PNGCompression& compression, int window_bits, BOOL prime, int flush, Sink sink, uint32_t& adler) {
+	const size_t filtered_size = format.rowbytes + 1;
+
+	std::vector<uint8_t> prior(format.rowbytes, 0);
+	std::vector<uint8_t> row(format.rowbytes);
+	std::vector<uint8_t> scratch(format.rowbytes);
+	std::vector<uint8_t> filtered;
+	std::vector<uint8_t> output(PNG_IDAT_SIZE);
+
+	zng_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	if (zng_deflateInit2(&stream, compression.level, Z_DEFLATED, window_bits, compression.mem_level, compression.strategy) != Z_OK) {
+		return FALSE;
+	}
+
+	// filter again the end of the previous band, the filter choices are the same as the previous worker's
+
+	unsigned y = first;
+	if (prime && (first > 0)) {
+		const unsigned window_rows = (unsigned)MIN((size_t)first, (PNG_WINDOW_SIZE + filtered_size - 1) / filtered_size);
+		y = first - window_rows;
+	}
+	if (y > 0) {
+		PrepareRow(format, y - 1, &prior[0]);
+	}
+
+	filtered.resize((first - y) * filtered_size);
+	for (unsigned i = 0; y < first; y++, i++) {
+		PrepareRow(format, y, &row[0]);
+		SelectFilter(format, &row[0], &prior[0], &filtered[i * filtered_size], &scratch[0]);
+		prior.swap(row);
+	}
+	if (!filtered.empty()) {
+		const size_t window = MIN(filtered.size(), (size_t)PNG_WINDOW_SIZE);
+		zng_deflateSetDictionary(&stream, &filtered[filtered.size() - window], (uint32_t)window);
+	}
+
+	// compress the rows
+
+	filtered.resize(filtered_size);
+	adler = zng_adler32(0, nullptr, 0);
+
+	int status = Z_OK;
+	for (y = first; y <= last; y++) {
+		int mode = Z_NO_FLUSH;
+		if (y < last) {
+			PrepareRow(format, y, &row[0]);
+			SelectFilter(format, &row[0], &prior[0], &filtered[0], &scratch[0]);
+			prior.swap(row);
+			if (window_bits < 0) {
+				adler = zng_adler32(adler, &filtered[0], (uint32_t)filtered_size);
+			}
+			stream.next_in = &filtered[0];
+			stream.avail_in = (uint32_t)filtered_size;
+		} else {
+			mode = flush;
+		}
+
+		// deflate until the row is consumed and, at the end, until the stream is flushed
+		do {
+			stream.next_out = &output[0];
+			stream.avail_out = (uint32_t)output.size();
+			status = zng_deflate(&stream, mode);
+			if ((status != Z_OK) && (status != Z_STREAM_END) && (status != Z_BUF_ERROR)) {
+				zng_deflateEnd(&stream);
+				return FALSE;
+			}
+			const size_t size = output.size() - stream.avail_out;
+			if (size) {
+				sink(&output[0], size);
+			}
+		} while ((stream.avail_in != 0) || (stream.avail_out == 0));
+	}
+
+	zng_deflateEnd(&stream);
+
+	return (flush == Z_FINISH) ? (status == Z_STREAM_END) : TRUE;
+}
+
+/**
+Write the IDAT chunks and the IEND chunk of a non-interlaced image. 
+With several workers, bands of rows are filtered and compressed on worker threads, 
+the band streams are joined with sync flushes into a single zlib stream, which any PNG decoder reads. 
+Each band is primed with the last 32 KB of the previous one (unless 'fast_bands' is set), 
+so that the compression ratio stays close to the single-threaded one.
+@param png_ptr PNG handle, the file header has been written
+@param format Row layout
+@param compression Deflate settings
+@param fast_bands If TRUE, compress smaller bands without preset dictionary
+@param workers Number of worker threads
+*/
+static void
+WriteImageData(png_structp png_ptr, const PNGRowFormat& format, const PNGCompression& compression, BOOL fast_bands, unsigned workers) {
+	uint32_t adler = 0;
+
+	if (workers <= 1) {
+		auto write_chunk = [png_ptr](const uint8_t *data, size_t size) {
+			png_write_chunk(png_ptr, (png_const_bytep)"IDAT", data, size);
+		};
+		if (!DeflateRows(format, 0, format.height, compression, MAX_WBITS, FALSE, Z_FINISH, write_chunk, adler)) {
+			throw FI_MSG_ERROR_MEMORY;
+		}
+		// the image data were not written by libpng, end the file ourselves
+		png_write_chunk(png_ptr, (png_const_bytep)"IEND", nullptr, 0);
+		return;
+	}
+
+	const size_t filtered_size = format.rowbytes + 1;
+	const unsigned band_rows = (unsigned)MAX((size_t)1, (fast_bands ? PNG_BAND_SIZE_FAST : PNG_BAND_SIZE) / filtered_size);
+	const unsigned band_count = (format.height + band_rows - 1) / band_rows;
+
+	// zlib header (RFC 1950), with the level hint computed as deflate does
+
+	const int level = compression.level;
+	const int level_hint = ((level == Z_DEFAULT_COMPRESSION) || (level == 6)) ? 2 : ((level < 2) ? 0 : ((level < 6) ? 1 : 3));
+	unsigned header = ((Z_DEFLATED + ((MAX_WBITS - 8) << 4)) << 8) | (level_hint << 6);
+	header += 31 - (header % 31);
+
+	adler = zng_adler32(0, nullptr, 0);
+
+	std::vector<std::vector<uint8_t> > outputs(workers);
+	std::vector<uint32_t> adlers(workers);
+
+	// compress one band per worker at a time, so that memory use does not depend on the image size
+
+	for (unsigned wave = 0; wave < band_count; wave += workers) {
+		const unsigned wave_count = MIN(workers, band_count - wave);
+		std::vector<char> succeeded(wave_count, 0);
+
+		ParallelFor(0, wave_count, wave_count, 1, [&](unsigned band_first, unsigned band_last) {
+			for (unsigned i = band_first; i < band_last; i++) {
+				const unsigned band = wave + i;
+				const unsigned first = band * band_rows;
+				const unsigned last = MIN(format.height, first + band_rows);
+				std::vector<uint8_t>& data = outputs[i];
+				data.clear();
+				auto append = [&data](const uint8_t *compressed, size_t size) {
+					data.insert(data.end(), compressed, compressed + size);
+				};
+				succeeded[i] = DeflateRows(format, first, last, compression, -MAX_WBITS, !fast_bands, (band == band_count - 1) ? Z_FINISH : Z_SYNC_FLUSH, append, adlers[i]) ? 1 : 0;
+			}
+		});
+
+		for (unsigned i = 0; i < wave_count; i++) {
+			if (!succeeded[i]) {
+				throw FI_MSG_ERROR_MEMORY;
+			}
+			const unsigned band = wave + i;
+			const unsigned rows = MIN(format.height, (band + 1) * band_rows) - band * band_rows;
+			std::vector<uint8_t>& data = outputs[i];
+
+			adler = zng_adler32_combine(adler, adlers[i], (rows * filtered_size));
+
+			if (band == 0) {
+				const uint8_t cmf_flg[2] = { (uint8_t)(header >> 8), (uint8_t)(header & 0xFF) };
+				data.insert(data.begin(), cmf_flg, cmf_flg + 2);
+			}
+			if (band == band_count - 1) {
+				const uint8_t trailer[4] = { (uint8_t)(adler >> 24), (uint8_t)(adler >> 16), (uint8_t)(adler >> 8), (uint8_t)adler };
+				data.insert(data.end(), trailer, trailer + 4);
+			}
+			if (!data.empty()) {
+				png_write_chunk(png_ptr, (png_const_bytep)"IDAT", &data[0], data.size());
+			}
+		}
+	}
+
+	png_write_chunk(png_ptr, (png_const_bytep)"IEND", nullptr, 0);
+}
+
+/**
+Search the filters and deflate strategy giving the smallest image data (PNG_SAVE_SMALLEST). 
+Every candidate compresses the whole image, the candidates are tried on several threads when workers > 1.
+@param format Row layout, receives the best filters and heuristic
+@param compression Deflate settings, receives the best strategy
+@param workers Number of worker threads
+*/
+static void
+SearchSmallestEncoding(PNGRowFormat& format, PNGCompression& compression, unsigned workers) {
+	static const struct {
+		int filters;
+		PNGFilterHeuristic heuristic;
+		int strategy;
+	} candidates[] = {
+		{ PNG_FILTER_NONE, PNG_HEURISTIC_SAD, Z_DEFAULT_STRATEGY },
+		{ PNG_FILTER_SUB, PNG_HEURISTIC_SAD, Z_DEFAULT_STRATEGY },
+		{ PNG_FILTER_UP, PNG_HEURISTIC_SAD, Z_DEFAULT_STRATEGY },
+		{ PNG_FILTER_AVG, PNG_HEURISTIC_SAD, Z_DEFAULT_STRATEGY },
+		{ PNG_FILTER_PAETH, PNG_HEURISTIC_SAD, Z_DEFAULT_STRATEGY },
+		{ PNG_ALL_FILTERS, PNG_HEURISTIC_SAD, Z_DEFAULT_STRATEGY },
+		{ PNG_ALL_FILTERS, PNG_HEURISTIC_SAD, Z_FILTERED },
+		{ PNG_ALL_FILTERS, PNG_HEURISTIC_ENTROPY, Z_DEFAULT_STRATEGY },
+		{ PNG_ALL_FILTERS, PNG_HEURISTIC_ENTROPY, Z_FILTERED }
+	};
+	const unsigned count = (unsigned)(sizeof(candidates) / sizeof(candidates[0]));
+
+	std::vector<size_t> sizes(count, (size_t)-1);
+
+	ParallelFor(0, count, workers, 1, [&](unsigned first, unsigned last) {
+		for (unsigned i = first; i < last; i++) {
+			PNGRowFormat candidate_format = format;
+			candidate_format.filters = candidates[i].filters;
+			candidate_format.heuristic = candidates[i].heuristic;
+			PNGCompression candidate_compression = compression;
+			candidate_compression.strategy = candidates[i].strategy;
+
+			size_t size = 0;
+			uint32_t adler = 0;
+			auto count_bytes = [&size](const uint8_t *, size_t compressed_size) {
+				size += compressed_size;
+			};
+			if (DeflateRows(candidate_format, 0, format.height, candidate_compression, MAX_WBITS, FALSE, Z_FINISH, count_bytes, adler)) {
+				sizes[i] = size;
+			}
+		}
+	});
+
+	unsigned best = 0;
+	for (unsigned i = 1; i < count; i++) {
+		if (sizes[i] < sizes[best]) {
+			best = i;
+		}
+	}
+	format.filters = candidates[best].filters;
+	format.heuristic = candidates[best].heuristic;
+	compression.strategy = candidates[best].strategy;
+}
+
+// --------------------------------------------------------------------------
+
 static BOOL DLL_CALLCONV
 Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void *data) {
 	png_structp png_ptr = nullptr;
@@ -890,11 +1707,30 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 			if((zlib_level >= 1) && (zlib_level <= 9)) {
 				png_set_compression_level(png_ptr, zlib_level);
 			} else if((flags & PNG_Z_NO_COMPRESSION) == PNG_Z_NO_COMPRESSION) {
+				zlib_level = Z_NO_COMPRESSION;
 				png_set_compression_level(png_ptr, Z_NO_COMPRESSION);
+			} else {
+				zlib_level = Z_DEFAULT_COMPRESSION;
+			}
+
+			// save presets override the compression level
+			const BOOL save_fast = ((flags & PNG_SAVE_FAST) == PNG_SAVE_FAST);
+			const BOOL save_smallest = !save_fast && ((flags & PNG_SAVE_SMALLEST) == PNG_SAVE_SMALLEST);
+			int zlib_mem_level = 8;
+			if (save_fast) {
+				zlib_level = Z_BEST_SPEED;
+				png_set_compression_level(png_ptr, Z_BEST_SPEED);
+			} else if (save_smallest) {
+				zlib_level = Z_BEST_COMPRESSION;
+				zlib_mem_level = 9;
+				png_set_compression_level(png_ptr, Z_BEST_COMPRESSION);
+				png_set_compression_mem_level(png_ptr, 9);
 			}
 
 			// filtered strategy works better for high color images
-			if(pixel_depth >= 16){
+			int zlib_strategy = Z_DEFAULT_STRATEGY;
+			if((pixel_depth >= 16) && !save_fast){
+				zlib_strategy = Z_FILTERED;
 				png_set_compression_strategy(png_ptr, Z_FILTERED);
 				png_set_filter(png_ptr, 0, PNG_FILTER_NONE|PNG_FILTER_SUB|PNG_FILTER_PAETH);
 			} else {
@@ -1048,6 +1884,71 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 				number_passes = png_set_interlace_handling(png_ptr);
 			}
 
+			// describe the rows as libpng writes them
+
+			const size_t rowbytes = png_get_rowbytes(png_ptr, info_ptr);
+			// palettized and low bit depth images are not filtered by default
+			const BOOL filterable = (png_get_color_type(png_ptr, info_ptr) != PNG_COLOR_TYPE_PALETTE) && (bit_depth >= 8);
+
+			PNGRowFormat format;
+			format.dib = dib;
+			format.width = width;
+			format.height = height;
+			format.rowbytes = rowbytes;
+			format.bpp = MAX(1U, (unsigned)(png_get_channels(png_ptr, info_ptr) * bit_depth) / 8);
+			// same filters as libpng: the ones set above, or all of them for filterable images
+			format.filters = !filterable ? PNG_FILTER_NONE : ((pixel_depth >= 16) ? (PNG_FILTER_NONE | PNG_FILTER_SUB | PNG_FILTER_PAETH) : PNG_ALL_FILTERS);
+			format.heuristic = PNG_HEURISTIC_SAD;
+			format.strip_alpha = (pixel_depth == 32) && !has_alpha_channel;
+#if FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR
+			format.swap_rgb = (image_type == FIT_BITMAP) && (pixel_depth >= 24);
+#else
+			format.swap_rgb = FALSE;
+#endif
+#ifndef FREEIMAGE_BIGENDIAN
+			format.swap_16 = (bit_depth == 16);
+#else
+			format.swap_16 = FALSE;
+#endif
+			// png_set_invert_mono was called above for opaque min-is-white images
+			format.invert = (FreeImage_GetColorType(dib) == FIC_MINISWHITE) && !bIsTransparent;
+
+			PNGCompression compression;
+			compression.level = zlib_level;
+			compression.strategy = zlib_strategy;
+			compression.mem_level = zlib_mem_level;
+
+			if (save_fast) {
+				// a single filter needs no per-row filter choice
+				format.filters = filterable ? PNG_FILTER_SUB : PNG_FILTER_NONE;
+				png_set_filter(png_ptr, 0, format.filters);
+			} else if (save_smallest && filterable) {
+				format.filters = PNG_ALL_FILTERS;
+				png_set_filter(png_ptr, 0, PNG_ALL_FILTERS);
+			}
+
+			// split the image data between worker threads when asked to (and when the image is large enough), 
+			// search the smallest encoding with PNG_SAVE_SMALLEST
+
+			const BOOL own_encoder = !bInterlaced && (FreeImage_GetColorType(dib) != FIC_CMYK);
+			const unsigned workers = own_encoder ? GetWorkerCount((flags & PNG_MULTITHREADED) == PNG_MULTITHREADED) : 1;
+			const BOOL multithreaded = ((flags & PNG_MULTITHREADED) == PNG_MULTITHREADED) && (workers > 1) && (rowbytes * height > PNG_BAND_SIZE_FAST);
+
+			if (own_encoder && (save_smallest || multithreaded)) {
+				if (save_smallest) {
+					SearchSmallestEncoding(format, compression, workers);
+				}
+
+				WriteImageData(png_ptr, format, compression, ((flags & PNG_MULTITHREADED_FAST) == PNG_MULTITHREADED_FAST), multithreaded ? workers : 1);
+
+				if (palette) {
+					png_free(png_ptr, palette);
+				}
+				png_destroy_write_struct(&png_ptr, &info_ptr);
+
+				return TRUE;
+			}
+
 			if ((pixel_depth == 32) && (!has_alpha_channel)) {
 				uint8_t *buffer = (uint8_t *)malloc(width * 3);
 
@@ -1055,7 +1956,7 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 				// the number of passes is either 1 for non-interlaced images, or 7 for interlaced images
 				for (int pass = 0; pass < number_passes; pass++) {
 					for (png_uint_32 k = 0; k < height; k++) {
-						FreeImage_ConvertLine32To24(buffer, FreeImage_GetScanLine(dib, height - k - 1), width);
+						FreeImage_ConvertLine32To24(buffer, (uint8_t*)FreeImage_GetConstScanLine(dib, height - k - 1), width);
 						png_write_row(png_ptr, buffer);
 					}
 				}
@@ -1064,7 +1965,7 @@ Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void
 				// the number of passes is either 1 for non-interlaced images, or 7 for interlaced images
 				for (int pass = 0; pass < number_passes; pass++) {
 					for (png_uint_32 k = 0; k < height; k++) {
-						png_write_row(png_ptr, FreeImage_GetScanLine(dib, height - k - 1));
+						png_write_row(png_ptr, FreeImage_GetConstScanLine(dib, height - k - 1));
 					}
 				}
 			}
@@ -1113,9 +2014,13 @@ InitPNG(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = Save;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
 	plugin->supports_icc_profiles_proc = SupportsICCProfiles;
 	plugin->supports_no_pixels_proc = SupportsNoPixels;
+	plugin->open_scanline_reader_proc = OpenScanlineReader;
+	plugin->read_next_scanline_proc = ReadNextScanline;
+	plugin->close_scanline_reader_proc = CloseScanlineReader;
 }
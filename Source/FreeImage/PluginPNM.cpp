@@ -186,6 +186,28 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return FALSE;
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t pbm_id1[] = { 0x50, 0x31 };
+	static const uint8_t pbm_id2[] = { 0x50, 0x34 };
+	static const uint8_t pgm_id1[] = { 0x50, 0x32 };
+	static const uint8_t pgm_id2[] = { 0x50, 0x35 };
+	static const uint8_t ppm_id1[] = { 0x50, 0x33 };
+	static const uint8_t ppm_id2[] = { 0x50, 0x36 };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(pbm_id1), pbm_id1, nullptr },
+		{ 0, sizeof(pbm_id2), pbm_id2, nullptr },
+		{ 0, sizeof(pgm_id1), pgm_id1, nullptr },
+		{ 0, sizeof(pgm_id2), pgm_id2, nullptr },
+		{ 0, sizeof(ppm_id1), ppm_id1, nullptr },
+		{ 0, sizeof(ppm_id2), ppm_id2, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return (
@@ -830,6 +852,7 @@ InitPNM(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = Save;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
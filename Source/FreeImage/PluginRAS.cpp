@@ -173,6 +173,18 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return (memcmp(ras_signature, signature, sizeof(ras_signature)) == 0);
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t ras_signature[] = { 0x59, 0xA6, 0x6A, 0x95 };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(ras_signature), ras_signature, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return FALSE;
@@ -504,6 +516,7 @@ InitRAS(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = nullptr;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
@@ -700,6 +700,18 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 			throw "LibRaw : failed to open input stream (unknown format)";
 		}
 
+		// size hint: decode at 50% size when the result is still large enough
+		const int requested_size = flags >> 16;
+		if((requested_size > 0) && !header_only) {
+			const int max_size = MAX(RawProcessor->imgdata.sizes.width, RawProcessor->imgdata.sizes.height);
+			if((max_size + 1) / 2 >= requested_size) {
+				RawProcessor->imgdata.params.half_size = 1;
+			}
+		}
+		// when an 8-bit image is needed, the embedded preview is enough if it is large enough
+		const BOOL use_preview = (requested_size > 0) && 
+			(MAX(RawProcessor->imgdata.thumbnail.twidth, RawProcessor->imgdata.thumbnail.theight) >= requested_size);
+
 		if(header_only) {
 			// header only mode
 			dib = FreeImage_AllocateHeaderT(header_only, FIT_RGB16, RawProcessor->imgdata.sizes.width, RawProcessor->imgdata.sizes.height);
@@ -709,16 +721,26 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 			dib = libraw_LoadUnprocessedData(RawProcessor);
 		}
 		else if((flags & RAW_PREVIEW) == RAW_PREVIEW) {
-			// try to get the embedded JPEG
-			dib = libraw_LoadEmbeddedPreview(RawProcessor, 0);
+			// try to get the embedded JPEG (reduced by the JPEG codec if a size hint was given)
+			dib = libraw_LoadEmbeddedPreview(RawProcessor, requested_size << 16);
 			if(!dib) {
 				// no JPEG preview: try to load as 8-bit/sample (i.e. RGB 24-bit)
 				dib = libraw_LoadRawData(RawProcessor, 8);
 			}
 		} 
 		else if((flags & RAW_DISPLAY) == RAW_DISPLAY) {
-			// load raw data as 8-bit/sample (i.e. RGB 24-bit)
-			dib = libraw_LoadRawData(RawProcessor, 8);
+			if(use_preview) {
+				// the embedded preview is large enough for the size hint
+				dib = libraw_LoadEmbeddedPreview(RawProcessor, requested_size << 16);
+				if(dib && (FreeImage_GetImageType(dib) != FIT_BITMAP || FreeImage_GetBPP(dib) != 24)) {
+					FreeImage_Unload(dib);
+					dib = nullptr;
+				}
+			}
+			if(!dib) {
+				// load raw data as 8-bit/sample (i.e. RGB 24-bit)
+				dib = libraw_LoadRawData(RawProcessor, 8);
+			}
 		} 
 		else {
 			// default: load raw data as linear 16-bit/sample (i.e. RGB 48-bit)
@@ -201,6 +201,18 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return (memcmp(sgi_signature, signature, sizeof(sgi_signature)) == 0);
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t sgi_signature[] = { 0x01, 0xDA };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(sgi_signature), sgi_signature, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
   return FALSE;
@@ -417,6 +429,7 @@ InitSGI(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = nullptr;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
@@ -37,6 +37,7 @@
 
 #include "FreeImage.h"
 #include "Utilities.h"
+#include "Threading.h"
 
 #include <tiffio.h>
 #include <tiffiop.h>
@@ -48,6 +49,9 @@
 #include "FreeImageIO.h"
 #include "PSDParser.h"
 
+#include <atomic>
+#include <mutex>
+
 // --------------------------------------------------------------------------
 // GeoTIFF profile (see XTIFF.cpp)
 // --------------------------------------------------------------------------
@@ -65,7 +69,7 @@ int tiff_write_exif_tags(TIFF *tif, TagLib::MDMODEL md_model, FIBITMAP *dib);
 //   LogLuv conversion functions interface (see TIFFLogLuv.cpp)
 // --------------------------------------------------------------------------
 void tiff_ConvertLineXYZToRGB(uint8_t *target, uint8_t *source, double stonits, int width_in_pixels);
-void tiff_ConvertLineRGBToXYZ(uint8_t *target, uint8_t *source, int width_in_pixels);
+void tiff_ConvertLineRGBToXYZ(uint8_t *target, const uint8_t *source, int width_in_pixels);
 
 // ----------------------------------------------------------
 
@@ -150,8 +154,8 @@ _tiffWriteProc(thandle_t handle, void *buf, tmsize_t size) {
 static toff_t
 _tiffSeekProc(thandle_t handle, toff_t off, int whence) {
 	fi_TIFFIO *fio = (fi_TIFFIO*)handle;
-	fio->io->seek_proc(fio->handle, (long)off, whence);
-	return fio->io->tell_proc(fio->handle);
+	IOSeek64(fio->io, fio->handle, (int64_t)off, whence);
+	return (toff_t)IOTell64(fio->io, fio->handle);
 }
 
 static int
@@ -164,11 +168,11 @@ _tiffCloseProc(thandle_t fd) {
 static toff_t
 _tiffSizeProc(thandle_t handle) {
     fi_TIFFIO *fio = (fi_TIFFIO*)handle;
-    long currPos = fio->io->tell_proc(fio->handle);
-    fio->io->seek_proc(fio->handle, 0, SEEK_END);
-    long fileSize = fio->io->tell_proc(fio->handle);
-    fio->io->seek_proc(fio->handle, currPos, SEEK_SET);
-    return fileSize;
+    const int64_t currPos = IOTell64(fio->io, fio->handle);
+    IOSeek64(fio->io, fio->handle, 0, SEEK_END);
+    const int64_t fileSize = IOTell64(fio->io, fio->handle);
+    IOSeek64(fio->io, fio->handle, currPos, SEEK_SET);
+    return (toff_t)fileSize;
 }
 
 static int
@@ -280,6 +284,8 @@ TIFFErrorHandler _TIFFerrorHandler = msdosErrorHandler;
 #define CVT(x)      (((x) * 255L) / ((1L<<16)-1))
 #define	SCALE(x)	(((x)*((1L<<16)-1))/255)
 
+#define TIFF_TILE_SIZE	256	// tile width and height used when saving tiled images (must be a multiple of 16)
+
 // ==========================================================
 // Internal functions
 // ==========================================================
@@ -678,12 +684,14 @@ WriteCompression(TIFF *tiff, uint16_t bitspersample, uint16_t samplesperpixel, u
 	} else if ((flags & TIFF_JPEG) == TIFF_JPEG) {
 		if(((bitsperpixel == 8) && (photometric != PHOTOMETRIC_PALETTE)) || (bitsperpixel == 24)) {
 			compression = COMPRESSION_JPEG;
-			// RowsPerStrip must be multiple of 8 for JPEG
-			uint32_t rowsperstrip = (uint32_t) -1;
-			rowsperstrip = TIFFDefaultStripSize(tiff, rowsperstrip);
-            rowsperstrip = rowsperstrip + (8 - (rowsperstrip % 8));
-			// overwrite previous RowsPerStrip
-			TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, rowsperstrip);
+			if(!TIFFIsTiled(tiff)) {
+				// RowsPerStrip must be multiple of 8 for JPEG
+				uint32_t rowsperstrip = (uint32_t) -1;
+				rowsperstrip = TIFFDefaultStripSize(tiff, rowsperstrip);
+				rowsperstrip = rowsperstrip + (8 - (rowsperstrip % 8));
+				// overwrite previous RowsPerStrip
+				TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, rowsperstrip);
+			}
 		} else {
 			// default to LZW
 			compression = COMPRESSION_LZW;
@@ -740,10 +748,12 @@ WriteCompression(TIFF *tiff, uint16_t bitspersample, uint16_t samplesperpixel, u
 		}
 	}
 	else if((compression == COMPRESSION_CCITTFAX3) || (compression == COMPRESSION_CCITTFAX4)) {
-		uint32_t imageLength = 0;
-		TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &imageLength);
-		// overwrite previous RowsPerStrip
-		TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, imageLength);
+		if(!TIFFIsTiled(tiff)) {
+			uint32_t imageLength = 0;
+			TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &imageLength);
+			// overwrite previous RowsPerStrip
+			TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, imageLength);
+		}
 
 		if(compression == COMPRESSION_CCITTFAX3) {
 			// try to be compliant with the TIFF Class F specification
@@ -831,7 +841,7 @@ tiff_read_exif_profile(FreeImageIO *io, fi_handle handle, TIFF *tiff, FIBITMAP *
 	// get the IFD offset
 	if(TIFFGetField(tiff, TIFFTAG_EXIFIFD, &exif_offset)) {
 
-		const long tell_pos = io->tell_proc(handle);
+		const int64_t tell_pos = IOTell64(io, handle);
 		const uint16_t cur_dir = TIFFCurrentDirectory(tiff);
 
 		// read EXIF tags
@@ -840,7 +850,7 @@ tiff_read_exif_profile(FreeImageIO *io, fi_handle handle, TIFF *tiff, FIBITMAP *
 			bResult = tiff_read_exif_tags(tiff, TagLib::EXIF_EXIF, dib);
 		}
 
-		io->seek_proc(handle, tell_pos, SEEK_SET);
+		IOSeek64(io, handle, tell_pos, SEEK_SET);
 		TIFFSetDirectory(tiff, cur_dir);
 	}
 
@@ -1009,6 +1019,24 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return FALSE;
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	static const uint8_t tiff_id1[] = { 0x49, 0x49, 0x2A, 0x00 };	// Classic TIFF, little-endian
+	static const uint8_t tiff_id2[] = { 0x4D, 0x4D, 0x00, 0x2A };	// Classic TIFF, big-endian
+	static const uint8_t tiff_id3[] = { 0x49, 0x49, 0x2B, 0x00 };	// Big TIFF, little-endian
+	static const uint8_t tiff_id4[] = { 0x4D, 0x4D, 0x00, 0x2B };	// Big TIFF, big-endian
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(tiff_id1), tiff_id1, nullptr },
+		{ 0, sizeof(tiff_id2), tiff_id2, nullptr },
+		{ 0, sizeof(tiff_id3), tiff_id3, nullptr },
+		{ 0, sizeof(tiff_id4), tiff_id4, nullptr }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return (
@@ -1228,6 +1256,713 @@ FindLoadMethod(TIFF *tif, FREE_IMAGE_TYPE image_type, int flags) {
 	return loadMethod;
 }
 
+// ==========================================================
+// Multithreaded strip / tile decoding
+// ==========================================================
+
+/**
+FreeImageIO shared by the worker TIFF handles: accesses are serialized, 
+while each worker keeps its own file position
+*/
+typedef struct {
+	FreeImageIO *io;
+	fi_handle handle;
+	std::mutex lock;
+} fi_TIFFSharedIO;
+
+typedef struct {
+	fi_TIFFSharedIO *shared;
+	toff_t offset;
+} fi_TIFFWorkerIO;
+
+static tmsize_t 
+_tiffWorkerReadProc(thandle_t handle, void *buf, tmsize_t size) {
+	fi_TIFFWorkerIO *wio = (fi_TIFFWorkerIO*)handle;
+	std::lock_guard<std::mutex> guard(wio->shared->lock);
+	IOSeek64(wio->shared->io, wio->shared->handle, (int64_t)wio->offset, SEEK_SET);
+	const tmsize_t count = wio->shared->io->read_proc(buf, (unsigned)size, 1, wio->shared->handle) * size;
+	wio->offset += count;
+	return count;
+}
+
+static tmsize_t
+_tiffWorkerWriteProc(thandle_t handle, void *buf, tmsize_t size) {
+	return 0;
+}
+
+static toff_t
+_tiffWorkerSizeProc(thandle_t handle) {
+	fi_TIFFWorkerIO *wio = (fi_TIFFWorkerIO*)handle;
+	std::lock_guard<std::mutex> guard(wio->shared->lock);
+	IOSeek64(wio->shared->io, wio->shared->handle, 0, SEEK_END);
+	return (toff_t)IOTell64(wio->shared->io, wio->shared->handle);
+}
+
+static toff_t
+_tiffWorkerSeekProc(thandle_t handle, toff_t off, int whence) {
+	fi_TIFFWorkerIO *wio = (fi_TIFFWorkerIO*)handle;
+	switch(whence) {
+		case SEEK_SET:
+			wio->offset = off;
+			break;
+		case SEEK_CUR:
+			wio->offset += off;
+			break;
+		case SEEK_END:
+			wio->offset = _tiffWorkerSizeProc(handle) + off;
+			break;
+	}
+	return wio->offset;
+}
+
+/**
+Decode the chunks [0, count) of the current directory, a chunk being a block of strips or a row of tiles. 
+The chunk decoder is called as body(TIFF *tiff, uint32_t chunk, uint8_t *buffer) and returns FALSE on a read error. 
+When several workers are requested, each of them opens its own TIFF handle on the current directory 
+and decodes a band of chunks into its own buffer: the body must only write to the destination 
+rows of its chunk. Bands whose worker cannot be set up are decoded afterwards on the calling thread.
+@param fio TIFF plugin context
+@param tif TIFF handle, positioned on the directory to decode
+@param count Number of chunks
+@param buffer Decoding buffer used with tif
+@param buffer_size Size of the decoding buffer, in bytes
+@param workers Number of worker threads to use
+@param body Chunk decoder
+@return Returns TRUE if all chunks were decoded without error, returns FALSE otherwise
+*/
+template <class Body> static BOOL
+DecodeChunks(fi_TIFFIO *fio, TIFF *tif, uint32_t count, uint8_t *buffer, tmsize_t buffer_size, unsigned workers, Body body) {
+	std::atomic<bool> bResult(true);
+
+	if((workers <= 1) || (count < 2)) {
+		for(uint32_t chunk = 0; chunk < count; chunk++) {
+			if(!body(tif, chunk, buffer)) {
+				bResult = false;
+			}
+		}
+		return bResult ? TRUE : FALSE;
+	}
+
+	fi_TIFFSharedIO shared;
+	shared.io = fio->io;
+	shared.handle = fio->handle;
+
+	const uint64_t dir_offset = TIFFCurrentDirOffset(tif);
+	const int64_t tell_pos = IOTell64(fio->io, fio->handle);
+
+	std::mutex failed_lock;
+	std::vector<std::pair<uint32_t, uint32_t> > failed;
+
+	ParallelFor(0, count, workers, 1, [&](uint32_t first, uint32_t last) {
+		fi_TIFFWorkerIO wio = { &shared, 0 };
+
+		TIFF *worker = TIFFClientOpen("", "r", (thandle_t)&wio, 
+			_tiffWorkerReadProc, _tiffWorkerWriteProc, _tiffWorkerSeekProc, _tiffCloseProc,
+			_tiffWorkerSizeProc, _tiffMapProc, _tiffUnmapProc);
+		uint8_t *worker_buffer = (uint8_t*)calloc(buffer_size, sizeof(uint8_t));
+
+		if(worker && worker_buffer && TIFFSetSubDirectory(worker, dir_offset)) {
+			for(uint32_t chunk = first; chunk < last; chunk++) {
+				if(!body(worker, chunk, worker_buffer)) {
+					bResult = false;
+				}
+			}
+		} else {
+			std::lock_guard<std::mutex> guard(failed_lock);
+			failed.push_back(std::make_pair(first, last));
+		}
+
+		free(worker_buffer);
+		if(worker) {
+			TIFFClose(worker);
+		}
+	});
+
+	// decode the remaining bands on the calling thread
+	for(size_t i = 0; i < failed.size(); i++) {
+		for(uint32_t chunk = failed[i].first; chunk < failed[i].second; chunk++) {
+			if(!body(tif, chunk, buffer)) {
+				bResult = false;
+			}
+		}
+	}
+
+	IOSeek64(fio->io, fio->handle, tell_pos, SEEK_SET);
+
+	return bResult ? TRUE : FALSE;
+}
+
+// ==========================================================
+// Multithreaded strip / tile encoding
+// ==========================================================
+
+/**
+Output of a private strip encoder: 
+bytes written by libtiff are appended to 'data', the file itself is never stored
+*/
+typedef struct tagTIFFStripSink {
+	TIFF *tif;
+	std::vector<uint8_t> data;
+	toff_t size;
+} fi_TIFFStripSink;
+
+static tmsize_t
+_tiffSinkReadProc(thandle_t handle, void *buf, tmsize_t size) {
+	return 0;
+}
+
+static tmsize_t
+_tiffSinkWriteProc(thandle_t handle, void *buf, tmsize_t size) {
+	fi_TIFFStripSink *sink = (fi_TIFFStripSink*)handle;
+	sink->data.insert(sink->data.end(), (uint8_t*)buf, (uint8_t*)buf + size);
+	sink->size += size;
+	return size;
+}
+
+static toff_t
+_tiffSinkSeekProc(thandle_t handle, toff_t off, int whence) {
+	// libtiff only seeks to the end of the file before appending a strip
+	fi_TIFFStripSink *sink = (fi_TIFFStripSink*)handle;
+	return (whence == SEEK_END) ? sink->size + off : off;
+}
+
+static toff_t
+_tiffSinkSizeProc(thandle_t handle) {
+	return ((fi_TIFFStripSink*)handle)->size;
+}
+
+/**
+Scanline writer used by SaveOneTIFF: scanlines must be written in order through WriteScanline. 
+Scanlines are gathered into bands (a strip or a row of tiles) that are cut into chunks (strips or tiles). 
+When several workers are used, bands are gathered into batches, the chunks of a batch 
+are compressed in parallel by private libtiff encoders and the compressed chunks are then 
+appended in order with TIFFWriteRawStrip / TIFFWriteRawTile. The resulting file is a regular TIFF. 
+Otherwise, scanlines of a stripped image are passed to TIFFWriteScanline 
+and tiles of a tiled image are written with TIFFWriteEncodedTile.
+*/
+class TIFFScanlineWriter {
+public:
+	/**
+	@param tif TIFF handle whose tags (including the compression and tile tags) have all been set
+	@param workers Number of worker threads to use
+	*/
+	TIFFScanlineWriter(TIFF *tif, unsigned workers);
+	~TIFFScanlineWriter();
+
+	/**
+	Write the next scanline
+	@param buffer Scanline data, in TIFF layout
+	@param row Scanline index (0 being the top of the image)
+	*/
+	void WriteScanline(void *buffer, uint32_t row);
+
+	/**
+	Encode and write the pending strips or tiles
+	@return Returns TRUE if all scanlines were written without error, returns FALSE otherwise
+	*/
+	BOOL Flush();
+
+private:
+	fi_TIFFStripSink* AcquireEncoder();
+	void ReleaseEncoder(fi_TIFFStripSink *sink);
+	BOOL EncodeChunk(TIFF *tif, uint32_t chunk, uint8_t *scratch);
+	void EncodeBatch();
+
+	TIFF *_tif;
+	unsigned _workers;
+	BOOL _error;
+	BOOL _tiled;
+	uint16_t _compression;
+	uint32_t _width;
+	uint32_t _height;
+	tmsize_t _lineSize;
+	// band geometry
+	uint32_t _bandRows;
+	uint32_t _chunksPerBand;
+	tmsize_t _chunkSize;
+	tmsize_t _tileRowSize;
+	// current batch of bands
+	uint8_t *_batch;
+	uint32_t _batchBands;
+	uint32_t _firstBand;
+	uint32_t _pendingRows;
+	std::vector<std::vector<uint8_t> > _encoded;
+	// private encoders
+	std::mutex _lock;
+	std::vector<fi_TIFFStripSink*> _encoders;
+	std::vector<fi_TIFFStripSink*> _idle;
+};
+
+TIFFScanlineWriter::TIFFScanlineWriter(TIFF *tif, unsigned workers) 
+: _tif(tif), _workers(1), _error(FALSE), _tiled(FALSE), _compression(COMPRESSION_NONE), _width(0), _height(0), _lineSize(0),
+_bandRows(0), _chunksPerBand(1), _chunkSize(0), _tileRowSize(0), 
+_batch(nullptr), _batchBands(0), _firstBand(0), _pendingRows(0) {
+
+	TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &_width);
+	TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &_height);
+	TIFFGetField(tif, TIFFTAG_COMPRESSION, &_compression);
+	_lineSize = TIFFScanlineSize(tif);
+	_tiled = TIFFIsTiled(tif) ? TRUE : FALSE;
+
+	if(_tiled) {
+		uint32_t tileWidth = 0;
+		TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tileWidth);
+		TIFFGetField(tif, TIFFTAG_TILELENGTH, &_bandRows);
+		_chunksPerBand = (_width + tileWidth - 1) / tileWidth;
+		_chunkSize = TIFFTileSize(tif);
+		_tileRowSize = TIFFTileRowSize(tif);
+	} else {
+		TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &_bandRows);
+		_bandRows = MAX<uint32_t>(1, MIN(_bandRows, _height));
+		_chunkSize = _bandRows * _lineSize;
+	}
+
+	// only codecs whose chunks do not depend on pseudo-tags or on the other chunks are handled
+	switch(_compression) {
+		case COMPRESSION_LZW:
+		case COMPRESSION_DEFLATE:
+		case COMPRESSION_ADOBE_DEFLATE:
+		case COMPRESSION_PACKBITS:
+		case COMPRESSION_JPEG:
+			break;
+		default:
+			workers = 1;
+			break;
+	}
+
+	const uint32_t bandCount = (_height + _bandRows - 1) / _bandRows;
+	const uint64_t bandSize = (uint64_t)_bandRows * _lineSize;
+
+	if((workers > 1) && (bandCount * _chunksPerBand > 1)) {
+		// gather enough chunks to keep the workers busy (at least 4 MB of raw data)
+		const uint32_t minBands = (4 * workers + _chunksPerBand - 1) / _chunksPerBand;
+		_batchBands = (uint32_t)MIN<uint64_t>(bandCount, MAX<uint64_t>(minBands, (4 << 20) / MAX<uint64_t>(1, bandSize)));
+		_batch = (uint8_t*)malloc((size_t)(_batchBands * bandSize));
+		_encoded.resize(_batchBands * _chunksPerBand);
+
+		// check that a private encoder can be set up
+		fi_TIFFStripSink *sink = _batch ? AcquireEncoder() : nullptr;
+		if(sink) {
+			ReleaseEncoder(sink);
+			_workers = workers;
+		}
+	}
+
+	if(_workers <= 1) {
+		free(_batch);
+		_batch = nullptr;
+		_encoded.clear();
+
+		if(_tiled) {
+			// tiles are written one row of tiles at a time
+			_batchBands = 1;
+			_batch = (uint8_t*)malloc((size_t)bandSize);
+			if(!_batch) {
+				_error = TRUE;
+			}
+		}
+	}
+}
+
+TIFFScanlineWriter::~TIFFScanlineWriter() {
+	for(size_t i = 0; i < _encoders.size(); i++) {
+		TIFFCleanup(_encoders[i]->tif);
+		delete _encoders[i];
+	}
+	free(_batch);
+}
+
+/**
+Get an idle private encoder, create one if needed. 
+Returns nullptr if the encoder could not be created
+*/
+fi_TIFFStripSink* 
+TIFFScanlineWriter::AcquireEncoder() {
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		if(!_idle.empty()) {
+			fi_TIFFStripSink *sink = _idle.back();
+			_idle.pop_back();
+			return sink;
+		}
+	}
+
+	fi_TIFFStripSink *sink = new(std::nothrow) fi_TIFFStripSink;
+	if(!sink) {
+		return nullptr;
+	}
+	sink->size = 0;
+	sink->tif = TIFFClientOpen("", TIFFIsBigEndian(_tif) ? "wb" : "wl", (thandle_t)sink, 
+		_tiffSinkReadProc, _tiffSinkWriteProc, _tiffSinkSeekProc, _tiffCloseProc,
+		_tiffSinkSizeProc, _tiffMapProc, _tiffUnmapProc);
+	if(!sink->tif) {
+		delete sink;
+		return nullptr;
+	}
+
+	// copy the tags used by the encoder
+
+	TIFF *tif = sink->tif;
+	uint32_t u32 = 0;
+	uint16_t u16 = 0;
+	int value = 0;
+
+	TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, _width);
+	TIFFSetField(tif, TIFFTAG_IMAGELENGTH, _height);
+	if(_tiled) {
+		TIFFGetField(_tif, TIFFTAG_TILEWIDTH, &u32);
+		TIFFSetField(tif, TIFFTAG_TILEWIDTH, u32);
+		TIFFSetField(tif, TIFFTAG_TILELENGTH, _bandRows);
+	} else {
+		TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, _bandRows);
+	}
+	TIFFGetFieldDefaulted(_tif, TIFFTAG_BITSPERSAMPLE, &u16);
+	TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, u16);
+	TIFFGetFieldDefaulted(_tif, TIFFTAG_SAMPLESPERPIXEL, &u16);
+	TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, u16);
+	TIFFGetFieldDefaulted(_tif, TIFFTAG_SAMPLEFORMAT, &u16);
+	TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, u16);
+	TIFFGetField(_tif, TIFFTAG_PHOTOMETRIC, &u16);
+	TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, u16);
+	TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+	TIFFGetFieldDefaulted(_tif, TIFFTAG_FILLORDER, &u16);
+	TIFFSetField(tif, TIFFTAG_FILLORDER, u16);
+	TIFFSetField(tif, TIFFTAG_COMPRESSION, _compression);
+
+	switch(_compression) {
+		case COMPRESSION_LZW:
+		case COMPRESSION_DEFLATE:
+		case COMPRESSION_ADOBE_DEFLATE:
+			if(TIFFGetField(_tif, TIFFTAG_PREDICTOR, &u16)) {
+				TIFFSetField(tif, TIFFTAG_PREDICTOR, u16);
+			}
+			if((_compression != COMPRESSION_LZW) && TIFFGetField(_tif, TIFFTAG_ZIPQUALITY, &value)) {
+				TIFFSetField(tif, TIFFTAG_ZIPQUALITY, value);
+			}
+			break;
+		case COMPRESSION_JPEG:
+			if(TIFFGetField(_tif, TIFFTAG_JPEGQUALITY, &value)) {
+				TIFFSetField(tif, TIFFTAG_JPEGQUALITY, value);
+			}
+			if(TIFFGetField(_tif, TIFFTAG_JPEGCOLORMODE, &value)) {
+				TIFFSetField(tif, TIFFTAG_JPEGCOLORMODE, value);
+			}
+			if(TIFFGetField(_tif, TIFFTAG_JPEGTABLESMODE, &value)) {
+				TIFFSetField(tif, TIFFTAG_JPEGTABLESMODE, value);
+			}
+			break;
+	}
+
+	std::lock_guard<std::mutex> guard(_lock);
+	_encoders.push_back(sink);
+
+	return sink;
+}
+
+void 
+TIFFScanlineWriter::ReleaseEncoder(fi_TIFFStripSink *sink) {
+	std::lock_guard<std::mutex> guard(_lock);
+	_idle.push_back(sink);
+}
+
+void 
+TIFFScanlineWriter::WriteScanline(void *buffer, uint32_t row) {
+	if((_workers <= 1) && !_tiled) {
+		if(TIFFWriteScanline(_tif, buffer, row, 0) == -1) {
+			_error = TRUE;
+		}
+		return;
+	}
+	if(!_batch) {
+		return;
+	}
+
+	memcpy(_batch + _pendingRows * _lineSize, buffer, _lineSize);
+	_pendingRows++;
+
+	if((_pendingRows == _batchBands * _bandRows) || (row + 1 == _height)) {
+		EncodeBatch();
+	}
+}
+
+/**
+Encode a strip or a tile of the current batch
+@param tif TIFF handle receiving the encoded chunk
+@param chunk Index of the chunk in the current batch
+@param scratch Tile buffer (tiled images only)
+*/
+BOOL 
+TIFFScanlineWriter::EncodeChunk(TIFF *tif, uint32_t chunk, uint8_t *scratch) {
+	const uint32_t band = chunk / _chunksPerBand;
+	const uint32_t column = chunk % _chunksPerBand;
+	const uint32_t rows = MIN(_bandRows, _pendingRows - band * _bandRows);
+	uint8_t *bits = _batch + band * _bandRows * _lineSize;
+
+	if(!_tiled) {
+		return (TIFFWriteEncodedStrip(tif, _firstBand + band, bits, rows * _lineSize) != -1) ? TRUE : FALSE;
+	}
+
+	// cut the tile out of the band (partial tiles are padded with zeros)
+
+	const tmsize_t offset = column * _tileRowSize;
+	const tmsize_t size = MIN(_tileRowSize, _lineSize - offset);
+
+	memset(scratch, 0, _chunkSize);
+	for(uint32_t y = 0; y < rows; y++) {
+		memcpy(scratch + y * _tileRowSize, bits + y * _lineSize + offset, size);
+	}
+
+	return (TIFFWriteEncodedTile(tif, (_firstBand + band) * _chunksPerBand + column, scratch, _chunkSize) != -1) ? TRUE : FALSE;
+}
+
+/**
+Compress the chunks of the current batch and append them to the file in order
+*/
+void 
+TIFFScanlineWriter::EncodeBatch() {
+	if(_pendingRows == 0) {
+		return;
+	}
+
+	const uint32_t bandCount = (_pendingRows + _bandRows - 1) / _bandRows;
+	const uint32_t chunkCount = bandCount * _chunksPerBand;
+
+	if(_workers <= 1) {
+		// tiles of a single-threaded tiled image
+		uint8_t *scratch = (uint8_t*)malloc(_chunkSize);
+		for(uint32_t i = 0; (i < chunkCount) && scratch; i++) {
+			if(!EncodeChunk(_tif, i, scratch)) {
+				_error = TRUE;
+			}
+		}
+		if(!scratch) {
+			_error = TRUE;
+		}
+		free(scratch);
+
+		_firstBand += bandCount;
+		_pendingRows = 0;
+		return;
+	}
+
+	std::atomic<bool> bResult(true);
+
+	ParallelFor(0, chunkCount, _workers, 1, [&](unsigned first, unsigned last) {
+		fi_TIFFStripSink *sink = AcquireEncoder();
+		uint8_t *scratch = _tiled ? (uint8_t*)malloc(_chunkSize) : nullptr;
+		if(!sink || (_tiled && !scratch)) {
+			bResult = false;
+		} else {
+			for(unsigned i = first; i < last; i++) {
+				sink->data.clear();
+				if(!EncodeChunk(sink->tif, i, scratch)) {
+					bResult = false;
+				}
+				_encoded[i].swap(sink->data);
+			}
+		}
+		free(scratch);
+		if(sink) {
+			ReleaseEncoder(sink);
+		}
+	});
+
+	if(bResult && (_compression == COMPRESSION_JPEG) && (_firstBand == 0)) {
+		// chunks are abbreviated JPEG streams: all encoders share the same tables
+		for(size_t i = 0; i < _encoders.size(); i++) {
+			uint32_t count = 0;
+			void *tables = nullptr;
+			if(TIFFGetField(_encoders[i]->tif, TIFFTAG_JPEGTABLES, &count, &tables) && count && tables) {
+				TIFFSetField(_tif, TIFFTAG_JPEGTABLES, count, tables);
+				break;
+			}
+		}
+	}
+
+	const uint32_t firstChunk = _firstBand * _chunksPerBand;
+
+	for(uint32_t i = 0; i < chunkCount; i++) {
+		if(bResult) {
+			const tmsize_t written = _tiled ? 
+				TIFFWriteRawTile(_tif, firstChunk + i, _encoded[i].data(), (tmsize_t)_encoded[i].size()) :
+				TIFFWriteRawStrip(_tif, firstChunk + i, _encoded[i].data(), (tmsize_t)_encoded[i].size());
+			if(written == -1) {
+				bResult = false;
+			}
+		}
+		std::vector<uint8_t>().swap(_encoded[i]);
+	}
+	if(!bResult) {
+		_error = TRUE;
+	}
+
+	_firstBand += bandCount;
+	_pendingRows = 0;
+}
+
+BOOL 
+TIFFScanlineWriter::Flush() {
+	if((_workers > 1) || _tiled) {
+		EncodeBatch();
+	}
+	return _error ? FALSE : TRUE;
+}
+
+// ==========================================================
+// Tiled pyramid generation
+// ==========================================================
+
+/**
+Reduced-resolution level of a tiled pyramid, produced scanline by scanline
+*/
+typedef struct tagTIFFPyramidLevel {
+	//! source image (first level only)
+	FIBITMAP *src;
+	//! previous level, source of this level (nullptr for the first level)
+	struct tagTIFFPyramidLevel *prev;
+	//! level image
+	FIBITMAP *dib;
+	//! rescaler producing the scanlines of the level
+	FIRESCALER *rescaler;
+	//! next scanline to produce
+	unsigned next_row;
+} fi_TIFFPyramidLevel;
+
+/**
+Produce the next scanline of a level
+*/
+static BOOL 
+ProducePyramidRow(fi_TIFFPyramidLevel *level) {
+	if(level->next_row >= FreeImage_GetHeight(level->dib)) {
+		return FALSE;
+	}
+	if(!FreeImage_ReadRescaledScanline(level->rescaler, FreeImage_GetScanLine(level->dib, level->next_row))) {
+		return FALSE;
+	}
+	level->next_row++;
+	return TRUE;
+}
+
+/**
+FI_ReadScanlineProc of a level: source scanlines are taken from the image or produced by the previous level
+*/
+static BOOL DLL_CALLCONV 
+_tiffPyramidReadProc(void *data, unsigned row, uint8_t *bits) {
+	fi_TIFFPyramidLevel *level = (fi_TIFFPyramidLevel*)data;
+
+	if(!level->prev) {
+		memcpy(bits, FreeImage_GetConstScanLine(level->src, row), FreeImage_GetLine(level->src));
+		return TRUE;
+	}
+
+	fi_TIFFPyramidLevel *prev = level->prev;
+	while(prev->next_row <= row) {
+		if(!ProducePyramidRow(prev)) {
+			return FALSE;
+		}
+	}
+	memcpy(bits, FreeImage_GetConstScanLine(prev->dib, row), FreeImage_GetLine(prev->dib));
+	return TRUE;
+}
+
+/**
+Build the reduced-resolution levels of a tiled pyramid. 
+Each level is half the size of the previous one, the last level fits in a single tile. 
+All levels are produced in a single pass over the image: 
+each level pulls its source scanlines from the previous level as they are produced.
+@param dib Full resolution image
+@param levels Receives the levels, from the largest to the smallest (to be released by the caller)
+@return Returns TRUE if successful, returns FALSE if the image cannot be reduced
+*/
+static BOOL 
+BuildPyramid(FIBITMAP *dib, std::vector<FIBITMAP*> &levels) {
+	const FREE_IMAGE_TYPE image_type = FreeImage_GetImageType(dib);
+	const unsigned bpp = FreeImage_GetBPP(dib);
+
+	if(image_type == FIT_BITMAP) {
+		// palettized and low bit depth images cannot be filtered
+		const FREE_IMAGE_COLOR_TYPE color_type = FreeImage_GetColorType(dib);
+		if((bpp != 8) && (bpp != 24) && (bpp != 32)) {
+			return FALSE;
+		}
+		if((bpp == 8) && ((color_type == FIC_PALETTE) || FreeImage_IsTransparent(dib))) {
+			return FALSE;
+		}
+	}
+
+	std::vector<fi_TIFFPyramidLevel> pyramid;
+	BOOL bResult = TRUE;
+
+	unsigned width = FreeImage_GetWidth(dib);
+	unsigned height = FreeImage_GetHeight(dib);
+	while((width > TIFF_TILE_SIZE) || (height > TIFF_TILE_SIZE)) {
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+
+		fi_TIFFPyramidLevel level = { dib, nullptr, nullptr, nullptr, 0 };
+		level.dib = FreeImage_AllocateT(image_type, width, height, bpp);
+		if(!level.dib) {
+			bResult = FALSE;
+			break;
+		}
+		pyramid.push_back(level);
+	}
+	if(pyramid.empty()) {
+		// the image fits in a single tile
+		return FALSE;
+	}
+
+	// the pyramid vector is no longer resized: link the levels
+
+	FIBITMAP *src = dib;
+	for(size_t i = 0; (i < pyramid.size()) && bResult; i++) {
+		fi_TIFFPyramidLevel *level = &pyramid[i];
+		level->prev = (i > 0) ? &pyramid[i - 1] : nullptr;
+		level->rescaler = FreeImage_OpenRescaler(image_type, bpp, 
+			FreeImage_GetWidth(src), FreeImage_GetHeight(src), FreeImage_GetWidth(level->dib), FreeImage_GetHeight(level->dib), 
+			FILTER_BOX, _tiffPyramidReadProc, level);
+		if(!level->rescaler) {
+			bResult = FALSE;
+			break;
+		}
+
+		// greyscale palette, color profile (needed to keep CMYK images CMYK) and resolution
+		if(bpp == 8) {
+			memcpy(FreeImage_GetPalette(level->dib), FreeImage_GetPalette(dib), 256 * sizeof(RGBQUAD));
+		}
+		const FIICCPROFILE *iccProfile = FreeImage_GetICCProfile(dib);
+		if(iccProfile->size && iccProfile->data) {
+			FreeImage_CreateICCProfile(level->dib, iccProfile->data, iccProfile->size);
+		}
+		FreeImage_GetICCProfile(level->dib)->flags = iccProfile->flags;
+		FreeImage_SetDotsPerMeterX(level->dib, (unsigned)((uint64_t)FreeImage_GetDotsPerMeterX(dib) * FreeImage_GetWidth(level->dib) / FreeImage_GetWidth(dib)));
+		FreeImage_SetDotsPerMeterY(level->dib, (unsigned)((uint64_t)FreeImage_GetDotsPerMeterY(dib) * FreeImage_GetHeight(level->dib) / FreeImage_GetHeight(dib)));
+
+		src = level->dib;
+	}
+
+	if(bResult) {
+		// pull the smallest level: this drives the whole pass, then complete the other levels
+		for(size_t i = pyramid.size(); (i > 0) && bResult; i--) {
+			fi_TIFFPyramidLevel *level = &pyramid[i - 1];
+			while((level->next_row < FreeImage_GetHeight(level->dib)) && bResult) {
+				bResult = ProducePyramidRow(level);
+			}
+		}
+	}
+
+	for(size_t i = 0; i < pyramid.size(); i++) {
+		FreeImage_CloseRescaler(pyramid[i].rescaler);
+		if(bResult) {
+			levels.push_back(pyramid[i].dib);
+		} else {
+			FreeImage_Unload(pyramid[i].dib);
+		}
+	}
+
+	return bResult;
+}
+
 // ==========================================================
 // TIFF thumbnail routines
 // ==========================================================
@@ -1253,7 +1988,7 @@ ReadThumbnail(FreeImageIO *io, fi_handle handle, void *data, TIFF *tiff, FIBITMA
 		
 		if(!TIFFLastDirectory(tiff)) {
 			// save current position
-			const long tell_pos = io->tell_proc(handle);
+			const int64_t tell_pos = IOTell64(io, handle);
 			const uint16_t cur_dir = TIFFCurrentDirectory(tiff);
 			
 			// load the thumbnail
@@ -1264,7 +1999,7 @@ ReadThumbnail(FreeImageIO *io, fi_handle handle, void *data, TIFF *tiff, FIBITMA
 			FreeImage_SetThumbnail(dib, thumbnail);
 			
 			// restore current position
-			io->seek_proc(handle, tell_pos, SEEK_SET);
+			IOSeek64(io, handle, tell_pos, SEEK_SET);
 			TIFFSetDirectory(tiff, cur_dir);
 		}
 	}
@@ -1278,14 +2013,16 @@ ReadThumbnail(FreeImageIO *io, fi_handle handle, void *data, TIFF *tiff, FIBITMA
 		
 		// This will also read the first (and only) subIFD from a Photoshop-created "pyramid" file.
 		// Subsequent, smaller images are 'nextIFD' in that subIFD. Currently we only load the first one. 
+		// Tiled pyramids (see TIFF_PYRAMID) store their levels as a list of SubIFDs, 
+		// from the largest to the smallest: the last one is used.
 		
 		if(TIFFGetField(tiff, TIFFTAG_SUBIFD, &subIFD_count, &subIFD_offsets)) {
 			if(subIFD_count > 0) {
 				// save current position
-				const long tell_pos = io->tell_proc(handle);
+				const int64_t tell_pos = IOTell64(io, handle);
 				const uint16_t cur_dir = TIFFCurrentDirectory(tiff);
 				
-				if(TIFFSetSubDirectory(tiff, subIFD_offsets[0])) {
+				if(TIFFSetSubDirectory(tiff, subIFD_offsets[subIFD_count - 1])) {
 					// load the thumbnail
 					int page = -1; 
 					int flags = TIFF_DEFAULT;
@@ -1295,7 +2032,7 @@ ReadThumbnail(FreeImageIO *io, fi_handle handle, void *data, TIFF *tiff, FIBITMA
 				}
 				
 				// restore current position
-				io->seek_proc(handle, tell_pos, SEEK_SET);
+				IOSeek64(io, handle, tell_pos, SEEK_SET);
 				TIFFSetDirectory(tiff, cur_dir);
 			}
 		}
@@ -1410,6 +2147,10 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 
 		TIFFLoadMethod loadMethod = FindLoadMethod(tif, image_type, flags);
 
+		// strips and tiles of compressed images may be decoded on several threads (only when asked to)
+
+		const unsigned workers = ((compression != COMPRESSION_NONE) && ((flags & TIFF_MULTITHREADED) == TIFF_MULTITHREADED)) ? GetWorkerCount(TRUE) : 1;
+
 		// ---------------------------------------------------------------------------------
 
 		if(loadMethod == LoadAsRBGA) {
@@ -1652,7 +2393,6 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 			
 			FIBITMAP *alpha = nullptr;
 			unsigned alpha_pitch = 0;
-			uint8_t *alpha_bits = nullptr;
 			unsigned alpha_Bpp = 0;
 
 			if(isCMYKA && !asCMYK && !header_only) {
@@ -1665,7 +2405,6 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 				if(!alpha) {
 					FreeImage_OutputMessageProc(s_format_id, "Failed to allocate temporary alpha channel");
 				} else {
-					alpha_bits = FreeImage_GetScanLine(alpha, height - 1);
 					alpha_pitch = FreeImage_GetPitch(alpha);
 					alpha_Bpp = FreeImage_GetBPP(alpha) / 8;
 				}
@@ -1700,8 +2439,6 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 				// In the tiff file the lines are save from up to down 
 				// In a DIB the lines must be saved from down to up
 
-				uint8_t *bits = FreeImage_GetScanLine(dib, height - 1);
-
 				// read the tiff lines and save them in the DIB
 
 				uint8_t *buf = (uint8_t*)malloc(TIFFStripSize(tif) * sizeof(uint8_t));
@@ -1710,18 +2447,27 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 					throw FI_MSG_ERROR_MEMORY;
 				}
 
-				if(planar_config == PLANARCONFIG_CONTIG) {
-					
+				// strip blocks are decoded independently (possibly on several threads)
+
+				const uint32_t blockRows = MAX<uint32_t>(1, MIN(rowsperstrip, height));
+				const uint32_t blockCount = (height + blockRows - 1) / blockRows;
+
+				BOOL bResult = TRUE;
+
+				if(planar_config == PLANARCONFIG_CONTIG) {
+					
 					// - loop for strip blocks -
 					
-					for (uint32_t y = 0; y < height; y += rowsperstrip) {
-						const int32_t strips = (y + rowsperstrip > height ? height - y : rowsperstrip);
+					auto readStripBlock = [&](TIFF *t, uint32_t block, uint8_t *buf) -> BOOL {
+						const uint32_t y = block * blockRows;
+						const int32_t strips = (y + blockRows > height ? height - y : blockRows);
 
-						if (TIFFReadEncodedStrip(tif, TIFFComputeStrip(tif, y, 0), buf, strips * src_line) == -1) {
-							free(buf);
-							FreeImage_Unload(alpha);
-							throw FI_MSG_ERROR_PARSING;
+						if (TIFFReadEncodedStrip(t, TIFFComputeStrip(t, y, 0), buf, strips * src_line) == -1) {
+							return FALSE;
 						} 
+
+						uint8_t *bits = FreeImage_GetScanLine(dib, height - 1 - y);
+						uint8_t *alpha_bits = alpha ? FreeImage_GetScanLine(alpha, height - 1 - y) : nullptr;
 						
 						// - loop for strips -
 						
@@ -1766,28 +2512,28 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 								bits -= dib_pitch;
 							}
 						}
+						return TRUE;
+					};
 
-					} // height
-				
+					bResult = DecodeChunks(fio, tif, blockCount, buf, TIFFStripSize(tif), workers, readStripBlock);
 				}
 				else if(planar_config == PLANARCONFIG_SEPARATE) {
 
-					uint8_t *dib_strip = bits;
-					uint8_t *al_strip = alpha_bits;
-
 					// - loop for strip blocks -
 					
-					for (uint32_t y = 0; y < height; y += rowsperstrip) {
-						const int32_t strips = (y + rowsperstrip > height ? height - y : rowsperstrip);
+					auto readStripBlock = [&](TIFF *t, uint32_t block, uint8_t *buf) -> BOOL {
+						const uint32_t y = block * blockRows;
+						const int32_t strips = (y + blockRows > height ? height - y : blockRows);
+
+						uint8_t *dib_strip = FreeImage_GetScanLine(dib, height - 1 - y);
+						uint8_t *al_strip = alpha ? FreeImage_GetScanLine(alpha, height - 1 - y) : nullptr;
 						
 						// - loop for channels (planes) -
 						
 						for(uint16_t sample = 0; sample < samplesperpixel; sample++) {
 							
-							if (TIFFReadEncodedStrip(tif, TIFFComputeStrip(tif, y, sample), buf, strips * src_line) == -1) {
-								free(buf);
-								FreeImage_Unload(alpha);
-								throw FI_MSG_ERROR_PARSING;
+							if (TIFFReadEncodedStrip(t, TIFFComputeStrip(t, y, sample), buf, strips * src_line) == -1) {
+								return FALSE;
 							} 
 									
 							uint8_t *dst_strip = dib_strip;
@@ -1829,13 +2575,16 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 							} // strips
 															
 						} // channels
-							
-						// done with a strip block, incr to the next
-						dib_strip -= strips * dib_pitch;
-						al_strip -= strips * alpha_pitch;
-							
-					} //< height
-					
+						return TRUE;
+					};
+
+					bResult = DecodeChunks(fio, tif, blockCount, buf, TIFFStripSize(tif), workers, readStripBlock);
+				}
+
+				if(!bResult) {
+					free(buf);
+					FreeImage_Unload(alpha);
+					throw FI_MSG_ERROR_PARSING;
 				}
 
 				free(buf);
@@ -1900,8 +2649,6 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 				// In the tiff file the lines are save from up to down 
 				// In a DIB the lines must be saved from down to up
 
-				uint8_t *bits = FreeImage_GetScanLine(dib, height - 1);
-
 				// read the tiff lines and save them in the DIB
 
 				uint8_t *buf = (uint8_t*)malloc(TIFFStripSize(tif) * sizeof(uint8_t));
@@ -1911,20 +2658,26 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 				memset(buf, 0, TIFFStripSize(tif) * sizeof(uint8_t));
 				
 				BOOL bThrowMessage = FALSE;
+
+				// strip blocks are decoded independently (possibly on several threads)
+
+				const uint32_t blockRows = MAX<uint32_t>(1, MIN(rowsperstrip, height));
+				const uint32_t blockCount = (height + blockRows - 1) / blockRows;
 				
 				if(planar_config == PLANARCONFIG_CONTIG) {
 
-					for (uint32_t y = 0; y < height; y += rowsperstrip) {
-						int32_t strips = (y + rowsperstrip > height ? height - y : rowsperstrip);
+					auto readStripBlock = [&](TIFF *t, uint32_t block, uint8_t *buf) -> BOOL {
+						BOOL bResult = TRUE;
+						const uint32_t y = block * blockRows;
+						const int32_t strips = (y + blockRows > height ? height - y : blockRows);
 
-						if (TIFFReadEncodedStrip(tif, TIFFComputeStrip(tif, y, 0), buf, strips * src_line) == -1) {
+						if (TIFFReadEncodedStrip(t, TIFFComputeStrip(t, y, 0), buf, strips * src_line) == -1) {
 							// ignore errors as they can be frequent and not really valid errors, especially with fax images
-							bThrowMessage = TRUE;							
-							/*
-							free(buf);
-							throw FI_MSG_ERROR_PARSING;
-							*/
+							bResult = FALSE;
 						} 
+
+						uint8_t *bits = FreeImage_GetScanLine(dib, height - 1 - y);
+
 						if(src_line == dst_line) {
 							// channel count match
 							for (int l = 0; l < strips; l++) {							
@@ -1940,24 +2693,31 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 								bits -= dst_pitch;
 							}
 						}
+						return bResult;
+					};
+
+					if(!DecodeChunks(fio, tif, blockCount, buf, TIFFStripSize(tif), workers, readStripBlock)) {
+						bThrowMessage = TRUE;
 					}
 				}
 				else if(planar_config == PLANARCONFIG_SEPARATE) {
 					
 					const unsigned Bpc = bitspersample / 8;
-					uint8_t* dib_strip = bits;
-					// - loop for strip blocks -
-					
-					for (uint32_t y = 0; y < height; y += rowsperstrip) {
-						const int32_t strips = (y + rowsperstrip > height ? height - y : rowsperstrip);
+
+					auto readStripBlock = [&](TIFF *t, uint32_t block, uint8_t *buf) -> BOOL {
+						BOOL bResult = TRUE;
+						const uint32_t y = block * blockRows;
+						const int32_t strips = (y + blockRows > height ? height - y : blockRows);
+
+						uint8_t* dib_strip = FreeImage_GetScanLine(dib, height - 1 - y);
 						
 						// - loop for channels (planes) -
 						
 						for(uint16_t sample = 0; sample < samplesperpixel; sample++) {
 							
-							if (TIFFReadEncodedStrip(tif, TIFFComputeStrip(tif, y, sample), buf, strips * src_line) == -1) {
+							if (TIFFReadEncodedStrip(t, TIFFComputeStrip(t, y, sample), buf, strips * src_line) == -1) {
 								// ignore errors as they can be frequent and not really valid errors, especially with fax images
-								bThrowMessage = TRUE;	
+								bResult = FALSE;
 							} 
 									
 							if(sample >= chCount) {
@@ -1985,12 +2745,12 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 							} // strips
 
 						} // channels
-							
-						// done with a strip block, incr to the next
-						dib_strip -= strips * dst_pitch;
-							
-					} // height
+						return bResult;
+					};
 
+					if(!DecodeChunks(fio, tif, blockCount, buf, TIFFStripSize(tif), workers, readStripBlock)) {
+						bThrowMessage = TRUE;
+					}
 				}
 				free(buf);
 				
@@ -2010,7 +2770,6 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 			// ---------------------------------------------------------------------------------
 
 			uint32_t tileWidth, tileHeight;
-			uint32_t src_line = 0;
 
 			// create a new DIB
 			dib = CreateImageType( header_only, image_type, width, height, bitspersample, samplesperpixel);
@@ -2053,25 +2812,26 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 				// In the tiff file the lines are saved from up to down 
 				// In a DIB the lines must be saved from down to up
 
-				uint8_t *bits = FreeImage_GetScanLine(dib, height - 1);
-				
-				for (uint32_t y = 0; y < height; y += tileHeight) {						
-					int32_t nrows = (y + tileHeight > height ? height - y : tileHeight);					
+				// each row of tiles is decoded independently (possibly on several threads)
+
+				const uint32_t tileRowCount = (height + tileHeight - 1) / tileHeight;
+
+				auto readTileRow = [&](TIFF *t, uint32_t tileRow, uint8_t *tileBuffer) -> BOOL {
+					const uint32_t y = tileRow * tileHeight;
+					const int32_t nrows = (y + tileHeight > height ? height - y : tileHeight);
+
+					uint8_t *bits = FreeImage_GetScanLine(dib, height - 1 - y);
 
 					for (uint32_t x = 0, rowSize = 0; x < width; x += tileWidth, rowSize += tileRowSize) {
 						memset(tileBuffer, 0, tileSize);
 
 						// read one tile
-						if (TIFFReadTile(tif, tileBuffer, x, y, 0, 0) < 0) {
-							free(tileBuffer);
-							throw "Corrupted tiled TIFF file";
+						if (TIFFReadTile(t, tileBuffer, x, y, 0, 0) < 0) {
+							return FALSE;
 						}
 						// convert to strip
-						if(x + tileWidth > width) {
-							src_line = imageRowSize - rowSize;
-						} else {
-							src_line = tileRowSize;
-						}
+						const uint32_t src_line = (x + tileWidth > width) ? imageRowSize - rowSize : tileRowSize;
+
 						uint8_t *src_bits = tileBuffer;
 						uint8_t *dst_bits = bits + rowSize;
 						for(int k = 0; k < nrows; k++) {
@@ -2080,8 +2840,12 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 							dst_bits -= dst_pitch;
 						}
 					}
+					return TRUE;
+				};
 
-					bits -= nrows * dst_pitch;
+				if(!DecodeChunks(fio, tif, tileRowCount, tileBuffer, tileSize, workers, readTileRow)) {
+					free(tileBuffer);
+					throw "Corrupted tiled TIFF file";
 				}
 
 #if FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR
@@ -2270,6 +3034,235 @@ Load(FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
 
 // --------------------------------------------------------------------------
 
+/**
+Copy a run of pixels from a decoded strip or tile to a dib scanline
+@param dst_bits Destination pixels
+@param src_bits Source pixels
+@param count Number of pixels to copy
+@param Bpp Bytes per pixel in the dib
+@param srcBpp Bytes per pixel in the TIFF data
+*/
+static inline void 
+CopyRegionPixels(uint8_t *dst_bits, const uint8_t *src_bits, unsigned count, unsigned Bpp, unsigned srcBpp) {
+	if(Bpp == srcBpp) {
+		memcpy(dst_bits, src_bits, count * Bpp);
+	} else {
+		// channel count mismatch (extra samples are skipped)
+		for(unsigned x = 0; x < count; x++, dst_bits += Bpp, src_bits += srcBpp) {
+			AssignPixel(dst_bits, src_bits, Bpp);
+		}
+	}
+}
+
+/**
+Load a rectangular region of a TIFF directory. 
+Contiguous strip and tile images with byte aligned pixels are decoded by reading only the strips or 
+tiles intersecting the region, other images are fully loaded and cropped. 
+@see FreeImage_LoadRegion
+*/
+static FIBITMAP * DLL_CALLCONV
+LoadRegion(FreeImageIO *io, fi_handle handle, int page, int left, int top, int right, int bottom, int flags, void *data) {
+	if (!handle || !data ) {
+		return nullptr;
+	}
+
+	TIFF   *tif = nullptr;
+	uint32_t height = 0; 
+	uint32_t width = 0; 
+	uint16_t bitspersample = 1;
+	uint16_t samplesperpixel = 1;
+	uint32_t rowsperstrip = (uint32_t)-1;  
+	uint16_t photometric = PHOTOMETRIC_MINISWHITE;
+	uint16_t planar_config;
+
+	FIBITMAP *dib = nullptr;
+	uint8_t *buf = nullptr;
+	uint32_t iccSize = 0;		// ICC profile length
+	void *iccBuf = nullptr;	// ICC profile data		
+
+	try {
+		fi_TIFFIO *fio = (fi_TIFFIO*)data;
+		tif = fio->tif;
+
+		if (page != -1) {
+			if (!tif || !TIFFSetDirectory(tif, (uint16_t)page)) {
+				throw "Error encountered while opening TIFF file";			
+			}
+		}
+
+		TIFFGetField(tif, TIFFTAG_PHOTOMETRIC, &photometric);
+		TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width);
+		TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height);
+		TIFFGetField(tif, TIFFTAG_SAMPLESPERPIXEL, &samplesperpixel);
+		TIFFGetField(tif, TIFFTAG_BITSPERSAMPLE, &bitspersample);
+		TIFFGetField(tif, TIFFTAG_ROWSPERSTRIP, &rowsperstrip);   			
+		TIFFGetField(tif, TIFFTAG_ICCPROFILE, &iccSize, &iccBuf);
+		TIFFGetFieldDefaulted(tif, TIFFTAG_PLANARCONFIG, &planar_config);
+
+		// normalize and clip the region
+
+		if(right < left) {
+			INPLACESWAP(left, right);
+		}
+		if(bottom < top) {
+			INPLACESWAP(top, bottom);
+		}
+		left = MAX(left, 0);
+		top = MAX(top, 0);
+		right = MIN(right, (int)width);
+		bottom = MIN(bottom, (int)height);
+		if((left >= right) || (top >= bottom)) {
+			throw "Invalid region";
+		}
+
+		// check if the region can be decoded directly
+
+		BOOL bDirectRegion = FALSE;
+
+		if((photometric != PHOTOMETRIC_LOGLUV) && (planar_config == PLANARCONFIG_CONTIG) && 
+			(bitspersample >= 8) && ((bitspersample * samplesperpixel) % 8 == 0) &&
+			IsValidBitsPerSample(photometric, bitspersample, samplesperpixel)) {
+
+			const FREE_IMAGE_TYPE image_type = ReadImageType(tif, bitspersample, samplesperpixel);
+			const TIFFLoadMethod loadMethod = FindLoadMethod(tif, image_type, flags);
+
+			if((loadMethod == LoadAsGenericStrip) || (loadMethod == LoadAsTiled)) {
+				// create a new DIB (same pixel format as when loading the whole image)
+				const uint16_t chCount = (loadMethod == LoadAsGenericStrip) ? MIN<uint16_t>(samplesperpixel, 4) : samplesperpixel;
+				dib = CreateImageType(FALSE, image_type, right - left, bottom - top, bitspersample, chCount);
+				if (dib == nullptr) {
+					throw FI_MSG_ERROR_MEMORY;
+				}
+				bDirectRegion = TRUE;
+			}
+		}
+
+		if(!bDirectRegion) {
+			// load the whole directory and crop it
+			FIBITMAP *full = Load(io, handle, -1, flags, data);
+			if(!full) {
+				return nullptr;
+			}
+			dib = FreeImage_Copy(full, left, top, right, bottom);
+			FreeImage_Unload(full);
+			return dib;
+		}
+
+		// fill in the resolution (english or universal)
+
+		ReadResolution(tif, dib);
+
+		// set up the colormap based on photometric	
+
+		ReadPalette(tif, photometric, bitspersample, dib);
+
+		const unsigned region_height = (unsigned)(bottom - top);
+		const unsigned Bpp = FreeImage_GetBPP(dib) / 8;
+		const unsigned srcBpp = bitspersample * samplesperpixel / 8;
+
+		BOOL bThrowMessage = FALSE;
+
+		if(TIFFIsTiled(tif)) {
+			// read the tiles intersecting the region
+
+			uint32_t tileWidth, tileHeight;
+			if(!TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tileWidth) || !TIFFGetField(tif, TIFFTAG_TILELENGTH, &tileHeight)) {
+				throw "Invalid tiled TIFF image";
+			}
+
+			const tmsize_t tileSize = TIFFTileSize(tif);
+			const tmsize_t tileRowSize = TIFFTileRowSize(tif);
+
+			buf = (uint8_t*)malloc(tileSize * sizeof(uint8_t));
+			if(buf == nullptr) {
+				throw FI_MSG_ERROR_MEMORY;
+			}
+
+			for(uint32_t ty = ((uint32_t)top / tileHeight) * tileHeight; ty < (uint32_t)bottom; ty += tileHeight) {
+				for(uint32_t tx = ((uint32_t)left / tileWidth) * tileWidth; tx < (uint32_t)right; tx += tileWidth) {
+					memset(buf, 0, tileSize);
+
+					// read one tile
+					if(TIFFReadTile(tif, buf, tx, ty, 0, 0) < 0) {
+						throw "Corrupted tiled TIFF file";
+					}
+
+					// copy the part of the tile inside the region
+					const uint32_t x0 = MAX(tx, (uint32_t)left);
+					const uint32_t x1 = MIN(tx + tileWidth, (uint32_t)right);
+					const uint32_t y1 = MIN(ty + tileHeight, (uint32_t)bottom);
+
+					for(uint32_t y = MAX(ty, (uint32_t)top); y < y1; y++) {
+						const uint8_t *src_bits = buf + (y - ty) * tileRowSize + (x0 - tx) * srcBpp;
+						uint8_t *dst_bits = FreeImage_GetScanLine(dib, region_height - 1 - (y - top)) + (x0 - left) * Bpp;
+						CopyRegionPixels(dst_bits, src_bits, x1 - x0, Bpp, srcBpp);
+					}
+				}
+			}
+
+		} else {
+			// read the strips intersecting the region
+
+			rowsperstrip = MIN(rowsperstrip, height);
+
+			const tmsize_t src_line = TIFFScanlineSize(tif);
+
+			buf = (uint8_t*)malloc(TIFFStripSize(tif) * sizeof(uint8_t));
+			if(buf == nullptr) {
+				throw FI_MSG_ERROR_MEMORY;
+			}
+			memset(buf, 0, TIFFStripSize(tif) * sizeof(uint8_t));
+
+			for(uint32_t sy = ((uint32_t)top / rowsperstrip) * rowsperstrip; sy < (uint32_t)bottom; sy += rowsperstrip) {
+				const uint32_t strips = (sy + rowsperstrip > height ? height - sy : rowsperstrip);
+
+				if(TIFFReadEncodedStrip(tif, TIFFComputeStrip(tif, sy, 0), buf, strips * src_line) == -1) {
+					// ignore errors as they can be frequent and not really valid errors, especially with fax images
+					bThrowMessage = TRUE;
+				}
+
+				const uint32_t y1 = MIN(sy + strips, (uint32_t)bottom);
+				for(uint32_t y = MAX(sy, (uint32_t)top); y < y1; y++) {
+					const uint8_t *src_bits = buf + (y - sy) * src_line + left * srcBpp;
+					uint8_t *dst_bits = FreeImage_GetScanLine(dib, region_height - 1 - (y - top));
+					CopyRegionPixels(dst_bits, src_bits, right - left, Bpp, srcBpp);
+				}
+			}
+		}
+
+		free(buf);
+		buf = nullptr;
+
+		if(bThrowMessage) {
+			FreeImage_OutputMessageProc(s_format_id, "Warning: parsing error. Image may be incomplete or contain invalid data !");
+		}
+
+#if FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR
+		SwapRedBlue32(dib);
+#endif
+
+		// copy TIFF metadata and ICC profile (must be done after FreeImage_Allocate)
+
+		ReadMetadata(io, handle, tif, dib);
+
+		FreeImage_CreateICCProfile(dib, iccBuf, iccSize);
+
+		return dib;
+
+	} catch (const char *message) {
+		free(buf);
+		if(dib)	{
+			FreeImage_Unload(dib);
+		}
+		if(message) {
+			FreeImage_OutputMessageProc(s_format_id, message);
+		}
+		return nullptr;
+	}
+}
+
+// --------------------------------------------------------------------------
+
 /**
 Save a single image into a TIF
 
@@ -2411,7 +3404,13 @@ SaveOneTIFF(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flag
 		TIFFSetField(out, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);	// single image plane 
 		TIFFSetField(out, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
 		TIFFSetField(out, TIFFTAG_FILLORDER, FILLORDER_MSB2LSB);
-		TIFFSetField(out, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(out, (uint32_t) -1)); 
+		if((flags & (TIFF_TILED | TIFF_PYRAMID)) != 0) {
+			// tile dimensions must be a multiple of 16
+			TIFFSetField(out, TIFFTAG_TILEWIDTH, TIFF_TILE_SIZE);
+			TIFFSetField(out, TIFFTAG_TILELENGTH, TIFF_TILE_SIZE);
+		} else {
+			TIFFSetField(out, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(out, (uint32_t) -1)); 
+		}
 
 		// handle metrics
 
@@ -2465,13 +3464,12 @@ SaveOneTIFF(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flag
 
 		WriteMetadata(out, dib);
 
-		// thumbnail tag
+		// thumbnail or reduced-resolution levels tag
 
 		if((ifd == 0) && (ifdCount > 1)) {
-			uint16_t nsubifd = 1;
-			uint64_t subifd[1];
-			subifd[0] = 0;
-			TIFFSetField(out, TIFFTAG_SUBIFD, nsubifd, subifd);
+			const uint16_t nsubifd = (uint16_t)(ifdCount - 1);
+			std::vector<uint64_t> subifd(nsubifd, 0);
+			TIFFSetField(out, TIFFTAG_SUBIFD, nsubifd, subifd.data());
 		}
 
 		// read the DIB lines from bottom to top
@@ -2480,6 +3478,10 @@ SaveOneTIFF(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flag
 		
 		const uint32_t pitch = FreeImage_GetPitch(dib);
 
+		// strips or tiles may be compressed on several threads (only when asked to)
+
+		TIFFScanlineWriter writer(out, ((flags & TIFF_MULTITHREADED) == TIFF_MULTITHREADED) ? GetWorkerCount(TRUE) : 1);
+
 		if(image_type == FIT_BITMAP) {
 			// standard bitmap type
 		
@@ -2500,9 +3502,10 @@ SaveOneTIFF(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flag
 						}
 
 						for (int y = height - 1; y >= 0; y--) {
-							uint8_t *bits = FreeImage_GetScanLine(dib, y);
+							const uint8_t *bits = FreeImage_GetConstScanLine(dib, y);
 
-							uint8_t *p = bits, *b = buffer;
+							const uint8_t *p = bits;
+							uint8_t *b = buffer;
 
 							for(uint32_t x = 0; x < width; x++) {
 								// copy the 8-bit layer
@@ -2516,7 +3519,7 @@ SaveOneTIFF(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flag
 
 							// write the scanline to disc
 
-							TIFFWriteScanline(out, buffer, height - y - 1, 0);
+							writer.WriteScanline(buffer, height - y - 1);
 						}
 
 						free(buffer);
@@ -2530,9 +3533,9 @@ SaveOneTIFF(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flag
 
 						for (uint32_t y = 0; y < height; y++) {
 							// get a copy of the scanline
-							memcpy(buffer, FreeImage_GetScanLine(dib, height - y - 1), pitch);
+							memcpy(buffer, FreeImage_GetConstScanLine(dib, height - y - 1), pitch);
 							// write the scanline to disc
-							TIFFWriteScanline(out, buffer, y, 0);
+							writer.WriteScanline(buffer, y);
 						}
 						free(buffer);
 					}
@@ -2551,7 +3554,7 @@ SaveOneTIFF(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flag
 					for (uint32_t y = 0; y < height; y++) {
 						// get a copy of the scanline
 
-						memcpy(buffer, FreeImage_GetScanLine(dib, height - y - 1), pitch);
+						memcpy(buffer, FreeImage_GetConstScanLine(dib, height - y - 1), pitch);
 
 #if FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR
 						if (photometric != PHOTOMETRIC_SEPARATED) {
@@ -2567,7 +3570,7 @@ SaveOneTIFF(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flag
 #endif
 						// write the scanline to disc
 
-						TIFFWriteScanline(out, buffer, y, 0);
+						writer.WriteScanline(buffer, y);
 					}
 
 					free(buffer);
@@ -2586,9 +3589,9 @@ SaveOneTIFF(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flag
 
 			for (uint32_t y = 0; y < height; y++) {
 				// get a copy of the scanline and convert from RGB to XYZ
-				tiff_ConvertLineRGBToXYZ(buffer, FreeImage_GetScanLine(dib, height - y - 1), width);
+				tiff_ConvertLineRGBToXYZ(buffer, FreeImage_GetConstScanLine(dib, height - y - 1), width);
 				// write the scanline to disc
-				TIFFWriteScanline(out, buffer, y, 0);
+				writer.WriteScanline(buffer, y);
 			}
 			free(buffer);
 		} else {
@@ -2601,16 +3604,20 @@ SaveOneTIFF(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flag
 			
 			for (uint32_t y = 0; y < height; y++) {
 				// get a copy of the scanline
-				memcpy(buffer, FreeImage_GetScanLine(dib, height - y - 1), pitch);
+				memcpy(buffer, FreeImage_GetConstScanLine(dib, height - y - 1), pitch);
 				// write the scanline to disc
-				TIFFWriteScanline(out, buffer, y, 0);
+				writer.WriteScanline(buffer, y);
 			}
 			free(buffer);
 		}
 
-		// write out the directory tag if we wrote a page other than -1 or if we have a thumbnail to write later
+		if(!writer.Flush()) {
+			throw "Failed to write TIFF strips";
+		}
+
+		// write out the directory tag if we wrote a page other than -1 or if we have a reduced image to write later
 
-		if( (page >= 0) || ((ifd == 0) && (ifdCount > 1)) ) {
+		if( (page >= 0) || (ifd + 1 < ifdCount) ) {
 			TIFFWriteDirectory(out);
 			// else: TIFFClose will WriteDirectory
 		}
@@ -2626,28 +3633,282 @@ SaveOneTIFF(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flag
 static BOOL DLL_CALLCONV
 Save(FreeImageIO *io, FIBITMAP *dib, fi_handle handle, int page, int flags, void *data) {
 	BOOL bResult = FALSE;
+
+	// handle reduced-resolution levels of a tiled pyramid as SubIFDs
+
+	std::vector<FIBITMAP*> levels;
+	if((flags & TIFF_PYRAMID) == TIFF_PYRAMID) {
+		BuildPyramid(dib, levels);
+	}
 	
-	// handle thumbnail as SubIFD
-	const BOOL bHasThumbnail = (FreeImage_GetThumbnail(dib) != nullptr);
-	const unsigned ifdCount = bHasThumbnail ? 2 : 1;
+	// ... or handle thumbnail as SubIFD
+	const BOOL bHasThumbnail = levels.empty() && (FreeImage_GetThumbnail(dib) != nullptr);
+	const unsigned ifdCount = 1 + (levels.empty() ? (bHasThumbnail ? 1 : 0) : (unsigned)levels.size());
 	
 	FIBITMAP *bitmap = dib;
 
 	for(unsigned ifd = 0; ifd < ifdCount; ifd++) {
-		// redirect dib to thumbnail for the second pass
-		if(ifd == 1) {
-			bitmap = FreeImage_GetThumbnail(dib);
+		// redirect dib to the reduced image for the next passes
+		if(ifd > 0) {
+			bitmap = levels.empty() ? FreeImage_GetThumbnail(dib) : levels[ifd - 1];
 		}
 
 		bResult = SaveOneTIFF(io, bitmap, handle, page, flags, data, ifd, ifdCount);
 		if(!bResult) {
-			return FALSE;
+			break;
 		}
 	}
 
+	for(size_t i = 0; i < levels.size(); i++) {
+		FreeImage_Unload(levels[i]);
+	}
+
 	return bResult;
 }
 
+// --------------------------------------------------------------------------
+
+/**
+Copy a SHORT, LONG or RATIONAL field of the current directory, if present
+*/
+static void
+CopyShortField(TIFF *in, TIFF *out, uint32_t tag) {
+	uint16_t value;
+	if(TIFFGetField(in, tag, &value)) {
+		TIFFSetField(out, tag, value);
+	}
+}
+
+static void
+CopyLongField(TIFF *in, TIFF *out, uint32_t tag) {
+	uint32_t value;
+	if(TIFFGetField(in, tag, &value)) {
+		TIFFSetField(out, tag, value);
+	}
+}
+
+static void
+CopyRationalField(TIFF *in, TIFF *out, uint32_t tag) {
+	float value;
+	if(TIFFGetField(in, tag, &value)) {
+		TIFFSetField(out, tag, value);
+	}
+}
+
+/**
+Copy a counted byte array field (ICC profile, JPEG tables) of the current directory, if present
+*/
+static void
+CopyDataField(TIFF *in, TIFF *out, uint32_t tag) {
+	uint32_t count = 0;
+	void *value = nullptr;
+	if(TIFFGetField(in, tag, &count, &value) && count) {
+		TIFFSetField(out, tag, count, value);
+	}
+}
+
+/**
+Check if the strips or tiles of the current directory can be written as is into a page saved with 'flags'
+@param in Source TIFF handle, positioned on the page
+@param flags FreeImage TIFF save flag
+@return Returns TRUE if the page can be copied without decoding it
+*/
+static BOOL
+CanCopyRawPage(TIFF *in, int flags) {
+	// the layout and the compression are requested by the caller
+	if(flags & (TIFF_TILED | TIFF_PYRAMID | TIFF_LOGLUV)) {
+		return FALSE;
+	}
+
+	uint16_t compression = COMPRESSION_NONE;
+	TIFFGetFieldDefaulted(in, TIFFTAG_COMPRESSION, &compression);
+
+	// old-style JPEG tables cannot be rewritten, other codecs must at least be known to LibTIFF
+	if((compression == COMPRESSION_OJPEG) || !TIFFIsCODECConfigured(compression)) {
+		return FALSE;
+	}
+
+	// an explicit compression flag must match the stored compression (same priority as WriteCompression)
+	static const struct { int flag; uint16_t compression; } requested[] = {
+		{ TIFF_PACKBITS, COMPRESSION_PACKBITS },
+		{ TIFF_DEFLATE, COMPRESSION_DEFLATE },
+		{ TIFF_ADOBE_DEFLATE, COMPRESSION_ADOBE_DEFLATE },
+		{ TIFF_NONE, COMPRESSION_NONE },
+		{ TIFF_CCITTFAX3, COMPRESSION_CCITTFAX3 },
+		{ TIFF_CCITTFAX4, COMPRESSION_CCITTFAX4 },
+		{ TIFF_LZW, COMPRESSION_LZW },
+		{ TIFF_JPEG, COMPRESSION_JPEG }
+	};
+	for(size_t i = 0; i < sizeof(requested) / sizeof(requested[0]); i++) {
+		if((flags & requested[i].flag) == requested[i].flag) {
+			if(requested[i].compression != compression) {
+				return FALSE;
+			}
+			break;
+		}
+	}
+
+	// thumbnails and reduced-resolution levels are rebuilt by Save
+	uint16_t nsubifd = 0;
+	toff_t *subifd = nullptr;
+	if(TIFFGetField(in, TIFFTAG_SUBIFD, &nsubifd, &subifd) && nsubifd) {
+		return FALSE;
+	}
+
+	// empty strips or tiles have no data to copy
+	const uint32_t chunkCount = TIFFIsTiled(in) ? TIFFNumberOfTiles(in) : TIFFNumberOfStrips(in);
+	for(uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+		if(TIFFGetStrileByteCount(in, chunk) == 0) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+Copy a page of an opened TIFF into the TIFF being written, 
+reusing the compressed strips or tiles of the source instead of decoding and encoding them again. 
+Metadata go through the same readers and writers as Load and Save.
+
+@param src_io Source FreeImage IO
+@param src_handle Source handle
+@param src_page Source page number
+@param src_data Source TIFF plugin context
+@param io FreeImage IO
+@param handle FreeImage handle
+@param page Destination page number
+@param flags FreeImage TIFF save flag
+@param data TIFF plugin context
+@return Returns TRUE if successful, returns FALSE if the page must be saved with Save
+*/
+static BOOL DLL_CALLCONV
+CopyPage(FreeImageIO *src_io, fi_handle src_handle, int src_page, void *src_data, FreeImageIO *io, fi_handle handle, int page, int flags, void *data) {
+	if (!src_data || !data) {
+		return FALSE;
+	}
+
+	TIFF *in = ((fi_TIFFIO*)src_data)->tif;
+	TIFF *out = ((fi_TIFFIO*)data)->tif;
+
+	if (!TIFFSetDirectory(in, (uint16_t)src_page) || !CanCopyRawPage(in, flags)) {
+		return FALSE;
+	}
+
+	FIBITMAP *metadata = nullptr;
+	
+	try {
+		// image structure, the compression goes first as it enables the codec tags
+
+		CopyShortField(in, out, TIFFTAG_COMPRESSION);
+		CopyLongField(in, out, TIFFTAG_IMAGEWIDTH);
+		CopyLongField(in, out, TIFFTAG_IMAGELENGTH);
+		CopyShortField(in, out, TIFFTAG_BITSPERSAMPLE);
+		CopyShortField(in, out, TIFFTAG_SAMPLESPERPIXEL);
+		CopyShortField(in, out, TIFFTAG_SAMPLEFORMAT);
+		CopyShortField(in, out, TIFFTAG_PHOTOMETRIC);
+		CopyShortField(in, out, TIFFTAG_PLANARCONFIG);
+		CopyShortField(in, out, TIFFTAG_FILLORDER);
+		CopyShortField(in, out, TIFFTAG_ORIENTATION);
+		CopyShortField(in, out, TIFFTAG_INKSET);
+		CopyShortField(in, out, TIFFTAG_PREDICTOR);
+		CopyLongField(in, out, TIFFTAG_GROUP3OPTIONS);
+		CopyLongField(in, out, TIFFTAG_GROUP4OPTIONS);
+		CopyDataField(in, out, TIFFTAG_JPEGTABLES);
+
+		if (TIFFIsTiled(in)) {
+			CopyLongField(in, out, TIFFTAG_TILEWIDTH);
+			CopyLongField(in, out, TIFFTAG_TILELENGTH);
+		} else {
+			CopyLongField(in, out, TIFFTAG_ROWSPERSTRIP);
+		}
+
+		uint16_t extra_count = 0;
+		uint16_t *extra_samples = nullptr;
+		if (TIFFGetField(in, TIFFTAG_EXTRASAMPLES, &extra_count, &extra_samples) && extra_count) {
+			TIFFSetField(out, TIFFTAG_EXTRASAMPLES, extra_count, extra_samples);
+		}
+
+		uint16_t *r = nullptr, *g = nullptr, *b = nullptr;
+		if (TIFFGetField(in, TIFFTAG_COLORMAP, &r, &g, &b)) {
+			TIFFSetField(out, TIFFTAG_COLORMAP, r, g, b);
+		}
+
+		uint16_t subsampling[2];
+		if (TIFFGetField(in, TIFFTAG_YCBCRSUBSAMPLING, &subsampling[0], &subsampling[1])) {
+			TIFFSetField(out, TIFFTAG_YCBCRSUBSAMPLING, subsampling[0], subsampling[1]);
+		}
+		CopyShortField(in, out, TIFFTAG_YCBCRPOSITIONING);
+
+		float *reference = nullptr;
+		if (TIFFGetField(in, TIFFTAG_REFERENCEBLACKWHITE, &reference)) {
+			TIFFSetField(out, TIFFTAG_REFERENCEBLACKWHITE, reference);
+		}
+
+		// metrics and color profile
+
+		CopyRationalField(in, out, TIFFTAG_XRESOLUTION);
+		CopyRationalField(in, out, TIFFTAG_YRESOLUTION);
+		CopyShortField(in, out, TIFFTAG_RESOLUTIONUNIT);
+		CopyDataField(in, out, TIFFTAG_ICCPROFILE);
+
+		// multi-paging, as in SaveOneTIFF
+
+		char page_number[20];
+		sprintf(page_number, "Page %d", page);
+
+		TIFFSetField(out, TIFFTAG_SUBFILETYPE, (uint32_t)FILETYPE_PAGE);
+		TIFFSetField(out, TIFFTAG_PAGENUMBER, (uint16_t)page, (uint16_t)0);
+		TIFFSetField(out, TIFFTAG_PAGENAME, page_number);
+
+		// metadata, read into a header only bitmap
+
+		metadata = FreeImage_AllocateHeader(TRUE, 1, 1, 8);
+		if (!metadata) {
+			throw FI_MSG_ERROR_MEMORY;
+		}
+		ReadMetadata(src_io, src_handle, in, metadata);
+		WriteMetadata(out, metadata);
+		FreeImage_Unload(metadata);
+		metadata = nullptr;
+
+		// compressed strips or tiles
+
+		const BOOL tiled = TIFFIsTiled(in);
+		const uint32_t chunkCount = tiled ? TIFFNumberOfTiles(in) : TIFFNumberOfStrips(in);
+		std::vector<uint8_t> buffer;
+
+		for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+			const tmsize_t size = (tmsize_t)TIFFGetStrileByteCount(in, chunk);
+			buffer.resize((size_t)size);
+
+			const tmsize_t read = tiled ? TIFFReadRawTile(in, chunk, buffer.data(), size) : TIFFReadRawStrip(in, chunk, buffer.data(), size);
+			if (read != size) {
+				throw "Failed to read TIFF strips";
+			}
+			const tmsize_t written = tiled ? TIFFWriteRawTile(out, chunk, buffer.data(), size) : TIFFWriteRawStrip(out, chunk, buffer.data(), size);
+			if (written != size) {
+				throw "Failed to write TIFF strips";
+			}
+		}
+
+		TIFFWriteDirectory(out);
+
+		return TRUE;
+
+	} catch(const char *text) {
+		if (metadata) {
+			FreeImage_Unload(metadata);
+		}
+		// drop the partial directory, the page is saved again by the caller
+		TIFFFreeDirectory(out);
+		TIFFCreateDirectory(out);
+
+		FreeImage_OutputMessageProc(s_format_id, text);
+		return FALSE;
+	}
+}
+
 // ==========================================================
 //   Init
 // ==========================================================
@@ -2671,9 +3932,12 @@ InitTIFF(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = Save;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
 	plugin->supports_icc_profiles_proc = SupportsICCProfiles;
 	plugin->supports_no_pixels_proc = SupportsNoPixels; 
+	plugin->load_region_proc = LoadRegion;
+	plugin->copypage_proc = CopyPage;
 }
@@ -21,6 +21,7 @@
 
 #include "FreeImage.h"
 #include "Utilities.h"
+#include "FreeImageIO.h"
 
 #include "../Metadata/FreeImageTag.h"
 
@@ -39,13 +40,31 @@ static int s_format_id;
 // ----------------------------------------------------------
 
 /**
-Read the whole file into memory
+Read the whole file into memory. 
+When the stream is a memory stream (e.g. a mapped file), the bitstream is a view of the stream data and is not copied.
+@param io FreeImageIO structure
+@param handle FreeImageIO handle
+@param bitstream Returned bitstream
+@param is_view Returned TRUE if the bitstream is a view of the stream data, returned FALSE if it must be released using free
 */
 static BOOL
-ReadFileToWebPData(FreeImageIO *io, fi_handle handle, WebPData * const bitstream) {
+ReadFileToWebPData(FreeImageIO *io, fi_handle handle, WebPData * const bitstream, BOOL *is_view) {
   uint8_t *raw_data = nullptr;
 
+  *is_view = FALSE;
+
   try {
+	  const uint8_t *view = nullptr;
+	  size_t view_size = 0;
+	  if(GetIOView(io, handle, &view, &view_size)) {
+		  // zero-copy : the stream remains open while the mux is in use
+		  io->seek_proc(handle, 0, SEEK_END);
+		  bitstream->bytes = view;
+		  bitstream->size = view_size;
+		  *is_view = TRUE;
+		  return TRUE;
+	  }
+
 	  // Read the input file and put it in memory
 	  long start_pos = io->tell_proc(handle);
 	  io->seek_proc(handle, 0, SEEK_END);
@@ -138,6 +157,20 @@ Validate(FreeImageIO *io, fi_handle handle) {
 	return FALSE;
 }
 
+static const FISIGNATURE * DLL_CALLCONV
+Signature(int *count) {
+	// "RIFF" chunk (the chunk size is ignored) of type WEBP
+	static const uint8_t webp_signature[] = { 0x52, 0x49, 0x46, 0x46, 0x00, 0x00, 0x00, 0x00, 0x57, 0x45, 0x42, 0x50 };
+	static const uint8_t webp_signature_mask[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF };
+
+	static const FISIGNATURE signatures[] = {
+		{ 0, sizeof(webp_signature), webp_signature, webp_signature_mask }
+	};
+
+	*count = (int)(sizeof(signatures) / sizeof(signatures[0]));
+	return signatures;
+}
+
 static BOOL DLL_CALLCONV
 SupportsExportDepth(int depth) {
 	return (
@@ -171,14 +204,21 @@ Open(FreeImageIO *io, fi_handle handle, BOOL read) {
 	if(read) {
 		// create the MUX object from the input stream
 		WebPData bitstream;
+		BOOL is_view = FALSE;
 		// read the input file and put it in memory
-		if(!ReadFileToWebPData(io, handle, &bitstream)) {
+		if(!ReadFileToWebPData(io, handle, &bitstream, &is_view)) {
 			return nullptr;
 		}
+		if(is_view) {
+			// keep a link to the stream data, which outlives the mux
+			copy_data = 0;
+		}
 		// create the MUX object
 		mux = WebPMuxCreate(&bitstream, copy_data);
-		// no longer needed since copy_data == 1
-		free((void*)bitstream.bytes);
+		if(!is_view) {
+			// no longer needed since copy_data == 1
+			free((void*)bitstream.bytes);
+		}
 		if(mux == nullptr) {
 			FreeImage_OutputMessageProc(s_format_id, "Failed to create mux object from file");
 			return nullptr;
@@ -434,8 +474,6 @@ EncodeImage(FIMEMORY *hmem, FIBITMAP *dib, int flags) {
 	WebPPicture picture;	// Input buffer
 	WebPConfig config;		// Coding parameters
 
-	BOOL bIsFlipped = FALSE;
-
 	try {
 		const unsigned width = FreeImage_GetWidth(dib);
 		const unsigned height = FreeImage_GetHeight(dib);
@@ -494,30 +532,28 @@ EncodeImage(FIMEMORY *hmem, FIBITMAP *dib, int flags) {
 
 		// --- Perform encoding ---
 		
-		// Invert dib scanlines
-		bIsFlipped = FreeImage_FlipVertical(dib);
-
-
 		// convert dib buffer to output stream
+		// (dib scanlines are stored upside down : read them from the last one, with a negative stride)
 
-		const uint8_t *bits = FreeImage_GetBits(dib);
+		const uint8_t *bits = FreeImage_GetConstScanLine(dib, height - 1);
+		const int stride = -(int)pitch;
 
 #if FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR
 		switch(bpp) {
 			case 24:
-				WebPPictureImportBGR(&picture, bits, pitch);
+				WebPPictureImportBGR(&picture, bits, stride);
 				break;
 			case 32:
-				WebPPictureImportBGRA(&picture, bits, pitch);
+				WebPPictureImportBGRA(&picture, bits, stride);
 				break;
 		}
 #else
 		switch(bpp) {
 			case 24:
-				WebPPictureImportRGB(&picture, bits, pitch);
+				WebPPictureImportRGB(&picture, bits, stride);
 				break;
 			case 32:
-				WebPPictureImportRGBA(&picture, bits, pitch);
+				WebPPictureImportRGBA(&picture, bits, stride);
 				break;
 		}
 
@@ -529,22 +565,12 @@ EncodeImage(FIMEMORY *hmem, FIBITMAP *dib, int flags) {
 
 		WebPPictureFree(&picture);
 
-		if(bIsFlipped) {
-			// invert dib scanlines
-			FreeImage_FlipVertical(dib);
-		}
-
 		return TRUE;
 
 	} catch (const char* text) {
 
 		WebPPictureFree(&picture);
 
-		if(bIsFlipped) {
-			// invert dib scanlines
-			FreeImage_FlipVertical(dib);
-		}
-
 		if(nullptr != text) {
 			FreeImage_OutputMessageProc(s_format_id, text);
 		}
@@ -688,6 +714,7 @@ InitWEBP(Plugin *plugin, int format_id) {
 	plugin->load_proc = Load;
 	plugin->save_proc = Save;
 	plugin->validate_proc = Validate;
+	plugin->signature_proc = Signature;
 	plugin->mime_proc = MimeType;
 	plugin->supports_export_bpp_proc = SupportsExportDepth;
 	plugin->supports_export_type_proc = SupportsExportType;
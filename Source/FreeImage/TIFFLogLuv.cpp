@@ -46,8 +46,8 @@ void tiff_ConvertLineXYZToRGB(uint8_t *target, uint8_t *source, double stonits,
 	}
 }
 
-void tiff_ConvertLineRGBToXYZ(uint8_t *target, uint8_t *source, int width_in_pixels) {
-	FIRGBF *rgbf = (FIRGBF*)source;
+void tiff_ConvertLineRGBToXYZ(uint8_t *target, const uint8_t *source, int width_in_pixels) {
+	const FIRGBF *rgbf = (const FIRGBF*)source;
 	float *xyz = (float*)target;
 	
 	for (int cols = 0; cols < width_in_pixels; cols++) {
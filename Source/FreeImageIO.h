@@ -39,13 +39,13 @@ FI_STRUCT (FIMEMORYHEADER) {
 	file_length is equal to the input buffer size when the buffer is a wrapped buffer, i.e. file_length == data_length. 
 	file_length is the amount of the written bytes when the buffer is a read/write buffer.
 	*/
-	long file_length;
+	int64_t file_length;
 	/**
 	When using read-only input buffers, data_length is equal to the input buffer size, i.e. the file_length.
 	When using read/write buffers, data_length is the size of the allocated buffer, 
 	whose size is greater than or equal to file_length.
 	*/
-	long data_length;
+	int64_t data_length;
 	/**
 	start buffer address
 	*/
@@ -53,11 +53,122 @@ FI_STRUCT (FIMEMORYHEADER) {
 	/**
 	Current position into the memory stream
 	*/
-	long current_position;
+	int64_t current_position;
+	/**
+	Segment size of a segmented stream (see FreeImage_OpenMemorySegmented), 0 for a contiguous stream. 
+	A segmented stream stores its data into fixed-size segments instead of the 'data' buffer : 
+	it grows without reallocating nor copying the data already written. 
+	data_length is then the total size of the allocated segments.
+	*/
+	uint32_t segment_size;
+	/**
+	Segment table of a segmented stream
+	*/
+	uint8_t **segments;
+	/**
+	Number of allocated segments
+	*/
+	unsigned segment_count;
+	/**
+	Capacity of the segment table
+	*/
+	unsigned segment_capacity;
 };
 
 void SetDefaultIO(FreeImageIO *io);
 
 void SetMemoryIO(FreeImageIO *io);
 
+/**
+Seek with a 64-bit offset. 
+Memory streams, the default file IO and the IO set by SetIO64 are sought directly, 
+other streams are sought by steps that fit into the 'long' offset of their seek_proc.
+@return Returns 0 if successful, returns a nonzero value otherwise
+*/
+int IOSeek64(FreeImageIO *io, fi_handle handle, int64_t offset, int origin);
+
+/**
+Get the current stream position as a 64-bit offset (see IOSeek64)
+@return Returns the current position if successful, returns -1 otherwise
+*/
+int64_t IOTell64(FreeImageIO *io, fi_handle handle);
+
+/**
+FreeImageIO wrapper of a FreeImageIO64 : plugins use the wrapper as any other FreeImageIO, 
+IOSeek64 and IOTell64 forward to the 64-bit functions of the wrapped IO
+*/
+FI_STRUCT (FIIO64HANDLE) {
+	FreeImageIO64 *io;
+	fi_handle handle;
+};
+
+/**
+Wrap a FreeImageIO64. 
+The handle to pass to the plugins is the FIIO64HANDLE itself.
+*/
+void SetIO64(FreeImageIO *io, FIIO64HANDLE *io64_handle, FreeImageIO64 *io64, fi_handle handle);
+
+/**
+Release the segments of a segmented memory stream
+*/
+void FreeMemorySegments(FIMEMORYHEADER *mem_header);
+
+/**
+Turn a segmented memory stream into a contiguous stream, copying its segments into a single buffer
+@return Returns TRUE if successful, returns FALSE otherwise
+*/
+BOOL FlattenMemorySegments(FIMEMORYHEADER *mem_header);
+
+// ----------------------------------------------------------
+
+/**
+Read-only view of a whole file mapped into the address space.
+The view is wrapped into a FIMEMORY stream (see FreeImage_OpenMemory) so that every plugin can read it 
+through the memory IO functions, without any intermediate copy of the file.
+*/
+FI_STRUCT (FIMAPPEDFILE) {
+	/**
+	start address of the mapped view
+	*/
+	uint8_t *data;
+	/**
+	size of the mapped view, i.e. the file size
+	*/
+	size_t size;
+};
+
+/**
+Map a file into memory, read-only.
+@param filename Name of the file to map
+@return Returns the mapping if successful, returns nullptr otherwise (e.g. empty file, file larger than the address space, 
+or file that cannot be mapped). Use UnmapFile to release the mapping.
+*/
+FIMAPPEDFILE* MapFile(const char *filename);
+
+#ifdef _WIN32
+/**
+Unicode version of MapFile
+*/
+FIMAPPEDFILE* MapFileU(const wchar_t *filename);
+#endif
+
+/**
+Release a mapping created with MapFile.
+@param mapping Mapping to release, may be nullptr
+*/
+void UnmapFile(FIMAPPEDFILE *mapping);
+
+/**
+Get a contiguous view of the bytes remaining in a stream, starting at the current stream position.
+Only memory streams (FIMEMORY used with the memory IO functions) provide such a view: plugins use it 
+to decode directly from a memory buffer or a mapped file instead of reading the stream into a temporary buffer.
+The view is valid as long as the stream is not written to nor closed. The stream position is not modified.
+@param io FreeImageIO structure
+@param handle Handle to the stream
+@param data Returned start address of the view
+@param size Returned number of bytes available from 'data'
+@return Returns TRUE if the stream provides a view, returns FALSE otherwise
+*/
+BOOL GetIOView(FreeImageIO *io, fi_handle handle, const uint8_t **data, size_t *size);
+
 #endif // !FREEIMAGE_IO_H
@@ -46,40 +46,19 @@ FreeImage_RescaleRect(FIBITMAP *src, int dst_width, int dst_height, int src_left
 		return nullptr;
 	}
 
-	// select the filter
-	CGenericFilter *pFilter = nullptr;
-	switch (filter) {
-		case FILTER_BOX:
-			pFilter = new(std::nothrow) CBoxFilter();
-			break;
-		case FILTER_BICUBIC:
-			pFilter = new(std::nothrow) CBicubicFilter();
-			break;
-		case FILTER_BILINEAR:
-			pFilter = new(std::nothrow) CBilinearFilter();
-			break;
-		case FILTER_BSPLINE:
-			pFilter = new(std::nothrow) CBSplineFilter();
-			break;
-		case FILTER_CATMULLROM:
-			pFilter = new(std::nothrow) CCatmullRomFilter();
-			break;
-		case FILTER_LANCZOS3:
-			pFilter = new(std::nothrow) CLanczos3Filter();
-			break;
-	}
-
-	if (!pFilter) {
+	// check the filter
+	if ((filter < FILTER_BOX) || (filter > FILTER_LANCZOS3)) {
 		return nullptr;
 	}
 
-	CResizeEngine Engine(pFilter);
+	// multithreaded filtering is enabled either globally or for this call only
+	const unsigned threads = GetWorkerCount((flags & FI_RESCALE_MULTITHREADED) == FI_RESCALE_MULTITHREADED);
+
+	CResizeEngine Engine(filter, threads);
 
 	dst = Engine.scale(src, dst_width, dst_height, src_left, src_top,
 			src_right - src_left, src_bottom - src_top, flags);
 
-	delete pFilter;
-
 	if ((flags & FI_RESCALE_OMIT_METADATA) != FI_RESCALE_OMIT_METADATA) {
 		// copy metadata from src to dst
 		FreeImage_CloneMetadata(dst, src);
@@ -190,3 +169,48 @@ FreeImage_MakeThumbnail(FIBITMAP *dib, int max_pixel_size, BOOL convert) {
 
 	return thumbnail;
 }
+
+// ==========================================================
+// Streaming rescale
+// ==========================================================
+
+FIRESCALER * DLL_CALLCONV
+FreeImage_OpenRescaler(FREE_IMAGE_TYPE type, unsigned bpp, int src_width, int src_height, int dst_width, int dst_height, FREE_IMAGE_FILTER filter, FI_ReadScanlineProc read_proc, void *data) {
+	if (!read_proc || (src_width <= 0) || (src_height <= 0) || (dst_width <= 0) || (dst_height <= 0)) {
+		return nullptr;
+	}
+	if ((filter < FILTER_BOX) || (filter > FILTER_LANCZOS3)) {
+		return nullptr;
+	}
+
+	FIRESCALER *rescaler = new(std::nothrow) FIRESCALER;
+	if (rescaler) {
+		CStreamingResizeEngine *engine = new(std::nothrow) CStreamingResizeEngine(filter, type, bpp, src_width, src_height, dst_width, dst_height, read_proc, data);
+		if (engine && engine->isValid()) {
+			rescaler->data = engine;
+		} else {
+			delete engine;
+			delete rescaler;
+			rescaler = nullptr;
+		}
+	}
+
+	return rescaler;
+}
+
+BOOL DLL_CALLCONV
+FreeImage_ReadRescaledScanline(FIRESCALER *rescaler, uint8_t *bits) {
+	if (rescaler && bits) {
+		CStreamingResizeEngine *engine = (CStreamingResizeEngine*)rescaler->data;
+		return engine->readScanline(bits);
+	}
+	return FALSE;
+}
+
+void DLL_CALLCONV
+FreeImage_CloseRescaler(FIRESCALER *rescaler) {
+	if (rescaler) {
+		delete (CStreamingResizeEngine*)rescaler->data;
+		delete rescaler;
+	}
+}
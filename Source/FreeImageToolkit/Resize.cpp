@@ -23,6 +23,34 @@
 
 #include "Resize.h"
 
+#include <list>
+#include <mutex>
+
+// SIMD instruction sets used by the fixed-point kernels
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define FI_RESIZE_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER) || defined(__GNUC__) || defined(__clang__)
+#define FI_RESIZE_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define FI_RESIZE_TARGET_AVX2
+#else
+#define FI_RESIZE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)) && !defined(__ARM_BIG_ENDIAN)
+#define FI_RESIZE_NEON
+#include <arm_neon.h>
+#endif
+
+/// Minimum number of rows (or columns) filtered by a single worker thread
+static const unsigned RESIZE_MIN_BAND_SIZE = 16;
+
+/// Number of fractional bits of the fixed-point filter weights
+static const int RESIZE_FIXED_POINT_BITS = 14;
+
 /**
 Returns the color type of a bitmap. In contrast to FreeImage_GetColorType,
 this function optionally supports a boolean OUT parameter, that receives TRUE,
@@ -138,6 +166,8 @@ GetRGBAPalette(FIBITMAP *dib, RGBQUAD * const buffer) {
 
 // --------------------------------------------------------------------------
 
+static BOOL HasResizeKernels();
+
 CWeightsTable::CWeightsTable(CGenericFilter *pFilter, unsigned uDstSize, unsigned uSrcSize) {
 	double dWidth;
 	double dFScale;
@@ -162,12 +192,14 @@ CWeightsTable::CWeightsTable(CGenericFilter *pFilter, unsigned uDstSize, unsigne
 	m_WindowSize = 2 * (int)ceil(dWidth) + 1; 
 	// length of dst line (no. of rows / cols) 
 	m_LineLength = uDstSize; 
+	m_FixedWeights = nullptr;
 
 	 // allocate list of contributions 
 	m_WeightTable = (Contribution*)malloc(m_LineLength * sizeof(Contribution));
-	for(unsigned u = 0; u < m_LineLength; u++) {
-		// allocate contributions for every pixel
-		m_WeightTable[u].Weights = (double*)malloc(m_WindowSize * sizeof(double));
+	// allocate contributions for every pixel, in a single block
+	m_Weights = (double*)malloc((size_t)m_LineLength * m_WindowSize * sizeof(double));
+	if (!m_WeightTable || !m_Weights) {
+		return;
 	}
 
 	// offset for discrete to continuous coordinate conversion
@@ -175,6 +207,7 @@ CWeightsTable::CWeightsTable(CGenericFilter *pFilter, unsigned uDstSize, unsigne
 
 	for(unsigned u = 0; u < m_LineLength; u++) {
 		// scan through line of contributions
+		double *weights = m_Weights + (size_t)u * m_WindowSize;
 
 		// inverse mapping (discrete dst 'u' to continous src 'dCenter')
 		const double dCenter = (double)u / dScale + dOffset;
@@ -191,21 +224,21 @@ CWeightsTable::CWeightsTable(CGenericFilter *pFilter, unsigned uDstSize, unsigne
 			// calculate weights
 			const double weight = dFScale * pFilter->Filter(dFScale * ((double)iSrc + 0.5 - dCenter));
 			// assert((iSrc-iLeft) < m_WindowSize);
-			m_WeightTable[u].Weights[iSrc-iLeft] = weight;
+			weights[iSrc-iLeft] = weight;
 			dTotalWeight += weight;
 		}
 		if((dTotalWeight > 0) && (dTotalWeight != 1)) {
 			// normalize weight of neighbouring points
 			for(int iSrc = iLeft; iSrc < iRight; iSrc++) {
 				// normalize point
-				m_WeightTable[u].Weights[iSrc-iLeft] /= dTotalWeight; 
+				weights[iSrc-iLeft] /= dTotalWeight; 
 			}
 		}
 
 		// simplify the filter, discarding null weights at the right
 		{			
 			int iTrailing = iRight - iLeft - 1;
-			while(m_WeightTable[u].Weights[iTrailing] == 0) {
+			while(weights[iTrailing] == 0) {
 				m_WeightTable[u].Right--;
 				iTrailing--;
 				if(m_WeightTable[u].Right == m_WeightTable[u].Left) {
@@ -216,15 +249,866 @@ CWeightsTable::CWeightsTable(CGenericFilter *pFilter, unsigned uDstSize, unsigne
 		}
 
 	} // next dst pixel
+
+	// fixed-point weights are only needed by the SIMD kernels
+	if (HasResizeKernels()) {
+		buildFixedPointWeights();
+	}
 }
 
 CWeightsTable::~CWeightsTable() {
-	for(unsigned u = 0; u < m_LineLength; u++) {
-		// free contributions for every pixel
-		free(m_WeightTable[u].Weights);
-	}
+	// free contributions for every pixel
+	free(m_Weights);
 	// free list of pixels contributions
 	free(m_WeightTable);
+	// free fixed-point weights
+	free(m_FixedWeights);
+}
+
+BOOL CWeightsTable::buildFixedPointWeights() {
+	int16_t *weights = (int16_t*)malloc(m_LineLength * m_WindowSize * sizeof(int16_t));
+	if (!weights) {
+		return FALSE;
+	}
+
+	const double dOne = (double)(1 << RESIZE_FIXED_POINT_BITS);
+
+	for (unsigned u = 0; u < m_LineLength; u++) {
+		const unsigned iLimit = m_WeightTable[u].Right - m_WeightTable[u].Left;
+		int16_t *fixed = weights + u * m_WindowSize;
+
+		// round the running sum of the weights rather than each weight, so that
+		// the rounding errors do not accumulate (normalized weights sum up to exactly one)
+		double dSum = 0;
+		double dPrevious = 0;
+		for (unsigned i = 0; i < iLimit; i++) {
+			dSum += m_Weights[(size_t)u * m_WindowSize + i];
+			const double dRounded = floor(dSum * dOne + 0.5);
+			const double weight = dRounded - dPrevious;
+			if ((weight < -32768) || (weight > 32767)) {
+				// the weight cannot be represented with 16 bits
+				free(weights);
+				return FALSE;
+			}
+			fixed[i] = (int16_t)weight;
+			dPrevious = dRounded;
+		}
+		for (unsigned i = iLimit; i < m_WindowSize; i++) {
+			fixed[i] = 0;
+		}
+	}
+
+	m_FixedWeights = weights;
+
+	return TRUE;
+}
+
+// --------------------------------------------------------------------------
+// Fixed-point SIMD kernels for 8-bit RGB and RGBA images
+//
+// Both filtering passes of 24- and 32-bit FIT_BITMAP images accumulate
+// the samples with 16-bit fixed-point weights in 32-bit integers. Between
+// both passes, the samples are kept in 16 bits with RESIZE_INTERMEDIATE_BITS
+// fractional bits (in a FIT_RGB16 or FIT_RGBA16 temporary image), so that
+// only the second pass rounds to 8 bits and the result differs by at most
+// one LSB from the floating-point implementation.
+// The horizontal kernels filter a whole row, the vertical kernels filter
+// a span of samples of a destination row (regardless of the number of channels).
+// Kernels are instantiated for 8-bit samples (uint8_t) and intermediate samples (int16_t).
+// --------------------------------------------------------------------------
+
+/// Number of fractional bits of the intermediate samples kept between both filtering passes
+static const int RESIZE_INTERMEDIATE_BITS = 7;
+
+/// Largest intermediate sample (255.0)
+static const int RESIZE_INTERMEDIATE_MAX = 0xFF << RESIZE_INTERMEDIATE_BITS;
+
+/// Number of fractional bits of a sample type
+template <class T> struct ResizeSampleBits;
+template <> struct ResizeSampleBits<uint8_t> { static const int value = 0; };
+template <> struct ResizeSampleBits<int16_t> { static const int value = RESIZE_INTERMEDIATE_BITS; };
+
+/// Right shift converting a sum of weighted S samples into a D sample
+template <class S, class D> struct ResizeShift {
+	static const int value = RESIZE_FIXED_POINT_BITS + ResizeSampleBits<S>::value - ResizeSampleBits<D>::value;
+};
+
+/// Sample conversion performed by a filtering pass
+typedef enum {
+	RESIZE_PASS_SINGLE = 0,	//! 8-bit samples to 8-bit samples (the image is filtered in a single direction)
+	RESIZE_PASS_FIRST = 1,	//! 8-bit samples to intermediate samples
+	RESIZE_PASS_SECOND = 2	//! intermediate samples to 8-bit samples
+} RESIZE_PASS;
+
+/**
+Filters a row of pixels horizontally
+@param weightsTable Weights table with fixed-point weights
+@param src_bits Pointer to the first source pixel of the row
+@param dst_bits Pointer to the first destination pixel of the row
+@param dst_width Number of destination pixels
+*/
+typedef void (*RESIZE_HORIZONTAL_KERNEL)(const CWeightsTable& weightsTable, const void *src_bits, void *dst_bits, unsigned dst_width);
+
+/**
+Filters a span of samples of a destination row vertically
+@param src_bits Pointer to the first sample of the span in the topmost contributing source row
+@param src_pitch Source pitch (in bytes)
+@param weights Fixed-point weights of the contributing source rows
+@param count Number of contributing source rows
+@param dst_bits Pointer to the first sample of the span in the destination row
+@param size Number of samples in the span
+*/
+typedef void (*RESIZE_VERTICAL_KERNEL)(const void *src_bits, unsigned src_pitch, const int16_t *weights, unsigned count, void *dst_bits, unsigned size);
+
+/// Stores a shifted sum into a clamped 8-bit sample
+static inline void
+StoreSample(int value, uint8_t *dst) {
+	*dst = (uint8_t)CLAMP<int>(value, 0, 0xFF);
+}
+
+/// Stores a shifted sum into a clamped intermediate sample
+static inline void
+StoreSample(int value, int16_t *dst) {
+	*dst = (int16_t)CLAMP<int>(value, 0, RESIZE_INTERMEDIATE_MAX);
+}
+
+/**
+Filters a span of samples vertically, one sample at a time
+@see RESIZE_VERTICAL_KERNEL
+*/
+template <class S, class D> static void
+VerticalSpanScalar(const void *src_bits, unsigned src_pitch, const int16_t *weights, unsigned count, void *dst_bits, unsigned size) {
+	const int shift = ResizeShift<S, D>::value;
+	D *dst = (D*)dst_bits;
+
+	for (unsigned x = 0; x < size; x++) {
+		const uint8_t *src = (const uint8_t*)src_bits + x * sizeof(S);
+		int value = 1 << (shift - 1);
+		for (unsigned i = 0; i < count; i++) {
+			value += weights[i] * (int)*(const S*)src;
+			src += src_pitch;
+		}
+		StoreSample(value >> shift, dst + x);
+	}
+}
+
+#if defined(FI_RESIZE_SSE2)
+
+/// Packs two 16-bit weights into each 32-bit lane, for use with _mm_madd_epi16
+static inline __m128i
+PackWeightsSSE2(int16_t w0, int16_t w1) {
+	return _mm_set1_epi32((int)((unsigned)(uint16_t)w0 | ((unsigned)(uint16_t)w1 << 16)));
+}
+
+/**
+Accumulates the weighted channels of the 4-channel pixels of a horizontal window
+@param pixel Pointer to the leftmost pixel of the window
+@param weights Fixed-point weights of the window
+@param count Number of pixels in the window
+@param sum Initial sums (rounding constant)
+@return Returns the four 32-bit sums
+*/
+static inline __m128i
+HorizontalPixel32SSE2(const uint8_t *pixel, const int16_t *weights, unsigned count, __m128i sum) {
+	const __m128i zero = _mm_setzero_si128();
+	unsigned i = 0;
+
+	for (; i + 1 < count; i += 2) {
+		// b0 g0 r0 a0 b1 g1 r1 a1 -> b0 b1 g0 g1 r0 r1 a0 a1
+		__m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(pixel + i * 4)), zero);
+		pixels = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels, PackWeightsSSE2(weights[i], weights[i + 1])));
+	}
+	if (i < count) {
+		int value;
+		memcpy(&value, pixel + i * 4, 4);
+		__m128i pixels = _mm_unpacklo_epi8(_mm_cvtsi32_si128(value), zero);
+		pixels = _mm_unpacklo_epi16(pixels, zero);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels, PackWeightsSSE2(weights[i], 0)));
+	}
+
+	return sum;
+}
+
+/// Loads a 3-channel pixel into the low bytes of a register
+static inline __m128i
+LoadPixel24SSE2(const uint8_t *pixel) {
+	return _mm_cvtsi32_si128(pixel[0] | (pixel[1] << 8) | (pixel[2] << 16));
+}
+
+/**
+Accumulates the weighted channels of the 3-channel pixels of a horizontal window
+@see HorizontalPixel32SSE2
+*/
+static inline __m128i
+HorizontalPixel24SSE2(const uint8_t *pixel, const int16_t *weights, unsigned count, __m128i sum) {
+	const __m128i zero = _mm_setzero_si128();
+	unsigned i = 0;
+
+	// while a third pixel follows, 8 bytes can be read without leaving the window
+	for (; i + 2 < count; i += 2) {
+		// b0 g0 r0 b1 g1 r1 -> b0 b1 g0 g1 r0 r1 (the fourth lane is unused)
+		__m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(pixel + i * 3)), zero);
+		pixels = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 6));
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels, PackWeightsSSE2(weights[i], weights[i + 1])));
+	}
+	if (i + 1 < count) {
+		const __m128i pixel0 = _mm_unpacklo_epi8(LoadPixel24SSE2(pixel + i * 3), zero);
+		const __m128i pixel1 = _mm_unpacklo_epi8(LoadPixel24SSE2(pixel + i * 3 + 3), zero);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(pixel0, pixel1), PackWeightsSSE2(weights[i], weights[i + 1])));
+	} else if (i < count) {
+		const __m128i pixel0 = _mm_unpacklo_epi8(LoadPixel24SSE2(pixel + i * 3), zero);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(pixel0, zero), PackWeightsSSE2(weights[i], 0)));
+	}
+
+	return sum;
+}
+
+/// Loads the channels of an intermediate pixel into the low 16-bit lanes of a register (unused lanes are zero)
+static inline __m128i
+LoadPixel16SSE2(const int16_t *pixel, unsigned channels) {
+	if (channels == 4) {
+		return _mm_loadl_epi64((const __m128i*)pixel);
+	}
+	int value;
+	memcpy(&value, pixel, 2 * sizeof(int16_t));
+	return _mm_insert_epi16(_mm_cvtsi32_si128(value), pixel[2], 2);
+}
+
+/**
+Accumulates the weighted channels of the intermediate pixels of a horizontal window
+@param channels Number of channels (3 or 4)
+@see HorizontalPixel32SSE2
+*/
+static inline __m128i
+HorizontalPixel16SSE2(const int16_t *pixel, const int16_t *weights, unsigned count, __m128i sum, unsigned channels) {
+	unsigned i = 0;
+
+	// 4 samples are read from each pixel : while a third pixel follows, the
+	// samples read after a 3-channel pixel are still inside the window (fourth lane, unused)
+	for (; i + 2 < count; i += 2) {
+		const __m128i pixel0 = _mm_loadl_epi64((const __m128i*)(pixel + i * channels));
+		const __m128i pixel1 = _mm_loadl_epi64((const __m128i*)(pixel + i * channels + channels));
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(pixel0, pixel1), PackWeightsSSE2(weights[i], weights[i + 1])));
+	}
+	if (i + 1 < count) {
+		const __m128i pixel0 = _mm_loadl_epi64((const __m128i*)(pixel + i * channels));
+		const __m128i pixel1 = LoadPixel16SSE2(pixel + i * channels + channels, channels);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(pixel0, pixel1), PackWeightsSSE2(weights[i], weights[i + 1])));
+	} else if (i < count) {
+		const __m128i pixel0 = LoadPixel16SSE2(pixel + i * channels, channels);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(pixel0, _mm_setzero_si128()), PackWeightsSSE2(weights[i], 0)));
+	}
+
+	return sum;
+}
+
+/// @see HorizontalPixel16SSE2
+static inline __m128i
+HorizontalPixel32SSE2(const int16_t *pixel, const int16_t *weights, unsigned count, __m128i sum) {
+	return HorizontalPixel16SSE2(pixel, weights, count, sum, 4);
+}
+
+/// @see HorizontalPixel16SSE2
+static inline __m128i
+HorizontalPixel24SSE2(const int16_t *pixel, const int16_t *weights, unsigned count, __m128i sum) {
+	return HorizontalPixel16SSE2(pixel, weights, count, sum, 3);
+}
+
+/// Stores four shifted sums into the clamped 8-bit channels of a pixel
+static inline void
+StorePixelSSE2(__m128i sum, uint8_t *dst, unsigned channels) {
+	sum = _mm_packs_epi32(sum, sum);
+	const int value = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+	memcpy(dst, &value, channels);
+}
+
+/// Clamps eight 16-bit samples to the range of the intermediate samples
+static inline __m128i
+ClampIntermediateSSE2(__m128i samples) {
+	return _mm_min_epi16(_mm_max_epi16(samples, _mm_setzero_si128()), _mm_set1_epi16(RESIZE_INTERMEDIATE_MAX));
+}
+
+/// Stores four shifted sums into the clamped intermediate channels of a pixel
+static inline void
+StorePixelSSE2(__m128i sum, int16_t *dst, unsigned channels) {
+	int16_t samples[4];
+	_mm_storel_epi64((__m128i*)samples, ClampIntermediateSSE2(_mm_packs_epi32(sum, sum)));
+	memcpy(dst, samples, channels * sizeof(int16_t));
+}
+
+/// @see RESIZE_HORIZONTAL_KERNEL
+template <class S, class D, unsigned channels> static void
+HorizontalRowSSE2(const CWeightsTable& weightsTable, const void *src_bits, void *dst_bits, unsigned dst_width) {
+	const int shift = ResizeShift<S, D>::value;
+	const __m128i half = _mm_set1_epi32(1 << (shift - 1));
+	const S *src = (const S*)src_bits;
+	D *dst = (D*)dst_bits;
+
+	for (unsigned x = 0; x < dst_width; x++) {
+		const unsigned iLeft = weightsTable.getLeftBoundary(x);
+		const unsigned iLimit = weightsTable.getRightBoundary(x) - iLeft;
+		const int16_t *weights = weightsTable.getFixedPointWeights(x);
+		const __m128i sum = (channels == 3) ? HorizontalPixel24SSE2(src + iLeft * 3, weights, iLimit, half) : HorizontalPixel32SSE2(src + iLeft * 4, weights, iLimit, half);
+		StorePixelSSE2(_mm_srai_epi32(sum, shift), dst, channels);
+		dst += channels;
+	}
+}
+
+/// Accumulates 16 8-bit samples of two rows (samples1 is zero for a single row)
+static inline void
+MultiplyAddSSE2(__m128i samples0, __m128i samples1, __m128i weight, __m128i sum[4]) {
+	const __m128i zero = _mm_setzero_si128();
+	// interleave the samples of both rows, so that each 32-bit lane holds a pair of 16-bit samples
+	const __m128i lo = _mm_unpacklo_epi8(samples0, samples1);
+	const __m128i hi = _mm_unpackhi_epi8(samples0, samples1);
+	sum[0] = _mm_add_epi32(sum[0], _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), weight));
+	sum[1] = _mm_add_epi32(sum[1], _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), weight));
+	sum[2] = _mm_add_epi32(sum[2], _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), weight));
+	sum[3] = _mm_add_epi32(sum[3], _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), weight));
+}
+
+/// Accumulates 16 intermediate samples of two rows (lo1 and hi1 are zero for a single row)
+static inline void
+MultiplyAddSSE2(__m128i lo0, __m128i hi0, __m128i lo1, __m128i hi1, __m128i weight, __m128i sum[4]) {
+	sum[0] = _mm_add_epi32(sum[0], _mm_madd_epi16(_mm_unpacklo_epi16(lo0, lo1), weight));
+	sum[1] = _mm_add_epi32(sum[1], _mm_madd_epi16(_mm_unpackhi_epi16(lo0, lo1), weight));
+	sum[2] = _mm_add_epi32(sum[2], _mm_madd_epi16(_mm_unpacklo_epi16(hi0, hi1), weight));
+	sum[3] = _mm_add_epi32(sum[3], _mm_madd_epi16(_mm_unpackhi_epi16(hi0, hi1), weight));
+}
+
+/// Accumulates 16 8-bit samples of two rows
+static inline void
+MultiplyAddRowsSSE2(const uint8_t *row0, const uint8_t *row1, __m128i weight, __m128i sum[4]) {
+	MultiplyAddSSE2(_mm_loadu_si128((const __m128i*)row0), _mm_loadu_si128((const __m128i*)row1), weight, sum);
+}
+
+/// Accumulates 16 8-bit samples of a single row
+static inline void
+MultiplyAddRowSSE2(const uint8_t *row0, __m128i weight, __m128i sum[4]) {
+	MultiplyAddSSE2(_mm_loadu_si128((const __m128i*)row0), _mm_setzero_si128(), weight, sum);
+}
+
+/// Accumulates 16 intermediate samples of two rows
+static inline void
+MultiplyAddRowsSSE2(const int16_t *row0, const int16_t *row1, __m128i weight, __m128i sum[4]) {
+	MultiplyAddSSE2(_mm_loadu_si128((const __m128i*)row0), _mm_loadu_si128((const __m128i*)(row0 + 8)),
+		_mm_loadu_si128((const __m128i*)row1), _mm_loadu_si128((const __m128i*)(row1 + 8)), weight, sum);
+}
+
+/// Accumulates 16 intermediate samples of a single row
+static inline void
+MultiplyAddRowSSE2(const int16_t *row0, __m128i weight, __m128i sum[4]) {
+	const __m128i zero = _mm_setzero_si128();
+	MultiplyAddSSE2(_mm_loadu_si128((const __m128i*)row0), _mm_loadu_si128((const __m128i*)(row0 + 8)), zero, zero, weight, sum);
+}
+
+/// Shifts four vectors of four sums and stores them into 16 clamped 8-bit samples
+static inline void
+StoreSamplesSSE2(uint8_t *dst, const __m128i sum[4], int shift) {
+	const __m128i lo = _mm_packs_epi32(_mm_srai_epi32(sum[0], shift), _mm_srai_epi32(sum[1], shift));
+	const __m128i hi = _mm_packs_epi32(_mm_srai_epi32(sum[2], shift), _mm_srai_epi32(sum[3], shift));
+	_mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(lo, hi));
+}
+
+/// Shifts four vectors of four sums and stores them into 16 clamped intermediate samples
+static inline void
+StoreSamplesSSE2(int16_t *dst, const __m128i sum[4], int shift) {
+	const __m128i lo = _mm_packs_epi32(_mm_srai_epi32(sum[0], shift), _mm_srai_epi32(sum[1], shift));
+	const __m128i hi = _mm_packs_epi32(_mm_srai_epi32(sum[2], shift), _mm_srai_epi32(sum[3], shift));
+	_mm_storeu_si128((__m128i*)dst, ClampIntermediateSSE2(lo));
+	_mm_storeu_si128((__m128i*)(dst + 8), ClampIntermediateSSE2(hi));
+}
+
+/// @see RESIZE_VERTICAL_KERNEL
+template <class S, class D> static void
+VerticalSpanSSE2(const void *src_bits, unsigned src_pitch, const int16_t *weights, unsigned count, void *dst_bits, unsigned size) {
+	const int shift = ResizeShift<S, D>::value;
+	const __m128i half = _mm_set1_epi32(1 << (shift - 1));
+	unsigned x = 0;
+
+	for (; x + 16 <= size; x += 16) {
+		// accumulate 16 samples at a time, two source rows per multiply-add
+		__m128i sum[4] = { half, half, half, half };
+		const uint8_t *src = (const uint8_t*)src_bits + x * sizeof(S);
+		unsigned i = 0;
+
+		for (; i + 1 < count; i += 2) {
+			MultiplyAddRowsSSE2((const S*)src, (const S*)(src + src_pitch), PackWeightsSSE2(weights[i], weights[i + 1]), sum);
+			src += 2 * src_pitch;
+		}
+		if (i < count) {
+			MultiplyAddRowSSE2((const S*)src, PackWeightsSSE2(weights[i], 0), sum);
+		}
+
+		StoreSamplesSSE2((D*)dst_bits + x, sum, shift);
+	}
+
+	// remaining samples
+	VerticalSpanScalar<S, D>((const S*)src_bits + x, src_pitch, weights, count, (D*)dst_bits + x, size - x);
+}
+
+#endif // FI_RESIZE_SSE2
+
+#if defined(FI_RESIZE_AVX2)
+
+/// Packs two 16-bit weights into each 32-bit lane, for use with _mm256_madd_epi16
+static inline FI_RESIZE_TARGET_AVX2 __m256i
+PackWeightsAVX2(int16_t w0, int16_t w1) {
+	return _mm256_set1_epi32((int)((unsigned)(uint16_t)w0 | ((unsigned)(uint16_t)w1 << 16)));
+}
+
+/**
+Accumulates 32 8-bit samples of two rows (samples1 is zero for a single row).
+Unpack instructions work on each 128-bit lane : the sums hold the samples 0-3 and 16-19,
+4-7 and 20-23, 8-11 and 24-27, 12-15 and 28-31.
+*/
+static inline FI_RESIZE_TARGET_AVX2 void
+MultiplyAddAVX2(__m256i samples0, __m256i samples1, __m256i weight, __m256i sum[4]) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i lo = _mm256_unpacklo_epi8(samples0, samples1);
+	const __m256i hi = _mm256_unpackhi_epi8(samples0, samples1);
+	sum[0] = _mm256_add_epi32(sum[0], _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), weight));
+	sum[1] = _mm256_add_epi32(sum[1], _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), weight));
+	sum[2] = _mm256_add_epi32(sum[2], _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), weight));
+	sum[3] = _mm256_add_epi32(sum[3], _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), weight));
+}
+
+/**
+Accumulates 32 16-bit samples of two rows (lo1 and hi1 are zero for a single row),
+given as samples 0-7 and 16-23 (lo) and samples 8-15 and 24-27 (hi), so that
+the sums hold the samples in the same order as with 8-bit samples.
+*/
+static inline FI_RESIZE_TARGET_AVX2 void
+MultiplyAddAVX2(__m256i lo0, __m256i hi0, __m256i lo1, __m256i hi1, __m256i weight, __m256i sum[4]) {
+	sum[0] = _mm256_add_epi32(sum[0], _mm256_madd_epi16(_mm256_unpacklo_epi16(lo0, lo1), weight));
+	sum[1] = _mm256_add_epi32(sum[1], _mm256_madd_epi16(_mm256_unpackhi_epi16(lo0, lo1), weight));
+	sum[2] = _mm256_add_epi32(sum[2], _mm256_madd_epi16(_mm256_unpacklo_epi16(hi0, hi1), weight));
+	sum[3] = _mm256_add_epi32(sum[3], _mm256_madd_epi16(_mm256_unpackhi_epi16(hi0, hi1), weight));
+}
+
+/// Loads 32 intermediate samples as samples 0-7 and 16-23 (lo) and samples 8-15 and 24-31 (hi)
+static inline FI_RESIZE_TARGET_AVX2 void
+LoadSamplesAVX2(const int16_t *row, __m256i& lo, __m256i& hi) {
+	const __m256i a = _mm256_loadu_si256((const __m256i*)row);
+	const __m256i b = _mm256_loadu_si256((const __m256i*)(row + 16));
+	lo = _mm256_permute2x128_si256(a, b, 0x20);
+	hi = _mm256_permute2x128_si256(a, b, 0x31);
+}
+
+/// Accumulates 32 8-bit samples of two rows
+static inline FI_RESIZE_TARGET_AVX2 void
+MultiplyAddRowsAVX2(const uint8_t *row0, const uint8_t *row1, __m256i weight, __m256i sum[4]) {
+	MultiplyAddAVX2(_mm256_loadu_si256((const __m256i*)row0), _mm256_loadu_si256((const __m256i*)row1), weight, sum);
+}
+
+/// Accumulates 32 8-bit samples of a single row
+static inline FI_RESIZE_TARGET_AVX2 void
+MultiplyAddRowAVX2(const uint8_t *row0, __m256i weight, __m256i sum[4]) {
+	MultiplyAddAVX2(_mm256_loadu_si256((const __m256i*)row0), _mm256_setzero_si256(), weight, sum);
+}
+
+/// Accumulates 32 intermediate samples of two rows
+static inline FI_RESIZE_TARGET_AVX2 void
+MultiplyAddRowsAVX2(const int16_t *row0, const int16_t *row1, __m256i weight, __m256i sum[4]) {
+	__m256i lo0, hi0, lo1, hi1;
+	LoadSamplesAVX2(row0, lo0, hi0);
+	LoadSamplesAVX2(row1, lo1, hi1);
+	MultiplyAddAVX2(lo0, hi0, lo1, hi1, weight, sum);
+}
+
+/// Accumulates 32 intermediate samples of a single row
+static inline FI_RESIZE_TARGET_AVX2 void
+MultiplyAddRowAVX2(const int16_t *row0, __m256i weight, __m256i sum[4]) {
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i lo0, hi0;
+	LoadSamplesAVX2(row0, lo0, hi0);
+	MultiplyAddAVX2(lo0, hi0, zero, zero, weight, sum);
+}
+
+/// Shifts four vectors of eight sums and stores them into 32 clamped 8-bit samples
+static inline FI_RESIZE_TARGET_AVX2 void
+StoreSamplesAVX2(uint8_t *dst, const __m256i sum[4], int shift) {
+	// unpack and pack instructions work on each 128-bit lane, so the sample order is restored
+	const __m256i lo = _mm256_packs_epi32(_mm256_srai_epi32(sum[0], shift), _mm256_srai_epi32(sum[1], shift));
+	const __m256i hi = _mm256_packs_epi32(_mm256_srai_epi32(sum[2], shift), _mm256_srai_epi32(sum[3], shift));
+	_mm256_storeu_si256((__m256i*)dst, _mm256_packus_epi16(lo, hi));
+}
+
+/// Shifts four vectors of eight sums and stores them into 32 clamped intermediate samples
+static inline FI_RESIZE_TARGET_AVX2 void
+StoreSamplesAVX2(int16_t *dst, const __m256i sum[4], int shift) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i max = _mm256_set1_epi16(RESIZE_INTERMEDIATE_MAX);
+	const __m256i lo = _mm256_packs_epi32(_mm256_srai_epi32(sum[0], shift), _mm256_srai_epi32(sum[1], shift));
+	const __m256i hi = _mm256_packs_epi32(_mm256_srai_epi32(sum[2], shift), _mm256_srai_epi32(sum[3], shift));
+	const __m256i samples0 = _mm256_min_epi16(_mm256_max_epi16(lo, zero), max);
+	const __m256i samples1 = _mm256_min_epi16(_mm256_max_epi16(hi, zero), max);
+	_mm256_storeu_si256((__m256i*)dst, _mm256_permute2x128_si256(samples0, samples1, 0x20));
+	_mm256_storeu_si256((__m256i*)(dst + 16), _mm256_permute2x128_si256(samples0, samples1, 0x31));
+}
+
+/// @see RESIZE_VERTICAL_KERNEL
+template <class S, class D> static FI_RESIZE_TARGET_AVX2 void
+VerticalSpanAVX2(const void *src_bits, unsigned src_pitch, const int16_t *weights, unsigned count, void *dst_bits, unsigned size) {
+	const int shift = ResizeShift<S, D>::value;
+	const __m256i half = _mm256_set1_epi32(1 << (shift - 1));
+	unsigned x = 0;
+
+	for (; x + 32 <= size; x += 32) {
+		// accumulate 32 samples at a time, two source rows per multiply-add
+		__m256i sum[4] = { half, half, half, half };
+		const uint8_t *src = (const uint8_t*)src_bits + x * sizeof(S);
+		unsigned i = 0;
+
+		for (; i + 1 < count; i += 2) {
+			MultiplyAddRowsAVX2((const S*)src, (const S*)(src + src_pitch), PackWeightsAVX2(weights[i], weights[i + 1]), sum);
+			src += 2 * src_pitch;
+		}
+		if (i < count) {
+			MultiplyAddRowAVX2((const S*)src, PackWeightsAVX2(weights[i], 0), sum);
+		}
+
+		StoreSamplesAVX2((D*)dst_bits + x, sum, shift);
+	}
+
+	// remaining samples
+	VerticalSpanSSE2<S, D>((const S*)src_bits + x, src_pitch, weights, count, (D*)dst_bits + x, size - x);
+}
+
+/// Returns TRUE if both the CPU and the OS support AVX2
+static BOOL
+HasAVX2() {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return FALSE;
+	}
+	__cpuid(info, 1);
+	// OSXSAVE and AVX
+	if ((info[2] & 0x18000000) != 0x18000000) {
+		return FALSE;
+	}
+	// the OS saves the YMM registers
+	if ((_xgetbv(0) & 6) != 6) {
+		return FALSE;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & 0x20) ? TRUE : FALSE;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+#endif
+}
+
+#endif // FI_RESIZE_AVX2
+
+#if defined(FI_RESIZE_NEON)
+
+/// Loads the channels of an 8-bit pixel into the low 16-bit lanes of a register
+static inline int16x4_t
+LoadPixelNEON(const uint8_t *pixel, unsigned channels) {
+	uint32_t value = 0;
+	memcpy(&value, pixel, channels);
+	return vget_low_s16(vreinterpretq_s16_u16(vmovl_u8(vcreate_u8(value))));
+}
+
+/// Loads the channels of an intermediate pixel into the low 16-bit lanes of a register
+static inline int16x4_t
+LoadPixelNEON(const int16_t *pixel, unsigned channels) {
+	int16_t samples[4] = { 0, 0, 0, 0 };
+	memcpy(samples, pixel, channels * sizeof(int16_t));
+	return vld1_s16(samples);
+}
+
+/// Rounds and shifts four sums, saturated to [0..65535]
+static inline uint16x4_t
+ShiftSumsNEON(int32x4_t sum, int shift) {
+	return vqmovun_s32(vrshlq_s32(sum, vdupq_n_s32(-shift)));
+}
+
+/// Stores four sums into the clamped 8-bit channels of a pixel
+static inline void
+StorePixelNEON(int32x4_t sum, int shift, uint8_t *dst, unsigned channels) {
+	const uint16x4_t samples = ShiftSumsNEON(sum, shift);
+	const uint32_t value = vget_lane_u32(vreinterpret_u32_u8(vqmovn_u16(vcombine_u16(samples, samples))), 0);
+	memcpy(dst, &value, channels);
+}
+
+/// Stores four sums into the clamped intermediate channels of a pixel
+static inline void
+StorePixelNEON(int32x4_t sum, int shift, int16_t *dst, unsigned channels) {
+	int16_t samples[4];
+	vst1_s16(samples, vreinterpret_s16_u16(vmin_u16(ShiftSumsNEON(sum, shift), vdup_n_u16(RESIZE_INTERMEDIATE_MAX))));
+	memcpy(dst, samples, channels * sizeof(int16_t));
+}
+
+/// @see RESIZE_HORIZONTAL_KERNEL
+template <class S, class D, unsigned channels> static void
+HorizontalRowNEON(const CWeightsTable& weightsTable, const void *src_bits, void *dst_bits, unsigned dst_width) {
+	const S *src = (const S*)src_bits;
+	D *dst = (D*)dst_bits;
+
+	for (unsigned x = 0; x < dst_width; x++) {
+		const unsigned iLeft = weightsTable.getLeftBoundary(x);
+		const unsigned iLimit = weightsTable.getRightBoundary(x) - iLeft;
+		const int16_t *weights = weightsTable.getFixedPointWeights(x);
+		const S *pixel = src + iLeft * channels;
+		int32x4_t sum = vdupq_n_s32(0);
+		for (unsigned i = 0; i < iLimit; i++) {
+			sum = vmlal_n_s16(sum, LoadPixelNEON(pixel, channels), weights[i]);
+			pixel += channels;
+		}
+		StorePixelNEON(sum, ResizeShift<S, D>::value, dst, channels);
+		dst += channels;
+	}
+}
+
+/// Loads eight 8-bit samples as 16-bit samples
+static inline int16x8_t
+LoadSamplesNEON(const uint8_t *src) {
+	return vreinterpretq_s16_u16(vmovl_u8(vld1_u8(src)));
+}
+
+/// Loads eight intermediate samples
+static inline int16x8_t
+LoadSamplesNEON(const int16_t *src) {
+	return vld1q_s16(src);
+}
+
+/// Stores eight sums into clamped 8-bit samples
+static inline void
+StoreSamplesNEON(uint8_t *dst, int32x4_t sum_lo, int32x4_t sum_hi, int shift) {
+	vst1_u8(dst, vqmovn_u16(vcombine_u16(ShiftSumsNEON(sum_lo, shift), ShiftSumsNEON(sum_hi, shift))));
+}
+
+/// Stores eight sums into clamped intermediate samples
+static inline void
+StoreSamplesNEON(int16_t *dst, int32x4_t sum_lo, int32x4_t sum_hi, int shift) {
+	const uint16x8_t samples = vcombine_u16(ShiftSumsNEON(sum_lo, shift), ShiftSumsNEON(sum_hi, shift));
+	vst1q_s16(dst, vreinterpretq_s16_u16(vminq_u16(samples, vdupq_n_u16(RESIZE_INTERMEDIATE_MAX))));
+}
+
+/// @see RESIZE_VERTICAL_KERNEL
+template <class S, class D> static void
+VerticalSpanNEON(const void *src_bits, unsigned src_pitch, const int16_t *weights, unsigned count, void *dst_bits, unsigned size) {
+	unsigned x = 0;
+
+	for (; x + 8 <= size; x += 8) {
+		// accumulate 8 samples at a time
+		int32x4_t sum_lo = vdupq_n_s32(0), sum_hi = vdupq_n_s32(0);
+		const uint8_t *src = (const uint8_t*)src_bits + x * sizeof(S);
+		for (unsigned i = 0; i < count; i++) {
+			const int16x8_t row = LoadSamplesNEON((const S*)src);
+			sum_lo = vmlal_n_s16(sum_lo, vget_low_s16(row), weights[i]);
+			sum_hi = vmlal_n_s16(sum_hi, vget_high_s16(row), weights[i]);
+			src += src_pitch;
+		}
+		StoreSamplesNEON((D*)dst_bits + x, sum_lo, sum_hi, ResizeShift<S, D>::value);
+	}
+
+	// remaining samples
+	VerticalSpanScalar<S, D>((const S*)src_bits + x, src_pitch, weights, count, (D*)dst_bits + x, size - x);
+}
+
+#endif // FI_RESIZE_NEON
+
+/// Fixed-point kernels selected for the running CPU, indexed by RESIZE_PASS
+typedef struct {
+	RESIZE_HORIZONTAL_KERNEL horizontal24[3];
+	RESIZE_HORIZONTAL_KERNEL horizontal32[3];
+	RESIZE_VERTICAL_KERNEL vertical[3];
+} ResizeKernels;
+
+/**
+Returns the fixed-point kernels best suited for the running CPU.
+All kernels are nullptr if no SIMD instruction set is available.
+*/
+static const ResizeKernels&
+GetResizeKernels() {
+	static const ResizeKernels kernels = []() {
+		ResizeKernels k = { { nullptr, nullptr, nullptr }, { nullptr, nullptr, nullptr }, { nullptr, nullptr, nullptr } };
+#if defined(FI_RESIZE_SSE2)
+		const ResizeKernels sse2 = {
+			{ HorizontalRowSSE2<uint8_t, uint8_t, 3>, HorizontalRowSSE2<uint8_t, int16_t, 3>, HorizontalRowSSE2<int16_t, uint8_t, 3> },
+			{ HorizontalRowSSE2<uint8_t, uint8_t, 4>, HorizontalRowSSE2<uint8_t, int16_t, 4>, HorizontalRowSSE2<int16_t, uint8_t, 4> },
+			{ VerticalSpanSSE2<uint8_t, uint8_t>, VerticalSpanSSE2<uint8_t, int16_t>, VerticalSpanSSE2<int16_t, uint8_t> }
+		};
+		k = sse2;
+#if defined(FI_RESIZE_AVX2)
+		if (HasAVX2()) {
+			k.vertical[RESIZE_PASS_SINGLE] = VerticalSpanAVX2<uint8_t, uint8_t>;
+			k.vertical[RESIZE_PASS_FIRST] = VerticalSpanAVX2<uint8_t, int16_t>;
+			k.vertical[RESIZE_PASS_SECOND] = VerticalSpanAVX2<int16_t, uint8_t>;
+		}
+#endif
+#elif defined(FI_RESIZE_NEON)
+		const ResizeKernels neon = {
+			{ HorizontalRowNEON<uint8_t, uint8_t, 3>, HorizontalRowNEON<uint8_t, int16_t, 3>, HorizontalRowNEON<int16_t, uint8_t, 3> },
+			{ HorizontalRowNEON<uint8_t, uint8_t, 4>, HorizontalRowNEON<uint8_t, int16_t, 4>, HorizontalRowNEON<int16_t, uint8_t, 4> },
+			{ VerticalSpanNEON<uint8_t, uint8_t>, VerticalSpanNEON<uint8_t, int16_t>, VerticalSpanNEON<int16_t, uint8_t> }
+		};
+		k = neon;
+#endif
+		return k;
+	}();
+	return kernels;
+}
+
+/// Returns TRUE if fixed-point kernels are available for the running CPU
+static BOOL
+HasResizeKernels() {
+	return GetResizeKernels().vertical[RESIZE_PASS_SINGLE] ? TRUE : FALSE;
+}
+
+/**
+Returns the number of channels of an image the fixed-point kernels can filter :
+24- or 32-bit FIT_BITMAP images (8-bit samples) and FIT_RGB16 or FIT_RGBA16
+temporary images (intermediate samples). Returns 0 for any other image.
+*/
+static unsigned
+GetResizeKernelChannels(FIBITMAP *dib) {
+	switch (FreeImage_GetImageType(dib)) {
+		case FIT_BITMAP:
+			return ((FreeImage_GetBPP(dib) == 24) || (FreeImage_GetBPP(dib) == 32)) ? FreeImage_GetBPP(dib) / 8 : 0;
+		case FIT_RGB16:
+			return 3;
+		case FIT_RGBA16:
+			return 4;
+		default:
+			return 0;
+	}
+}
+
+/**
+Returns TRUE if the fixed-point kernels can be used to filter src into dst :
+both must have the same number of channels and at least one of them must be
+a FIT_BITMAP image (16-bit images are only filtered as temporary images).
+*/
+static BOOL
+CanUseResizeKernels(FIBITMAP *src, FIBITMAP *dst) {
+	if (!HasResizeKernels()) {
+		return FALSE;
+	}
+	if ((FreeImage_GetImageType(src) != FIT_BITMAP) && (FreeImage_GetImageType(dst) != FIT_BITMAP)) {
+		return FALSE;
+	}
+	const unsigned channels = GetResizeKernelChannels(src);
+	return (channels != 0) && (channels == GetResizeKernelChannels(dst));
+}
+
+/**
+Returns the filtering pass performed by the fixed-point kernels from src to dst
+(temporary images hold intermediate samples)
+@see CanUseResizeKernels
+*/
+static RESIZE_PASS
+GetResizePass(FIBITMAP *src, FIBITMAP *dst) {
+	if (FreeImage_GetImageType(dst) != FIT_BITMAP) {
+		return RESIZE_PASS_FIRST;
+	}
+	return (FreeImage_GetImageType(src) != FIT_BITMAP) ? RESIZE_PASS_SECOND : RESIZE_PASS_SINGLE;
+}
+
+// --------------------------------------------------------------------------
+// Weights tables cache
+
+/// Maximum number of cached weights tables
+static const size_t RESIZE_CACHE_MAX_TABLES = 32;
+
+/// Maximum memory used by the cached weights tables (in bytes)
+static const size_t RESIZE_CACHE_MAX_SIZE = 16 * 1024 * 1024;
+
+/// Cached weights table and its key
+typedef struct {
+	FREE_IMAGE_FILTER filter;
+	unsigned dst_size;
+	unsigned src_size;
+	std::shared_ptr<const CWeightsTable> table;
+} CachedWeightsTable;
+
+/// Cached tables, most recently used first
+static std::list<CachedWeightsTable> s_weights_cache;
+/// Memory used by the cached tables
+static size_t s_weights_cache_size = 0;
+/// Protects the cache
+static std::mutex s_weights_cache_mutex;
+
+/**
+Allocate an upsampling / downsampling filter
+@param filter Filter type
+@return Returns the filter if successful, returns nullptr otherwise
+*/
+static CGenericFilter*
+CreateFilter(FREE_IMAGE_FILTER filter) {
+	CGenericFilter *pFilter = nullptr;
+	switch (filter) {
+		case FILTER_BOX:
+			pFilter = new(std::nothrow) CBoxFilter();
+			break;
+		case FILTER_BICUBIC:
+			pFilter = new(std::nothrow) CBicubicFilter();
+			break;
+		case FILTER_BILINEAR:
+			pFilter = new(std::nothrow) CBilinearFilter();
+			break;
+		case FILTER_BSPLINE:
+			pFilter = new(std::nothrow) CBSplineFilter();
+			break;
+		case FILTER_CATMULLROM:
+			pFilter = new(std::nothrow) CCatmullRomFilter();
+			break;
+		case FILTER_LANCZOS3:
+			pFilter = new(std::nothrow) CLanczos3Filter();
+			break;
+	}
+
+	return pFilter;
+}
+
+std::shared_ptr<const CWeightsTable>
+CWeightsTableCache::get(FREE_IMAGE_FILTER filter, unsigned uDstSize, unsigned uSrcSize) {
+	{
+		std::lock_guard<std::mutex> lock(s_weights_cache_mutex);
+
+		for (std::list<CachedWeightsTable>::iterator i = s_weights_cache.begin(); i != s_weights_cache.end(); ++i) {
+			if ((i->filter == filter) && (i->dst_size == uDstSize) && (i->src_size == uSrcSize)) {
+				// move the table to the front of the list
+				s_weights_cache.splice(s_weights_cache.begin(), s_weights_cache, i);
+				return s_weights_cache.front().table;
+			}
+		}
+	}
+
+	// compute the table without holding the lock
+	CGenericFilter *pFilter = CreateFilter(filter);
+	if (!pFilter) {
+		return std::shared_ptr<const CWeightsTable>();
+	}
+	std::shared_ptr<CWeightsTable> table(new(std::nothrow) CWeightsTable(pFilter, uDstSize, uSrcSize));
+	delete pFilter;
+
+	if (!table || !table->isValid()) {
+		return std::shared_ptr<const CWeightsTable>();
+	}
+
+	const size_t size = table->getMemorySize();
+	if (size <= RESIZE_CACHE_MAX_SIZE) {
+		std::lock_guard<std::mutex> lock(s_weights_cache_mutex);
+
+		CachedWeightsTable entry = { filter, uDstSize, uSrcSize, table };
+		s_weights_cache.push_front(entry);
+		s_weights_cache_size += size;
+
+		// drop the least recently used tables
+		while ((s_weights_cache.size() > RESIZE_CACHE_MAX_TABLES) || (s_weights_cache_size > RESIZE_CACHE_MAX_SIZE)) {
+			s_weights_cache_size -= s_weights_cache.back().table->getMemorySize();
+			s_weights_cache.pop_back();
+		}
+	}
+
+	return table;
 }
 
 // --------------------------------------------------------------------------
@@ -378,6 +1262,18 @@ FIBITMAP* CResizeEngine::scale(FIBITMAP *src, unsigned dst_width, unsigned dst_h
 	}
 	*/
 
+	// 24- and 32-bit images filtered in both directions by the fixed-point kernels keep
+	// 16-bit intermediate samples in the temporary image, so that only the second pass
+	// rounds to 8 bits (both weights tables are cached, so they are only computed once)
+	FREE_IMAGE_TYPE tmp_type = image_type;
+	if ((src_width != dst_width) && (src_height != dst_height) && CanUseResizeKernels(src, dst)) {
+		std::shared_ptr<const CWeightsTable> weightsX = CWeightsTableCache::get(m_Filter, dst_width, src_width);
+		std::shared_ptr<const CWeightsTable> weightsY = CWeightsTableCache::get(m_Filter, dst_height, src_height);
+		if (weightsX && weightsX->getFixedPointWeights(0) && weightsY && weightsY->getFixedPointWeights(0)) {
+			tmp_type = (dst_bpp == 24) ? FIT_RGB16 : FIT_RGBA16;
+		}
+	}
+
 	if (dst_width <= src_width) {
 		// xy filtering
 		// -------------
@@ -390,7 +1286,7 @@ FIBITMAP* CResizeEngine::scale(FIBITMAP *src, unsigned dst_width, unsigned dst_h
 			if (src_height != dst_height) {
 				// source and destination heights are also different so, we need
 				// a temporary image
-				tmp = FreeImage_AllocateT(image_type, dst_width, src_height, dst_bpp_s1, 0, 0, 0);
+				tmp = FreeImage_AllocateT(tmp_type, dst_width, src_height, dst_bpp_s1, 0, 0, 0);
 				if (!tmp) {
 					FreeImage_Unload(dst);
 					return nullptr;
@@ -403,7 +1299,13 @@ FIBITMAP* CResizeEngine::scale(FIBITMAP *src, unsigned dst_width, unsigned dst_h
 			}
 
 			// scale source image horizontally into temporary (or destination) image
-			horizontalFilter(src, src_height, src_width, src_offset_x, src_offset_y, src_pal, tmp, dst_width);
+			if (!horizontalFilter(src, src_height, src_width, src_offset_x, src_offset_y, src_pal, tmp, dst_width)) {
+				if (tmp != dst) {
+					FreeImage_Unload(tmp);
+				}
+				FreeImage_Unload(dst);
+				return nullptr;
+			}
 
 			// set x and y offsets to zero for the second filter method
 			// invocation (the temporary image only contains the portion of
@@ -426,7 +1328,10 @@ FIBITMAP* CResizeEngine::scale(FIBITMAP *src, unsigned dst_width, unsigned dst_h
 		if (src_height != dst_height) {
 			// source and destination heights are different so, scale
 			// temporary (or source) image vertically into destination image
-			verticalFilter(tmp, dst_width, src_height, src_offset_x, src_offset_y, src_pal, dst, dst_height);
+			if (!verticalFilter(tmp, dst_width, src_height, src_offset_x, src_offset_y, src_pal, dst, dst_height)) {
+				FreeImage_Unload(dst);
+				dst = nullptr;
+			}
 		}
 
 		// free temporary image, if not pointing to either src or dst
@@ -456,7 +1361,7 @@ FIBITMAP* CResizeEngine::scale(FIBITMAP *src, unsigned dst_width, unsigned dst_h
 			if (src_width != dst_width) {
 				// source and destination widths are also different so, we need
 				// a temporary image
-				tmp = FreeImage_AllocateT(image_type, src_width, dst_height, dst_bpp_s1, 0, 0, 0);
+				tmp = FreeImage_AllocateT(tmp_type, src_width, dst_height, dst_bpp_s1, 0, 0, 0);
 				if (!tmp) {
 					FreeImage_Unload(dst);
 					return nullptr;
@@ -469,7 +1374,13 @@ FIBITMAP* CResizeEngine::scale(FIBITMAP *src, unsigned dst_width, unsigned dst_h
 			}
 
 			// scale source image vertically into temporary (or destination) image
-			verticalFilter(src, src_width, src_height, src_offset_x, src_offset_y, src_pal, tmp, dst_height);
+			if (!verticalFilter(src, src_width, src_height, src_offset_x, src_offset_y, src_pal, tmp, dst_height)) {
+				if (tmp != dst) {
+					FreeImage_Unload(tmp);
+				}
+				FreeImage_Unload(dst);
+				return nullptr;
+			}
 
 			// set x and y offsets to zero for the second filter method
 			// invocation (the temporary image only contains the portion of
@@ -493,7 +1404,10 @@ FIBITMAP* CResizeEngine::scale(FIBITMAP *src, unsigned dst_width, unsigned dst_h
 		if (src_width != dst_width) {
 			// source and destination heights are different so, scale
 			// temporary (or source) image horizontally into destination image
-			horizontalFilter(tmp, dst_height, src_width, src_offset_x, src_offset_y, src_pal, dst, dst_width);
+			if (!horizontalFilter(tmp, dst_height, src_width, src_offset_x, src_offset_y, src_pal, dst, dst_width)) {
+				FreeImage_Unload(dst);
+				dst = nullptr;
+			}
 		}
 
 		// free temporary image, if not pointing to either src or dst
@@ -505,10 +1419,38 @@ FIBITMAP* CResizeEngine::scale(FIBITMAP *src, unsigned dst_width, unsigned dst_h
 	return dst;
 } 
 
-void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsigned src_width, unsigned src_offset_x, unsigned src_offset_y, const RGBQUAD *const src_pal, FIBITMAP *const dst, unsigned dst_width) {
+BOOL CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsigned src_width, unsigned src_offset_x, unsigned src_offset_y, const RGBQUAD *const src_pal, FIBITMAP *const dst, unsigned dst_width) {
+
+	// retrieve the contributions
+	std::shared_ptr<const CWeightsTable> weightsTable = CWeightsTableCache::get(m_Filter, dst_width, src_width);
+	if (!weightsTable) {
+		return FALSE;
+	}
+
+	// filter bands of rows, one band per worker thread
+	ParallelFor(0, height, m_nThreads, RESIZE_MIN_BAND_SIZE, [&](unsigned first_row, unsigned last_row) {
+		horizontalFilterBand(*weightsTable, src, src_width, src_offset_x, src_offset_y, src_pal, dst, dst_width, first_row, last_row);
+	});
 
-	// allocate and calculate the contributions
-	CWeightsTable weightsTable(m_pFilter, dst_width, src_width);
+	return TRUE;
+}
+
+void CResizeEngine::horizontalFilterBand(const CWeightsTable& weightsTable, FIBITMAP *const src, unsigned src_width, unsigned src_offset_x, unsigned src_offset_y, const RGBQUAD *const src_pal, FIBITMAP *const dst, unsigned dst_width, unsigned first_row, unsigned last_row) {
+
+	if (CanUseResizeKernels(src, dst) && weightsTable.getFixedPointWeights(0)) {
+		// scale the 24- or 32-bit image with the fixed-point SIMD kernels
+		const unsigned bytespp = FreeImage_GetBPP(src) / 8;
+		const RESIZE_PASS pass = GetResizePass(src, dst);
+		const RESIZE_HORIZONTAL_KERNEL kernel = (GetResizeKernelChannels(src) == 3) ? GetResizeKernels().horizontal24[pass] : GetResizeKernels().horizontal32[pass];
+
+		for (unsigned y = first_row; y < last_row; y++) {
+			// scale each row
+			const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x * bytespp;
+			uint8_t * const dst_bits = FreeImage_GetScanLine(dst, y);
+			kernel(weightsTable, src_bits, dst_bits, dst_width);
+		}
+		return;
+	}
 
 	// step through rows
 	switch(FreeImage_GetImageType(src)) {
@@ -524,9 +1466,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 							src_offset_x >>= 3;
 							if (src_pal) {
 								// we have got a palette
-								for (unsigned y = 0; y < height; y++) {
+								for (unsigned y = first_row; y < last_row; y++) {
 									// scale each row
-									const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+									const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 									uint8_t * const dst_bits = FreeImage_GetScanLine(dst, y);
 
 									for (unsigned x = 0; x < dst_width; x++) {
@@ -548,9 +1490,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 								}
 							} else {
 								// we do not have a palette
-								for (unsigned y = 0; y < height; y++) {
+								for (unsigned y = first_row; y < last_row; y++) {
 									// scale each row
-									const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+									const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 									uint8_t * const dst_bits = FreeImage_GetScanLine(dst, y);
 
 									for (unsigned x = 0; x < dst_width; x++) {
@@ -581,9 +1523,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 							src_offset_x >>= 3;
 							if (src_pal) {
 								// we have got a palette
-								for (unsigned y = 0; y < height; y++) {
+								for (unsigned y = first_row; y < last_row; y++) {
 									// scale each row
-									const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+									const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 									uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 
 									for (unsigned x = 0; x < dst_width; x++) {
@@ -612,9 +1554,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 								}
 							} else {
 								// we do not have a palette
-								for (unsigned y = 0; y < height; y++) {
+								for (unsigned y = first_row; y < last_row; y++) {
 									// scale each row
-									const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+									const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 									uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 
 									for (unsigned x = 0; x < dst_width; x++) {
@@ -649,9 +1591,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 							// we always have got a palette here
 							src_offset_x >>= 3;
 
-							for (unsigned y = 0; y < height; y++) {
+							for (unsigned y = first_row; y < last_row; y++) {
 								// scale each row
-								const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+								const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 								uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 
 								for (unsigned x = 0; x < dst_width; x++) {
@@ -695,9 +1637,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 							// we always have got a palette for 4-bit images
 							src_offset_x >>= 1;
 
-							for (unsigned y = 0; y < height; y++) {
+							for (unsigned y = first_row; y < last_row; y++) {
 								// scale each row
-								const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+								const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 								uint8_t * const dst_bits = FreeImage_GetScanLine(dst, y);
 
 								for (unsigned x = 0; x < dst_width; x++) {
@@ -726,9 +1668,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 							// we always have got a palette for 4-bit images
 							src_offset_x >>= 1;
 
-							for (unsigned y = 0; y < height; y++) {
+							for (unsigned y = first_row; y < last_row; y++) {
 								// scale each row
-								const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+								const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 								uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 
 								for (unsigned x = 0; x < dst_width; x++) {
@@ -764,9 +1706,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 							// we always have got a palette for 4-bit images
 							src_offset_x >>= 1;
 
-							for (unsigned y = 0; y < height; y++) {
+							for (unsigned y = first_row; y < last_row; y++) {
 								// scale each row
-								const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+								const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 								uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 
 								for (unsigned x = 0; x < dst_width; x++) {
@@ -810,9 +1752,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 							// into an 8 bpp destination image
 							if (src_pal) {
 								// we have got a palette
-								for (unsigned y = 0; y < height; y++) {
+								for (unsigned y = first_row; y < last_row; y++) {
 									// scale each row
-									const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+									const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 									uint8_t * const dst_bits = FreeImage_GetScanLine(dst, y);
 
 									for (unsigned x = 0; x < dst_width; x++) {
@@ -835,9 +1777,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 								}
 							} else {
 								// we do not have a palette
-								for (unsigned y = 0; y < height; y++) {
+								for (unsigned y = first_row; y < last_row; y++) {
 									// scale each row
-									const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+									const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 									uint8_t * const dst_bits = FreeImage_GetScanLine(dst, y);
 
 									for (unsigned x = 0; x < dst_width; x++) {
@@ -867,9 +1809,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 							// transparently convert the non-transparent 8-bit image to 24 bpp
 							if (src_pal) {
 								// we have got a palette
-								for (unsigned y = 0; y < height; y++) {
+								for (unsigned y = first_row; y < last_row; y++) {
 									// scale each row
-									const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+									const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 									uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 
 									for (unsigned x = 0; x < dst_width; x++) {
@@ -899,9 +1841,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 								}
 							} else {
 								// we do not have a palette
-								for (unsigned y = 0; y < height; y++) {
+								for (unsigned y = first_row; y < last_row; y++) {
 									// scale each row
-									const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+									const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 									uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 
 									for (unsigned x = 0; x < dst_width; x++) {
@@ -935,9 +1877,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 						{
 							// transparently convert the transparent 8-bit image to 32 bpp; 
 							// we always have got a palette here
-							for (unsigned y = 0; y < height; y++) {
+							for (unsigned y = first_row; y < last_row; y++) {
 								// scale each row
-								const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+								const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 								uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 
 								for (unsigned x = 0; x < dst_width; x++) {
@@ -978,9 +1920,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 					// transparently convert the 16-bit non-transparent image to 24 bpp
 					if (IS_FORMAT_RGB565(src)) {
 						// image has 565 format
-						for (unsigned y = 0; y < height; y++) {
+						for (unsigned y = first_row; y < last_row; y++) {
 							// scale each row
-							const uint16_t * const src_bits = (uint16_t *)FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x / sizeof(uint16_t);
+							const uint16_t * const src_bits = (const uint16_t *)FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x / sizeof(uint16_t);
 							uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 
 							for (unsigned x = 0; x < dst_width; x++) {
@@ -1010,9 +1952,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 						}
 					} else {
 						// image has 555 format
-						for (unsigned y = 0; y < height; y++) {
+						for (unsigned y = first_row; y < last_row; y++) {
 							// scale each row
-							const uint16_t * const src_bits = (uint16_t *)FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x;
+							const uint16_t * const src_bits = (const uint16_t *)FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x;
 							uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 
 							for (unsigned x = 0; x < dst_width; x++) {
@@ -1047,9 +1989,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 				case 24:
 				{
 					// scale the 24-bit non-transparent image into a 24 bpp destination image
-					for (unsigned y = 0; y < height; y++) {
+					for (unsigned y = first_row; y < last_row; y++) {
 						// scale each row
-						const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x * 3;
+						const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x * 3;
 						uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 
 						for (unsigned x = 0; x < dst_width; x++) {
@@ -1083,9 +2025,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 				case 32:
 				{
 					// scale the 32-bit transparent image into a 32 bpp destination image
-					for (unsigned y = 0; y < height; y++) {
+					for (unsigned y = first_row; y < last_row; y++) {
 						// scale each row
-						const uint8_t * const src_bits = FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x * 4;
+						const uint8_t * const src_bits = FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x * 4;
 						uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
 
 						for (unsigned x = 0; x < dst_width; x++) {
@@ -1126,9 +2068,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 			// Calculate the number of words per pixel (1 for 16-bit, 3 for 48-bit or 4 for 64-bit)
 			const unsigned wordspp = (FreeImage_GetLine(src) / src_width) / sizeof(uint16_t);
 
-			for (unsigned y = 0; y < height; y++) {
+			for (unsigned y = first_row; y < last_row; y++) {
 				// scale each row
-				const uint16_t *src_bits = (uint16_t*)FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x / sizeof(uint16_t);
+				const uint16_t *src_bits = (const uint16_t *)FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x / sizeof(uint16_t);
 				uint16_t *dst_bits = (uint16_t*)FreeImage_GetScanLine(dst, y);
 
 				for (unsigned x = 0; x < dst_width; x++) {
@@ -1160,9 +2102,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 			// Calculate the number of words per pixel (1 for 16-bit, 3 for 48-bit or 4 for 64-bit)
 			const unsigned wordspp = (FreeImage_GetLine(src) / src_width) / sizeof(uint16_t);
 
-			for (unsigned y = 0; y < height; y++) {
+			for (unsigned y = first_row; y < last_row; y++) {
 				// scale each row
-				const uint16_t *src_bits = (uint16_t*)FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x / sizeof(uint16_t);
+				const uint16_t *src_bits = (const uint16_t *)FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x / sizeof(uint16_t);
 				uint16_t *dst_bits = (uint16_t*)FreeImage_GetScanLine(dst, y);
 
 				for (unsigned x = 0; x < dst_width; x++) {
@@ -1198,9 +2140,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 			// Calculate the number of words per pixel (1 for 16-bit, 3 for 48-bit or 4 for 64-bit)
 			const unsigned wordspp = (FreeImage_GetLine(src) / src_width) / sizeof(uint16_t);
 
-			for (unsigned y = 0; y < height; y++) {
+			for (unsigned y = first_row; y < last_row; y++) {
 				// scale each row
-				const uint16_t *src_bits = (uint16_t*)FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x / sizeof(uint16_t);
+				const uint16_t *src_bits = (const uint16_t *)FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x / sizeof(uint16_t);
 				uint16_t *dst_bits = (uint16_t*)FreeImage_GetScanLine(dst, y);
 
 				for (unsigned x = 0; x < dst_width; x++) {
@@ -1240,9 +2182,9 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 			// Calculate the number of floats per pixel (1 for 32-bit, 3 for 96-bit or 4 for 128-bit)
 			const unsigned floatspp = (FreeImage_GetLine(src) / src_width) / sizeof(float);
 
-			for(unsigned y = 0; y < height; y++) {
+			for(unsigned y = first_row; y < last_row; y++) {
 				// scale each row
-				const float *src_bits = (float*)FreeImage_GetScanLine(src, y + src_offset_y) + src_offset_x / sizeof(float);
+				const float *src_bits = (const float *)FreeImage_GetConstScanLine(src, y + src_offset_y) + src_offset_x / sizeof(float);
 				float *dst_bits = (float*)FreeImage_GetScanLine(dst, y);
 
 				for(unsigned x = 0; x < dst_width; x++) {
@@ -1276,10 +2218,44 @@ void CResizeEngine::horizontalFilter(FIBITMAP *const src, unsigned height, unsig
 }
 
 /// Performs vertical image filtering
-void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned src_height, unsigned src_offset_x, unsigned src_offset_y, const RGBQUAD *const src_pal, FIBITMAP *const dst, unsigned dst_height) {
+BOOL CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned src_height, unsigned src_offset_x, unsigned src_offset_y, const RGBQUAD *const src_pal, FIBITMAP *const dst, unsigned dst_height) {
+
+	// retrieve the contributions
+	std::shared_ptr<const CWeightsTable> weightsTable = CWeightsTableCache::get(m_Filter, dst_height, src_height);
+	if (!weightsTable) {
+		return FALSE;
+	}
+
+	// filter bands of columns, one band per worker thread
+	ParallelFor(0, width, m_nThreads, RESIZE_MIN_BAND_SIZE, [&](unsigned first_col, unsigned last_col) {
+		verticalFilterBand(*weightsTable, src, width, src_offset_x, src_offset_y, src_pal, dst, dst_height, first_col, last_col);
+	});
+
+	return TRUE;
+}
 
-	// allocate and calculate the contributions
-	CWeightsTable weightsTable(m_pFilter, dst_height, src_height);
+void CResizeEngine::verticalFilterBand(const CWeightsTable& weightsTable, FIBITMAP *const src, unsigned width, unsigned src_offset_x, unsigned src_offset_y, const RGBQUAD *const src_pal, FIBITMAP *const dst, unsigned dst_height, unsigned first_col, unsigned last_col) {
+
+	if (CanUseResizeKernels(src, dst) && weightsTable.getFixedPointWeights(0)) {
+		// scale the 24- or 32-bit image with the fixed-point SIMD kernels,
+		// filtering the band row by row
+		const unsigned src_bytespp = FreeImage_GetBPP(src) / 8;
+		const unsigned dst_bytespp = FreeImage_GetBPP(dst) / 8;
+		const unsigned src_pitch = FreeImage_GetPitch(src);
+		const unsigned dst_pitch = FreeImage_GetPitch(dst);
+		const uint8_t *const src_base = FreeImage_GetConstBits(src) + src_offset_y * src_pitch + (src_offset_x + first_col) * src_bytespp;
+		uint8_t *dst_bits = FreeImage_GetBits(dst) + first_col * dst_bytespp;
+		const unsigned samples = (last_col - first_col) * GetResizeKernelChannels(src);
+		const RESIZE_VERTICAL_KERNEL kernel = GetResizeKernels().vertical[GetResizePass(src, dst)];
+
+		for (unsigned y = 0; y < dst_height; y++) {
+			const unsigned iLeft = weightsTable.getLeftBoundary(y);				// retrieve left boundary
+			const unsigned iLimit = weightsTable.getRightBoundary(y) - iLeft;	// retrieve right boundary
+			kernel(src_base + iLeft * src_pitch, src_pitch, weightsTable.getFixedPointWeights(y), iLimit, dst_bits, samples);
+			dst_bits += dst_pitch;
+		}
+		return;
+	}
 
 	// step through columns
 	switch(FreeImage_GetImageType(src)) {
@@ -1292,7 +2268,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 				case 1:
 				{
 					const unsigned src_pitch = FreeImage_GetPitch(src);
-					const uint8_t * const src_base = FreeImage_GetBits(src) + src_offset_y * src_pitch + (src_offset_x >> 3);
+					const uint8_t * const src_base = FreeImage_GetConstBits(src) + src_offset_y * src_pitch + (src_offset_x >> 3);
 
 					switch(FreeImage_GetBPP(dst)) {
 						case 8:
@@ -1300,7 +2276,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 							// transparently convert the 1-bit non-transparent greyscale image to 8 bpp
 							if (src_pal) {
 								// we have got a palette
-								for (unsigned x = 0; x < width; x++) {
+								for (unsigned x = first_col; x < last_col; x++) {
 									// work on column x in dst
 									uint8_t *dst_bits = dst_base + x;
 									const unsigned index = x >> 3;
@@ -1330,7 +2306,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 								}
 							} else {
 								// we do not have a palette
-								for (unsigned x = 0; x < width; x++) {
+								for (unsigned x = first_col; x < last_col; x++) {
 									// work on column x in dst
 									uint8_t *dst_bits = dst_base + x;
 									const unsigned index = x >> 3;
@@ -1366,7 +2342,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 							// transparently convert the non-transparent 1-bit image to 24 bpp
 							if (src_pal) {
 								// we have got a palette
-								for (unsigned x = 0; x < width; x++) {
+								for (unsigned x = first_col; x < last_col; x++) {
 									// work on column x in dst
 									uint8_t *dst_bits = dst_base + x * 3;
 									const unsigned index = x >> 3;
@@ -1401,7 +2377,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 								}
 							} else {
 								// we do not have a palette
-								for (unsigned x = 0; x < width; x++) {
+								for (unsigned x = first_col; x < last_col; x++) {
 									// work on column x in dst
 									uint8_t *dst_bits = dst_base + x * 3;
 									const unsigned index = x >> 3;
@@ -1439,7 +2415,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 						{
 							// transparently convert the transparent 1-bit image to 32 bpp; 
 							// we always have got a palette here
-							for (unsigned x = 0; x < width; x++) {
+							for (unsigned x = first_col; x < last_col; x++) {
 								// work on column x in dst
 								uint8_t *dst_bits = dst_base + x * 4;
 								const unsigned index = x >> 3;
@@ -1483,14 +2459,14 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 				case 4:
 				{
 					const unsigned src_pitch = FreeImage_GetPitch(src);
-					const uint8_t *const src_base = FreeImage_GetBits(src) + src_offset_y * src_pitch + (src_offset_x >> 1);
+					const uint8_t *const src_base = FreeImage_GetConstBits(src) + src_offset_y * src_pitch + (src_offset_x >> 1);
 
 					switch(FreeImage_GetBPP(dst)) {
 						case 8:
 						{
 							// transparently convert the non-transparent 4-bit greyscale image to 8 bpp; 
 							// we always have got a palette for 4-bit images
-							for (unsigned x = 0; x < width; x++) {
+							for (unsigned x = first_col; x < last_col; x++) {
 								// work on column x in dst
 								uint8_t *dst_bits = dst_base + x;
 								const unsigned index = x >> 1;
@@ -1523,7 +2499,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 						{
 							// transparently convert the non-transparent 4-bit image to 24 bpp; 
 							// we always have got a palette for 4-bit images
-							for (unsigned x = 0; x < width; x++) {
+							for (unsigned x = first_col; x < last_col; x++) {
 								// work on column x in dst
 								uint8_t *dst_bits = dst_base + x * 3;
 								const unsigned index = x >> 1;
@@ -1562,7 +2538,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 						{
 							// transparently convert the transparent 4-bit image to 32 bpp; 
 							// we always have got a palette for 4-bit images
-							for (unsigned x = 0; x < width; x++) {
+							for (unsigned x = first_col; x < last_col; x++) {
 								// work on column x in dst
 								uint8_t *dst_bits = dst_base + x * 4;
 								const unsigned index = x >> 1;
@@ -1605,7 +2581,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 				case 8:
 				{
 					const unsigned src_pitch = FreeImage_GetPitch(src);
-					const uint8_t *const src_base = FreeImage_GetBits(src) + src_offset_y * src_pitch + src_offset_x;
+					const uint8_t *const src_base = FreeImage_GetConstBits(src) + src_offset_y * src_pitch + src_offset_x;
 
 					switch(FreeImage_GetBPP(dst)) {
 						case 8:
@@ -1613,7 +2589,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 							// scale the 8-bit non-transparent greyscale image into an 8 bpp destination image
 							if (src_pal) {
 								// we have got a palette
-								for (unsigned x = 0; x < width; x++) {
+								for (unsigned x = first_col; x < last_col; x++) {
 									// work on column x in dst
 									uint8_t *dst_bits = dst_base + x;
 
@@ -1639,7 +2615,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 								}
 							} else {
 								// we do not have a palette
-								for (unsigned x = 0; x < width; x++) {
+								for (unsigned x = first_col; x < last_col; x++) {
 									// work on column x in dst
 									uint8_t *dst_bits = dst_base + x;
 
@@ -1672,7 +2648,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 							// transparently convert the non-transparent 8-bit image to 24 bpp
 							if (src_pal) {
 								// we have got a palette
-								for (unsigned x = 0; x < width; x++) {
+								for (unsigned x = first_col; x < last_col; x++) {
 									// work on column x in dst
 									uint8_t *dst_bits = dst_base + x * 3;
 
@@ -1704,7 +2680,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 								}
 							} else {
 								// we do not have a palette
-								for (unsigned x = 0; x < width; x++) {
+								for (unsigned x = first_col; x < last_col; x++) {
 									// work on column x in dst
 									uint8_t *dst_bits = dst_base + x * 3;
 
@@ -1739,7 +2715,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 						{
 							// transparently convert the transparent 8-bit image to 32 bpp; 
 							// we always have got a palette here
-							for (unsigned x = 0; x < width; x++) {
+							for (unsigned x = first_col; x < last_col; x++) {
 								// work on column x in dst
 								uint8_t *dst_bits = dst_base + x * 4;
 
@@ -1781,11 +2757,11 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 				{
 					// transparently convert the 16-bit non-transparent image to 24 bpp
 					const unsigned src_pitch = FreeImage_GetPitch(src) / sizeof(uint16_t);
-					const uint16_t *const src_base = (uint16_t *)FreeImage_GetBits(src) + src_offset_y * src_pitch + src_offset_x;
+					const uint16_t *const src_base = (const uint16_t *)FreeImage_GetConstBits(src) + src_offset_y * src_pitch + src_offset_x;
 
 					if (IS_FORMAT_RGB565(src)) {
 						// image has 565 format
-						for (unsigned x = 0; x < width; x++) {
+						for (unsigned x = first_col; x < last_col; x++) {
 							// work on column x in dst
 							uint8_t *dst_bits = dst_base + x * 3;
 
@@ -1816,7 +2792,7 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 						}
 					} else {
 						// image has 555 format
-						for (unsigned x = 0; x < width; x++) {
+						for (unsigned x = first_col; x < last_col; x++) {
 							// work on column x in dst
 							uint8_t *dst_bits = dst_base + x * 3;
 
@@ -1853,9 +2829,9 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 				{
 					// scale the 24-bit transparent image into a 24 bpp destination image
 					const unsigned src_pitch = FreeImage_GetPitch(src);
-					const uint8_t *const src_base = FreeImage_GetBits(src) + src_offset_y * src_pitch + src_offset_x * 3;
+					const uint8_t *const src_base = FreeImage_GetConstBits(src) + src_offset_y * src_pitch + src_offset_x * 3;
 
-					for (unsigned x = 0; x < width; x++) {
+					for (unsigned x = first_col; x < last_col; x++) {
 						// work on column x in dst
 						const unsigned index = x * 3;
 						uint8_t *dst_bits = dst_base + index;
@@ -1892,9 +2868,9 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 				{
 					// scale the 32-bit transparent image into a 32 bpp destination image
 					const unsigned src_pitch = FreeImage_GetPitch(src);
-					const uint8_t *const src_base = FreeImage_GetBits(src) + src_offset_y * src_pitch + src_offset_x * 4;
+					const uint8_t *const src_base = FreeImage_GetConstBits(src) + src_offset_y * src_pitch + src_offset_x * 4;
 
-					for (unsigned x = 0; x < width; x++) {
+					for (unsigned x = first_col; x < last_col; x++) {
 						// work on column x in dst
 						const unsigned index = x * 4;
 						uint8_t *dst_bits = dst_base + index;
@@ -1941,9 +2917,9 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 			uint16_t *const dst_base = (uint16_t *)FreeImage_GetBits(dst);
 
 			const unsigned src_pitch = FreeImage_GetPitch(src) / sizeof(uint16_t);
-			const uint16_t *const src_base = (uint16_t *)FreeImage_GetBits(src)	+ src_offset_y * src_pitch + src_offset_x * wordspp;
+			const uint16_t *const src_base = (const uint16_t *)FreeImage_GetConstBits(src)	+ src_offset_y * src_pitch + src_offset_x * wordspp;
 
-			for (unsigned x = 0; x < width; x++) {
+			for (unsigned x = first_col; x < last_col; x++) {
 				// work on column x in dst
 				const unsigned index = x * wordspp;	// pixel index
 				uint16_t *dst_bits = dst_base + index;
@@ -1982,9 +2958,9 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 			uint16_t *const dst_base = (uint16_t *)FreeImage_GetBits(dst);
 
 			const unsigned src_pitch = FreeImage_GetPitch(src) / sizeof(uint16_t);
-			const uint16_t *const src_base = (uint16_t *)FreeImage_GetBits(src) + src_offset_y * src_pitch + src_offset_x * wordspp;
+			const uint16_t *const src_base = (const uint16_t *)FreeImage_GetConstBits(src) + src_offset_y * src_pitch + src_offset_x * wordspp;
 
-			for (unsigned x = 0; x < width; x++) {
+			for (unsigned x = first_col; x < last_col; x++) {
 				// work on column x in dst
 				const unsigned index = x * wordspp;	// pixel index
 				uint16_t *dst_bits = dst_base + index;
@@ -2028,9 +3004,9 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 			uint16_t *const dst_base = (uint16_t *)FreeImage_GetBits(dst);
 
 			const unsigned src_pitch = FreeImage_GetPitch(src) / sizeof(uint16_t);
-			const uint16_t *const src_base = (uint16_t *)FreeImage_GetBits(src) + src_offset_y * src_pitch + src_offset_x * wordspp;
+			const uint16_t *const src_base = (const uint16_t *)FreeImage_GetConstBits(src) + src_offset_y * src_pitch + src_offset_x * wordspp;
 
-			for (unsigned x = 0; x < width; x++) {
+			for (unsigned x = first_col; x < last_col; x++) {
 				// work on column x in dst
 				const unsigned index = x * wordspp;	// pixel index
 				uint16_t *dst_bits = dst_base + index;
@@ -2078,9 +3054,9 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 			float *const dst_base = (float *)FreeImage_GetBits(dst);
 
 			const unsigned src_pitch = FreeImage_GetPitch(src) / sizeof(float);
-			const float *const src_base = (float *)FreeImage_GetBits(src) + src_offset_y * src_pitch + src_offset_x * floatspp;
+			const float *const src_base = (const float *)FreeImage_GetConstBits(src) + src_offset_y * src_pitch + src_offset_x * floatspp;
 
-			for (unsigned x = 0; x < width; x++) {
+			for (unsigned x = first_col; x < last_col; x++) {
 				// work on column x in dst
 				const unsigned index = x * floatspp;	// pixel index
 				float *dst_bits = (float *)dst_base + index;
@@ -2114,3 +3090,278 @@ void CResizeEngine::verticalFilter(FIBITMAP *const src, unsigned width, unsigned
 		break;
 	}
 }
+
+// --------------------------------------------------------------------------
+// Streaming resize engine
+
+/// Rounds and clamps a filtered value to the range of a sample type
+template <class T> static inline T
+ClampSample(double value);
+
+template <> inline uint8_t
+ClampSample<uint8_t>(double value) {
+	return (uint8_t)CLAMP<int>((int)(value + 0.5), 0, 0xFF);
+}
+
+template <> inline uint16_t
+ClampSample<uint16_t>(double value) {
+	return (uint16_t)CLAMP<int>((int)(value + 0.5), 0, 0xFFFF);
+}
+
+template <> inline float
+ClampSample<float>(double value) {
+	return (float)value;
+}
+
+/**
+Filters a row of pixels horizontally (floating-point weights)
+@param weightsTable Weights table
+@param src_bits First source pixel of the row
+@param dst_bits First destination pixel of the row
+@param dst_width Number of destination pixels
+@param channels Number of samples per pixel (1 to 4)
+*/
+template <class T> static void
+HorizontalRow(const CWeightsTable& weightsTable, const T *src_bits, T *dst_bits, unsigned dst_width, unsigned channels) {
+	for (unsigned x = 0; x < dst_width; x++) {
+		// loop through row
+		const unsigned iLeft = weightsTable.getLeftBoundary(x);				// retrieve left boundary
+		const unsigned iLimit = weightsTable.getRightBoundary(x) - iLeft;	// retrieve right boundary
+		const T *pixel = src_bits + iLeft * channels;
+		double value[4] = {0, 0, 0, 0};
+
+		for (unsigned i = 0; i < iLimit; i++) {
+			// accumulate weighted effect of each neighboring pixel
+			const double weight = weightsTable.getWeight(x, i);
+			for (unsigned c = 0; c < channels; c++) {
+				value[c] += (weight * (double)pixel[c]);
+			}
+			pixel += channels;
+		}
+
+		// clamp and place result in destination pixel
+		for (unsigned c = 0; c < channels; c++) {
+			dst_bits[c] = ClampSample<T>(value[c]);
+		}
+		dst_bits += channels;
+	}
+}
+
+/**
+Filters a window of contiguous rows vertically (floating-point weights)
+@param weightsTable Weights table
+@param src_bits First contributing source row
+@param src_pitch Source pitch (in bytes)
+@param dst_pos Destination row index
+@param dst_bits Destination row
+@param count Number of samples in a row
+*/
+template <class T> static void
+VerticalRow(const CWeightsTable& weightsTable, const uint8_t *src_bits, unsigned src_pitch, unsigned dst_pos, T *dst_bits, unsigned count) {
+	const unsigned iLimit = weightsTable.getRightBoundary(dst_pos) - weightsTable.getLeftBoundary(dst_pos);
+
+	for (unsigned x = 0; x < count; x++) {
+		const uint8_t *src = src_bits;
+		double value = 0;
+
+		for (unsigned i = 0; i < iLimit; i++) {
+			// accumulate weighted effect of each neighboring pixel
+			value += (weightsTable.getWeight(dst_pos, i) * (double)((const T*)src)[x]);
+			src += src_pitch;
+		}
+
+		// clamp and place result in destination pixel
+		dst_bits[x] = ClampSample<T>(value);
+	}
+}
+
+CStreamingResizeEngine::CStreamingResizeEngine(FREE_IMAGE_FILTER filter, FREE_IMAGE_TYPE type, unsigned bpp,
+	unsigned src_width, unsigned src_height, unsigned dst_width, unsigned dst_height,
+	FI_ReadScanlineProc read_proc, void *data) :
+	m_Type(type), m_nBytesPerPixel(0),
+	m_nSrcWidth(src_width), m_nSrcHeight(src_height), m_nDstWidth(dst_width), m_nDstHeight(dst_height),
+	m_bHorizontalFirst(dst_width <= src_width), m_bIntermediate(FALSE),
+	m_pRing(nullptr), m_nRingRows(0), m_nRingPitch(0), m_pLine(nullptr),
+	m_nNextSrcRow(0), m_nNextDstRow(0), m_ReadProc(read_proc), m_pData(data) {
+
+	// check the image type
+	unsigned expected_bpp = 0;
+	switch (type) {
+		case FIT_BITMAP:
+			expected_bpp = ((bpp == 8) || (bpp == 24) || (bpp == 32)) ? bpp : 0;
+			break;
+		case FIT_UINT16:
+			expected_bpp = 16;
+			break;
+		case FIT_RGB16:
+			expected_bpp = 48;
+			break;
+		case FIT_RGBA16:
+			expected_bpp = 64;
+			break;
+		case FIT_FLOAT:
+			expected_bpp = 32;
+			break;
+		case FIT_RGBF:
+			expected_bpp = 96;
+			break;
+		case FIT_RGBAF:
+			expected_bpp = 128;
+			break;
+		default:
+			break;
+	}
+	if (!read_proc || (bpp != expected_bpp) || !src_width || !src_height || !dst_width || !dst_height) {
+		return;
+	}
+	m_nBytesPerPixel = bpp / 8;
+
+	// retrieve the contributions
+	if (src_width != dst_width) {
+		m_pWeightsX = CWeightsTableCache::get(filter, dst_width, src_width);
+		if (!m_pWeightsX) {
+			return;
+		}
+	}
+	if (src_height != dst_height) {
+		m_pWeightsY = CWeightsTableCache::get(filter, dst_height, src_height);
+		if (!m_pWeightsY) {
+			return;
+		}
+	}
+
+	// as CResizeEngine, 24- and 32-bit images filtered in both directions by the fixed-point
+	// kernels keep 16-bit intermediate samples between both passes
+	m_bIntermediate = (type == FIT_BITMAP) && (bpp >= 24) && m_pWeightsX && m_pWeightsY
+		&& m_pWeightsX->getFixedPointWeights(0) && m_pWeightsY->getFixedPointWeights(0);
+	const unsigned intermediate_bytespp = m_bIntermediate ? 2 * m_nBytesPerPixel : m_nBytesPerPixel;
+
+	// the ring buffer holds a filter window of rows, either filtered horizontally
+	// (dst_width pixels) or as read from the source (src_width pixels)
+	m_nRingRows = m_pWeightsY ? m_pWeightsY->getWindowSize() : 1;
+	m_nRingPitch = m_bHorizontalFirst ? dst_width * intermediate_bytespp : src_width * m_nBytesPerPixel;
+
+	// the work buffer holds a source row (xy filtering) or a vertically filtered row (yx filtering)
+	m_pLine = (uint8_t*)malloc(src_width * intermediate_bytespp);
+	if (!m_pLine) {
+		return;
+	}
+	m_pRing = (uint8_t*)malloc((m_nRingRows > 1 ? 2 * m_nRingRows : 1) * m_nRingPitch);
+}
+
+CStreamingResizeEngine::~CStreamingResizeEngine() {
+	free(m_pRing);
+	free(m_pLine);
+}
+
+BOOL CStreamingResizeEngine::pushSourceRow() {
+	const unsigned src_row = m_nNextSrcRow;
+	uint8_t *ring_bits = getRingRow(src_row);
+
+	if (m_bHorizontalFirst && m_pWeightsX) {
+		// xy filtering: store the horizontally filtered row
+		if (!m_ReadProc(m_pData, src_row, m_pLine)) {
+			return FALSE;
+		}
+		filterRow(m_pLine, ring_bits);
+	} else {
+		// yx filtering: store the source row
+		if (!m_ReadProc(m_pData, src_row, ring_bits)) {
+			return FALSE;
+		}
+	}
+
+	if (m_nRingRows > 1) {
+		// store a second copy after the end of the ring, so that
+		// a window of rows wrapping around the ring is contiguous
+		memcpy(ring_bits + m_nRingRows * m_nRingPitch, ring_bits, m_nRingPitch);
+	}
+
+	m_nNextSrcRow++;
+
+	return TRUE;
+}
+
+BOOL CStreamingResizeEngine::readScanline(uint8_t *dst_bits) {
+	if (!isValid() || !dst_bits || (m_nNextDstRow >= m_nDstHeight)) {
+		return FALSE;
+	}
+
+	const unsigned dst_row = m_nNextDstRow;
+
+	// source rows contributing to the destination row
+	const unsigned iLeft = m_pWeightsY ? m_pWeightsY->getLeftBoundary(dst_row) : dst_row;
+	const unsigned iRight = m_pWeightsY ? m_pWeightsY->getRightBoundary(dst_row) : dst_row + 1;
+
+	while (m_nNextSrcRow < iRight) {
+		if (!pushSourceRow()) {
+			return FALSE;
+		}
+	}
+
+	// with yx filtering, the vertically filtered row still has to be filtered horizontally
+	const BOOL bHorizontalLast = !m_bHorizontalFirst && m_pWeightsX;
+	uint8_t *column_bits = bHorizontalLast ? m_pLine : dst_bits;
+
+	if (m_pWeightsY) {
+		filterColumn(getRingRow(iLeft), m_nRingPitch, dst_row, column_bits, m_bHorizontalFirst ? m_nDstWidth : m_nSrcWidth);
+	} else {
+		memcpy(column_bits, getRingRow(dst_row), m_nRingPitch);
+	}
+
+	if (bHorizontalLast) {
+		filterRow(m_pLine, dst_bits);
+	}
+
+	m_nNextDstRow++;
+
+	return TRUE;
+}
+
+void CStreamingResizeEngine::filterRow(const uint8_t *src_bits, uint8_t *dst_bits) const {
+	if ((m_Type == FIT_BITMAP) && (m_nBytesPerPixel >= 3) && m_pWeightsX->getFixedPointWeights(0)) {
+		// 24- or 32-bit image
+		const RESIZE_PASS pass = !m_bIntermediate ? RESIZE_PASS_SINGLE : (m_bHorizontalFirst ? RESIZE_PASS_FIRST : RESIZE_PASS_SECOND);
+		const RESIZE_HORIZONTAL_KERNEL kernel = (m_nBytesPerPixel == 3) ? GetResizeKernels().horizontal24[pass] : GetResizeKernels().horizontal32[pass];
+		kernel(*m_pWeightsX, src_bits, dst_bits, m_nDstWidth);
+		return;
+	}
+
+	switch (m_Type) {
+		case FIT_BITMAP:
+			HorizontalRow<uint8_t>(*m_pWeightsX, src_bits, dst_bits, m_nDstWidth, m_nBytesPerPixel);
+			break;
+		case FIT_UINT16:
+		case FIT_RGB16:
+		case FIT_RGBA16:
+			HorizontalRow<uint16_t>(*m_pWeightsX, (const uint16_t*)src_bits, (uint16_t*)dst_bits, m_nDstWidth, m_nBytesPerPixel / sizeof(uint16_t));
+			break;
+		default:
+			HorizontalRow<float>(*m_pWeightsX, (const float*)src_bits, (float*)dst_bits, m_nDstWidth, m_nBytesPerPixel / sizeof(float));
+			break;
+	}
+}
+
+void CStreamingResizeEngine::filterColumn(const uint8_t *src_bits, unsigned src_pitch, unsigned dst_pos, uint8_t *dst_bits, unsigned width) const {
+	if ((m_Type == FIT_BITMAP) && (m_nBytesPerPixel >= 3) && m_pWeightsY->getFixedPointWeights(0)) {
+		// 24- or 32-bit image
+		const RESIZE_PASS pass = !m_bIntermediate ? RESIZE_PASS_SINGLE : (m_bHorizontalFirst ? RESIZE_PASS_SECOND : RESIZE_PASS_FIRST);
+		const unsigned iLimit = m_pWeightsY->getRightBoundary(dst_pos) - m_pWeightsY->getLeftBoundary(dst_pos);
+		GetResizeKernels().vertical[pass](src_bits, src_pitch, m_pWeightsY->getFixedPointWeights(dst_pos), iLimit, dst_bits, width * m_nBytesPerPixel);
+		return;
+	}
+
+	switch (m_Type) {
+		case FIT_BITMAP:
+			VerticalRow<uint8_t>(*m_pWeightsY, src_bits, src_pitch, dst_pos, dst_bits, width * m_nBytesPerPixel);
+			break;
+		case FIT_UINT16:
+		case FIT_RGB16:
+		case FIT_RGBA16:
+			VerticalRow<uint16_t>(*m_pWeightsY, src_bits, src_pitch, dst_pos, (uint16_t*)dst_bits, width * m_nBytesPerPixel / sizeof(uint16_t));
+			break;
+		default:
+			VerticalRow<float>(*m_pWeightsY, src_bits, src_pitch, dst_pos, (float*)dst_bits, width * m_nBytesPerPixel / sizeof(float));
+			break;
+	}
+}
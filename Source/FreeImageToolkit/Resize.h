@@ -27,6 +27,9 @@
 #include "FreeImage.h"
 #include "Utilities.h"
 #include "Filters.h" 
+#include "Threading.h"
+
+#include <memory>
 
 /**
   Filter weights table.<br>
@@ -39,19 +42,29 @@ class CWeightsTable
   Contribution information for a single pixel
 */
 typedef struct {
-	/// Normalized weights of neighboring pixels
-	double *Weights;
 	/// Bounds of source pixels window
 	unsigned Left, Right;
 } Contribution;
 
 private:
-	/// Row (or column) of contribution weights 
+	/// Row (or column) of contribution bounds
 	Contribution *m_WeightTable;
+	/// Normalized weights of neighboring pixels (m_WindowSize weights per pixel, in one allocation)
+	double *m_Weights;
 	/// Filter window size (of affecting source pixels) 
 	unsigned m_WindowSize;
 	/// Length of line (no. of rows / cols) 
 	unsigned m_LineLength;
+	/// 16-bit fixed-point copy of the weights (m_WindowSize weights per pixel), or nullptr
+	int16_t *m_FixedWeights;
+
+	/**
+	Compute a 16-bit fixed-point copy of the weights, used by the SIMD filtering kernels.<br>
+	The fixed-point weights of each destination pixel are rounded so that they sum up to exactly one.
+	@return Returns TRUE if successful, returns FALSE if a weight does not fit into 16 bits
+	or if memory allocation failed
+	*/
+	BOOL buildFixedPointWeights();
 
 public:
 	/** 
@@ -69,20 +82,44 @@ public:
 	*/
 	~CWeightsTable();
 
+	/**
+	Check the table state after construction
+	@return Returns TRUE if the table could be allocated, FALSE otherwise
+	*/
+	BOOL isValid() const {
+		return (m_WeightTable != nullptr) && (m_Weights != nullptr);
+	}
+
+	/**
+	Retrieve the memory used by the table
+	@return Returns the table size in bytes
+	*/
+	size_t getMemorySize() const {
+		const size_t weights = (size_t)m_LineLength * m_WindowSize;
+		return sizeof(CWeightsTable) + m_LineLength * sizeof(Contribution) + weights * sizeof(double) + (m_FixedWeights ? weights * sizeof(int16_t) : 0);
+	}
+
 	/** Retrieve a filter weight, given source and destination positions
 	@param dst_pos Pixel position in destination line buffer
 	@param src_pos Pixel position in source line buffer
 	@return Returns the filter weight
 	*/
-	double getWeight(unsigned dst_pos, unsigned src_pos) {
-		return m_WeightTable[dst_pos].Weights[src_pos];
+	double getWeight(unsigned dst_pos, unsigned src_pos) const {
+		return m_Weights[dst_pos * m_WindowSize + src_pos];
+	}
+
+	/** Retrieve the filter window size
+	@return Returns the maximum number of source pixels contributing to a destination pixel
+	*/
+	unsigned getWindowSize() const {
+		return m_WindowSize;
 	}
 
 	/** Retrieve left boundary of source line buffer
 	@param dst_pos Pixel position in destination line buffer
 	@return Returns the left boundary of source line buffer
 	*/
-	unsigned getLeftBoundary(unsigned dst_pos) {
+	unsigned getLeftBoundary(unsigned dst_pos) const {
 		return m_WeightTable[dst_pos].Left;
 	}
 
@@ -90,9 +127,42 @@ public:
 	@param dst_pos Pixel position in destination line buffer
 	@return Returns the right boundary of source line buffer
 	*/
-	unsigned getRightBoundary(unsigned dst_pos) {
+	unsigned getRightBoundary(unsigned dst_pos) const {
 		return m_WeightTable[dst_pos].Right;
 	}
+
+	/** Retrieve the fixed-point filter weights of a destination pixel
+	@param dst_pos Pixel position in destination line buffer
+	@return Returns the fixed-point weights from the left to the right boundary,
+	returns nullptr if the fixed-point weights are not available (no SIMD kernels
+	for the running CPU, or weights that do not fit into 16 bits)
+	*/
+	const int16_t* getFixedPointWeights(unsigned dst_pos) const {
+		return m_FixedWeights ? m_FixedWeights + dst_pos * m_WindowSize : nullptr;
+	}
+};
+
+// ---------------------------------------------
+
+/**
+ CWeightsTableCache<br>
+ Process-wide cache of the most recently used weights tables.<br>
+ Tables only depend on the filter and on the source and destination line lengths
+ (source rectangle offsets are applied by the filtering methods), so that
+ repeated rescaling to the same sizes reuses the tables of both axes.
+ Cached tables are immutable and shared, so they may be used by several threads at once.
+*/
+class CWeightsTableCache
+{
+public:
+	/**
+	Retrieve a weights table, computing it if it is not cached
+	@param filter Filter used for upsampling or downsampling
+	@param uDstSize Length (in pixels) of the destination line buffer
+	@param uSrcSize Length (in pixels) of the source line buffer
+	@return Returns the weights table if successful, returns an empty pointer otherwise
+	*/
+	static std::shared_ptr<const CWeightsTable> get(FREE_IMAGE_FILTER filter, unsigned uDstSize, unsigned uSrcSize);
 };
 
 // ---------------------------------------------
@@ -114,16 +184,19 @@ public:
 class CResizeEngine
 {
 private:
-	/// Pointer to the FIR / IIR filter
-	CGenericFilter* m_pFilter;
+	/// FIR / IIR filter
+	FREE_IMAGE_FILTER m_Filter;
+	/// Number of worker threads used by the filtering methods
+	unsigned m_nThreads;
 
 public:
 
 	/**
 	Constructor
 	@param filter FIR /IIR filter to be used
+	@param threads Number of worker threads to be used (1 means single-threaded)
 	*/
-	CResizeEngine(CGenericFilter* filter):m_pFilter(filter) {}
+	CResizeEngine(FREE_IMAGE_FILTER filter, unsigned threads = 1):m_Filter(filter), m_nThreads(MAX(1U, threads)) {}
 
 	/// Destructor
 	virtual ~CResizeEngine() {}
@@ -172,8 +245,9 @@ private:
 	@param src_pal
 	@param dst Destination image
 	@param dst_width Destination image width
+	@return Returns TRUE if successful, FALSE otherwise
 	*/
-	void horizontalFilter(FIBITMAP * const src, const unsigned height, const unsigned src_width,
+	BOOL horizontalFilter(FIBITMAP * const src, const unsigned height, const unsigned src_width,
 			const unsigned src_offset_x, const unsigned src_offset_y, const RGBQUAD * const src_pal,
 			FIBITMAP * const dst, const unsigned dst_width);
 
@@ -187,10 +261,144 @@ private:
 	@param src_pal
 	@param dst Destination image
 	@param dst_height Destination image height
+	@return Returns TRUE if successful, FALSE otherwise
 	*/
-	void verticalFilter(FIBITMAP * const src, const unsigned width, const unsigned src_height,
+	BOOL verticalFilter(FIBITMAP * const src, const unsigned width, const unsigned src_height,
 			const unsigned src_offset_x, const unsigned src_offset_y, const RGBQUAD * const src_pal,
 			FIBITMAP * const dst, const unsigned dst_height);
+
+	/**
+	Performs horizontal image filtering of the rows [first_row, last_row).<br>
+	Rows are independent from each other, so that bands of rows may be
+	filtered concurrently by different threads.
+	@see horizontalFilter
+	*/
+	void horizontalFilterBand(const CWeightsTable& weightsTable, FIBITMAP * const src, const unsigned src_width,
+			unsigned src_offset_x, const unsigned src_offset_y, const RGBQUAD * const src_pal,
+			FIBITMAP * const dst, const unsigned dst_width, const unsigned first_row, const unsigned last_row);
+
+	/**
+	Performs vertical image filtering of the columns [first_col, last_col).<br>
+	Columns are independent from each other, so that bands of columns may be
+	filtered concurrently by different threads.
+	@see verticalFilter
+	*/
+	void verticalFilterBand(const CWeightsTable& weightsTable, FIBITMAP * const src, const unsigned width,
+			const unsigned src_offset_x, const unsigned src_offset_y, const RGBQUAD * const src_pal,
+			FIBITMAP * const dst, const unsigned dst_height, const unsigned first_col, const unsigned last_col);
+};
+
+// ---------------------------------------------
+
+/**
+ CStreamingResizeEngine<br>
+ This class performs the same filtered zoom as CResizeEngine, but on a stream of scanlines.
+ Source scanlines are pulled from a callback as they are needed and destination
+ scanlines are produced one at a time, in the same order.<br>
+ Only a ring buffer of filter window rows is kept in memory, so that memory use does
+ not depend on the image heights. As CResizeEngine, the engine filters horizontally
+ first when the image gets narrower and vertically first otherwise, so that the output
+ is identical to the one of CResizeEngine when scanlines are streamed in scanline order.<br>
+ The engine works with 8-, 24- and 32-bit FIT_BITMAP samples (8-bit samples are handled
+ as linear greyscale values), uint16_t samples (FIT_UINT16, FIT_RGB16, FIT_RGBA16)
+ and float samples (FIT_FLOAT, FIT_RGBF, FIT_RGBAF).
+*/
+class CStreamingResizeEngine
+{
+private:
+	/// Image type
+	FREE_IMAGE_TYPE m_Type;
+	/// Number of bytes per pixel
+	unsigned m_nBytesPerPixel;
+	/// Source and destination sizes
+	unsigned m_nSrcWidth, m_nSrcHeight, m_nDstWidth, m_nDstHeight;
+	/// Horizontal (x) and vertical (y) weights tables, empty if the size is unchanged
+	std::shared_ptr<const CWeightsTable> m_pWeightsX, m_pWeightsY;
+	/// TRUE if rows are filtered horizontally before being stored into the ring buffer
+	BOOL m_bHorizontalFirst;
+	/// TRUE if the rows between both filtering passes hold 16-bit intermediate samples (fixed-point kernels)
+	BOOL m_bIntermediate;
+	/// Ring buffer of source rows, each row is stored twice so that any window of rows is contiguous
+	uint8_t *m_pRing;
+	/// Number of rows in the ring buffer
+	unsigned m_nRingRows;
+	/// Size (in bytes) of a ring buffer row
+	unsigned m_nRingPitch;
+	/// Single row work buffer
+	uint8_t *m_pLine;
+	/// Next source row to be read
+	unsigned m_nNextSrcRow;
+	/// Next destination row to be produced
+	unsigned m_nNextDstRow;
+	/// Source scanline callback
+	FI_ReadScanlineProc m_ReadProc;
+	/// Data passed to the source scanline callback
+	void *m_pData;
+
+public:
+	/**
+	Constructor
+	@param filter FIR /IIR filter to be used
+	@param type Image type
+	@param bpp Image bit depth
+	@param src_width Source image width
+	@param src_height Source image height
+	@param dst_width Destination image width
+	@param dst_height Destination image height
+	@param read_proc Callback used to read the source scanlines
+	@param data User data passed to the callback
+	*/
+	CStreamingResizeEngine(FREE_IMAGE_FILTER filter, FREE_IMAGE_TYPE type, unsigned bpp,
+		unsigned src_width, unsigned src_height, unsigned dst_width, unsigned dst_height,
+		FI_ReadScanlineProc read_proc, void *data);
+
+	/// Destructor
+	virtual ~CStreamingResizeEngine();
+
+	/**
+	Check the engine state after construction
+	@return Returns TRUE if the image type is supported and all buffers could be allocated
+	*/
+	BOOL isValid() const {
+		return m_pRing != nullptr;
+	}
+
+	/**
+	Produce the next destination scanline, reading source scanlines as needed
+	@param dst_bits Buffer receiving the scanline (dst_width pixels)
+	@return Returns TRUE if successful, returns FALSE if all scanlines were produced
+	or if the source scanline callback failed
+	*/
+	BOOL readScanline(uint8_t *dst_bits);
+
+private:
+	/**
+	Read the next source row into the ring buffer
+	@return Returns TRUE if successful, FALSE otherwise
+	*/
+	BOOL pushSourceRow();
+
+	/// Returns a pointer to the ring buffer row holding the source row src_row
+	uint8_t* getRingRow(unsigned src_row) const {
+		return m_pRing + (src_row % m_nRingRows) * m_nRingPitch;
+	}
+
+	/**
+	Filter a row horizontally
+	@param src_bits Source row (m_nSrcWidth pixels)
+	@param dst_bits Destination row (m_nDstWidth pixels)
+	*/
+	void filterRow(const uint8_t *src_bits, uint8_t *dst_bits) const;
+
+	/**
+	Filter a window of contiguous rows vertically
+	@param src_bits First contributing row
+	@param src_pitch Row pitch (in bytes)
+	@param dst_pos Destination row index
+	@param dst_bits Destination row
+	@param width Row width (in pixels)
+	*/
+	void filterColumn(const uint8_t *src_bits, unsigned src_pitch, unsigned dst_pos, uint8_t *dst_bits, unsigned width) const;
 };
 
 #endif //   _RESIZE_H_
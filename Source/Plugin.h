@@ -30,6 +30,11 @@
 #include "FreeImage.h"
 #include "Utilities.h"
 
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
 // ==========================================================
 
 struct Plugin;
@@ -46,7 +51,7 @@ FI_STRUCT (PluginNode) {
 	/** The actual plugin, holding the function pointers */
 	Plugin *m_plugin;
 	/** Enable/Disable switch */
-	BOOL m_enabled;
+	std::atomic<BOOL> m_enabled;
 
 	/** Unique format string for the plugin */
 	const char *m_format;
@@ -58,6 +63,59 @@ FI_STRUCT (PluginNode) {
 	const char *m_regexpr;
 };
 
+// =====================================================================
+//  Plugin Table
+// =====================================================================
+
+/**
+Case insensitive hash of a C string
+*/
+struct PluginKeyHash {
+	size_t operator()(const char *key) const;
+};
+
+/**
+Case insensitive comparison of two C strings
+*/
+struct PluginKeyEqual {
+	bool operator()(const char *key1, const char *key2) const;
+};
+
+/**
+Snapshot of the registered plugins, with the lookup tables used to find a plugin. 
+A published snapshot is never modified : registering a plugin builds a new snapshot 
+and swaps it in, so that the lookups never take a lock.
+*/
+struct PluginTable {
+	/** Lookup table : key -> FREE_IMAGE_FORMATs matching the key, in registration order */
+	typedef std::unordered_map<const char *, std::vector<int>, PluginKeyHash, PluginKeyEqual> PluginIndex;
+
+	/** Plugin nodes, indexed by FREE_IMAGE_FORMAT */
+	std::vector<PluginNode *> m_nodes;
+	/** Format strings */
+	PluginIndex m_formats;
+	/** MIME types */
+	PluginIndex m_mimes;
+	/** File extensions and format strings (see FreeImage_GetFIFFromFilename) */
+	PluginIndex m_extensions;
+	/** Storage of the lookup keys */
+	std::deque<std::string> m_keys;
+
+	/** Magic signature of a plugin (see FI_SignatureProc) */
+	struct SignatureEntry {
+		int m_id;
+		const FISIGNATURE *m_signature;
+	};
+	/** Signatures starting at offset 0 with an unmasked first byte, indexed by this byte, in registration order */
+	std::vector<SignatureEntry> m_signatures[256];
+	/** Other signatures, in registration order */
+	std::vector<SignatureEntry> m_other_signatures;
+	/** Plugins without signatures, identified by their validate_proc, in registration order */
+	std::vector<int> m_validators;
+	/** Number of bytes needed to match all the signatures */
+	unsigned m_signature_size;
+};
+
 // =====================================================================
 //  Internal Plugin List
 // =====================================================================
@@ -70,14 +128,24 @@ public :
 	FREE_IMAGE_FORMAT AddNode(FI_InitProc proc, void *instance = nullptr, const char *format = 0, const char *description = 0, const char *extension = 0, const char *regexpr = 0);
 	PluginNode *FindNodeFromFormat(const char *format);
 	PluginNode *FindNodeFromMime(const char *mime);
+	PluginNode *FindNodeFromExtension(const char *extension);
 	PluginNode *FindNodeFromFIF(int node_id);
 
+	/** Current snapshot, valid until the list is destroyed */
+	const PluginTable *GetTable() const;
+
 	int Size() const;
 	BOOL IsEmpty() const;
 
 private :
-	std::map<int, PluginNode *> m_plugin_map;
-	int m_node_count;
+	PluginNode *FindEnabledNode(const PluginTable *table, const PluginTable::PluginIndex &index, const char *key) const;
+
+	/** Current snapshot, read without lock */
+	std::atomic<const PluginTable *> m_table;
+	/** Previous snapshots, possibly still in use by a reader : released with the list */
+	std::vector<const PluginTable *> m_retired_tables;
+	/** Serializes the plugin registrations */
+	std::mutex m_write_lock;
 };
 
 // ==========================================================
@@ -0,0 +1,100 @@
+// ==========================================================
+// Multithreading helpers
+//
+// This file is part of FreeImage 3
+//
+// COVERED CODE IS PROVIDED UNDER THIS LICENSE ON AN "AS IS" BASIS, WITHOUT WARRANTY
+// OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING, WITHOUT LIMITATION, WARRANTIES
+// THAT THE COVERED CODE IS FREE OF DEFECTS, MERCHANTABLE, FIT FOR A PARTICULAR PURPOSE
+// OR NON-INFRINGING. THE ENTIRE RISK AS TO THE QUALITY AND PERFORMANCE OF THE COVERED
+// CODE IS WITH YOU. SHOULD ANY COVERED CODE PROVE DEFECTIVE IN ANY RESPECT, YOU (NOT
+// THE INITIAL DEVELOPER OR ANY OTHER CONTRIBUTOR) ASSUME THE COST OF ANY NECESSARY
+// SERVICING, REPAIR OR CORRECTION. THIS DISCLAIMER OF WARRANTY CONSTITUTES AN ESSENTIAL
+// PART OF THIS LICENSE. NO USE OF ANY COVERED CODE IS AUTHORIZED HEREUNDER EXCEPT UNDER
+// THIS DISCLAIMER.
+//
+// Use at your own risk!
+// ==========================================================
+
+#ifndef FREEIMAGE_THREADING_H
+#define FREEIMAGE_THREADING_H
+
+#include "FreeImage.h"
+#include "Utilities.h"
+
+#include <thread>
+#include <vector>
+
+// ==========================================================
+//   Worker thread count
+// ==========================================================
+
+/**
+Returns the number of worker threads an opt-in multithreaded operation should use.
+The value is taken from FreeImage_SetThreadCount.
+@param force If TRUE, the operation was explicitly asked to run multithreaded
+(e.g. through a load, save or rescale flag): when no thread count was set,
+one worker per hardware thread is used instead of a single one
+@return Returns the number of worker threads (always >= 1)
+@see FreeImage_SetThreadCount
+*/
+unsigned GetWorkerCount(BOOL force);
+
+// ==========================================================
+//   Parallel loops
+// ==========================================================
+
+/**
+Splits the range [first, last) into contiguous bands and processes each band
+with body(band_first, band_last). The first band is processed on the calling
+thread, the others on short-lived worker threads.
+Bands never overlap, so the body may write to band-specific output without locking.
+If a worker thread cannot be created, its band is processed on the calling thread.
+@param first First index of the range
+@param last One past the last index of the range
+@param workers Maximum number of bands (i.e. threads) to use
+@param grain Minimum number of indices per band
+@param body Functor called as body(unsigned band_first, unsigned band_last)
+*/
+template <class Body> void
+ParallelFor(unsigned first, unsigned last, unsigned workers, unsigned grain, Body body) {
+	if (last <= first) {
+		return;
+	}
+	const unsigned count = last - first;
+	unsigned bands = MAX(1U, MIN(workers, count / MAX(1U, grain)));
+
+	if (bands <= 1) {
+		body(first, last);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	threads.reserve(bands - 1);
+
+	const unsigned band_size = count / bands;
+	const unsigned remainder = count % bands;
+
+	// first band runs on the calling thread, start the others
+	unsigned band_first = first + band_size + (remainder ? 1 : 0);
+	const unsigned caller_last = band_first;
+
+	for (unsigned band = 1; band < bands; band++) {
+		const unsigned band_last = band_first + band_size + ((band < remainder) ? 1 : 0);
+		try {
+			threads.push_back(std::thread(body, band_first, band_last));
+		} catch (...) {
+			// no more threads available: do the work ourselves
+			body(band_first, band_last);
+		}
+		band_first = band_last;
+	}
+
+	body(first, caller_last);
+
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+}
+
+#endif // FREEIMAGE_THREADING_H
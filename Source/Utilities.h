@@ -69,6 +69,21 @@
 void* FreeImage_Aligned_Malloc(size_t amount, size_t alignment);
 void FreeImage_Aligned_Free(void* mem);
 
+// Pixel access without copy-on-write (pixels shared by shallow clones must only be read)
+// defined in BitmapAccess.cpp
+
+uint8_t* FreeImage_GetBitsInternal(FIBITMAP *dib);
+
+/**
+Clone a bitmap with or without its pixels
+@param dib Bitmap to clone
+@param header_only If TRUE, the clone only gets the header, palette, ICC profile, metadata and thumbnail of dib. 
+Otherwise the clone has pixels : a copy of the pixels of dib, or uninitialized pixels when dib is a 'header only' bitmap
+@return Returns the cloned bitmap, or nullptr if an error occured
+@see FreeImage_Clone
+*/
+FIBITMAP* FreeImage_CloneInternal(FIBITMAP *dib, BOOL header_only);
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
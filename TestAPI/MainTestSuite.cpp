@@ -65,15 +65,33 @@ int main(int argc, char *argv[]) {
 	// test plugins capabilities
 	showPlugins();
 
+	// test plugin lookup tables
+	testPluginLookup();
+
+	// test file type detection
+	testGetFileType();
+
 	// test the clone function
 	testAllocateCloneUnload("exif.jpg");
 
+	// test custom allocators and the bitmap pool
+	testAllocator();
+
+	// test copy-on-write clones
+	testCopyOnWrite("exif.jpg");
+
 	// test internal image types
 	testImageType(width, height);
 
 	// test loading / saving / converting image types using the TIFF plugin
 	testImageTypeTIFF(width, height);
 
+	// test TIFF region loading, multithreading and tiled saving
+	testTIFF(width, height);
+
+	// test multithreaded PNG saving, save presets and row by row decoding
+	testPNG(width, height);
+
 	// test memory IO
 	testMemIO("sample.png");
 	testMemIO("exif.jxr");
@@ -99,6 +117,9 @@ int main(int argc, char *argv[]) {
 	// test Exif raw metadata loading & saving
 	testExifRaw();
 
+	// test rescaling functions
+	testRescale(width, height);
+
 	// test thumbnail functions
 	testThumbnail("exif.jpg", 0);
 
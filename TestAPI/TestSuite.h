@@ -40,10 +40,13 @@
 // Some useful tools
 // ==========================================================
 FIBITMAP* createZonePlateImage(unsigned width, unsigned height, int scale);
+BOOL isSameImage(FIBITMAP *dib1, FIBITMAP *dib2);
 
 // Test plugins capabilities
 // ==========================================================
 void showPlugins();
+void testPluginLookup();
+void testGetFileType();
 
 // Image types test suite
 // ==========================================================
@@ -52,6 +55,14 @@ BOOL testAllocateCloneUnloadType(FREE_IMAGE_TYPE image_type, unsigned width, uns
 void testImageType(unsigned width, unsigned height);
 void testImageTypeTIFF(unsigned width, unsigned height);
 
+// Allocator test suite
+// ==========================================================
+void testAllocator();
+
+// Copy-on-write test suite
+// ==========================================================
+void testCopyOnWrite(const char *lpszPathName);
+
 // Header loading test suite
 // ==========================================================
 void testHeaderOnly();
@@ -77,12 +88,27 @@ void testMultiPageMemory(const char *lpszPathName);
 
 void testJPEG();
 
+// TIFF test suite
+// ==========================================================
+
+void testTIFF(unsigned width, unsigned height);
+
+// PNG test suite
+// ==========================================================
+
+void testPNG(unsigned width, unsigned height);
+
 // Channels test suite
 // ==========================================================
 
 void testImageChannels(unsigned width, unsigned height);
 
 
+// Rescale test suite
+// ==========================================================
+
+void testRescale(unsigned width, unsigned height);
+
 // Thumbnails test suite
 // ==========================================================
 void testThumbnail(const char *lpszPathName, int flags);
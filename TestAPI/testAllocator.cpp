@@ -0,0 +1,185 @@
+// ==========================================================
+// FreeImage 3 Test Script
+//
+// This file is part of FreeImage 3
+//
+// COVERED CODE IS PROVIDED UNDER THIS LICENSE ON AN "AS IS" BASIS, WITHOUT WARRANTY
+// OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING, WITHOUT LIMITATION, WARRANTIES
+// THAT THE COVERED CODE IS FREE OF DEFECTS, MERCHANTABLE, FIT FOR A PARTICULAR PURPOSE
+// OR NON-INFRINGING. THE ENTIRE RISK AS TO THE QUALITY AND PERFORMANCE OF THE COVERED
+// CODE IS WITH YOU. SHOULD ANY COVERED CODE PROVE DEFECTIVE IN ANY RESPECT, YOU (NOT
+// THE INITIAL DEVELOPER OR ANY OTHER CONTRIBUTOR) ASSUME THE COST OF ANY NECESSARY
+// SERVICING, REPAIR OR CORRECTION. THIS DISCLAIMER OF WARRANTY CONSTITUTES AN ESSENTIAL
+// PART OF THIS LICENSE. NO USE OF ANY COVERED CODE IS AUTHORIZED HEREUNDER EXCEPT UNDER
+// THIS DISCLAIMER.
+//
+// Use at your own risk!
+// ==========================================================
+
+#include "TestSuite.h"
+
+#include <string.h>
+
+// Local test functions
+// ----------------------------------------------------------
+
+// counting allocator used by the tests below
+typedef struct {
+	unsigned allocations;			// bitmap handles
+	unsigned frees;
+	unsigned aligned_allocations;	// bitmap data and work buffers
+	unsigned aligned_frees;
+} AllocatorCounters;
+
+static AllocatorCounters s_counters;
+
+// live blocks allocated by countingAlignedMalloc
+static const int MAX_COUNTED_BLOCKS = 64;
+static uint8_t *s_counted_blocks[MAX_COUNTED_BLOCKS];
+static size_t s_counted_sizes[MAX_COUNTED_BLOCKS];
+
+static void* DLL_CALLCONV 
+countingMalloc(size_t size, void *user) {
+	((AllocatorCounters*)user)->allocations++;
+	return malloc(size);
+}
+
+static void DLL_CALLCONV 
+countingFree(void *ptr, void *user) {
+	((AllocatorCounters*)user)->frees++;
+	free(ptr);
+}
+
+static void* DLL_CALLCONV 
+countingAlignedMalloc(size_t size, size_t alignment, void *user) {
+	((AllocatorCounters*)user)->aligned_allocations++;
+	// keep the original pointer just before the aligned block
+	uint8_t *block = (uint8_t*)malloc(size + 2 * alignment);
+	if(!block) return nullptr;
+	uint8_t *aligned = block + 2 * alignment - ((size_t)block % alignment);
+	*((void**)aligned - 1) = block;
+	for(int i = 0; i < MAX_COUNTED_BLOCKS; i++) {
+		if(!s_counted_blocks[i]) {
+			s_counted_blocks[i] = aligned;
+			s_counted_sizes[i] = size;
+			break;
+		}
+	}
+	return aligned;
+}
+
+static void DLL_CALLCONV 
+countingAlignedFree(void *ptr, void *user) {
+	((AllocatorCounters*)user)->aligned_frees++;
+	for(int i = 0; i < MAX_COUNTED_BLOCKS; i++) {
+		if(s_counted_blocks[i] == ptr) {
+			s_counted_blocks[i] = nullptr;
+			break;
+		}
+	}
+	free(*((void**)ptr - 1));
+}
+
+// size of the part of a block allocated by countingAlignedMalloc which starts with the bitmap data
+static size_t 
+countedBlockSize(FIBITMAP *dib) {
+	const uint8_t *data = (const uint8_t *)dib->data;
+	for(int i = 0; i < MAX_COUNTED_BLOCKS; i++) {
+		if(s_counted_blocks[i] && (s_counted_blocks[i] <= data) && (data < s_counted_blocks[i] + s_counted_sizes[i])) {
+			return s_counted_blocks[i] + s_counted_sizes[i] - data;
+		}
+	}
+	return 0;
+}
+
+/**
+Check that the bitmap pool reuses the blocks allocated through a custom allocator
+*/
+static BOOL testBitmapPool() {
+	FreeImageAllocator allocator = { countingMalloc, countingFree, countingAlignedMalloc, countingAlignedFree, &s_counters };
+
+	if(!FreeImage_SetAllocator(&allocator)) return FALSE;
+
+	// without pool, each bitmap is a new allocation
+	memset(&s_counters, 0, sizeof(s_counters));
+	FIBITMAP *dib = FreeImage_Allocate(640, 480, 24);
+	FreeImage_Unload(dib);
+	dib = FreeImage_Allocate(640, 480, 24);
+	FreeImage_Unload(dib);
+	if(s_counters.aligned_allocations != 2) return FALSE;
+
+	// with a pool, the released block is reused and cleared
+	FreeImage_SetBitmapPoolSize(16 * 1024 * 1024);
+	memset(&s_counters, 0, sizeof(s_counters));
+	dib = FreeImage_Allocate(640, 480, 24);
+	memset(FreeImage_GetBits(dib), 0xFF, FreeImage_GetPitch(dib) * FreeImage_GetHeight(dib));
+	FreeImage_Unload(dib);
+	dib = FreeImage_Allocate(639, 480, 24);
+	if(s_counters.aligned_allocations != 1) return FALSE;
+	if(FreeImage_GetScanLine(dib, 0)[0] != 0) return FALSE;
+	FreeImage_Unload(dib);
+
+	// a clone keeps the size class of its own block : clone without pool, release it to the pool, 
+	// then reuse its block for a larger bitmap of the same size class
+	FIBITMAP *src = FreeImage_Allocate(640, 480, 24);
+	FreeImage_SetBitmapPoolSize(0);
+	FIBITMAP *clone = FreeImage_Clone(src);
+	FreeImage_SetBitmapPoolSize(16 * 1024 * 1024);
+	FreeImage_Unload(clone);
+	dib = FreeImage_Allocate(660, 480, 24);
+	if(countedBlockSize(dib) < FreeImage_GetPitch(dib) * FreeImage_GetHeight(dib)) return FALSE;
+	FreeImage_Unload(dib);
+	FreeImage_Unload(src);
+
+	// a pooled clone of an unpooled bitmap goes back to the pool
+	FreeImage_SetBitmapPoolSize(0);
+	src = FreeImage_Allocate(640, 480, 24);
+	FreeImage_SetBitmapPoolSize(16 * 1024 * 1024);
+	clone = FreeImage_Clone(src);
+	FreeImage_Unload(clone);
+	memset(&s_counters, 0, sizeof(s_counters));
+	dib = FreeImage_Allocate(640, 480, 24);
+	if(s_counters.aligned_allocations != 0) return FALSE;
+	FreeImage_Unload(dib);
+	FreeImage_Unload(src);
+
+	// restore the default allocator (this flushes the pool)
+	FreeImage_SetBitmapPoolSize(0);
+	return FreeImage_SetAllocator(nullptr);
+}
+
+/**
+Check that the blocks allocated before a call to FreeImage_SetAllocator are released by their own allocator
+*/
+static BOOL testAllocatorSwap() {
+	FreeImageAllocator allocator = { countingMalloc, countingFree, countingAlignedMalloc, countingAlignedFree, &s_counters };
+
+	// allocated by the default allocator, released while the counting allocator is set
+	FIBITMAP *dib1 = FreeImage_Allocate(64, 64, 24);
+	if(!dib1 || !FreeImage_SetAllocator(&allocator)) return FALSE;
+	memset(&s_counters, 0, sizeof(s_counters));
+	FreeImage_Unload(dib1);
+	if((s_counters.frees != 0) || (s_counters.aligned_frees != 0)) return FALSE;
+
+	// allocated by the counting allocator, released after the default allocator is restored
+	FIBITMAP *dib2 = FreeImage_Allocate(64, 64, 24);
+	if(!dib2 || (s_counters.allocations != 1) || (s_counters.aligned_allocations != 1)) return FALSE;
+	if(!FreeImage_SetAllocator(nullptr)) return FALSE;
+	FreeImage_Unload(dib2);
+	if((s_counters.frees != 1) || (s_counters.aligned_frees != 1)) return FALSE;
+
+	return TRUE;
+}
+
+// Main test functions
+// ----------------------------------------------------------
+
+void testAllocator() {
+	printf("testAllocator ...\n");
+
+	BOOL bResult = testBitmapPool();
+	assert(bResult);
+
+	bResult = testAllocatorSwap();
+	assert(bResult);
+}
@@ -0,0 +1,153 @@
+// ==========================================================
+// FreeImage 3 Test Script
+//
+// This file is part of FreeImage 3
+//
+// COVERED CODE IS PROVIDED UNDER THIS LICENSE ON AN "AS IS" BASIS, WITHOUT WARRANTY
+// OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING, WITHOUT LIMITATION, WARRANTIES
+// THAT THE COVERED CODE IS FREE OF DEFECTS, MERCHANTABLE, FIT FOR A PARTICULAR PURPOSE
+// OR NON-INFRINGING. THE ENTIRE RISK AS TO THE QUALITY AND PERFORMANCE OF THE COVERED
+// CODE IS WITH YOU. SHOULD ANY COVERED CODE PROVE DEFECTIVE IN ANY RESPECT, YOU (NOT
+// THE INITIAL DEVELOPER OR ANY OTHER CONTRIBUTOR) ASSUME THE COST OF ANY NECESSARY
+// SERVICING, REPAIR OR CORRECTION. THIS DISCLAIMER OF WARRANTY CONSTITUTES AN ESSENTIAL
+// PART OF THIS LICENSE. NO USE OF ANY COVERED CODE IS AUTHORIZED HEREUNDER EXCEPT UNDER
+// THIS DISCLAIMER.
+//
+// Use at your own risk!
+// ==========================================================
+
+#include "TestSuite.h"
+
+#include <string.h>
+#include <thread>
+
+// Local test functions
+// ----------------------------------------------------------
+
+/**
+Check that shallow clones share the pixels of their source until one of them is written to
+*/
+static BOOL testCloneShallow(const char *lpszPathName) {
+	FREE_IMAGE_FORMAT fif = FreeImage_GetFIFFromFilename(lpszPathName);
+
+	FIBITMAP *dib = FreeImage_Load(fif, lpszPathName, 0);
+	if(!dib) return FALSE;
+
+	// clones share the pixels of dib
+	FIBITMAP *clone1 = FreeImage_CloneShallow(dib);
+	FIBITMAP *clone2 = FreeImage_CloneShallow(clone1);
+	if(!clone1 || !clone2) return FALSE;
+	if(FreeImage_GetConstBits(clone1) != FreeImage_GetConstBits(dib)) return FALSE;
+	if(FreeImage_GetConstBits(clone2) != FreeImage_GetConstBits(dib)) return FALSE;
+
+	// saving a clone only reads its pixels
+	FIMEMORY *hmem = FreeImage_OpenMemory();
+	FreeImage_SaveToMemory(FIF_PNG, clone1, hmem, 0);
+	FreeImage_SaveToMemory(FIF_JPEG, clone2, hmem, 0);
+	FreeImage_CloseMemory(hmem);
+	if(FreeImage_GetConstBits(clone1) != FreeImage_GetConstBits(dib)) return FALSE;
+	if(FreeImage_GetConstBits(clone2) != FreeImage_GetConstBits(dib)) return FALSE;
+
+	const unsigned height = FreeImage_GetHeight(dib);
+	const unsigned line = FreeImage_GetLine(dib);
+	const uint8_t first = FreeImage_GetConstScanLine(dib, 0)[0];
+
+	// writing to a clone copies its pixels
+	uint8_t *bits = FreeImage_GetScanLine(clone1, 0);
+	if(bits == FreeImage_GetConstBits(dib)) return FALSE;
+	bits[0] = (uint8_t)~first;
+	if(FreeImage_GetConstScanLine(dib, 0)[0] != first) return FALSE;
+	if(FreeImage_GetConstScanLine(clone2, 0)[0] != first) return FALSE;
+
+	// writing to the source copies its pixels as well
+	FreeImage_GetBits(dib)[0] = (uint8_t)~first;
+	if(FreeImage_GetConstScanLine(clone2, 0)[0] != first) return FALSE;
+
+	// the shared pixels outlive the source
+	FreeImage_Unload(dib);
+	FIBITMAP *check = FreeImage_Load(fif, lpszPathName, 0);
+	for(unsigned y = 0; y < height; y++) {
+		if(memcmp(FreeImage_GetConstScanLine(check, y), FreeImage_GetConstScanLine(clone2, y), line) != 0) return FALSE;
+	}
+	// the last user of the shared pixels writes in place
+	const uint8_t *shared_bits = FreeImage_GetConstBits(clone2);
+	if(!FreeImage_MakeWritable(clone2) || (FreeImage_GetBits(clone2) != shared_bits)) return FALSE;
+
+	FreeImage_Unload(check);
+	FreeImage_Unload(clone2);
+	FreeImage_Unload(clone1);
+
+	return TRUE;
+}
+
+/**
+Check that saving, converting and rescaling a shallow clone do not copy its pixels
+*/
+static BOOL testReadOnlyAccess(const char *lpszPathName) {
+	FIBITMAP *dib = FreeImage_Load(FreeImage_GetFIFFromFilename(lpszPathName), lpszPathName, 0);
+	if(!dib) return FALSE;
+	FIBITMAP *clone = FreeImage_CloneShallow(dib);
+	if(!clone) return FALSE;
+
+	FIMEMORY *hmem = FreeImage_OpenMemory();
+	FreeImage_SaveToMemory(FIF_BMP, clone, hmem, 0);
+	FreeImage_SaveToMemory(FIF_TIFF, clone, hmem, TIFF_LZW);
+	FreeImage_CloseMemory(hmem);
+	FIBITMAP *dib32 = FreeImage_ConvertTo32Bits(clone);
+	FIBITMAP *small = FreeImage_Rescale(clone, FreeImage_GetWidth(clone) / 2, FreeImage_GetHeight(clone) / 2, FILTER_BILINEAR);
+
+	BOOL bResult = dib32 && small && (FreeImage_GetConstBits(clone) == FreeImage_GetConstBits(dib));
+
+	if(dib32) FreeImage_Unload(dib32);
+	if(small) FreeImage_Unload(small);
+	FreeImage_Unload(clone);
+	FreeImage_Unload(dib);
+
+	return bResult;
+}
+
+/**
+Check that two threads writing to the same shallow clone copy its pixels only once
+*/
+static BOOL testConcurrentDetach(const char *lpszPathName) {
+	FIBITMAP *dib = FreeImage_Load(FreeImage_GetFIFFromFilename(lpszPathName), lpszPathName, 0);
+	if(!dib) return FALSE;
+	const uint8_t first = FreeImage_GetConstScanLine(dib, 0)[0];
+
+	for(int i = 0; i < 100; i++) {
+		FIBITMAP *clone = FreeImage_CloneShallow(dib);
+		if(!clone) return FALSE;
+
+		uint8_t *bits[2] = { nullptr, nullptr };
+		std::thread t0([&]() { bits[0] = FreeImage_GetScanLine(clone, 0); });
+		std::thread t1([&]() { bits[1] = FreeImage_GetScanLine(clone, 0); });
+		t0.join();
+		t1.join();
+
+		// both threads see the same private copy, the source is left unchanged
+		if(!bits[0] || (bits[0] != bits[1]) || (bits[0] == FreeImage_GetConstScanLine(dib, 0))) return FALSE;
+		bits[0][0] = (uint8_t)~first;
+		if(FreeImage_GetConstScanLine(dib, 0)[0] != first) return FALSE;
+
+		FreeImage_Unload(clone);
+	}
+	FreeImage_Unload(dib);
+
+	return TRUE;
+}
+
+// Main test functions
+// ----------------------------------------------------------
+
+void testCopyOnWrite(const char *lpszPathName) {
+	printf("testCopyOnWrite ...\n");
+
+	BOOL bResult = testCloneShallow(lpszPathName);
+	assert(bResult);
+
+	bResult = testReadOnlyAccess(lpszPathName);
+	assert(bResult);
+
+	bResult = testConcurrentDetach(lpszPathName);
+	assert(bResult);
+}
@@ -21,6 +21,8 @@
 
 
 #include "TestSuite.h"
+#include <string.h>
+#include <vector>
 
 void  
 testBuildMPage(const char *src_filename, const char *dst_filename, FREE_IMAGE_FORMAT dst_fif, unsigned bpp) {
@@ -91,6 +93,50 @@ void testMPageCache(const char *src_filename, const char *dst_filename) {
 	FreeImage_CloseMultiBitmap(out, 0); 
 }
 
+void testMPageSwapCache(const char *dst_filename, BOOL keep_cache_in_memory) {
+	const int count = 48;
+
+	// build pages of different sizes, identified by their color
+	FIMULTIBITMAP *out = FreeImage_OpenMultiBitmap(FIF_TIFF, dst_filename, TRUE, FALSE, keep_cache_in_memory);
+	assert(out != nullptr);
+	for(int i = 0; i < count; i++) {
+		FIBITMAP *dib = FreeImage_Allocate(64 + 8 * i, 32 + 16 * (i % 5), 8);
+		assert(dib != nullptr);
+		for(unsigned y = 0; y < FreeImage_GetHeight(dib); y++) {
+			memset(FreeImage_GetScanLine(dib, y), i, FreeImage_GetLine(dib));
+		}
+		FreeImage_AppendPage(out, dib);
+		FreeImage_Unload(dib);
+	}
+
+	// delete every third page : the space of the deleted pages is reused by the next pages
+	for(int i = count - 1; i >= 0; i -= 3) {
+		FreeImage_DeletePage(out, i);
+	}
+	FIBITMAP *dib = FreeImage_Allocate(512, 512, 8);
+	for(unsigned y = 0; y < FreeImage_GetHeight(dib); y++) {
+		memset(FreeImage_GetScanLine(dib, y), 255, FreeImage_GetLine(dib));
+	}
+	FreeImage_InsertPage(out, 1, dib);
+	FreeImage_Unload(dib);
+	FreeImage_CloseMultiBitmap(out, 0);
+
+	// check the saved file
+	FIMULTIBITMAP *src = FreeImage_OpenMultiBitmap(FIF_TIFF, dst_filename, FALSE, TRUE, TRUE);
+	assert(src != nullptr);
+	assert(FreeImage_GetPageCount(src) == count - count / 3 + 1);
+	for(int page = 0; page < FreeImage_GetPageCount(src); page++) {
+		// expected page numbers : 0, inserted page, 1, 3, 4, 6, 7, ...
+		const int kept = (page == 0) ? 0 : page - 1;
+		const int expected = (page == 1) ? 255 : (kept / 2) * 3 + (kept % 2);
+		FIBITMAP *dib = FreeImage_LockPage(src, page);
+		assert(dib != nullptr);
+		assert(FreeImage_GetScanLine(dib, 0)[0] == expected);
+		FreeImage_UnlockPage(src, dib, FALSE);
+	}
+	FreeImage_CloseMultiBitmap(src, 0);
+}
+
 // --------------------------------------------------------------------------
 
 BOOL testCloneMultiPage(FREE_IMAGE_FORMAT fif, const char *input, const char *output, int output_flag) {
@@ -174,6 +220,390 @@ void testLockDeleteMultiPage(const char *input) {
 
 // --------------------------------------------------------------------------
 
+static void 
+walkCachedMultiPage(const char *input, size_t max_bytes, int flags) {
+	FIMULTIBITMAP *reference = FreeImage_OpenMultiBitmap(FIF_TIFF, input, FALSE, TRUE, TRUE);
+	FIMULTIBITMAP *src = FreeImage_OpenMultiBitmap(FIF_TIFF, input, FALSE, TRUE, TRUE);
+	assert(reference && src);
+
+	BOOL bResult = FreeImage_SetMultiBitmapCache(src, max_bytes, flags);
+	assert(bResult);
+
+	const int count = FreeImage_GetPageCount(src);
+
+	// walk the pages twice : the second walk reads the cached pages
+	for(int pass = 0; pass < 2; pass++) {
+		for(int page = 0; page < count; page++) {
+			FIBITMAP *expected = FreeImage_LockPage(reference, page);
+			FIBITMAP *dib = FreeImage_LockPage(src, page);
+			assert(expected && dib);
+			assert(isSameImage(expected, dib));
+			FreeImage_UnlockPage(src, dib, FALSE);
+			FreeImage_UnlockPage(reference, expected, FALSE);
+		}
+	}
+
+	FreeImage_CloseMultiBitmap(reference, 0);
+	FreeImage_CloseMultiBitmap(src, 0);
+}
+
+void testDecodedPageCache(const char *input) {
+	// unlocked pages are kept decoded
+	FIMULTIBITMAP *src = FreeImage_OpenMultiBitmap(FIF_TIFF, input, FALSE, TRUE, TRUE);
+	assert(src);
+	BOOL bResult = FreeImage_SetMultiBitmapCache(src, 16 * 1024 * 1024);
+	assert(bResult);
+	FIBITMAP *dib = FreeImage_LockPage(src, 1);
+	FreeImage_UnlockPage(src, dib, FALSE);
+	FIBITMAP *cached = FreeImage_LockPage(src, 1);
+	assert(cached == dib);
+	FreeImage_UnlockPage(src, cached, FALSE);
+	FreeImage_CloseMultiBitmap(src, 0);
+
+	walkCachedMultiPage(input, 16 * 1024 * 1024, FI_PAGECACHE_DEFAULT);
+	walkCachedMultiPage(input, 16 * 1024 * 1024, FI_PAGECACHE_COMPRESS);
+	walkCachedMultiPage(input, 16 * 1024 * 1024, FI_PAGECACHE_COMPRESS | FI_PAGECACHE_PREFETCH);
+	// budget smaller than a page
+	walkCachedMultiPage(input, 1024, FI_PAGECACHE_PREFETCH);
+}
+
+static void 
+lockPagesInParallel(FIMULTIBITMAP *src, FIMULTIBITMAP *reference) {
+	const int count = FreeImage_GetPageCount(src);
+
+	// lock all pages but the first one, the last page is requested twice
+	FIBITMAP *first = FreeImage_LockPage(src, 0);
+	assert(first != nullptr);
+
+	std::vector<int> pages;
+	for(int page = count - 1; page >= 0; page--) {
+		pages.push_back(page);
+	}
+	pages.push_back(count - 1);
+	std::vector<FIBITMAP*> dibs(pages.size());
+
+	const int locked_count = FreeImage_LockPages(src, &pages[0], (int)pages.size(), &dibs[0]);
+	assert(locked_count == count - 1);
+
+	for(size_t i = 0; i < pages.size(); i++) {
+		if((pages[i] == 0) || (i == pages.size() - 1)) {
+			assert(dibs[i] == nullptr);
+			continue;
+		}
+		FIBITMAP *expected = FreeImage_LockPage(reference, pages[i]);
+		assert(expected && dibs[i]);
+		assert(isSameImage(expected, dibs[i]));
+		FreeImage_UnlockPage(reference, expected, FALSE);
+		FreeImage_UnlockPage(src, dibs[i], FALSE);
+	}
+	FreeImage_UnlockPage(src, first, FALSE);
+
+	int locked = 0;
+	FreeImage_GetLockedPageNumbers(src, nullptr, &locked);
+	assert(locked == 0);
+}
+
+void testLockPages(const char *input) {
+	FreeImage_SetThreadCount(4);
+
+	FIMULTIBITMAP *reference = FreeImage_OpenMultiBitmap(FIF_TIFF, input, FALSE, TRUE, TRUE);
+	assert(reference != nullptr);
+
+	// file source : each worker reopens the file
+	FIMULTIBITMAP *src = FreeImage_OpenMultiBitmap(FIF_TIFF, input, FALSE, TRUE, TRUE);
+	assert(src != nullptr);
+	lockPagesInParallel(src, reference);
+	FreeImage_CloseMultiBitmap(src, 0);
+
+	// memory source : each worker reads the buffer through its own stream
+	src = FreeImage_OpenMultiBitmapMapped(FIF_TIFF, input);
+	assert(src != nullptr);
+	lockPagesInParallel(src, reference);
+	FreeImage_CloseMultiBitmap(src, 0);
+
+	FreeImage_CloseMultiBitmap(reference, 0);
+
+	// restore the 'not set' default
+	FreeImage_SetThreadCount(-1);
+}
+
+void testRawPageCopy(FREE_IMAGE_FORMAT fif, const char *input, const char *output) {
+	// work on a copy of the input
+	BOOL bResult = testCloneMultiPage(fif, input, output, 0);
+	assert(bResult);
+
+	// append a page : the other pages are copied from the source file without decoding them
+	FIMULTIBITMAP *dst = FreeImage_OpenMultiBitmap(fif, output, FALSE, FALSE, TRUE);
+	assert(dst != nullptr);
+	const int count = FreeImage_GetPageCount(dst);
+	FIBITMAP *appended = FreeImage_Allocate(40, 24, 8);
+	assert(appended != nullptr);
+	RGBQUAD *pal = FreeImage_GetPalette(appended);
+	for(int i = 0; i < 256; i++) {
+		pal[i].rgbRed = pal[i].rgbGreen = pal[i].rgbBlue = (uint8_t)i;
+	}
+	for(unsigned y = 0; y < FreeImage_GetHeight(appended); y++) {
+		memset(FreeImage_GetScanLine(appended, y), (int)(y * 8), FreeImage_GetLine(appended));
+	}
+	FreeImage_AppendPage(dst, appended);
+	bResult = FreeImage_CloseMultiBitmap(dst, 0);
+	assert(bResult);
+
+	// check the saved file
+	FIMULTIBITMAP *reference = FreeImage_OpenMultiBitmap(fif, input, FALSE, TRUE, TRUE);
+	FIMULTIBITMAP *src = FreeImage_OpenMultiBitmap(fif, output, FALSE, TRUE, TRUE);
+	assert(reference && src);
+	assert(FreeImage_GetPageCount(src) == count + 1);
+	for(int page = 0; page <= count; page++) {
+		FIBITMAP *expected = (page < count) ? FreeImage_LockPage(reference, page) : appended;
+		FIBITMAP *dib = FreeImage_LockPage(src, page);
+		assert(expected && dib);
+		assert(isSameImage(expected, dib));
+		FreeImage_UnlockPage(src, dib, FALSE);
+		if(expected != appended) {
+			FreeImage_UnlockPage(reference, expected, FALSE);
+		}
+	}
+	FreeImage_CloseMultiBitmap(src, 0);
+	FreeImage_CloseMultiBitmap(reference, 0);
+
+	FreeImage_Unload(appended);
+}
+
+static void 
+setAnimationTag(FIBITMAP *dib, const char *key, FREE_IMAGE_MDTYPE type, uint32_t length, const void *value) {
+	FITAG *tag = FreeImage_CreateTag();
+	assert(tag != nullptr);
+	FreeImage_SetTagKey(tag, key);
+	FreeImage_SetTagType(tag, type);
+	FreeImage_SetTagCount(tag, 1);
+	FreeImage_SetTagLength(tag, length);
+	FreeImage_SetTagValue(tag, value);
+	FreeImage_SetMetadata(FIMD_ANIMATION, dib, key, tag);
+	FreeImage_DeleteTag(tag);
+}
+
+static void 
+drawAnimationFrame(FIBITMAP *canvas, FIBITMAP *frame, int left, int top, const RGBQUAD *fill) {
+	const RGBQUAD *pal = FreeImage_GetPalette(frame);
+	const uint8_t *table = FreeImage_GetTransparencyTable(frame);
+	const int count = FreeImage_GetTransparencyCount(frame);
+	for(unsigned y = 0; y < FreeImage_GetHeight(frame); y++) {
+		RGBQUAD *dst = (RGBQUAD*)FreeImage_GetScanLine(canvas, FreeImage_GetHeight(canvas) - (top + y) - 1) + left;
+		const uint8_t *src = FreeImage_GetScanLine(frame, FreeImage_GetHeight(frame) - y - 1);
+		for(unsigned x = 0; x < FreeImage_GetWidth(frame); x++) {
+			if(fill) {
+				dst[x] = *fill;
+			} else if((src[x] >= count) || (table[src[x]] != 0)) {
+				dst[x] = pal[src[x]];
+				dst[x].rgbReserved = 0xFF;
+			}
+		}
+	}
+}
+
+static FIBITMAP * 
+playFrame(const char *input, int page) {
+	FIMULTIBITMAP *src = FreeImage_OpenMultiBitmap(FIF_GIF, input, FALSE, TRUE, TRUE, GIF_PLAYBACK);
+	assert(src != nullptr);
+	FIBITMAP *dib = FreeImage_LockPage(src, page);
+	assert(dib != nullptr);
+	FIBITMAP *clone = FreeImage_Clone(dib);
+	FreeImage_UnlockPage(src, dib, FALSE);
+	FreeImage_CloseMultiBitmap(src, 0);
+	return clone;
+}
+
+void testGIFPlayback(const char *output) {
+	const int width = 48, height = 32, count = 40;
+
+	// build an animation mixing the disposal methods, transparent and full screen frames
+	FIMULTIBITMAP *dst = FreeImage_OpenMultiBitmap(FIF_GIF, output, TRUE, FALSE, FALSE);
+	assert(dst != nullptr);
+	for(int page = 0; page < count; page++) {
+		const bool full_screen = (page % 13 == 0);
+		const int w = full_screen ? width : 8 + (page * 7) % 24;
+		const int h = full_screen ? height : 4 + (page * 5) % 20;
+		FIBITMAP *frame = FreeImage_Allocate(w, h, 8);
+		assert(frame != nullptr);
+		RGBQUAD *pal = FreeImage_GetPalette(frame);
+		for(int i = 0; i < 256; i++) {
+			pal[i].rgbRed = (uint8_t)(i * 7 + page);
+			pal[i].rgbGreen = (uint8_t)(i * 13);
+			pal[i].rgbBlue = (uint8_t)(i * 31 + page * 3);
+		}
+		for(int y = 0; y < h; y++) {
+			uint8_t *bits = FreeImage_GetScanLine(frame, y);
+			for(int x = 0; x < w; x++) {
+				bits[x] = (uint8_t)((x + y + page) % 24);
+			}
+		}
+		if(!full_screen && (page % 2)) {
+			// indexes below 8 are transparent
+			uint8_t table[256];
+			memset(table, 0xFF, 256);
+			memset(table, 0, 8);
+			FreeImage_SetTransparencyTable(frame, table, 256);
+		}
+		const uint16_t left = (uint16_t)((page * 11) % (width - w + 1));
+		const uint16_t top = (uint16_t)((page * 3) % (height - h + 1));
+		const uint8_t disposal = full_screen ? 1 : (uint8_t)((page / 2) % 4);
+		const int32_t frame_time = 10 * (page + 1);
+		setAnimationTag(frame, "FrameLeft", FIDT_SHORT, 2, &left);
+		setAnimationTag(frame, "FrameTop", FIDT_SHORT, 2, &top);
+		setAnimationTag(frame, "DisposalMethod", FIDT_BYTE, 1, &disposal);
+		setAnimationTag(frame, "FrameTime", FIDT_LONG, 4, &frame_time);
+		if(page == 0) {
+			const uint16_t logical_width = width, logical_height = height;
+			setAnimationTag(frame, "LogicalWidth", FIDT_SHORT, 2, &logical_width);
+			setAnimationTag(frame, "LogicalHeight", FIDT_SHORT, 2, &logical_height);
+		}
+		FreeImage_AppendPage(dst, frame);
+		FreeImage_Unload(frame);
+	}
+	BOOL bResult = FreeImage_CloseMultiBitmap(dst, 0);
+	assert(bResult);
+
+	// compose the expected frames from the raw ones
+	FIMULTIBITMAP *raw = FreeImage_OpenMultiBitmap(FIF_GIF, output, FALSE, TRUE, TRUE, GIF_LOAD256);
+	assert(raw != nullptr);
+	FIBITMAP *canvas = FreeImage_Allocate(width, height, 32);
+	assert(canvas != nullptr);
+	RGBQUAD background = { 0, 0, 0, 0 };
+	std::vector<FIBITMAP*> expected(count);
+	for(int page = 0; page < count; page++) {
+		FIBITMAP *frame = FreeImage_LockPage(raw, page);
+		assert(frame != nullptr);
+		if(page == 0) {
+			FreeImage_GetBackgroundColor(frame, &background);
+			background.rgbReserved = 0;
+			for(int y = 0; y < height; y++) {
+				RGBQUAD *bits = (RGBQUAD*)FreeImage_GetScanLine(canvas, y);
+				for(int x = 0; x < width; x++) {
+					bits[x] = background;
+				}
+			}
+		}
+		FITAG *tag = nullptr;
+		BOOL bResult = FreeImage_GetMetadata(FIMD_ANIMATION, frame, "FrameLeft", &tag);
+		assert(bResult);
+		const int left = *(uint16_t*)FreeImage_GetTagValue(tag);
+		bResult = FreeImage_GetMetadata(FIMD_ANIMATION, frame, "FrameTop", &tag);
+		assert(bResult);
+		const int top = *(uint16_t*)FreeImage_GetTagValue(tag);
+		bResult = FreeImage_GetMetadata(FIMD_ANIMATION, frame, "DisposalMethod", &tag);
+		assert(bResult);
+		const int disposal = *(uint8_t*)FreeImage_GetTagValue(tag);
+
+		expected[page] = FreeImage_Clone(canvas);
+		drawAnimationFrame(expected[page], frame, left, top, nullptr);
+		if(disposal == 2) {
+			drawAnimationFrame(canvas, frame, left, top, &background);
+		} else if(disposal != 3) {
+			drawAnimationFrame(canvas, frame, left, top, nullptr);
+		}
+		FreeImage_UnlockPage(raw, frame, FALSE);
+
+		// a freshly opened animation replays the frames from the start
+		FIBITMAP *dib = playFrame(output, page);
+		assert(isSameImage(expected[page], dib));
+		bResult = FreeImage_GetMetadata(FIMD_ANIMATION, dib, "FrameTime", &tag);
+		assert(bResult);
+		assert(*(int32_t*)FreeImage_GetTagValue(tag) == 10 * (page + 1));
+		FreeImage_Unload(dib);
+	}
+	FreeImage_Unload(canvas);
+	FreeImage_CloseMultiBitmap(raw, 0);
+
+	// the playback state is kept between the pages : play forward, backward, then seek around
+	std::vector<int> order;
+	for(int page = 0; page < count; page++) {
+		order.push_back(page);
+	}
+	for(int page = count - 1; page >= 0; page--) {
+		order.push_back(page);
+	}
+	for(int i = 0; i < count; i++) {
+		order.push_back((i * 17 + 5) % count);
+	}
+	FIMULTIBITMAP *src = FreeImage_OpenMultiBitmap(FIF_GIF, output, FALSE, TRUE, TRUE, GIF_PLAYBACK);
+	assert(src != nullptr);
+	for(size_t i = 0; i < order.size(); i++) {
+		FIBITMAP *dib = FreeImage_LockPage(src, order[i]);
+		assert(dib != nullptr);
+		assert(isSameImage(expected[order[i]], dib));
+		FreeImage_UnlockPage(src, dib, FALSE);
+	}
+	FreeImage_CloseMultiBitmap(src, 0);
+
+	for(int page = 0; page < count; page++) {
+		FreeImage_Unload(expected[page]);
+	}
+}
+
+void testGIFCodec() {
+	// LZW round trip of 1-, 4- and 8-bit images, with odd widths, interlaced or not
+	const unsigned bpps[] = { 1, 4, 8 };
+	for(int i = 0; i < 3; i++) {
+		for(int interlaced = 0; interlaced < 2; interlaced++) {
+			const unsigned bpp = bpps[i];
+			const unsigned width = (bpp == 8) ? 701 : 333, height = (bpp == 8) ? 389 : 77;
+			FIBITMAP *src = FreeImage_Allocate(width, height, bpp);
+			assert(src != nullptr);
+			RGBQUAD *pal = FreeImage_GetPalette(src);
+			for(unsigned k = 0; k < FreeImage_GetColorsUsed(src); k++) {
+				pal[k].rgbRed = pal[k].rgbGreen = pal[k].rgbBlue = (uint8_t)k;
+			}
+			// mix of runs and noise, so that the string table is reset several times
+			uint32_t seed = 1234567;
+			for(unsigned y = 0; y < height; y++) {
+				uint8_t *bits = FreeImage_GetScanLine(src, y);
+				for(unsigned x = 0; x < FreeImage_GetLine(src); x++) {
+					seed = seed * 1103515245 + 12345;
+					bits[x] = ((seed >> 16) % 3) ? (uint8_t)(x * y / 97) : (uint8_t)(seed >> 24);
+				}
+			}
+			if(bpp < 8) {
+				// clear the padding bits of the last pixel byte
+				const unsigned used = width * bpp;
+				for(unsigned y = 0; y < height; y++) {
+					FreeImage_GetScanLine(src, y)[used / 8] &= (uint8_t)(0xFF << (8 - used % 8));
+				}
+			}
+			const uint8_t flag = (uint8_t)interlaced;
+			setAnimationTag(src, "Interlaced", FIDT_BYTE, 1, &flag);
+
+			FIMEMORY *stream = FreeImage_OpenMemory();
+			BOOL bResult = FreeImage_SaveToMemory(FIF_GIF, src, stream, 0);
+			assert(bResult);
+			FreeImage_SeekMemory(stream, 0, SEEK_SET);
+			FIBITMAP *dst = FreeImage_LoadFromMemory(FIF_GIF, stream, 0);
+			assert(dst != nullptr);
+			assert(isSameImage(src, dst));
+
+			FreeImage_Unload(dst);
+			FreeImage_CloseMemory(stream);
+			FreeImage_Unload(src);
+		}
+	}
+
+	// a 12-bit LZW minimum code size leaves no room for the clear and end codes : the frame is rejected
+	uint8_t corrupted[] = {
+		'G', 'I', 'F', '8', '9', 'a', 1, 0, 1, 0, 0x80, 0, 0,	// 1x1 logical screen, 2 colors global palette
+		0, 0, 0, 0xFF, 0xFF, 0xFF,
+		0x2C, 0, 0, 0, 0, 1, 0, 1, 0, 0,	// 1x1 image
+		12,									// LZW minimum code size
+		4, 0x00, 0x20, 0x00, 0x02, 0,		// 13-bit codes 0 and 4098
+		0x3B
+	};
+	FIMEMORY *stream = FreeImage_OpenMemory(corrupted, sizeof(corrupted));
+	FIBITMAP *dib = FreeImage_LoadFromMemory(FIF_GIF, stream, 0);
+	assert(dib == nullptr);
+	FreeImage_CloseMemory(stream);
+}
+
+// --------------------------------------------------------------------------
+
 void testMultiPage(const char *lpszPathName) {
 	printf("testMultiPage ...\n");
 
@@ -190,4 +620,24 @@ void testMultiPage(const char *lpszPathName) {
 
 	// test multipage cache
 	testMPageCache(lpszPathName, "mpages.tif");
+
+	// test decoded page cache
+	testDecodedPageCache("mpages.tif");
+
+	// test parallel page decoding
+	testLockPages("mpages.tif");
+
+	// test the swap file of the modified pages
+	testMPageSwapCache("swap.tif", FALSE);
+	testMPageSwapCache("swap.tif", TRUE);
+
+	// test the copy of the unchanged pages
+	testRawPageCopy(FIF_TIFF, "sample.tif", "append.tif");
+	testRawPageCopy(FIF_GIF, "sample.gif", "append.gif");
+
+	// test the animation playback
+	testGIFPlayback("animation.gif");
+
+	// test the GIF LZW codec
+	testGIFCodec();
 }
@@ -21,6 +21,7 @@
 
 
 #include "TestSuite.h"
+#include <string.h>
 
 // --------------------------------------------------------------------------
 
@@ -88,6 +89,36 @@ void testLoadMultiBitmapFromMemory(const char *lpszPathName) {
 	}
 }
 
+void testOpenMultiBitmapMapped(const char *lpszPathName) {
+	FREE_IMAGE_FORMAT fif = FreeImage_GetFileType(lpszPathName);
+
+	// open the same file through stdio and through a mapped view
+	FIMULTIBITMAP *src = FreeImage_OpenMultiBitmap(fif, lpszPathName, FALSE, TRUE);
+	FIMULTIBITMAP *mapped = FreeImage_OpenMultiBitmapMapped(fif, lpszPathName, 0);
+	assert(src && mapped);
+
+	const int count = FreeImage_GetPageCount(src);
+	assert(FreeImage_GetPageCount(mapped) == count);
+
+	for(int page = 0; page < count; page++) {
+		FIBITMAP *dib = FreeImage_LockPage(src, page);
+		FIBITMAP *check = FreeImage_LockPage(mapped, page);
+		assert(dib && check);
+		assert(FreeImage_GetWidth(dib) == FreeImage_GetWidth(check));
+		assert(FreeImage_GetHeight(dib) == FreeImage_GetHeight(check));
+		assert(FreeImage_GetBPP(dib) == FreeImage_GetBPP(check));
+		const unsigned line = FreeImage_GetLine(dib);
+		for(unsigned y = 0; y < FreeImage_GetHeight(dib); y++) {
+			assert(memcmp(FreeImage_GetScanLine(dib, y), FreeImage_GetScanLine(check, y), line) == 0);
+		}
+		FreeImage_UnlockPage(mapped, check, FALSE);
+		FreeImage_UnlockPage(src, dib, FALSE);
+	}
+
+	FreeImage_CloseMultiBitmap(mapped, 0);
+	FreeImage_CloseMultiBitmap(src, 0);
+}
+
 // --------------------------------------------------------------------------
 
 BOOL testSaveMultiBitmapToMemory(const char *input, const char *output, int output_flag) {
@@ -260,6 +291,9 @@ void testMultiPageMemory(const char *lpszPathName) {
 	// test FreeImage_LoadMultiBitmapFromMemory
 	testLoadMultiBitmapFromMemory(lpszPathName);
 
+	// test FreeImage_OpenMultiBitmapMapped
+	testOpenMultiBitmapMapped(lpszPathName);
+
 	// test FreeImage_SaveMultiBitmapToMemory
 	bSuccess = testSaveMultiBitmapToMemory("sample.tif", "mpage-mstream.tif", 0);
 	assert(bSuccess);
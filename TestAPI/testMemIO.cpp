@@ -22,6 +22,8 @@
 
 #include "TestSuite.h"
 
+#include <string.h>
+
 void testSaveMemIO(const char *lpszPathName) {
 	FIMEMORY *hmem = nullptr; 
 
@@ -139,10 +141,164 @@ void testAcquireMemIO(const char *lpszPathName) {
 
 }
 
+void testLoadMappedIO(const char *lpszPathName) {
+	FREE_IMAGE_FORMAT fif = FreeImage_GetFileType(lpszPathName);
+
+	// load a regular file
+	FIBITMAP *dib = FreeImage_Load(fif, lpszPathName, 0);
+	assert(dib != nullptr);
+
+	// load the same file through a mapped view
+	FIBITMAP *check = FreeImage_LoadMapped(fif, lpszPathName, 0);
+	assert(check != nullptr);
+
+	// both images must be identical
+	assert(FreeImage_GetWidth(dib) == FreeImage_GetWidth(check));
+	assert(FreeImage_GetHeight(dib) == FreeImage_GetHeight(check));
+	assert(FreeImage_GetBPP(dib) == FreeImage_GetBPP(check));
+	const unsigned line = FreeImage_GetLine(dib);
+	for(unsigned y = 0; y < FreeImage_GetHeight(dib); y++) {
+		assert(memcmp(FreeImage_GetScanLine(dib, y), FreeImage_GetScanLine(check, y), line) == 0);
+	}
+
+	FreeImage_Unload(check);
+	FreeImage_Unload(dib);
+}
+
+void testSegmentedMemIO(const char *lpszPathName) {
+	FREE_IMAGE_FORMAT fif = FreeImage_GetFileType(lpszPathName);
+
+	FIBITMAP *dib = FreeImage_Load(fif, lpszPathName, 0);
+	assert(dib != nullptr);
+
+	// save to a contiguous stream
+	FIMEMORY *hmem = FreeImage_OpenMemory();
+	BOOL bResult = FreeImage_SaveToMemory(FIF_PNG, dib, hmem, 0);
+	assert(bResult);
+
+	// save to a segmented stream, using small segments
+	FIMEMORY *hsegmented = FreeImage_OpenMemorySegmented(4096);
+	bResult = FreeImage_SaveToMemory(FIF_PNG, dib, hsegmented, 0);
+	assert(bResult);
+
+	uint8_t *mem_buffer = nullptr;
+	uint32_t size_in_bytes = 0;
+	bResult = FreeImage_AcquireMemory(hmem, &mem_buffer, &size_in_bytes);
+	assert(bResult);
+	assert(FreeImage_TellMemory(hsegmented) == (long)size_in_bytes);
+
+	// query the segments
+	unsigned count = 0;
+	bResult = FreeImage_AcquireMemorySegments(hsegmented, nullptr, &count);
+	assert(bResult);
+	assert(count == (size_in_bytes + 4095) / 4096);
+	FIMEMORYSEGMENT *segments = (FIMEMORYSEGMENT*)malloc(count * sizeof(FIMEMORYSEGMENT));
+	unsigned too_small = count - 1;
+	bResult = FreeImage_AcquireMemorySegments(hsegmented, segments, &too_small);
+	assert(!bResult && (too_small == count));
+	bResult = FreeImage_AcquireMemorySegments(hsegmented, segments, &count);
+	assert(bResult);
+
+	// the segments must hold the same bytes as the contiguous stream
+	uint32_t offset = 0;
+	for(unsigned i = 0; i < count; i++) {
+		assert(memcmp(mem_buffer + offset, segments[i].data, segments[i].size) == 0);
+		offset += segments[i].size;
+	}
+	assert(offset == size_in_bytes);
+	free(segments);
+
+	// load back from the segmented stream
+	FreeImage_SeekMemory(hsegmented, 0, SEEK_SET);
+	FIBITMAP *check = FreeImage_LoadFromMemory(FIF_PNG, hsegmented, 0);
+	assert(check != nullptr);
+	assert(FreeImage_GetWidth(check) == FreeImage_GetWidth(dib));
+	assert(FreeImage_GetHeight(check) == FreeImage_GetHeight(dib));
+	FreeImage_Unload(check);
+
+	// acquiring a segmented stream as a single buffer flattens it
+	uint8_t *flat_buffer = nullptr;
+	uint32_t flat_size = 0;
+	bResult = FreeImage_AcquireMemory(hsegmented, &flat_buffer, &flat_size);
+	assert(bResult);
+	assert((flat_size == size_in_bytes) && (memcmp(flat_buffer, mem_buffer, flat_size) == 0));
+
+	FreeImage_CloseMemory(hsegmented);
+	FreeImage_CloseMemory(hmem);
+	FreeImage_Unload(dib);
+}
+
+// 64-bit IO functions wrapping a memory stream
+static unsigned DLL_CALLCONV 
+_ReadProc64(void *buffer, unsigned size, unsigned count, fi_handle handle) {
+	return FreeImage_ReadMemory(buffer, size, count, (FIMEMORY*)handle);
+}
+static unsigned DLL_CALLCONV 
+_WriteProc64(void *buffer, unsigned size, unsigned count, fi_handle handle) {
+	return FreeImage_WriteMemory(buffer, size, count, (FIMEMORY*)handle);
+}
+static int DLL_CALLCONV 
+_SeekProc64(fi_handle handle, int64_t offset, int origin) {
+	return FreeImage_SeekMemory64((FIMEMORY*)handle, offset, origin) ? 0 : -1;
+}
+static int64_t DLL_CALLCONV 
+_TellProc64(fi_handle handle) {
+	return FreeImage_TellMemory64((FIMEMORY*)handle);
+}
+
+void testMemIO64(const char *lpszPathName) {
+	FREE_IMAGE_FORMAT fif = FreeImage_GetFileType(lpszPathName);
+
+	FIBITMAP *dib = FreeImage_Load(fif, lpszPathName, 0);
+	assert(dib != nullptr);
+
+	FreeImageIO64 io;
+	io.read_proc = _ReadProc64;
+	io.write_proc = _WriteProc64;
+	io.seek_proc = _SeekProc64;
+	io.tell_proc = _TellProc64;
+
+	// save and load back through the 64-bit IO functions
+	FIMEMORY *hmem = FreeImage_OpenMemory();
+	BOOL bResult = FreeImage_SaveToHandle64(FIF_TIFF, dib, &io, (fi_handle)hmem, TIFF_DEFAULT);
+	assert(bResult);
+	FreeImage_SeekMemory64(hmem, 0, SEEK_END);
+	const int64_t file_size = FreeImage_TellMemory64(hmem);
+	assert(file_size > 0);
+
+	FreeImage_SeekMemory64(hmem, 0, SEEK_SET);
+	FIBITMAP *check = FreeImage_LoadFromHandle64(FIF_TIFF, &io, (fi_handle)hmem, 0);
+	assert(check != nullptr);
+	assert(FreeImage_GetWidth(check) == FreeImage_GetWidth(dib));
+	assert(FreeImage_GetHeight(check) == FreeImage_GetHeight(dib));
+	FreeImage_Unload(check);
+
+	uint8_t *mem_buffer = nullptr;
+	uint64_t size_in_bytes = 0;
+	bResult = FreeImage_AcquireMemory64(hmem, &mem_buffer, &size_in_bytes);
+	assert(bResult);
+	assert(size_in_bytes == (uint64_t)file_size);
+
+	// the position may be moved beyond 4 GB
+	const int64_t far_position = (int64_t)5 << 30;
+	bResult = FreeImage_SeekMemory64(hmem, far_position, SEEK_SET);
+	assert(bResult && (FreeImage_TellMemory64(hmem) == far_position));
+	bResult = FreeImage_SeekMemory64(hmem, -far_position, SEEK_CUR);
+	assert(bResult && (FreeImage_TellMemory64(hmem) == 0));
+	bResult = FreeImage_SeekMemory64(hmem, -1, SEEK_SET);
+	assert(!bResult);
+
+	FreeImage_CloseMemory(hmem);
+	FreeImage_Unload(dib);
+}
+
 void testMemIO(const char *lpszPathName) {
 	printf("testMemIO ...\n");
 	testSaveMemIO(lpszPathName);
 	testLoadMemIO(lpszPathName);
 	testAcquireMemIO(lpszPathName);
+	testLoadMappedIO(lpszPathName);
+	testSegmentedMemIO(lpszPathName);
+	testMemIO64(lpszPathName);
 }
 
@@ -0,0 +1,244 @@
+// ==========================================================
+// FreeImage 3 Test Script
+//
+// This file is part of FreeImage 3
+//
+// COVERED CODE IS PROVIDED UNDER THIS LICENSE ON AN "AS IS" BASIS, WITHOUT WARRANTY
+// OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING, WITHOUT LIMITATION, WARRANTIES
+// THAT THE COVERED CODE IS FREE OF DEFECTS, MERCHANTABLE, FIT FOR A PARTICULAR PURPOSE
+// OR NON-INFRINGING. THE ENTIRE RISK AS TO THE QUALITY AND PERFORMANCE OF THE COVERED
+// CODE IS WITH YOU. SHOULD ANY COVERED CODE PROVE DEFECTIVE IN ANY RESPECT, YOU (NOT
+// THE INITIAL DEVELOPER OR ANY OTHER CONTRIBUTOR) ASSUME THE COST OF ANY NECESSARY
+// SERVICING, REPAIR OR CORRECTION. THIS DISCLAIMER OF WARRANTY CONSTITUTES AN ESSENTIAL
+// PART OF THIS LICENSE. NO USE OF ANY COVERED CODE IS AUTHORIZED HEREUNDER EXCEPT UNDER
+// THIS DISCLAIMER.
+//
+// Use at your own risk!
+// ==========================================================
+
+#include "TestSuite.h"
+
+#include <string.h>
+
+// Local test functions
+// ----------------------------------------------------------
+
+/**
+Check that multithreaded PNG encoding gives the same pixels as single-threaded encoding
+*/
+static BOOL testMultithreadedPNG(FIBITMAP *src, int flags) {
+	BOOL bResult = FALSE;
+
+	// single-threaded reference
+	FreeImage_SetThreadCount(1);
+	if(!FreeImage_Save(FIF_PNG, src, "multithreaded.png", flags)) {
+		return FALSE;
+	}
+	FIBITMAP *ref = FreeImage_Load(FIF_PNG, "multithreaded.png", 0);
+
+	// multithreaded
+	FreeImage_SetThreadCount(4);
+	FIBITMAP *dst = nullptr;
+	if(FreeImage_Save(FIF_PNG, src, "multithreaded.png", flags | PNG_MULTITHREADED)) {
+		dst = FreeImage_Load(FIF_PNG, "multithreaded.png", 0);
+	}
+	FreeImage_SetThreadCount(-1);
+
+	if(ref && dst) {
+		bResult = isSameImage(ref, dst);
+	}
+
+	if(ref) FreeImage_Unload(ref);
+	if(dst) FreeImage_Unload(dst);
+
+	return bResult;
+}
+
+/**
+Check that a save preset gives the same pixels as the default settings
+(and, for PNG_SAVE_SMALLEST, a file that is not larger)
+*/
+static BOOL testPNGSavePreset(FIBITMAP *src, int flags) {
+	BOOL bResult = FALSE;
+
+	// default settings
+	if(!FreeImage_Save(FIF_PNG, src, "preset.png", PNG_DEFAULT)) {
+		return FALSE;
+	}
+	FIBITMAP *ref = FreeImage_Load(FIF_PNG, "preset.png", 0);
+	FILE *file = fopen("preset.png", "rb");
+	fseek(file, 0, SEEK_END);
+	const long default_size = ftell(file);
+	fclose(file);
+
+	// save preset
+	FIBITMAP *dst = nullptr;
+	long preset_size = 0;
+	if(FreeImage_Save(FIF_PNG, src, "preset.png", flags)) {
+		dst = FreeImage_Load(FIF_PNG, "preset.png", 0);
+		file = fopen("preset.png", "rb");
+		fseek(file, 0, SEEK_END);
+		preset_size = ftell(file);
+		fclose(file);
+	}
+
+	if(ref && dst) {
+		bResult = isSameImage(ref, dst);
+		// the smallest encoding includes the default filters and strategy
+		if((flags & PNG_SAVE_SMALLEST) && (preset_size > default_size)) {
+			bResult = FALSE;
+		}
+	}
+
+	if(ref) FreeImage_Unload(ref);
+	if(dst) FreeImage_Unload(dst);
+
+	return bResult;
+}
+
+static unsigned DLL_CALLCONV
+myReadProc(void *buffer, unsigned size, unsigned count, fi_handle handle) {
+	return (unsigned)fread(buffer, size, count, (FILE *)handle);
+}
+
+static unsigned DLL_CALLCONV
+myWriteProc(void *buffer, unsigned size, unsigned count, fi_handle handle) {
+	return (unsigned)fwrite(buffer, size, count, (FILE *)handle);
+}
+
+static int DLL_CALLCONV
+mySeekProc(fi_handle handle, long offset, int origin) {
+	return fseek((FILE *)handle, offset, origin);
+}
+
+static long DLL_CALLCONV
+myTellProc(fi_handle handle) {
+	return ftell((FILE *)handle);
+}
+
+/**
+Check that the rows returned by a PNG scanline reader are the rows of the loaded image
+*/
+static BOOL testScanlineReader(FIBITMAP *src, int flags) {
+	FreeImageIO io;
+
+	io.read_proc  = myReadProc;
+	io.write_proc = myWriteProc;
+	io.seek_proc  = mySeekProc;
+	io.tell_proc  = myTellProc;
+
+	if(!FreeImage_Save(FIF_PNG, src, "scanlines.png", flags)) {
+		return FALSE;
+	}
+	FIBITMAP *ref = FreeImage_Load(FIF_PNG, "scanlines.png", 0);
+	if(!ref) {
+		return FALSE;
+	}
+
+	BOOL bResult = FALSE;
+
+	FILE *file = fopen("scanlines.png", "rb");
+	FISCANLINEREADER *reader = file ? FreeImage_OpenScanlineReader(FIF_PNG, &io, (fi_handle)file, 0) : nullptr;
+	if(reader) {
+		FIBITMAP *header = FreeImage_GetScanlineReaderInfo(reader);
+		const unsigned height = FreeImage_GetHeight(ref);
+		const unsigned line = FreeImage_GetLine(ref);
+
+		bResult = !FreeImage_HasPixels(header) && (FreeImage_GetImageType(header) == FreeImage_GetImageType(ref)) && (FreeImage_GetBPP(header) == FreeImage_GetBPP(ref)) 
+			&& (FreeImage_GetWidth(header) == FreeImage_GetWidth(ref)) && (FreeImage_GetHeight(header) == height) && (FreeImage_GetLine(header) == line);
+
+		// rows are returned from the top of the image
+		uint8_t *bits = (uint8_t*)calloc(line, 1);
+		for(unsigned y = 0; bResult && (y < height); y++) {
+			bResult = FreeImage_ReadNextScanline(reader, bits) && (memcmp(bits, FreeImage_GetScanLine(ref, height - 1 - y), line) == 0);
+		}
+		bResult = bResult && !FreeImage_ReadNextScanline(reader, bits);
+		free(bits);
+
+		FreeImage_CloseScanlineReader(reader);
+	}
+
+	if(file) fclose(file);
+	FreeImage_Unload(ref);
+
+	return bResult;
+}
+
+// Main test functions
+// ----------------------------------------------------------
+
+void testPNG(unsigned width, unsigned height) {
+	BOOL bResult = FALSE;
+
+	printf("testPNG ...\n");
+
+	// create a test 8-bit image
+	FIBITMAP *src = createZonePlateImage(width, height, 128);
+	assert(src != nullptr);
+
+	FIBITMAP *src24 = FreeImage_ConvertTo24Bits(src);
+	assert(src24 != nullptr);
+	FIBITMAP *src32 = FreeImage_ConvertTo32Bits(src);
+	assert(src32 != nullptr);
+	FreeImage_SetTransparent(src32, TRUE);
+	FIBITMAP *src16 = FreeImage_ConvertToType(src, FIT_UINT16);
+	assert(src16 != nullptr);
+	FIBITMAP *src48 = FreeImage_ConvertToType(src24, FIT_RGB16);
+	assert(src48 != nullptr);
+
+	// multithreaded saving
+	// -------------------------
+
+	bResult = testMultithreadedPNG(src, PNG_MULTITHREADED_FAST);
+	assert(bResult);
+	bResult = testMultithreadedPNG(src24, PNG_DEFAULT);
+	assert(bResult);
+	bResult = testMultithreadedPNG(src24, PNG_Z_BEST_COMPRESSION | PNG_MULTITHREADED_FAST);
+	assert(bResult);
+	bResult = testMultithreadedPNG(src32, PNG_Z_BEST_SPEED);
+	assert(bResult);
+	bResult = testMultithreadedPNG(src16, PNG_MULTITHREADED_FAST);
+	assert(bResult);
+	bResult = testMultithreadedPNG(src48, PNG_Z_NO_COMPRESSION);
+	assert(bResult);
+
+	// save presets
+	// -------------------------
+
+	bResult = testPNGSavePreset(src, PNG_SAVE_FAST);
+	assert(bResult);
+	bResult = testPNGSavePreset(src24, PNG_SAVE_FAST);
+	assert(bResult);
+	bResult = testPNGSavePreset(src, PNG_SAVE_SMALLEST);
+	assert(bResult);
+	bResult = testPNGSavePreset(src24, PNG_SAVE_SMALLEST);
+	assert(bResult);
+	bResult = testPNGSavePreset(src32, PNG_SAVE_SMALLEST | PNG_MULTITHREADED);
+	assert(bResult);
+	bResult = testPNGSavePreset(src48, PNG_SAVE_SMALLEST);
+	assert(bResult);
+	bResult = testPNGSavePreset(src48, PNG_SAVE_FAST | PNG_INTERLACED);
+	assert(bResult);
+
+	// row by row decoding (non-interlaced and Adam7 interlaced)
+	// -------------------------
+
+	FIBITMAP *images[] = { src, src24, src32, src48 };
+	for(int i = 0; i < 4; i++) {
+		bResult = testScanlineReader(images[i], PNG_DEFAULT);
+		assert(bResult);
+		bResult = testScanlineReader(images[i], PNG_INTERLACED);
+		assert(bResult);
+	}
+	FIBITMAP *src4 = FreeImage_ConvertTo4Bits(src);
+	assert(src4 != nullptr);
+	bResult = testScanlineReader(src4, PNG_INTERLACED);
+	assert(bResult);
+	FreeImage_Unload(src4);
+
+	FreeImage_Unload(src48);
+	FreeImage_Unload(src16);
+	FreeImage_Unload(src32);
+	FreeImage_Unload(src24);
+	FreeImage_Unload(src);
+}
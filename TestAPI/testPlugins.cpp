@@ -36,3 +36,99 @@ void showPlugins() {
 	printf("\n");
 }
 
+
+// Plugin lookup by format, MIME type and file extension
+// ----------------------------------------------------------
+void testPluginLookup() {
+	printf("testPluginLookup ...\n");
+
+	for (int j = 0; j < FreeImage_GetFIFCount(); j++) {
+		const FREE_IMAGE_FORMAT fif = (FREE_IMAGE_FORMAT)j;
+		// several plugins may share a format string : the first one is returned
+		const FREE_IMAGE_FORMAT found = FreeImage_GetFIFFromFormat(FreeImage_GetFormatFromFIF(fif));
+		assert((found != FIF_UNKNOWN) && (found <= fif));
+	}
+
+	// lookups are case insensitive
+	assert(FreeImage_GetFIFFromFormat("png") == FIF_PNG);
+	assert(FreeImage_GetFIFFromFilename("image.JPG") == FIF_JPEG);
+	assert(FreeImage_GetFIFFromFilename("C:\\images\\image.tiff") == FIF_TIFF);
+	assert(FreeImage_GetFIFFromFilename("tif") == FIF_TIFF);
+	assert(FreeImage_GetFIFFromFilename("image.pbm") == FIF_PBM);
+	assert(FreeImage_GetFIFFromFilename("image.unknown") == FIF_UNKNOWN);
+	assert(FreeImage_GetFIFFromMime("image/png") == FIF_PNG);
+
+	// disabled plugins are skipped
+	FreeImage_SetPluginEnabled(FIF_PBM, FALSE);
+	assert(FreeImage_GetFIFFromFilename("image.pbm") == FIF_PBMRAW);
+	FreeImage_SetPluginEnabled(FIF_PBM, TRUE);
+
+	FreeImage_SetPluginEnabled(FIF_JPEG, FALSE);
+	assert(FreeImage_GetFIFFromFilename("image.jpg") == FIF_UNKNOWN);
+	assert(FreeImage_GetFIFFromFormat("JPEG") == FIF_UNKNOWN);
+	FreeImage_SetPluginEnabled(FIF_JPEG, TRUE);
+	assert(FreeImage_GetFIFFromFormat("JPEG") == FIF_JPEG);
+}
+
+// ----------------------------------------------------------
+// File type detection from magic signatures
+// ----------------------------------------------------------
+
+static FREE_IMAGE_FORMAT 
+getFileTypeOfSavedImage(FIBITMAP *dib, FREE_IMAGE_FORMAT fif) {
+	FREE_IMAGE_FORMAT result = FIF_UNKNOWN;
+	FIMEMORY *hmem = FreeImage_OpenMemory();
+	if (FreeImage_SaveToMemory(fif, dib, hmem, 0)) {
+		FreeImage_SeekMemory(hmem, 0, SEEK_SET);
+		result = FreeImage_GetFileTypeFromMemory(hmem, 0);
+	}
+	FreeImage_CloseMemory(hmem);
+	return result;
+}
+
+void testGetFileType() {
+	printf("testGetFileType ...\n");
+
+	const FREE_IMAGE_FORMAT formats[] = { 
+		FIF_BMP, FIF_JPEG, FIF_PNG, FIF_TIFF, FIF_GIF, FIF_PSD, FIF_PPMRAW, FIF_PCX, FIF_RAS, FIF_HDR, FIF_PFM, FIF_SGI, FIF_TARGA, FIF_ICO 
+	};
+
+	FIBITMAP *dib24 = FreeImage_Allocate(32, 32, 24);
+	FIBITMAP *dib8 = FreeImage_Allocate(32, 32, 8);
+	FIBITMAP *dibF = FreeImage_AllocateT(FIT_RGBF, 32, 32);
+	assert(dib24 && dib8 && dibF);
+
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+		const FREE_IMAGE_FORMAT fif = formats[i];
+		FIBITMAP *dib = (fif == FIF_HDR || fif == FIF_PFM) ? dibF : (fif == FIF_GIF) ? dib8 : dib24;
+		if (FreeImage_FIFSupportsWriting(fif)) {
+			// the PNM plugins share their signatures : the first one registered wins
+			const FREE_IMAGE_FORMAT expected = (fif == FIF_PPMRAW) ? FIF_PBM : fif;
+			const FREE_IMAGE_FORMAT detected = getFileTypeOfSavedImage(dib, fif);
+			assert(detected == expected);
+		}
+	}
+
+	// disabled plugins are not detected
+	FreeImage_SetPluginEnabled(FIF_PNG, FALSE);
+	FREE_IMAGE_FORMAT detected = getFileTypeOfSavedImage(dib24, FIF_PNG);
+	assert(detected == FIF_UNKNOWN);
+	FreeImage_SetPluginEnabled(FIF_PNG, TRUE);
+
+	// unknown and truncated streams
+	uint8_t garbage[] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 };
+	FIMEMORY *hmem = FreeImage_OpenMemory(garbage, sizeof(garbage));
+	detected = FreeImage_GetFileTypeFromMemory(hmem, 0);
+	assert(detected == FIF_UNKNOWN);
+	FreeImage_CloseMemory(hmem);
+
+	uint8_t png_start[] = { 0x89, 0x50, 0x4E };
+	hmem = FreeImage_OpenMemory(png_start, sizeof(png_start));
+	detected = FreeImage_GetFileTypeFromMemory(hmem, 0);
+	assert(detected == FIF_UNKNOWN);
+	FreeImage_CloseMemory(hmem);
+
+	FreeImage_Unload(dib24);
+	FreeImage_Unload(dib8);
+	FreeImage_Unload(dibF);
+}
@@ -0,0 +1,413 @@
+// ==========================================================
+// FreeImage 3 Test Script
+//
+// This file is part of FreeImage 3
+//
+// COVERED CODE IS PROVIDED UNDER THIS LICENSE ON AN "AS IS" BASIS, WITHOUT WARRANTY
+// OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING, WITHOUT LIMITATION, WARRANTIES
+// THAT THE COVERED CODE IS FREE OF DEFECTS, MERCHANTABLE, FIT FOR A PARTICULAR PURPOSE
+// OR NON-INFRINGING. THE ENTIRE RISK AS TO THE QUALITY AND PERFORMANCE OF THE COVERED
+// CODE IS WITH YOU. SHOULD ANY COVERED CODE PROVE DEFECTIVE IN ANY RESPECT, YOU (NOT
+// THE INITIAL DEVELOPER OR ANY OTHER CONTRIBUTOR) ASSUME THE COST OF ANY NECESSARY
+// SERVICING, REPAIR OR CORRECTION. THIS DISCLAIMER OF WARRANTY CONSTITUTES AN ESSENTIAL
+// PART OF THIS LICENSE. NO USE OF ANY COVERED CODE IS AUTHORIZED HEREUNDER EXCEPT UNDER
+// THIS DISCLAIMER.
+//
+// Use at your own risk!
+// ==========================================================
+
+#include "TestSuite.h"
+
+#include <string.h>
+
+// Local test functions
+// ----------------------------------------------------------
+
+/**
+Same as isSameImage, allowing the bytes to differ by one
+*/
+static BOOL isSimilarImage(FIBITMAP *dib1, FIBITMAP *dib2) {
+	if((FreeImage_GetImageType(dib1) != FreeImage_GetImageType(dib2)) || (FreeImage_GetBPP(dib1) != FreeImage_GetBPP(dib2))) {
+		return FALSE;
+	}
+	if((FreeImage_GetWidth(dib1) != FreeImage_GetWidth(dib2)) || (FreeImage_GetHeight(dib1) != FreeImage_GetHeight(dib2))) {
+		return FALSE;
+	}
+	const unsigned line = FreeImage_GetLine(dib1);
+	for(unsigned y = 0; y < FreeImage_GetHeight(dib1); y++) {
+		const uint8_t *bits1 = FreeImage_GetScanLine(dib1, y);
+		const uint8_t *bits2 = FreeImage_GetScanLine(dib2, y);
+		for(unsigned x = 0; x < line; x++) {
+			if(abs((int)bits1[x] - (int)bits2[x]) > 1) {
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+/**
+Check that multithreaded rescaling gives the same result as single-threaded rescaling
+*/
+static BOOL testRescaleMultithreaded(FIBITMAP *src, int dst_width, int dst_height, FREE_IMAGE_FILTER filter) {
+	BOOL bResult = FALSE;
+
+	// single-threaded reference
+	FreeImage_SetThreadCount(1);
+	FIBITMAP *ref = FreeImage_Rescale(src, dst_width, dst_height, filter);
+
+	// multithreaded through the flag (a negative count restores the 'not set' state, i.e. one thread per hardware thread)
+	FreeImage_SetThreadCount(-1);
+	FIBITMAP *dst1 = FreeImage_RescaleRect(src, dst_width, dst_height, 0, 0, FreeImage_GetWidth(src), FreeImage_GetHeight(src), filter, FI_RESCALE_MULTITHREADED);
+
+	// multithreaded through the global setting
+	FreeImage_SetThreadCount(4);
+	FIBITMAP *dst2 = FreeImage_Rescale(src, dst_width, dst_height, filter);
+	FreeImage_SetThreadCount(-1);
+
+	if(ref && dst1 && dst2) {
+		bResult = isSameImage(ref, dst1) && isSameImage(ref, dst2);
+	}
+
+	if(ref) FreeImage_Unload(ref);
+	if(dst1) FreeImage_Unload(dst1);
+	if(dst2) FreeImage_Unload(dst2);
+
+	return bResult;
+}
+
+/**
+Create a 8-bit greyscale image filled with pseudo-random noise
+(the worst case for the rounding errors of separable filters)
+*/
+static FIBITMAP* createNoiseImage(unsigned width, unsigned height) {
+	FIBITMAP *dst = FreeImage_Allocate(width, height, 8);
+	if(!dst) {
+		return nullptr;
+	}
+	RGBQUAD *pal = FreeImage_GetPalette(dst);
+	for(int i = 0; i < 256; i++) {
+		pal[i].rgbRed = pal[i].rgbGreen = pal[i].rgbBlue = (uint8_t)i;
+	}
+	uint32_t seed = 12345;
+	for(unsigned y = 0; y < height; y++) {
+		uint8_t *bits = FreeImage_GetScanLine(dst, y);
+		for(unsigned x = 0; x < width; x++) {
+			seed = seed * 1103515245 + 12345;
+			bits[x] = (uint8_t)(seed >> 16);
+		}
+	}
+	return dst;
+}
+
+/**
+Check that 24- and 32-bit images (rescaled using fixed-point weights) are within
+one LSB of the corresponding greyscale image (rescaled using floating-point weights)
+*/
+static BOOL testRescaleFixedPoint(FIBITMAP *src8, FIBITMAP *src, int dst_width, int dst_height, FREE_IMAGE_FILTER filter) {
+	BOOL bResult = FALSE;
+
+	FIBITMAP *ref = FreeImage_Rescale(src8, dst_width, dst_height, filter);
+	FIBITMAP *dst = FreeImage_Rescale(src, dst_width, dst_height, filter);
+
+	if(ref && dst) {
+		const unsigned bytespp = FreeImage_GetLine(dst) / FreeImage_GetWidth(dst);
+		bResult = TRUE;
+		for(unsigned y = 0; y < FreeImage_GetHeight(dst); y++) {
+			const uint8_t *ref_bits = FreeImage_GetScanLine(ref, y);
+			const uint8_t *dst_bits = FreeImage_GetScanLine(dst, y);
+			for(unsigned x = 0; x < FreeImage_GetWidth(dst); x++) {
+				for(int c = 0; c < 3; c++) {
+					if(abs((int)dst_bits[c] - (int)ref_bits[x]) > 1) {
+						bResult = FALSE;
+					}
+				}
+				dst_bits += bytespp;
+			}
+		}
+	}
+
+	if(ref) FreeImage_Unload(ref);
+	if(dst) FreeImage_Unload(dst);
+
+	return bResult;
+}
+
+/**
+Source scanline callback reading the rows of a FIBITMAP
+*/
+static BOOL DLL_CALLCONV readBitmapScanline(void *data, unsigned row, uint8_t *bits) {
+	FIBITMAP *src = (FIBITMAP*)data;
+	if(row >= FreeImage_GetHeight(src)) {
+		return FALSE;
+	}
+	memcpy(bits, FreeImage_GetScanLine(src, row), FreeImage_GetLine(src));
+	return TRUE;
+}
+
+/**
+Check that streaming rescaling gives the same result as FreeImage_Rescale
+*/
+static BOOL testRescaleStreaming(FIBITMAP *src, int dst_width, int dst_height, FREE_IMAGE_FILTER filter) {
+	BOOL bResult = FALSE;
+
+	FIBITMAP *ref = FreeImage_Rescale(src, dst_width, dst_height, filter);
+	FIBITMAP *dst = FreeImage_AllocateT(FreeImage_GetImageType(src), dst_width, dst_height, FreeImage_GetBPP(src));
+
+	FIRESCALER *rescaler = FreeImage_OpenRescaler(FreeImage_GetImageType(src), FreeImage_GetBPP(src), 
+		FreeImage_GetWidth(src), FreeImage_GetHeight(src), dst_width, dst_height, filter, readBitmapScanline, src);
+
+	if(ref && dst && rescaler) {
+		bResult = TRUE;
+		for(int y = 0; y < dst_height; y++) {
+			bResult &= FreeImage_ReadRescaledScanline(rescaler, FreeImage_GetScanLine(dst, y));
+		}
+		// all scanlines were produced
+		bResult &= !FreeImage_ReadRescaledScanline(rescaler, FreeImage_GetScanLine(dst, 0));
+		if(bResult) {
+			if(FreeImage_GetBPP(src) == 8) {
+				// FreeImage_Rescale returns a greyscale palette
+				memcpy(FreeImage_GetPalette(dst), FreeImage_GetPalette(ref), 256 * sizeof(RGBQUAD));
+			}
+			bResult = isSameImage(ref, dst);
+		}
+	}
+
+	FreeImage_CloseRescaler(rescaler);
+	if(ref) FreeImage_Unload(ref);
+	if(dst) FreeImage_Unload(dst);
+
+	return bResult;
+}
+
+/**
+Check that rescaling with cached weights tables gives the same result as rescaling
+with freshly computed tables, before and after the tables are evicted from the cache
+(which holds at most 32 tables and 16 MB)
+*/
+static BOOL testRescaleWeightsCache(FIBITMAP *src, int dst_width, int dst_height, FREE_IMAGE_FILTER filter) {
+	BOOL bResult = FALSE;
+
+	// first use of the geometry : the tables are computed, then cached
+	FIBITMAP *ref = FreeImage_Rescale(src, dst_width, dst_height, filter);
+	// same geometry : the tables are found in the cache
+	FIBITMAP *hit = FreeImage_Rescale(src, dst_width, dst_height, filter);
+
+	FIBITMAP *thumb = FreeImage_Rescale(src, 16, 16, FILTER_BOX);
+	FIBITMAP *line = FreeImage_Rescale(src, 16, 1, FILTER_BOX);
+
+	if(ref && hit && thumb && line) {
+		bResult = isSameImage(ref, hit);
+
+		// evict by count : more distinct geometries than the cache holds
+		for(int i = 0; (i < 40) && bResult; i++) {
+			FIBITMAP *dst = FreeImage_Rescale(thumb, 17 + i, 9 + i, filter);
+			bResult = (dst != nullptr);
+			if(dst) FreeImage_Unload(dst);
+		}
+		// evict by size : a few very long tables
+		for(int i = 0; (i < 4) && bResult; i++) {
+			FIBITMAP *dst = FreeImage_Rescale(line, 200000 + i, 1, filter);
+			bResult = (dst != nullptr);
+			if(dst) FreeImage_Unload(dst);
+		}
+
+		// the tables are computed again
+		if(bResult) {
+			FIBITMAP *miss = FreeImage_Rescale(src, dst_width, dst_height, filter);
+			bResult = miss && isSameImage(ref, miss);
+			if(miss) FreeImage_Unload(miss);
+		}
+	}
+
+	if(ref) FreeImage_Unload(ref);
+	if(hit) FreeImage_Unload(hit);
+	if(thumb) FreeImage_Unload(thumb);
+	if(line) FreeImage_Unload(line);
+
+	return bResult;
+}
+
+static unsigned DLL_CALLCONV
+myReadProc(void *buffer, unsigned size, unsigned count, fi_handle handle) {
+	return (unsigned)fread(buffer, size, count, (FILE *)handle);
+}
+
+static unsigned DLL_CALLCONV
+myWriteProc(void *buffer, unsigned size, unsigned count, fi_handle handle) {
+	return (unsigned)fwrite(buffer, size, count, (FILE *)handle);
+}
+
+static int DLL_CALLCONV
+mySeekProc(fi_handle handle, long offset, int origin) {
+	return fseek((FILE *)handle, offset, origin);
+}
+
+static long DLL_CALLCONV
+myTellProc(fi_handle handle) {
+	return ftell((FILE *)handle);
+}
+
+/**
+Check that FreeImage_LoadScaled returns an image fitted into the bounding box
+*/
+static BOOL testLoadScaled(FREE_IMAGE_FORMAT fif, const char *filename, int max_width, int max_height, unsigned expected_width, unsigned expected_height) {
+	FreeImageIO io;
+
+	io.read_proc  = myReadProc;
+	io.write_proc = myWriteProc;
+	io.seek_proc  = mySeekProc;
+	io.tell_proc  = myTellProc;
+
+	FILE *file = fopen(filename, "rb");
+	if(!file) {
+		return FALSE;
+	}
+	FIBITMAP *dib = FreeImage_LoadScaled(fif, &io, (fi_handle)file, max_width, max_height, FILTER_CATMULLROM);
+	fclose(file);
+
+	BOOL bResult = dib && (FreeImage_GetWidth(dib) == expected_width) && (FreeImage_GetHeight(dib) == expected_height);
+
+	if(dib) FreeImage_Unload(dib);
+
+	return bResult;
+}
+
+/**
+Check that FreeImage_LoadScaled (which rescales the rows of a PNG file while they are decoded) is close to FreeImage_Rescale
+*/
+static BOOL testLoadScaledPNG(FIBITMAP *src, int flags) {
+	FreeImageIO io;
+
+	io.read_proc  = myReadProc;
+	io.write_proc = myWriteProc;
+	io.seek_proc  = mySeekProc;
+	io.tell_proc  = myTellProc;
+
+	if(!FreeImage_Save(FIF_PNG, src, "scanlines.png", flags)) {
+		return FALSE;
+	}
+	FIBITMAP *ref = FreeImage_Load(FIF_PNG, "scanlines.png", 0);
+	FILE *file = fopen("scanlines.png", "rb");
+	if(!ref || !file) {
+		if(ref) FreeImage_Unload(ref);
+		if(file) fclose(file);
+		return FALSE;
+	}
+
+	const int dst_width = (int)FreeImage_GetWidth(ref) / 3;
+	const int dst_height = (int)(FreeImage_GetHeight(ref) * (double)dst_width / FreeImage_GetWidth(ref) + 0.5);
+
+	FIBITMAP *dst = FreeImage_LoadScaled(FIF_PNG, &io, (fi_handle)file, dst_width, FreeImage_GetHeight(ref), FILTER_CATMULLROM);
+	FIBITMAP *expected = FreeImage_Rescale(ref, dst_width, dst_height, FILTER_CATMULLROM);
+
+	// rows are filtered in reverse order, which may round 8-bit greyscale values differently
+	BOOL bResult = dst && expected && isSimilarImage(dst, expected);
+
+	if(dst) FreeImage_Unload(dst);
+	if(expected) FreeImage_Unload(expected);
+	fclose(file);
+	FreeImage_Unload(ref);
+
+	return bResult;
+}
+
+// Main test function
+// ----------------------------------------------------------
+
+void testRescale(unsigned width, unsigned height) {
+	BOOL bResult = FALSE;
+
+	printf("testRescale ...\n");
+
+	// create a test 8-bit image
+	FIBITMAP *src8 = createZonePlateImage(width, height, 128);
+	assert(src8 != nullptr);
+
+	FIBITMAP *images[] = {
+		src8,
+		FreeImage_ConvertTo24Bits(src8),
+		FreeImage_ConvertTo32Bits(src8),
+		FreeImage_ConvertToType(src8, FIT_RGB16),
+		FreeImage_ConvertToType(src8, FIT_RGBF)
+	};
+	const int count = sizeof(images) / sizeof(images[0]);
+
+	for(int i = 0; i < count; i++) {
+		assert(images[i] != nullptr);
+
+		// downsampling (xy filtering) and upsampling (yx filtering)
+		bResult = testRescaleMultithreaded(images[i], width / 3, height / 2, FILTER_CATMULLROM);
+		assert(bResult);
+		bResult = testRescaleMultithreaded(images[i], width * 2, height + 7, FILTER_LANCZOS3);
+		assert(bResult);
+	}
+
+	// streaming rescaling
+	for(int i = 0; i < count; i++) {
+		bResult = testRescaleStreaming(images[i], width / 3, height / 2, FILTER_CATMULLROM);
+		assert(bResult);
+		bResult = testRescaleStreaming(images[i], width * 2, height + 7, FILTER_LANCZOS3);
+		assert(bResult);
+		bResult = testRescaleStreaming(images[i], width, height / 5, FILTER_BSPLINE);
+		assert(bResult);
+		bResult = testRescaleStreaming(images[i], width + 3, height, FILTER_BILINEAR);
+		assert(bResult);
+	}
+
+	// weights tables cache hits and evictions
+	for(int i = 0; i < count; i++) {
+		bResult = testRescaleWeightsCache(images[i], width - 5, height + 3, FILTER_BSPLINE);
+		assert(bResult);
+	}
+
+	// 8-bit RGB(A) images are rescaled using fixed-point weights
+	for(int i = 1; i <= 2; i++) {
+		bResult = testRescaleFixedPoint(src8, images[i], width / 3, height / 2, FILTER_CATMULLROM);
+		assert(bResult);
+		bResult = testRescaleFixedPoint(src8, images[i], width * 2, height + 7, FILTER_LANCZOS3);
+		assert(bResult);
+		bResult = testRescaleFixedPoint(src8, images[i], width / 7, height / 5, FILTER_BOX);
+		assert(bResult);
+	}
+	FIBITMAP *noise8 = createNoiseImage(width, height);
+	assert(noise8 != nullptr);
+	FIBITMAP *noise[] = { FreeImage_ConvertTo24Bits(noise8), FreeImage_ConvertTo32Bits(noise8) };
+	for(int i = 0; i < 2; i++) {
+		assert(noise[i] != nullptr);
+		bResult = testRescaleFixedPoint(noise8, noise[i], width / 3, height / 2, FILTER_CATMULLROM);
+		assert(bResult);
+		bResult = testRescaleFixedPoint(noise8, noise[i], width * 2, height + 7, FILTER_LANCZOS3);
+		assert(bResult);
+		bResult = testRescaleFixedPoint(noise8, noise[i], width + 13, height / 3, FILTER_BICUBIC);
+		assert(bResult);
+		FreeImage_Unload(noise[i]);
+	}
+	FreeImage_Unload(noise8);
+
+	// loading at a reduced size (with and without a decoder size hint)
+	const FREE_IMAGE_FORMAT formats[] = { FIF_JPEG, FIF_PNG };
+	const char *filenames[] = { "zoneplate_scaled.jpg", "zoneplate_scaled.png" };
+	for(int i = 0; i < 2; i++) {
+		if(FreeImage_Save(formats[i], images[1], filenames[i], 0)) {
+			bResult = testLoadScaled(formats[i], filenames[i], width / 4, height, width / 4, (unsigned)(height * (double)(width / 4) / width + 0.5));
+			assert(bResult);
+			bResult = testLoadScaled(formats[i], filenames[i], width * 2, height / 3, (unsigned)(width * (double)(height / 3) / height + 0.5), height / 3);
+			assert(bResult);
+			bResult = testLoadScaled(formats[i], filenames[i], width * 2, height * 2, width, height);
+			assert(bResult);
+		}
+	}
+
+	// loading PNG files at a reduced size (non-interlaced and Adam7 interlaced rows)
+	for(int i = 0; i < 4; i++) {
+		bResult = testLoadScaledPNG(images[i], PNG_DEFAULT);
+		assert(bResult);
+		bResult = testLoadScaledPNG(images[i], PNG_INTERLACED);
+		assert(bResult);
+	}
+
+	for(int i = 0; i < count; i++) {
+		FreeImage_Unload(images[i]);
+	}
+}
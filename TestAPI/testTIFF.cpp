@@ -0,0 +1,185 @@
+// ==========================================================
+// FreeImage 3 Test Script
+//
+// This file is part of FreeImage 3
+//
+// COVERED CODE IS PROVIDED UNDER THIS LICENSE ON AN "AS IS" BASIS, WITHOUT WARRANTY
+// OF ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING, WITHOUT LIMITATION, WARRANTIES
+// THAT THE COVERED CODE IS FREE OF DEFECTS, MERCHANTABLE, FIT FOR A PARTICULAR PURPOSE
+// OR NON-INFRINGING. THE ENTIRE RISK AS TO THE QUALITY AND PERFORMANCE OF THE COVERED
+// CODE IS WITH YOU. SHOULD ANY COVERED CODE PROVE DEFECTIVE IN ANY RESPECT, YOU (NOT
+// THE INITIAL DEVELOPER OR ANY OTHER CONTRIBUTOR) ASSUME THE COST OF ANY NECESSARY
+// SERVICING, REPAIR OR CORRECTION. THIS DISCLAIMER OF WARRANTY CONSTITUTES AN ESSENTIAL
+// PART OF THIS LICENSE. NO USE OF ANY COVERED CODE IS AUTHORIZED HEREUNDER EXCEPT UNDER
+// THIS DISCLAIMER.
+//
+// Use at your own risk!
+// ==========================================================
+
+#include "TestSuite.h"
+
+// Local test functions
+// ----------------------------------------------------------
+
+static unsigned DLL_CALLCONV
+myReadProc(void *buffer, unsigned size, unsigned count, fi_handle handle) {
+	return (unsigned)fread(buffer, size, count, (FILE *)handle);
+}
+
+static unsigned DLL_CALLCONV
+myWriteProc(void *buffer, unsigned size, unsigned count, fi_handle handle) {
+	return (unsigned)fwrite(buffer, size, count, (FILE *)handle);
+}
+
+static int DLL_CALLCONV
+mySeekProc(fi_handle handle, long offset, int origin) {
+	return fseek((FILE *)handle, offset, origin);
+}
+
+static long DLL_CALLCONV
+myTellProc(fi_handle handle) {
+	return ftell((FILE *)handle);
+}
+
+/**
+Check that FreeImage_LoadRegion gives the same result as a full load followed by FreeImage_Copy
+*/
+static BOOL testLoadRegionTIFF(FIBITMAP *src, int flags, int left, int top, int right, int bottom) {
+	BOOL bResult = FALSE;
+
+	FreeImageIO io;
+
+	io.read_proc  = myReadProc;
+	io.write_proc = myWriteProc;
+	io.seek_proc  = mySeekProc;
+	io.tell_proc  = myTellProc;
+
+	if(!FreeImage_Save(FIF_TIFF, src, "region.tif", flags)) {
+		return FALSE;
+	}
+
+	FIBITMAP *full = FreeImage_Load(FIF_TIFF, "region.tif", 0);
+	FIBITMAP *ref = full ? FreeImage_Copy(full, left, top, right, bottom) : nullptr;
+
+	FIBITMAP *dst = nullptr;
+	FILE *file = fopen("region.tif", "rb");
+	if(file) {
+		dst = FreeImage_LoadRegion(FIF_TIFF, &io, (fi_handle)file, -1, left, top, right, bottom, 0);
+		fclose(file);
+	}
+
+	if(ref && dst) {
+		bResult = isSameImage(ref, dst);
+	}
+
+	if(full) FreeImage_Unload(full);
+	if(ref) FreeImage_Unload(ref);
+	if(dst) FreeImage_Unload(dst);
+
+	return bResult;
+}
+
+/**
+Check that multithreaded TIFF encoding and decoding give the same result as single-threaded encoding and decoding
+*/
+static BOOL testMultithreadedTIFF(FIBITMAP *src, int flags) {
+	BOOL bResult = FALSE;
+
+	// single-threaded reference
+	FreeImage_SetThreadCount(1);
+	if(!FreeImage_Save(FIF_TIFF, src, "multithreaded.tif", flags)) {
+		return FALSE;
+	}
+	FIBITMAP *ref = FreeImage_Load(FIF_TIFF, "multithreaded.tif", 0);
+
+	// multithreaded
+	FreeImage_SetThreadCount(4);
+	FIBITMAP *dst = nullptr;
+	if(FreeImage_Save(FIF_TIFF, src, "multithreaded.tif", flags | TIFF_MULTITHREADED)) {
+		dst = FreeImage_Load(FIF_TIFF, "multithreaded.tif", TIFF_MULTITHREADED);
+	}
+	FreeImage_SetThreadCount(-1);
+
+	if(ref && dst) {
+		bResult = isSameImage(ref, dst);
+	}
+
+	if(ref) FreeImage_Unload(ref);
+	if(dst) FreeImage_Unload(dst);
+
+	return bResult;
+}
+
+/**
+Check that a tiled TIFF (with or without reduced-resolution levels) is reloaded unchanged
+*/
+static BOOL testSaveTiledTIFF(FIBITMAP *src, int flags) {
+	BOOL bResult = FALSE;
+
+	if(!FreeImage_Save(FIF_TIFF, src, "tiled.tif", flags)) {
+		return FALSE;
+	}
+
+	FIBITMAP *dst = FreeImage_Load(FIF_TIFF, "tiled.tif", 0);
+	if(dst) {
+		bResult = isSameImage(src, dst);
+
+		if((flags & TIFF_PYRAMID) == TIFF_PYRAMID) {
+			// the smallest level is loaded as a thumbnail
+			FIBITMAP *thumbnail = FreeImage_GetThumbnail(dst);
+			bResult &= (thumbnail != nullptr) && (FreeImage_GetWidth(thumbnail) <= 256) && (FreeImage_GetHeight(thumbnail) <= 256);
+		}
+
+		FreeImage_Unload(dst);
+	}
+
+	return bResult;
+}
+
+// Main test functions
+// ----------------------------------------------------------
+
+void testTIFF(unsigned width, unsigned height) {
+	BOOL bResult = FALSE;
+
+	printf("testTIFF ...\n");
+
+	// create a test 8-bit image
+	FIBITMAP *src = createZonePlateImage(width, height, 128);
+	assert(src != nullptr);
+	FIBITMAP *src24 = FreeImage_ConvertTo24Bits(src);
+	assert(src24 != nullptr);
+
+	// region loading
+	// -------------------------
+
+	bResult = testLoadRegionTIFF(src, TIFF_LZW, 10, 20, width / 2, height - 3);
+	assert(bResult);
+	bResult = testLoadRegionTIFF(src24, TIFF_NONE, 1, 1, width - 1, 2);
+	assert(bResult);
+	bResult = testLoadRegionTIFF(src24, TIFF_DEFLATE, width / 3, height / 3, width, height);
+	assert(bResult);
+
+	// multithreaded loading / saving
+	// -------------------------
+
+	bResult = testMultithreadedTIFF(src, TIFF_LZW);
+	assert(bResult);
+	bResult = testMultithreadedTIFF(src24, TIFF_DEFLATE);
+	assert(bResult);
+	bResult = testMultithreadedTIFF(src24, TIFF_JPEG);
+	assert(bResult);
+
+	// tiled images
+	// -------------------------
+
+	bResult = testSaveTiledTIFF(src, TIFF_TILED | TIFF_LZW);
+	assert(bResult);
+	bResult = testSaveTiledTIFF(src24, TIFF_PYRAMID | TIFF_DEFLATE);
+	assert(bResult);
+	bResult = testSaveTiledTIFF(src24, TIFF_PYRAMID | TIFF_DEFLATE | TIFF_MULTITHREADED);
+	assert(bResult);
+
+	FreeImage_Unload(src24);
+	FreeImage_Unload(src);
+}